@@ -0,0 +1,33 @@
+#version 450
+
+// Last step up the bloom chain, a tent of the first level straight onto the scene (blended additively)
+
+layout(binding = 0) uniform sampler2D bloom;
+
+layout( push_constant ) uniform constants {
+    vec2 sourceTexel;
+    ivec2 targetSize;
+    float threshold;
+    float knee;
+    float intensity;
+    float radius;
+    uint brightPass;
+} push;
+
+// IN
+layout(location = 0) in vec2 inUV;
+
+// OUT
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec2 d = push.sourceTexel * push.radius;
+
+    vec3 color = texture(bloom, inUV).rgb * 4.0;
+    color += (texture(bloom, inUV + vec2(-d.x, 0.0)).rgb + texture(bloom, inUV + vec2(d.x, 0.0)).rgb +
+              texture(bloom, inUV + vec2(0.0, -d.y)).rgb + texture(bloom, inUV + vec2(0.0, d.y)).rgb) * 2.0;
+    color += texture(bloom, inUV + vec2(-d.x, -d.y)).rgb + texture(bloom, inUV + vec2(d.x, -d.y)).rgb +
+             texture(bloom, inUV + vec2(-d.x, d.y)).rgb + texture(bloom, inUV + vec2(d.x, d.y)).rgb;
+
+    outColor = vec4(color / 16.0 * push.intensity, 0.0);
+}
@@ -0,0 +1,11 @@
+#version 450
+
+// --- IN --- //
+layout(location = 0) in vec4 inFragColor;
+
+// --- OUT--- //
+layout(location = 0) out vec4 outFragColor;
+
+void main() {
+    outFragColor = inFragColor;
+}
@@ -0,0 +1,18 @@
+#version 450
+
+layout(std140, binding = 0) uniform UniformBufferObjectVert {
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+// IN
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec4 inColor; // RGBA8 unpacked by the vertex fetch
+
+// OUT
+layout(location = 0) out vec4 outFragColor;
+
+void main() {
+    gl_Position = ubo.proj * ubo.view * vec4(inPosition, 1.0);
+    outFragColor = inColor;
+}
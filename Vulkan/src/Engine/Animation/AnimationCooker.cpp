@@ -0,0 +1,179 @@
+#include "AnimationCooker.h"
+
+#include <chrono>
+#include <iostream>
+#include <utility>
+
+#include <ozz/animation/offline/animation_builder.h>
+#include <ozz/animation/offline/animation_optimizer.h>
+#include <ozz/animation/offline/skeleton_builder.h>
+#include <ozz/animation/runtime/animation.h>
+#include <ozz/animation/runtime/skeleton.h>
+#include <ozz/base/io/archive.h>
+#include <ozz/base/io/stream.h>
+#include <ozz/base/memory/unique_ptr.h>
+
+#include "Engine/Graphics/Objects/Skeleton.h"
+
+#ifdef MEGA_FBX_IMPORT
+#include <ozz/animation/offline/fbx/fbx.h>
+#include <ozz/animation/offline/fbx/fbx_animation.h>
+#include <ozz/animation/offline/fbx/fbx_skeleton.h>
+#include <ozz/animation/offline/tools/import2ozz.h>
+#endif
+
+namespace Mega
+{
+	// Same layout Skeleton.cpp's LoadArchive reads, an ozz tag followed by the object
+	template<typename T>
+	static bool SaveArchive(const char* in_filePath, const char* in_kind, const T& in_object, size_t* out_pBytes)
+	{
+		ozz::io::File file(in_filePath, "wb");
+		if (!file.opened()) {
+			std::cout << "ERROR: Could not write " << in_kind << " file " << in_filePath << std::endl;
+			return false;
+		}
+
+		ozz::io::OArchive archive(&file);
+		archive << in_object;
+
+		if (out_pBytes != nullptr) { *out_pBytes = (size_t)file.Tell(); }
+		return true;
+	}
+
+	bool CookSkeleton(const ozz::animation::offline::RawSkeleton& in_raw, const char* in_filePath, Skeleton* out_pSkeleton)
+	{
+		if (!in_raw.Validate()) {
+			std::cout << "ERROR: Skeleton for " << in_filePath << " is invalid (too many joints?)" << std::endl;
+			return false;
+		}
+
+		ozz::animation::offline::SkeletonBuilder builder;
+		ozz::unique_ptr<ozz::animation::Skeleton> pSkeleton = builder(in_raw);
+		if (!pSkeleton) {
+			std::cout << "ERROR: Could not build skeleton for " << in_filePath << std::endl;
+			return false;
+		}
+
+		if (!SaveArchive(in_filePath, "skeleton", *pSkeleton, nullptr)) { return false; }
+
+		out_pSkeleton->Set(std::move(*pSkeleton));
+		return true;
+	}
+
+	bool CookClip(const ozz::animation::offline::RawAnimation& in_raw, const Skeleton& in_skeleton, const char* in_filePath,
+		const ConstructInfoAnimationCook* in_pInfo, AnimationCookReport* out_pReport)
+	{
+		ConstructInfoAnimationCook defaultInfo;
+		if (in_pInfo == nullptr) { in_pInfo = &defaultInfo; }
+
+		if (!in_raw.Validate() || in_raw.num_tracks() != (int)in_skeleton.GetJointCount()) {
+			std::cout << "ERROR: Clip " << in_raw.name.c_str() << " is invalid or doesn't match its skeleton" << std::endl;
+			return false;
+		}
+
+		// The optimizer measures error down the whole joint chain, so tolerances hold at the fingertips
+		ozz::animation::offline::RawAnimation optimized;
+		const ozz::animation::offline::RawAnimation* pRaw = &in_raw;
+		if (in_pInfo->optimize) {
+			ozz::animation::offline::AnimationOptimizer optimizer;
+			optimizer.setting.tolerance = in_pInfo->tolerance;
+			optimizer.setting.distance = in_pInfo->distance;
+			if (!optimizer(in_raw, in_skeleton.GetRaw(), &optimized)) {
+				std::cout << "ERROR: Could not optimize clip " << in_raw.name.c_str() << std::endl;
+				return false;
+			}
+			pRaw = &optimized;
+		}
+
+		ozz::animation::offline::AnimationBuilder builder;
+		ozz::unique_ptr<ozz::animation::Animation> pAnimation = builder(*pRaw);
+		if (!pAnimation) {
+			std::cout << "ERROR: Could not build clip " << in_raw.name.c_str() << std::endl;
+			return false;
+		}
+
+		out_pReport->name = in_raw.name.c_str();
+		out_pReport->duration = in_raw.duration;
+		out_pReport->rawBytes = in_raw.size();
+		if (!SaveArchive(in_filePath, "animation", *pAnimation, &out_pReport->cookedBytes)) { return false; }
+
+		// Timed exactly the way the game loads it
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		AnimationClip clip;
+		bool loaded = clip.Load(in_filePath);
+		out_pReport->loadMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		return loaded;
+	}
+
+#ifdef MEGA_FBX_IMPORT
+	// Take names often have characters a file name can't ("Armature|Walk")
+	static std::string ClipFileName(const char* in_name)
+	{
+		std::string out_name = in_name;
+		for (char& c : out_name) {
+			if (c == '|' || c == ':' || c == '/' || c == '\\' || c == '*' || c == '?' || c == '"' || c == '<' || c == '>') { c = '_'; }
+		}
+		return out_name.empty() ? "clip" : out_name;
+	}
+#endif
+
+	bool CookAnimations(const ConstructInfoAnimationCook* in_pInfo)
+	{
+#ifdef MEGA_FBX_IMPORT
+		namespace offline = ozz::animation::offline;
+
+		offline::fbx::FbxManagerInstance manager;
+		offline::fbx::FbxAnimationIOSettings settings(manager);
+		offline::fbx::FbxSceneLoader loader(in_pInfo->sourcePath, "", manager, settings);
+		if (loader.scene() == nullptr) {
+			std::cout << "ERROR: Could not import " << in_pInfo->sourcePath << std::endl;
+			return false;
+		}
+
+		// Only real skeleton nodes become joints, meshes and helpers in the scene are left out
+		offline::OzzImporter::NodeType types = {};
+		types.skeleton = true;
+
+		offline::RawSkeleton rawSkeleton;
+		if (!offline::fbx::ExtractSkeleton(loader, types, &rawSkeleton)) {
+			std::cout << "ERROR: " << in_pInfo->sourcePath << " has no skeleton" << std::endl;
+			return false;
+		}
+
+		const std::string outputDir = std::string(in_pInfo->outputDir) + "/";
+		Skeleton skeleton;
+		if (!CookSkeleton(rawSkeleton, (outputDir + ANIMATION_COOK_SKELETON_FILE).c_str(), &skeleton)) { return false; }
+		std::cout << "Cooked skeleton: " << skeleton.GetJointCount() << " joints" << std::endl;
+
+		offline::OzzImporter::AnimationNames names = offline::fbx::GetAnimationNames(loader);
+		uint32_t cookedCount = 0;
+		size_t rawTotal = 0, cookedTotal = 0;
+		for (const ozz::string& name : names) {
+			offline::RawAnimation rawAnimation;
+			if (!offline::fbx::ExtractAnimation(name.c_str(), loader, skeleton.GetRaw(), in_pInfo->samplingRate, &rawAnimation)) {
+				std::cout << "WARNING: Could not import take " << name.c_str() << ", skipped" << std::endl;
+				continue;
+			}
+			rawAnimation.name = name;
+
+			std::string clipPath = outputDir + ClipFileName(name.c_str()) + ANIMATION_COOK_CLIP_EXT;
+			AnimationCookReport report;
+			if (!CookClip(rawAnimation, skeleton, clipPath.c_str(), in_pInfo, &report)) { continue; }
+
+			std::cout << "Cooked clip " << report.name << ": " << report.duration << "s, " << report.rawBytes << " -> " << report.cookedBytes << " bytes ("
+				<< report.GetCompressionRatio() << ":1), loads in " << report.loadMilliseconds << "ms" << std::endl;
+			rawTotal += report.rawBytes;
+			cookedTotal += report.cookedBytes;
+			cookedCount++;
+		}
+
+		std::cout << "Cooked " << cookedCount << " of " << names.size() << " clips from " << in_pInfo->sourcePath << ", " << rawTotal << " -> " << cookedTotal << " bytes" << std::endl;
+		return cookedCount > 0 || names.empty();
+#else
+		std::cout << "ERROR: Can't cook " << in_pInfo->sourcePath << ", this build has no FBX importer (define MEGA_FBX_IMPORT and link ozz_animation_fbx)" << std::endl;
+		return false;
+#endif
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <ozz/animation/offline/raw_animation.h>
+#include <ozz/animation/offline/raw_skeleton.h>
+
+#define ANIMATION_COOK_TOLERANCE     1e-3f // Error allowed over a whole joint chain, in meters (ozz's default, 1mm)
+#define ANIMATION_COOK_DISTANCE      1e-1f // How far from a joint its error is measured, stands in for the skin around it
+#define ANIMATION_COOK_SKELETON_FILE "skeleton.ozz"
+#define ANIMATION_COOK_CLIP_EXT      ".ozz"
+
+namespace Mega
+{
+	class Skeleton;
+
+	struct ConstructInfoAnimationCook {
+		const char* sourcePath = nullptr; // FBX with the skeleton and every clip as a take
+		const char* outputDir = nullptr;  // Gets ANIMATION_COOK_SKELETON_FILE and one archive per take
+		float tolerance = ANIMATION_COOK_TOLERANCE;
+		float distance = ANIMATION_COOK_DISTANCE;
+		float samplingRate = 0.0f; // Keys per second taken from the source, 0 = the source's frame rate
+		bool optimize = true;      // Off keeps every sampled key, to compare against
+	};
+
+	// What cooking one clip bought
+	struct AnimationCookReport {
+		std::string name;
+		float duration = 0.0f;
+		size_t rawBytes = 0;           // Every sampled key, uncompressed
+		size_t cookedBytes = 0;        // The archive on disk
+		float loadMilliseconds = 0.0f; // Reading the archive back the way the game does
+		float GetCompressionRatio() const { return cookedBytes > 0 ? rawBytes / (float)cookedBytes : 0.0f; }
+	};
+
+	// Offline, headless. Imports the skeleton and every take from in_pInfo->sourcePath, drops the keys
+	// ozz's AnimationOptimizer can rebuild within the tolerances, and writes ozz binary archives that
+	// Skeleton::Load and AnimationClip::Load read back without any parsing. Prints every clip's
+	// compression ratio and load time. False when the skeleton or every clip failed
+	bool CookAnimations(const ConstructInfoAnimationCook* in_pInfo);
+
+	// The steps CookAnimations runs, for raw data from anywhere else (other importers, built in code).
+	// out_pSkeleton gets the built skeleton so clips can be cooked against it right away
+	bool CookSkeleton(const ozz::animation::offline::RawSkeleton& in_raw, const char* in_filePath, Skeleton* out_pSkeleton);
+	bool CookClip(const ozz::animation::offline::RawAnimation& in_raw, const Skeleton& in_skeleton, const char* in_filePath,
+		const ConstructInfoAnimationCook* in_pInfo, AnimationCookReport* out_pReport);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+#define ANIMATION_INVALID_INDEX UINT32_MAX
+
+namespace Mega
+{
+	// Stable reference to an animated character, works like RigidBodyHandle
+	struct AnimationHandle {
+		uint32_t index = ANIMATION_INVALID_INDEX;
+		uint32_t generation = 0;
+
+		bool IsValid() const { return index != ANIMATION_INVALID_INDEX; }
+		bool operator==(const AnimationHandle& in_other) const { return index == in_other.index && generation == in_other.generation; }
+		bool operator!=(const AnimationHandle& in_other) const { return !(*this == in_other); }
+	};
+}
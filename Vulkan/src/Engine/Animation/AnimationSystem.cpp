@@ -0,0 +1,416 @@
+#include "AnimationSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <ozz/animation/runtime/blending_job.h>
+#include <ozz/animation/runtime/local_to_model_job.h>
+#include <ozz/base/maths/simd_math.h>
+#include <ozz/base/maths/soa_float4x4.h>
+#include <ozz/base/span.h>
+
+#include "Engine/Core/Debug.h"
+#include "Engine/Core/ThreadPool.h"
+
+// LocalToModelJob writes into the palette directly, so a glm matrix has to be laid out like ozz's
+static_assert(sizeof(Mega::Mat4x4F) == sizeof(ozz::math::Float4x4), "Palette matrices have to match ozz::math::Float4x4");
+
+namespace Mega
+{
+	// LocalToModelJob with masked joints skipped, each just takes its parent's matrix. SoA groups with
+	// nothing but masked joints aren't even converted
+	static void LocalToModelMasked(const ozz::animation::Skeleton& in_skeleton, const ozz::span<const ozz::math::SoaTransform>& in_locals,
+		const uint8_t* in_pMask, ozz::math::Float4x4* out_pModels)
+	{
+		const ozz::span<const int16_t> parents = in_skeleton.joint_parents();
+		const ozz::math::Float4x4 identity = ozz::math::Float4x4::identity();
+		const int32_t jointCount = in_skeleton.num_joints();
+
+		for (int32_t begin = 0; begin < jointCount; begin += 4) {
+			const int32_t end = std::min(begin + 4, jointCount);
+
+			bool anyUnmasked = false;
+			for (int32_t joint = begin; joint < end; joint++) { anyUnmasked |= in_pMask[joint] == 0; }
+
+			ozz::math::Float4x4 locals[4];
+			if (anyUnmasked) {
+				const ozz::math::SoaTransform& transform = in_locals[begin / 4];
+				const ozz::math::SoaFloat4x4 soaMatrices = ozz::math::SoaFloat4x4::FromAffine(transform.translation, transform.rotation, transform.scale);
+				ozz::math::Transpose16x16(&soaMatrices.cols[0].x, locals->cols);
+			}
+
+			for (int32_t joint = begin; joint < end; joint++) {
+				const int16_t parent = parents[joint];
+				const ozz::math::Float4x4& parentMatrix = parent == ozz::animation::Skeleton::kNoParent ? identity : out_pModels[parent];
+				out_pModels[joint] = in_pMask[joint] ? parentMatrix : parentMatrix * locals[joint & 3];
+			}
+		}
+	}
+
+	void AnimationSystem::Initialize(ThreadPool* in_pThreadPool)
+	{
+		m_pThreadPool = in_pThreadPool;
+
+		uint32_t slotCount = m_pThreadPool != nullptr ? m_pThreadPool->GetThreadSlotCount() : 1;
+		m_contexts.resize(slotCount);
+		for (std::unique_ptr<ozz::animation::SamplingJob::Context>& pContext : m_contexts) {
+			pContext = std::make_unique<ozz::animation::SamplingJob::Context>();
+		}
+	}
+
+	void AnimationSystem::Destroy()
+	{
+		m_characters.clear();
+		m_freeList.clear();
+		m_contexts.clear();
+		m_liveCount = 0;
+		m_jointCount = 0;
+		m_contextTracks = 0;
+		m_pThreadPool = nullptr;
+	}
+
+	AnimationHandle AnimationSystem::Create(const ConstructInfoAnimatedCharacter* in_pInfo)
+	{
+		MEGA_ASSERT(in_pInfo != nullptr && in_pInfo->pSkeleton != nullptr, "Animated character needs a skeleton");
+
+		AnimationHandle handle;
+		if (!m_freeList.empty()) {
+			handle.index = m_freeList.back();
+			m_freeList.pop_back();
+		}
+		else {
+			handle.index = (uint32_t)m_characters.size();
+			m_characters.emplace_back();
+		}
+
+		Character& character = m_characters[handle.index];
+		handle.generation = character.generation;
+
+		MEGA_ASSERT((in_pInfo->pInverseBindPoses == nullptr || in_pInfo->pInverseBindPoses->size() == in_pInfo->pSkeleton->GetJointCount()),
+			"Skinned mesh needs one inverse bind pose per skeleton joint");
+		character.pSkeleton = in_pInfo->pSkeleton;
+		character.pInverseBindPoses = in_pInfo->pInverseBindPoses;
+		character.alive = true;
+		character.layerCount = 1;
+		character.boundsRadius = 0.0f;
+		character.lod = eAnimationLod::Full;
+		character.samplesValid = false;
+		character.paletteOffset = ANIMATION_INVALID_INDEX;
+		for (uint32_t i = 0; i < ANIMATION_MAX_LAYERS; i++) { character.layers[i] = AnimationLayer(); }
+
+		// Allocated once here so Evaluate never allocates
+		const uint32_t soaJoints = character.pSkeleton->GetSoaJointCount();
+		for (uint32_t i = 0; i < ANIMATION_MAX_LAYERS; i++) { character.locals[i].resize(soaJoints); }
+		character.blended.resize(soaJoints);
+
+		// Contexts are resized here rather than in Evaluate, where other threads could be using them
+		const uint32_t tracks = character.pSkeleton->GetJointCount();
+		if (tracks > m_contextTracks) {
+			m_contextTracks = tracks;
+			for (std::unique_ptr<ozz::animation::SamplingJob::Context>& pContext : m_contexts) { pContext->Resize((int)tracks); }
+		}
+
+		m_liveCount++;
+		return handle;
+	}
+
+	void AnimationSystem::Release(const AnimationHandle in_handle)
+	{
+		Character* pCharacter = Get(in_handle);
+		MEGA_ASSERT(pCharacter != nullptr, "Releasing a stale or invalid animation handle");
+		if (pCharacter == nullptr) { return; }
+
+		pCharacter->alive = false;
+		pCharacter->pSkeleton = nullptr;
+		pCharacter->pInverseBindPoses = nullptr;
+		pCharacter->generation++;
+
+		m_freeList.push_back(in_handle.index);
+		m_liveCount--;
+	}
+
+	bool AnimationSystem::IsAlive(const AnimationHandle in_handle) const
+	{
+		return Get(in_handle) != nullptr;
+	}
+
+	AnimationSystem::Character* AnimationSystem::Get(const AnimationHandle in_handle)
+	{
+		if (in_handle.index >= m_characters.size()) { return nullptr; }
+		Character& character = m_characters[in_handle.index];
+		return character.alive && character.generation == in_handle.generation ? &character : nullptr;
+	}
+
+	const AnimationSystem::Character* AnimationSystem::Get(const AnimationHandle in_handle) const
+	{
+		if (in_handle.index >= m_characters.size()) { return nullptr; }
+		const Character& character = m_characters[in_handle.index];
+		return character.alive && character.generation == in_handle.generation ? &character : nullptr;
+	}
+
+	void AnimationSystem::SetLayerCount(const AnimationHandle in_handle, const uint32_t in_count)
+	{
+		MEGA_ASSERT(in_count <= ANIMATION_MAX_LAYERS, "Too many animation layers");
+		Character* pCharacter = Get(in_handle);
+		if (pCharacter == nullptr) { return; }
+
+		pCharacter->layerCount = in_count;
+	}
+
+	void AnimationSystem::SetLayer(const AnimationHandle in_handle, const uint32_t in_layer, const AnimationLayer& in_state)
+	{
+		MEGA_ASSERT(in_layer < ANIMATION_MAX_LAYERS, "Animation layer out of range");
+		Character* pCharacter = Get(in_handle);
+		if (pCharacter == nullptr) { return; }
+
+		MEGA_ASSERT((in_state.pClip == nullptr || in_state.pClip->GetTrackCount() == pCharacter->pSkeleton->GetJointCount()),
+			"Animation clip was made for a different skeleton");
+		pCharacter->layers[in_layer] = in_state;
+		if (in_layer >= pCharacter->layerCount) { pCharacter->layerCount = in_layer + 1; }
+	}
+
+	AnimationLayer* AnimationSystem::GetLayer(const AnimationHandle in_handle, const uint32_t in_layer)
+	{
+		MEGA_ASSERT(in_layer < ANIMATION_MAX_LAYERS, "Animation layer out of range");
+		Character* pCharacter = Get(in_handle);
+		return pCharacter != nullptr ? &pCharacter->layers[in_layer] : nullptr;
+	}
+
+	bool AnimationSystem::IsPosed(const AnimationHandle in_handle) const
+	{
+		const Character* pCharacter = Get(in_handle);
+		return pCharacter != nullptr && pCharacter->paletteOffset != ANIMATION_INVALID_INDEX;
+	}
+
+	uint32_t AnimationSystem::GetPaletteOffset(const AnimationHandle in_handle) const
+	{
+		const Character* pCharacter = Get(in_handle);
+		MEGA_ASSERT(pCharacter != nullptr && pCharacter->paletteOffset != ANIMATION_INVALID_INDEX, "Stale handle or a character that hasn't been evaluated yet");
+		return pCharacter != nullptr ? pCharacter->paletteOffset : 0;
+	}
+
+	void AnimationSystem::SetBounds(const AnimationHandle in_handle, const Vec3F& in_center, const float in_radius)
+	{
+		Character* pCharacter = Get(in_handle);
+		if (pCharacter == nullptr) { return; }
+
+		pCharacter->boundsCenter = in_center;
+		pCharacter->boundsRadius = in_radius;
+	}
+
+	void AnimationSystem::SetLodView(const Vec3F& in_eye, const Frustum& in_frustum, const float in_pixelsPerUnit)
+	{
+		m_lodEye = in_eye;
+		m_lodFrustum = in_frustum;
+		m_lodPixelsPerUnit = in_pixelsPerUnit;
+	}
+
+	eAnimationLod AnimationSystem::SelectLod(const Character& in_character) const
+	{
+		if (!m_lodSettings.enabled || m_lodPixelsPerUnit <= 0.0f || in_character.boundsRadius <= 0.0f) { return eAnimationLod::Full; }
+		if (!m_lodFrustum.IntersectsSphere(in_character.boundsCenter, in_character.boundsRadius)) { return eAnimationLod::Frozen; }
+
+		const float distance = std::max(glm::length(in_character.boundsCenter - m_lodEye) - in_character.boundsRadius, 0.1f);
+		const float pixels = in_character.boundsRadius * 2.0f / distance * m_lodPixelsPerUnit;
+
+		// Dropping to a coarser level happens right at the threshold, getting back needs the margin
+		auto finerThan = [&](const eAnimationLod in_level, const float in_threshold) {
+			const bool wasCoarser = in_character.lod >= in_level && in_character.lod != eAnimationLod::Frozen;
+			return pixels >= in_threshold * (wasCoarser ? 1.0f + ANIMATION_LOD_HYSTERESIS : 1.0f);
+		};
+		if (finerThan(eAnimationLod::Throttled, m_lodSettings.throttledPixels)) { return eAnimationLod::Full; }
+		if (finerThan(eAnimationLod::Reduced, m_lodSettings.reducedPixels)) { return eAnimationLod::Throttled; }
+		return eAnimationLod::Reduced;
+	}
+
+	void AnimationSystem::Update(const float in_dt)
+	{
+		for (Character& character : m_characters) {
+			if (!character.alive) { continue; }
+
+			for (uint32_t i = 0; i < character.layerCount; i++) {
+				AnimationLayer& layer = character.layers[i];
+				if (layer.pClip == nullptr) { continue; }
+
+				const float duration = layer.pClip->GetDuration();
+				layer.time += in_dt * layer.speed;
+				if (layer.loop && duration > 0.0f) {
+					layer.time = std::fmod(layer.time, duration);
+					if (layer.time < 0.0f) { layer.time += duration; }
+				}
+				else {
+					layer.time = glm::clamp(layer.time, 0.0f, duration);
+				}
+			}
+		}
+	}
+
+	void AnimationSystem::Evaluate(std::vector<Mat4x4F>* out_pPalette)
+	{
+		// Every character's level and its joints' spot are picked up front so the jobs never touch the
+		// vector itself, or allocate
+		uint32_t jointCount = 0;
+		for (uint32_t& count : m_lodCounts) { count = 0; }
+		for (Character& character : m_characters) {
+			if (!character.alive) { continue; }
+
+			const eAnimationLod lod = SelectLod(character);
+			if (lod != character.lod) {
+				character.lod = lod;
+				character.samplesValid = false; // Blending across a level change would show a stale pose
+			}
+			m_lodCounts[(uint32_t)lod]++;
+
+			const uint32_t joints = character.pSkeleton->GetJointCount();
+			if (lod != eAnimationLod::Full && character.samples[0].size() != joints) {
+				character.samples[0].resize(joints);
+				character.samples[1].resize(joints);
+			}
+
+			character.paletteOffset = jointCount;
+			jointCount += joints;
+		}
+		m_jointCount = jointCount;
+
+		out_pPalette->resize(jointCount);
+		if (jointCount == 0) { return; }
+		MEGA_ASSERT(((uintptr_t)out_pPalette->data() & 15) == 0, "Bone palette has to be 16 byte aligned for ozz");
+
+		Mat4x4F* pPalette = out_pPalette->data();
+		auto evaluateRange = [&](const uint32_t in_begin, const uint32_t in_end) {
+			for (uint32_t i = in_begin; i < in_end; i++) {
+				Character& character = m_characters[i];
+				if (character.alive) { UpdateCharacter(character, i, pPalette + character.paletteOffset); }
+			}
+		};
+
+		const uint32_t characterCount = (uint32_t)m_characters.size();
+		if (m_pThreadPool != nullptr) { m_pThreadPool->ParallelFor(0, characterCount, ANIMATION_GRAIN_SIZE, evaluateRange); }
+		else { evaluateRange(0, characterCount); }
+	}
+
+	void AnimationSystem::UpdateCharacter(Character& io_character, const uint32_t in_index, Mat4x4F* out_pMatrices)
+	{
+		if (io_character.lod == eAnimationLod::Full) {
+			EvaluateCharacter(io_character, false, out_pMatrices);
+			return;
+		}
+
+		// Posed once as it leaves the view (the level change cleared the samples), then held so it is
+		// still standing there if something ends up drawing it
+		if (io_character.lod == eAnimationLod::Frozen) {
+			if (!io_character.samplesValid) {
+				EvaluateCharacter(io_character, false, io_character.samples[1].data());
+				io_character.samplesValid = true;
+			}
+			std::copy(io_character.samples[1].begin(), io_character.samples[1].end(), out_pMatrices);
+			return;
+		}
+
+		const bool reduced = io_character.lod == eAnimationLod::Reduced;
+		const uint32_t interval = std::max(reduced ? m_lodSettings.reducedInterval : m_lodSettings.throttledInterval, 1u);
+		const uint32_t jointCount = io_character.pSkeleton->GetJointCount();
+
+		if (!io_character.samplesValid) {
+			// Nothing to blend from yet. Both samples start the same, and the index staggers when each
+			// character samples next so a crowd's samples are spread over the interval
+			EvaluateCharacter(io_character, reduced, io_character.samples[1].data());
+			std::copy(io_character.samples[1].begin(), io_character.samples[1].end(), io_character.samples[0].begin());
+			io_character.samplesValid = true;
+			io_character.framesSinceSample = in_index % interval;
+		}
+		else if (++io_character.framesSinceSample >= interval) {
+			std::swap(io_character.samples[0], io_character.samples[1]);
+			EvaluateCharacter(io_character, reduced, io_character.samples[1].data());
+			io_character.framesSinceSample = 0;
+		}
+
+		// The pose trails the newest sample by one interval, which isn't visible at these sizes and keeps
+		// every frame in between a plain blend. Matrices are blended directly, rotations stay close enough
+		// to rigid over a few frames
+		const ozz::math::SimdFloat4 alpha = ozz::math::simd_float4::Load1(io_character.framesSinceSample / (float)interval);
+		const ozz::math::Float4x4* pOlder = (const ozz::math::Float4x4*)io_character.samples[0].data();
+		const ozz::math::Float4x4* pNewer = (const ozz::math::Float4x4*)io_character.samples[1].data();
+		ozz::math::Float4x4* pOut = (ozz::math::Float4x4*)out_pMatrices;
+		for (uint32_t joint = 0; joint < jointCount; joint++) {
+			for (uint32_t column = 0; column < 4; column++) {
+				pOut[joint].cols[column] = ozz::math::Lerp(pOlder[joint].cols[column], pNewer[joint].cols[column], alpha);
+			}
+		}
+	}
+
+	void AnimationSystem::EvaluateCharacter(Character& io_character, const bool in_maskLeaves, Mat4x4F* out_pMatrices)
+	{
+		const ozz::animation::Skeleton& skeleton = io_character.pSkeleton->GetRaw();
+		ozz::animation::SamplingJob::Context* pContext = m_contexts[ThreadPool::GetCurrentThreadIndex()].get();
+
+		// Sample every layer that has a clip
+		ozz::animation::BlendingJob::Layer blendLayers[ANIMATION_MAX_LAYERS];
+		uint32_t blendCount = 0;
+		for (uint32_t i = 0; i < io_character.layerCount; i++) {
+			const AnimationLayer& layer = io_character.layers[i];
+			if (layer.pClip == nullptr || layer.weight <= 0.0f) { continue; }
+
+			const float duration = layer.pClip->GetDuration();
+			ozz::animation::SamplingJob sampling;
+			sampling.animation = &layer.pClip->GetRaw();
+			sampling.context = pContext;
+			sampling.ratio = duration > 0.0f ? layer.time / duration : 0.0f;
+			sampling.output = ozz::make_span(io_character.locals[i]);
+			if (!sampling.Run()) { continue; }
+
+			blendLayers[blendCount].weight = layer.weight;
+			blendLayers[blendCount].transform = ozz::make_span(io_character.locals[i]);
+			blendCount++;
+		}
+
+		// Nothing playing is the rest pose, and one layer at full weight doesnt need blending at all
+		ozz::span<const ozz::math::SoaTransform> locals = skeleton.joint_rest_poses();
+		if (blendCount == 1 && blendLayers[0].weight >= 1.0f) {
+			locals = blendLayers[0].transform;
+		}
+		else if (blendCount > 0) {
+			ozz::animation::BlendingJob blending;
+			blending.threshold = ANIMATION_BLEND_THRESHOLD;
+			blending.layers = ozz::span<const ozz::animation::BlendingJob::Layer>(blendLayers, blendCount);
+			blending.rest_pose = skeleton.joint_rest_poses();
+			blending.output = ozz::make_span(io_character.blended);
+			if (blending.Run()) { locals = ozz::make_span(io_character.blended); }
+		}
+
+		ozz::math::Float4x4* pModels = (ozz::math::Float4x4*)out_pMatrices;
+		const uint8_t* pMask = in_maskLeaves ? io_character.pSkeleton->GetLeafMask().data() : nullptr;
+		if (pMask != nullptr) {
+			LocalToModelMasked(skeleton, locals, pMask, pModels);
+		}
+		else {
+			ozz::animation::LocalToModelJob localToModel;
+			localToModel.skeleton = &skeleton;
+			localToModel.input = locals;
+			localToModel.output = ozz::span<ozz::math::Float4x4>(pModels, skeleton.num_joints());
+			localToModel.Run();
+		}
+
+		// Skinning matrices, done here with ozz's SIMD math so the GPU only does one multiply per influence
+		if (io_character.pInverseBindPoses != nullptr) {
+			const Mat4x4F* pInverseBinds = io_character.pInverseBindPoses->data();
+			const ozz::span<const int16_t> parents = skeleton.joint_parents();
+			for (int32_t joint = 0; joint < skeleton.num_joints(); joint++) {
+				// A masked joint's vertices move rigidly with its parent, parents always come first
+				if (pMask != nullptr && pMask[joint]) {
+					pModels[joint] = pModels[parents[joint]];
+					continue;
+				}
+
+				const float* pBind = &pInverseBinds[joint][0][0];
+				const ozz::math::Float4x4 inverseBind = { {
+					ozz::math::simd_float4::LoadPtrU(pBind),
+					ozz::math::simd_float4::LoadPtrU(pBind + 4),
+					ozz::math::simd_float4::LoadPtrU(pBind + 8),
+					ozz::math::simd_float4::LoadPtrU(pBind + 12) } };
+				pModels[joint] = pModels[joint] * inverseBind;
+			}
+		}
+	}
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <ozz/animation/runtime/sampling_job.h>
+#include <ozz/base/containers/vector.h>
+#include <ozz/base/maths/soa_transform.h>
+
+#include "Engine/Core/Math/Math.h"
+#include "Engine/Animation/AnimationHandle.h"
+#include "Engine/Graphics/Objects/Skeleton.h"
+
+#define ANIMATION_MAX_LAYERS      uint32_t(4)
+#define ANIMATION_GRAIN_SIZE      uint32_t(4)  // Characters per job, one character is a few microseconds of sampling
+#define ANIMATION_BLEND_THRESHOLD 0.1f         // Layers weighing less than this in total fall back to the rest pose
+
+#define ANIMATION_LOD_THROTTLED_PIXELS   150.0f      // Characters shorter than this on screen are sampled every few frames
+#define ANIMATION_LOD_REDUCED_PIXELS     50.0f       // and below this less often still, with their leaf joints following their parents
+#define ANIMATION_LOD_THROTTLED_INTERVAL uint32_t(2) // Frames between samples
+#define ANIMATION_LOD_REDUCED_INTERVAL   uint32_t(4)
+#define ANIMATION_LOD_HYSTERESIS         0.15f       // A finer level needs this much more than its threshold, so characters don't flicker between two
+
+namespace Mega
+{
+	class ThreadPool;
+
+	// One clip playing on a character, every layer is sampled and then blended by weight
+	struct AnimationLayer {
+		const AnimationClip* pClip = nullptr;
+		float time = 0.0f;   // Seconds into the clip
+		float speed = 1.0f;  // Negative plays backwards
+		float weight = 1.0f;
+		bool loop = true;
+	};
+
+	// Cheapest last. Levels are picked every Evaluate from the bounds given with SetBounds
+	enum class eAnimationLod : uint8_t {
+		Full,      // Every joint sampled every frame
+		Throttled, // Sampled every few frames, the frames in between blend the last two samples
+		// Sampled even less often, leaf joints just follow their parents. Sampling still decodes every track
+		// (ozz samples whole clips), the leaves only skip local-to-model and their skinning matrices
+		Reduced,
+		Frozen,    // Outside the view, holds the pose it had when it left without evaluating again
+		Count
+	};
+
+	struct AnimationLodSettings {
+		bool enabled = true; // Off runs everything at Full
+		float throttledPixels = ANIMATION_LOD_THROTTLED_PIXELS;
+		float reducedPixels = ANIMATION_LOD_REDUCED_PIXELS;
+		uint32_t throttledInterval = ANIMATION_LOD_THROTTLED_INTERVAL;
+		uint32_t reducedInterval = ANIMATION_LOD_REDUCED_INTERVAL;
+	};
+
+	struct ConstructInfoAnimatedCharacter {
+		const Skeleton* pSkeleton = nullptr; // Has to outlive the character
+		// The skinned mesh's, one per joint. When set the palette holds skinning matrices (joint times
+		// inverse bind pose) instead of bare model space joints. Has to outlive the character too
+		const std::vector<Mat4x4F>* pInverseBindPoses = nullptr;
+	};
+
+	// Skeletal animation on ozz for every character in the scene. Evaluate runs one job per few
+	// characters: each samples its layers into SoA local transforms (SamplingJob), blends them
+	// (BlendingJob) and converts the result to model space (LocalToModelJob), writing the matrices
+	// straight into the bone palette that gets copied to the GPU. Sampling contexts (the keyframe
+	// cursors ozz keeps between samples) are per pool thread rather than per character, so memory
+	// doesnt grow with the character count. Far away characters drop to cheaper LOD levels and ones out of
+	// view just hold their last pose, so a mostly distant crowd costs next to nothing
+	class AnimationSystem {
+	public:
+		void Initialize(ThreadPool* in_pThreadPool);
+		void Destroy();
+
+		AnimationHandle Create(const ConstructInfoAnimatedCharacter* in_pInfo);
+		void Release(const AnimationHandle in_handle);
+		bool IsAlive(const AnimationHandle in_handle) const;
+
+		// Layers past the count are ignored, a character starts with one empty layer (the rest pose)
+		void SetLayerCount(const AnimationHandle in_handle, const uint32_t in_count);
+		void SetLayer(const AnimationHandle in_handle, const uint32_t in_layer, const AnimationLayer& in_state);
+		// nullptr for a stale handle, the layer can be changed in place between Evaluates
+		AnimationLayer* GetLayer(const AnimationHandle in_handle, const uint32_t in_layer);
+
+		// World space sphere around the character, the LOD is picked from how big it is on screen.
+		// Characters that never get bounds always run at Full
+		void SetBounds(const AnimationHandle in_handle, const Vec3F& in_center, const float in_radius);
+		// The camera LODs are picked for. in_pixelsPerUnit is the screen pixels one world unit covers at
+		// distance one
+		void SetLodView(const Vec3F& in_eye, const Frustum& in_frustum, const float in_pixelsPerUnit);
+		void SetLodSettings(const AnimationLodSettings& in_settings) { m_lodSettings = in_settings; }
+		const AnimationLodSettings& GetLodSettings() const { return m_lodSettings; }
+
+		// Moves every layer's time along, in_dt in seconds
+		void Update(const float in_dt);
+		// Model space joint matrices of every posed character, one after the other. Not thread safe, and
+		// characters can't be created or released while it runs
+		void Evaluate(std::vector<Mat4x4F>* out_pPalette);
+		// False when the handle is stale or the character was created after the last Evaluate
+		bool IsPosed(const AnimationHandle in_handle) const;
+		// Where the character's joints start in the palette the last Evaluate wrote
+		uint32_t GetPaletteOffset(const AnimationHandle in_handle) const;
+
+		uint32_t GetLiveCount() const { return m_liveCount; }
+		uint32_t GetJointCount() const { return m_jointCount; }
+		// Characters at in_lod in the last Evaluate
+		uint32_t GetLodCount(const eAnimationLod in_lod) const { return m_lodCounts[(uint32_t)in_lod]; }
+
+	private:
+		struct Character {
+			const Skeleton* pSkeleton = nullptr;
+			const std::vector<Mat4x4F>* pInverseBindPoses = nullptr;
+			uint32_t generation = 0;
+			bool alive = false;
+
+			AnimationLayer layers[ANIMATION_MAX_LAYERS];
+			uint32_t layerCount = 0;
+			uint32_t paletteOffset = ANIMATION_INVALID_INDEX; // Until its first Evaluate
+
+			Vec3F boundsCenter = Vec3F(0.0f);
+			float boundsRadius = 0.0f; // 0 = no bounds, always Full
+			eAnimationLod lod = eAnimationLod::Full;
+			// Every level but Full. The last two samples' palettes, older first, blended on the frames in
+			// between (Frozen holds the newer one). Allocated the first time the character slows down
+			std::vector<Mat4x4F> samples[2];
+			bool samplesValid = false;
+			uint32_t framesSinceSample = 0;
+
+			ozz::vector<ozz::math::SoaTransform> locals[ANIMATION_MAX_LAYERS]; // Sampled, one per layer
+			ozz::vector<ozz::math::SoaTransform> blended;
+		};
+
+		Character* Get(const AnimationHandle in_handle);
+		const Character* Get(const AnimationHandle in_handle) const;
+		eAnimationLod SelectLod(const Character& in_character) const;
+		// Runs the character's level, sampling or blending the last samples into out_pMatrices
+		void UpdateCharacter(Character& io_character, const uint32_t in_index, Mat4x4F* out_pMatrices);
+		void EvaluateCharacter(Character& io_character, const bool in_maskLeaves, Mat4x4F* out_pMatrices);
+
+		ThreadPool* m_pThreadPool = nullptr;
+
+		std::vector<Character> m_characters;
+		std::vector<uint32_t> m_freeList;
+		uint32_t m_liveCount = 0;
+		uint32_t m_jointCount = 0; // Palette size after the last Evaluate
+
+		AnimationLodSettings m_lodSettings;
+		Vec3F m_lodEye = Vec3F(0.0f);
+		Frustum m_lodFrustum;
+		float m_lodPixelsPerUnit = 0.0f; // 0 until SetLodView, everything stays Full
+		uint32_t m_lodCounts[(uint32_t)eAnimationLod::Count] = {};
+
+		std::vector<std::unique_ptr<ozz::animation::SamplingJob::Context>> m_contexts; // One per pool thread
+		uint32_t m_contextTracks = 0; // Biggest skeleton created so far, every context is sized for it
+	};
+}
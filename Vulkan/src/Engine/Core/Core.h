@@ -2,4 +2,6 @@
 
 #include "Engine/Core/Debug.h"
 #include "Engine/Core/SystemGuard.h"
+#include "Engine/Core/FramePacer.h"
+#include "Engine/Core/ThreadPool.h"
 #include "Engine/Core/Math/Math.h"
\ No newline at end of file
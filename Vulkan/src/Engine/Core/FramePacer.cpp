@@ -0,0 +1,186 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+#define FRAME_PACER_HISTORY 240
+#define FRAME_PACER_SLEEP_CHUNK std::chrono::milliseconds(1)
+#define FRAME_PACER_JITTER_WEIGHT 0.05 // How quickly the learned slack follows new wake up measurements
+#define FRAME_PACER_MIN_SLACK_NS 100000.0  // 0.1ms
+#define FRAME_PACER_MAX_SLACK_NS 4000000.0 // 4ms
+#define FRAME_PACER_FINE_SLEEP std::chrono::microseconds(100)
+#define FRAME_PACER_MIN_SPIN_NS 200000.0 // 0.2ms, the part we always yield through
+
+namespace Mega
+{
+	void FramePacer::Initialize()
+	{
+#ifdef _WIN32
+		// Windows sleeps in 15.6ms quanta by default which makes any sleep useless for pacing
+		m_raisedTimerResolution = (timeBeginPeriod(1) == TIMERR_NOERROR);
+#endif
+		m_errorHistory.assign(FRAME_PACER_HISTORY, 0.0f);
+		m_errorHead = 0;
+		m_errorCount = 0;
+	}
+
+	void FramePacer::Destroy()
+	{
+#ifdef _WIN32
+		if (m_raisedTimerResolution) { timeEndPeriod(1); }
+#endif
+		m_raisedTimerResolution = false;
+	}
+
+	void FramePacer::SetTargetFrameRate(const double in_frameRate)
+	{
+		m_targetFrameRate = in_frameRate > 0.0 ? in_frameRate : 0.0;
+		m_interval = m_targetFrameRate > 0.0
+			? std::chrono::nanoseconds((int64_t)std::llround(1000000000.0 / m_targetFrameRate))
+			: std::chrono::nanoseconds(0);
+
+		// Restart the deadline chain from now so a rate change doesnt release a burst of frames
+		m_nextDeadline = Clock::now() + m_interval;
+		m_errorCount = 0;
+		m_errorHead = 0;
+	}
+
+	void FramePacer::SetPresentLimit(const bool in_vsyncLimited, const double in_refreshRate)
+	{
+		m_vsyncLimited = in_vsyncLimited;
+		m_refreshRate = in_refreshRate;
+	}
+
+	void FramePacer::Start()
+	{
+		m_lastFrameEnd = Clock::now();
+		m_nextDeadline = m_lastFrameEnd + m_interval;
+	}
+
+	float FramePacer::EndFrame()
+	{
+		if (IsPacing()) {
+			Clock::time_point now = Clock::now();
+
+			// More than a whole frame late, the miss still counts against the deadline it missed. Then the
+			// missed deadlines are dropped instead of sprinting to catch up
+			if (now > m_nextDeadline + m_interval) {
+				RecordPacingError((double)std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_nextDeadline).count());
+				m_nextDeadline = now + m_interval;
+			}
+			else {
+				SleepUntil(m_nextDeadline);
+
+				Clock::time_point released = Clock::now();
+				RecordPacingError((double)std::chrono::duration_cast<std::chrono::nanoseconds>(released - m_nextDeadline).count());
+				m_nextDeadline += m_interval;
+			}
+		}
+		else if (m_vsyncLimited && m_refreshRate > 0.0) {
+			// Present is doing the pacing, still report how far off the refresh interval each frame was
+			double expectedNs = 1000000000.0 / m_refreshRate;
+			double actualNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_lastFrameEnd).count();
+			RecordPacingError(std::abs(actualNs - expectedNs));
+		}
+
+		Clock::time_point frameEnd = Clock::now();
+		float out_dt = std::chrono::duration<float, std::milli>(frameEnd - m_lastFrameEnd).count();
+		m_lastFrameEnd = frameEnd;
+
+		return out_dt;
+	}
+
+	bool FramePacer::IsPacing() const
+	{
+		if (m_interval.count() <= 0) { return false; }
+
+		// Vsync already holds us to the refresh rate, only pace when asking for something slower
+		if (m_vsyncLimited && m_refreshRate > 0.0 && m_targetFrameRate >= m_refreshRate - 0.5) { return false; }
+
+		return true;
+	}
+
+	void FramePacer::SleepUntil(const Clock::time_point& in_deadline)
+	{
+		// Coarse phase: only sleep while we would still wake up before the deadline given how late
+		// the OS has been waking us recently
+		double slackNs = std::clamp(m_jitterMeanNs + 2.0 * std::sqrt(m_jitterVarianceNs), FRAME_PACER_MIN_SLACK_NS, FRAME_PACER_MAX_SLACK_NS);
+		const std::chrono::nanoseconds chunk = FRAME_PACER_SLEEP_CHUNK;
+
+		Clock::time_point now = Clock::now();
+		while ((double)std::chrono::duration_cast<std::chrono::nanoseconds>(in_deadline - now).count() > (double)chunk.count() + slackNs) {
+			std::this_thread::sleep_for(chunk);
+
+			Clock::time_point woke = Clock::now();
+			RecordWakeJitter((double)std::chrono::duration_cast<std::chrono::nanoseconds>(woke - now - chunk).count());
+			now = woke;
+		}
+
+		// Fine phase: shorter sleeps while they have been waking up in time, so the spin below is only as
+		// long as the OS actually needs instead of the whole coarse slack
+		const std::chrono::nanoseconds fineChunk = FRAME_PACER_FINE_SLEEP;
+		while ((double)std::chrono::duration_cast<std::chrono::nanoseconds>(in_deadline - now).count() > (double)fineChunk.count() + std::max(m_fineJitterMeanNs, FRAME_PACER_MIN_SPIN_NS)) {
+			std::this_thread::sleep_for(fineChunk);
+
+			Clock::time_point woke = Clock::now();
+			double jitter = std::max((double)std::chrono::duration_cast<std::chrono::nanoseconds>(woke - now - fineChunk).count(), 0.0);
+			m_fineJitterMeanNs += FRAME_PACER_JITTER_WEIGHT * (jitter - m_fineJitterMeanNs);
+			now = woke;
+		}
+
+		// Give the core away every iteration so we are not hammering it like the old loop did
+		while (Clock::now() < in_deadline) {
+			std::this_thread::yield();
+		}
+	}
+
+	void FramePacer::RecordWakeJitter(const double in_jitterNs)
+	{
+		double jitter = std::max(in_jitterNs, 0.0);
+		double delta = jitter - m_jitterMeanNs;
+
+		m_jitterMeanNs += FRAME_PACER_JITTER_WEIGHT * delta;
+		m_jitterVarianceNs = (1.0 - FRAME_PACER_JITTER_WEIGHT) * (m_jitterVarianceNs + FRAME_PACER_JITTER_WEIGHT * delta * delta);
+	}
+
+	void FramePacer::RecordPacingError(const double in_errorNs)
+	{
+		if (m_errorHistory.empty()) { return; }
+
+		m_errorHistory[m_errorHead] = (float)(in_errorNs / 1000.0);
+		m_errorHead = (m_errorHead + 1) % (uint32_t)m_errorHistory.size();
+		m_errorCount = std::min(m_errorCount + 1, (uint32_t)m_errorHistory.size());
+	}
+
+	FramePacingStats FramePacer::GetStats() const
+	{
+		FramePacingStats out_stats;
+		out_stats.sampleCount = m_errorCount;
+		out_stats.presentLimited = !IsPacing() && m_vsyncLimited;
+		out_stats.sleepSlack = (float)(std::clamp(m_jitterMeanNs + 2.0 * std::sqrt(m_jitterVarianceNs), FRAME_PACER_MIN_SLACK_NS, FRAME_PACER_MAX_SLACK_NS) / 1000.0);
+		if (m_errorCount == 0) { return out_stats; }
+
+		std::vector<float> sorted(m_errorHistory.begin(), m_errorHistory.begin() + m_errorCount);
+		auto percentile = [&sorted](const float in_p) {
+			size_t index = std::min(sorted.size() - 1, (size_t)(in_p * (float)(sorted.size() - 1) + 0.5f));
+			std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+			return sorted[index];
+		};
+
+		out_stats.p50 = percentile(0.50f);
+		out_stats.p95 = percentile(0.95f);
+		out_stats.p99 = percentile(0.99f);
+		out_stats.worst = *std::max_element(sorted.begin(), sorted.end());
+
+		return out_stats;
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <cstdint>
+
+namespace Mega
+{
+	// Pacing error percentiles (how late each frame was released compared to its deadline)
+	// over the last FRAME_PACER_HISTORY frames, in microseconds
+	struct FramePacingStats
+	{
+		float p50 = 0.0f;
+		float p95 = 0.0f;
+		float p99 = 0.0f;
+		float worst = 0.0f;
+		float sleepSlack = 0.0f; // Current learned slack we leave the OS scheduler, in microseconds
+		uint32_t sampleCount = 0;
+		bool presentLimited = false; // True when the swapchain is doing the limiting for us
+	};
+
+	// Releases frames at fixed nanosecond deadlines. Sleeps in small chunks while there is more time
+	// left than the OS has recently overslept by, then in shorter ones while those wake up in time, and
+	// only yields the last stretch. Deadlines are absolute (next = previous + interval) so error never
+	// accumulates, and if we fall more than a frame behind we rebase instead of trying to catch up with a
+	// burst of frames
+	class FramePacer
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		void Initialize();
+		void Destroy();
+
+		// 0 disables pacing (run as fast as the renderer lets us)
+		void SetTargetFrameRate(const double in_frameRate);
+		double GetTargetFrameRate() const { return m_targetFrameRate; }
+		std::chrono::nanoseconds GetTargetInterval() const { return m_interval; }
+
+		// Tell the pacer how the swapchain presents. With a vsync (FIFO) present mode the present call
+		// already blocks to the refresh rate, so if we are aiming at or above it pacing again on the cpu
+		// just adds a second, out of phase limiter
+		void SetPresentLimit(const bool in_vsyncLimited, const double in_refreshRate);
+
+		// Start measuring, call once right before the first frame
+		void Start();
+		// Block until this frame's deadline, returns the real time since the last call in milliseconds
+		float EndFrame();
+
+		FramePacingStats GetStats() const;
+
+	private:
+		bool IsPacing() const;
+		void SleepUntil(const Clock::time_point& in_deadline);
+		void RecordWakeJitter(const double in_jitterNs);
+		void RecordPacingError(const double in_errorNs);
+
+		double m_targetFrameRate = 0.0;
+		std::chrono::nanoseconds m_interval = std::chrono::nanoseconds(0);
+
+		bool m_vsyncLimited = false;
+		double m_refreshRate = 0.0;
+
+		Clock::time_point m_lastFrameEnd;
+		Clock::time_point m_nextDeadline;
+
+		// Exponentially weighted mean/variance of how much longer a sleep takes than asked for
+		double m_jitterMeanNs = 1000000.0; // Start pessimistic (1ms) until we have measured something
+		double m_jitterVarianceNs = 0.0;
+		double m_fineJitterMeanNs = 1000000.0; // Same for the short sleeps near the deadline
+
+		std::vector<float> m_errorHistory; // Ring buffer of pacing error in microseconds
+		uint32_t m_errorHead = 0;
+		uint32_t m_errorCount = 0;
+
+		bool m_raisedTimerResolution = false;
+	};
+}
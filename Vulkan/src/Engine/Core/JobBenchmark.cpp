@@ -0,0 +1,115 @@
+#include "JobBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "Engine/Core/ThreadPool.h"
+
+namespace Mega
+{
+	struct JobBenchmarkResult {
+		float parallelForMs = 0.0f;
+		float jobGraphMs = 0.0f;
+		float nestedMs = 0.0f;
+	};
+
+	// Enough math per item that the run isnt just measuring memory bandwidth
+	static float JobBenchmarkKernel(const uint32_t in_item)
+	{
+		float value = (float)in_item * 0.001f;
+		for (uint32_t i = 0; i < 16; i++) { value = std::sqrt(value * value + 1.0f) * 0.999f; }
+		return value;
+	}
+
+	template<typename Function>
+	static float TimeJobBenchmarkCase(const uint32_t in_repeats, Function&& in_function)
+	{
+		in_function(); // Warm up, first run pays for waking the workers and touching the memory
+
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < in_repeats; i++) { in_function(); }
+		auto end = std::chrono::steady_clock::now();
+
+		return std::chrono::duration<float, std::milli>(end - start).count() / (float)std::max(in_repeats, 1u);
+	}
+
+	static JobBenchmarkResult RunJobBenchmarkCase(const ConstructInfoJobBenchmark& in_info, ThreadPool* in_pThreadPool)
+	{
+		JobBenchmarkResult out_result;
+		std::vector<float> output(in_info.itemCount);
+
+		// Flat range
+		out_result.parallelForMs = TimeJobBenchmarkCase(in_info.repeats, [&]() {
+			in_pThreadPool->ParallelFor(0, in_info.itemCount, in_info.grainSize, [&output](const uint32_t in_begin, const uint32_t in_end) {
+				for (uint32_t i = in_begin; i < in_end; i++) { output[i] = JobBenchmarkKernel(i); }
+			});
+		});
+
+		// Waves of independent jobs, each wave only released once the previous one is done
+		const uint32_t jobsPerWave = std::max(in_info.jobCount / std::max(in_info.waveCount, 1u), 1u);
+		const uint32_t itemsPerJob = std::max(in_info.itemCount / std::max(in_info.jobCount, 1u), 1u);
+		out_result.jobGraphMs = TimeJobBenchmarkCase(in_info.repeats, [&]() {
+			std::vector<JobCounter> waves(in_info.waveCount);
+			for (uint32_t wave = 0; wave < in_info.waveCount; wave++) {
+				for (uint32_t job = 0; job < jobsPerWave; job++) {
+					auto work = [&output, wave, job, jobsPerWave, itemsPerJob]() {
+						uint32_t begin = ((wave * jobsPerWave + job) * itemsPerJob) % (uint32_t)output.size();
+						uint32_t end = std::min(begin + itemsPerJob, (uint32_t)output.size());
+						for (uint32_t i = begin; i < end; i++) { output[i] = JobBenchmarkKernel(i); }
+					};
+
+					if (wave == 0) { in_pThreadPool->Run(work, &waves[wave]); }
+					else { in_pThreadPool->RunAfter(&waves[wave - 1], work, &waves[wave]); }
+				}
+			}
+			for (auto& wave : waves) { in_pThreadPool->Wait(&wave); }
+		});
+
+		// Parallel for inside parallel for, what a system spread across the pool running its own loops looks like
+		const uint32_t outerCount = 64;
+		const uint32_t innerCount = std::max(in_info.itemCount / outerCount, 1u);
+		out_result.nestedMs = TimeJobBenchmarkCase(in_info.repeats, [&]() {
+			in_pThreadPool->ParallelFor(0, outerCount, 1, [&](const uint32_t in_outerBegin, const uint32_t in_outerEnd) {
+				for (uint32_t outer = in_outerBegin; outer < in_outerEnd; outer++) {
+					in_pThreadPool->ParallelFor(0, innerCount, in_info.grainSize, [&output, outer, innerCount](const uint32_t in_begin, const uint32_t in_end) {
+						for (uint32_t i = in_begin; i < in_end; i++) { output[outer * innerCount + i] = JobBenchmarkKernel(i); }
+					});
+				}
+			});
+		});
+
+		return out_result;
+	}
+
+	void RunJobBenchmark(const ConstructInfoJobBenchmark* in_pInfo)
+	{
+		ConstructInfoJobBenchmark info = in_pInfo ? *in_pInfo : ConstructInfoJobBenchmark();
+
+		uint32_t maxThreads = info.maxThreads != 0 ? info.maxThreads : std::max(std::thread::hardware_concurrency(), 1u);
+
+		std::printf("Job system, %u items (grain %u), %u jobs in %u waves, %u repeats\n", info.itemCount, info.grainSize, info.jobCount, info.waveCount, info.repeats);
+		std::printf("%8s %14s %9s %14s %9s %14s %9s\n", "threads", "for (ms)", "speedup", "graph (ms)", "speedup", "nested (ms)", "speedup");
+
+		JobBenchmarkResult single;
+		for (uint32_t threads = 1; threads <= maxThreads; threads++) {
+			// A fresh pool per thread count, the calling thread is one of them
+			ThreadPool threadPool;
+			threadPool.Initialize(threads - 1);
+			JobBenchmarkResult result = RunJobBenchmarkCase(info, &threadPool);
+			threadPool.Destroy();
+
+			if (threads == 1) { single = result; }
+
+			auto speedup = [](const float in_single, const float in_ms) { return in_ms > 0.0f ? in_single / in_ms : 0.0f; };
+			std::printf("%8u %14.3f %8.2fx %14.3f %8.2fx %14.3f %8.2fx\n", threads,
+				result.parallelForMs, speedup(single.parallelForMs, result.parallelForMs),
+				result.jobGraphMs, speedup(single.jobGraphMs, result.jobGraphMs),
+				result.nestedMs, speedup(single.nestedMs, result.nestedMs));
+			std::fflush(stdout);
+		}
+	}
+}
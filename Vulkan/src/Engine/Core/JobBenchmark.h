@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Mega
+{
+	struct ConstructInfoJobBenchmark {
+		uint32_t maxThreads = 0; // 0 = hardware concurrency
+
+		uint32_t itemCount = 1 << 20;   // ParallelFor case, one small math kernel per item
+		uint32_t grainSize = 1024;
+		uint32_t jobCount = 4096;       // Dependency case, fan out/fan in waves of jobs chained by counters
+		uint32_t waveCount = 16;
+		uint32_t repeats = 20;
+	};
+
+	// Headless, no window or renderer. Times a ParallelFor over a flat range, a graph of small jobs
+	// chained through counters and a nested ParallelFor for every thread count up to maxThreads and
+	// prints the average time and speedup over one thread
+	void RunJobBenchmark(const ConstructInfoJobBenchmark* in_pInfo);
+}
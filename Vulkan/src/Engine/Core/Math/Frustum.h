@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cmath>
+
+#include "Vec.h"
+#include "Mat.h"
+
+namespace Mega
+{
+	// Six planes pointing inwards, pulled straight out of a view projection matrix (Gribb/Hartmann).
+	// The near plane assumes -w..w depth, with 0..w depth it is just a little conservative
+	struct Frustum {
+		Vec4F planes[6];
+
+		static Frustum FromViewProjection(const Mat4x4F& in_viewProjection) {
+			Vec4F row0(in_viewProjection[0][0], in_viewProjection[1][0], in_viewProjection[2][0], in_viewProjection[3][0]);
+			Vec4F row1(in_viewProjection[0][1], in_viewProjection[1][1], in_viewProjection[2][1], in_viewProjection[3][1]);
+			Vec4F row2(in_viewProjection[0][2], in_viewProjection[1][2], in_viewProjection[2][2], in_viewProjection[3][2]);
+			Vec4F row3(in_viewProjection[0][3], in_viewProjection[1][3], in_viewProjection[2][3], in_viewProjection[3][3]);
+
+			Frustum out_frustum;
+			out_frustum.planes[0] = row3 + row0; // Left
+			out_frustum.planes[1] = row3 - row0; // Right
+			out_frustum.planes[2] = row3 + row1; // Bottom
+			out_frustum.planes[3] = row3 - row1; // Top
+			out_frustum.planes[4] = row3 + row2; // Near
+			out_frustum.planes[5] = row3 - row2; // Far
+			return out_frustum;
+		}
+
+		// Object space box under in_transform, tested as the world space box around it. Can say visible
+		// for boxes just outside a corner, never says hidden for one that is visible
+		bool IntersectsBox(const Vec3F& in_min, const Vec3F& in_max, const Mat4x4F& in_transform) const {
+			Vec3F localCenter = (in_min + in_max) * 0.5f;
+			Vec3F localExtent = (in_max - in_min) * 0.5f;
+
+			Vec3F center = Vec3F(in_transform * Vec4F(localCenter, 1.0f));
+			Vec3F extent(
+				std::abs(in_transform[0][0]) * localExtent.x + std::abs(in_transform[1][0]) * localExtent.y + std::abs(in_transform[2][0]) * localExtent.z,
+				std::abs(in_transform[0][1]) * localExtent.x + std::abs(in_transform[1][1]) * localExtent.y + std::abs(in_transform[2][1]) * localExtent.z,
+				std::abs(in_transform[0][2]) * localExtent.x + std::abs(in_transform[1][2]) * localExtent.y + std::abs(in_transform[2][2]) * localExtent.z);
+
+			for (const Vec4F& plane : planes) {
+				float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+				float radius = std::abs(plane.x) * extent.x + std::abs(plane.y) * extent.y + std::abs(plane.z) * extent.z;
+				if (distance + radius < 0.0f) { return false; }
+			}
+			return true;
+		}
+
+		// World space sphere. The planes aren't normalized, so the radius is scaled by each normal's length
+		bool IntersectsSphere(const Vec3F& in_center, const float in_radius) const {
+			for (const Vec4F& plane : planes) {
+				float distance = plane.x * in_center.x + plane.y * in_center.y + plane.z * in_center.z + plane.w;
+				float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+				if (distance + in_radius * length < 0.0f) { return false; }
+			}
+			return true;
+		}
+	};
+}
@@ -2,7 +2,37 @@
 
 #include <GLM/matrix.hpp>
 
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define MEGA_MATH_SSE
+#endif
+
 namespace Mega
 {
 	using Mat4x4F = glm::mat4x4;
-}
\ No newline at end of file
+
+	// out = a * b. Every result column is the columns of a weighted by one column of b, four mul/adds of
+	// whole columns with SSE. out may alias a or b
+	inline void MultiplyMat4(const Mat4x4F& in_a, const Mat4x4F& in_b, Mat4x4F* out_pResult)
+	{
+#ifdef MEGA_MATH_SSE
+		const __m128 a0 = _mm_loadu_ps(&in_a[0][0]);
+		const __m128 a1 = _mm_loadu_ps(&in_a[1][0]);
+		const __m128 a2 = _mm_loadu_ps(&in_a[2][0]);
+		const __m128 a3 = _mm_loadu_ps(&in_a[3][0]);
+
+		for (int i = 0; i < 4; i++) {
+			const __m128 b = _mm_loadu_ps(&in_b[i][0]);
+
+			__m128 column = _mm_mul_ps(a0, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+			column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1))));
+			column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2))));
+			column = _mm_add_ps(column, _mm_mul_ps(a3, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3))));
+
+			_mm_storeu_ps(&(*out_pResult)[i][0], column);
+		}
+#else
+		*out_pResult = in_a * in_b;
+#endif
+	}
+}
@@ -2,5 +2,6 @@
 
 #include "Mat.h"
 #include "Vec.h"
+#include "Frustum.h"
 
 #define PI 3.1415927410125732421875f
\ No newline at end of file
@@ -0,0 +1,271 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+#include "Engine/Core/Debug.h"
+
+namespace Mega
+{
+	static thread_local uint32_t t_threadIndex = 0;
+	static thread_local const ThreadPool* t_pThreadPool = nullptr;
+
+	void ThreadPool::Initialize(const uint32_t in_workerCount, const uint32_t in_externalThreadCount)
+	{
+		MEGA_ASSERT(m_workers.empty(), "Initializing a thread pool twice");
+
+		m_stopping = false;
+		m_queuedJobs = 0;
+
+		m_queues.clear();
+		for (uint32_t i = 0; i < in_workerCount + 1 + in_externalThreadCount; i++) {
+			m_queues.push_back(std::make_unique<JobQueue>());
+		}
+		m_externalSlotsTaken.assign(in_externalThreadCount, 0);
+
+		m_workers.reserve(in_workerCount);
+		for (uint32_t i = 0; i < in_workerCount; i++) {
+			m_workers.emplace_back(&ThreadPool::WorkerLoop, this, i + 1);
+		}
+	}
+
+	void ThreadPool::Destroy()
+	{
+		// Workers finish whatever is still queued before they leave
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_stopping = true;
+		}
+		m_sleepCondition.notify_all();
+
+		for (auto& worker : m_workers) {
+			worker.join();
+		}
+		m_workers.clear();
+		m_externalSlotsTaken.clear();
+
+		// Nobody left to run these, do it here so no counter is left waiting
+		while (TryRunJob()) {}
+		m_queues.clear();
+	}
+
+	void ThreadPool::AttachCurrentThread()
+	{
+		MEGA_ASSERT(t_pThreadPool != this, "Thread is already attached to this pool");
+
+		std::lock_guard<std::mutex> lock(m_externalMutex);
+		for (uint32_t i = 0; i < (uint32_t)m_externalSlotsTaken.size(); i++) {
+			if (m_externalSlotsTaken[i]) { continue; }
+
+			m_externalSlotsTaken[i] = 1;
+			t_threadIndex = (uint32_t)m_workers.size() + 1 + i;
+			t_pThreadPool = this;
+			return;
+		}
+
+		MEGA_RUNTIME_ERROR("No free external thread slots, reserve more in ThreadPool::Initialize");
+	}
+
+	void ThreadPool::DetachCurrentThread()
+	{
+		MEGA_ASSERT(t_pThreadPool == this && t_threadIndex > m_workers.size(), "Detaching a thread that was never attached");
+
+		// Anything still in our queue gets stolen by someone else, so there is nothing to hand over
+		std::lock_guard<std::mutex> lock(m_externalMutex);
+		m_externalSlotsTaken[t_threadIndex - m_workers.size() - 1] = 0;
+		t_threadIndex = 0;
+		t_pThreadPool = nullptr;
+	}
+
+	void ThreadPool::Run(JobFunction in_job, JobCounter* in_pCounter)
+	{
+		if (in_pCounter != nullptr) { in_pCounter->m_pending.fetch_add(1, std::memory_order_relaxed); }
+
+		Job job = { std::move(in_job), in_pCounter };
+		if (m_workers.empty()) { Execute(job); return; }
+
+		Push(std::move(job));
+	}
+
+	void ThreadPool::RunAfter(JobCounter* in_pDependency, JobFunction in_job, JobCounter* in_pCounter)
+	{
+		if (in_pCounter != nullptr) { in_pCounter->m_pending.fetch_add(1, std::memory_order_relaxed); }
+
+		// Under the dependency's lock so it cant hit 0 and release its continuations in between
+		{
+			std::lock_guard<std::mutex> lock(in_pDependency->m_mutex);
+			if (!in_pDependency->IsDone()) {
+				in_pDependency->m_continuations.push_back({ std::move(in_job), in_pCounter });
+				return;
+			}
+		}
+
+		Job job = { std::move(in_job), in_pCounter };
+		if (m_workers.empty()) { Execute(job); return; }
+		Push(std::move(job));
+	}
+
+	void ThreadPool::Wait(JobCounter* in_pCounter)
+	{
+		uint32_t idleRounds = 0;
+		while (!in_pCounter->IsDone()) {
+			if (TryRunJob()) { idleRounds = 0; continue; }
+
+			// What we are waiting on is running on another thread
+			if (++idleRounds > THREAD_POOL_SPIN_COUNT) { std::this_thread::yield(); }
+		}
+
+		// The thread that finished the last job may still be releasing continuations under the lock
+		std::lock_guard<std::mutex> lock(in_pCounter->m_mutex);
+	}
+
+	void ThreadPool::ParallelFor(const uint32_t in_begin, const uint32_t in_end, const uint32_t in_grainSize, const RangeFunction& in_function, const uint32_t in_maxThreads)
+	{
+		if (in_end <= in_begin) { return; }
+
+		const uint32_t grain = std::max(in_grainSize, 1u);
+		const uint32_t chunkCount = (in_end - in_begin + grain - 1) / grain;
+		uint32_t threadCount = in_maxThreads == 0 ? GetThreadCount() : std::min(in_maxThreads, GetThreadCount());
+		threadCount = std::min(threadCount, chunkCount);
+
+		if (threadCount <= 1) {
+			in_function(in_begin, in_end);
+			return;
+		}
+
+		// Every participant pulls chunks off a shared counter until there are none left, which keeps
+		// uneven chunks balanced without handing out one job per chunk. Everything lives on this stack,
+		// Wait doesnt return until every helper job has run
+		std::atomic<uint32_t> nextChunk = { 0 };
+		auto participate = [&nextChunk, chunkCount, grain, in_begin, in_end, &in_function]() {
+			uint32_t chunk;
+			while ((chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) < chunkCount) {
+				const uint32_t begin = in_begin + chunk * grain;
+				in_function(begin, std::min(begin + grain, in_end));
+			}
+		};
+
+		JobCounter helpers;
+		for (uint32_t i = 1; i < threadCount; i++) {
+			Run(participate, &helpers);
+		}
+		participate();
+
+		// Helpers may still be inside their last chunk, or not started yet, in which case we run them
+		Wait(&helpers);
+	}
+
+	uint32_t ThreadPool::GetCurrentThreadIndex()
+	{
+		return t_threadIndex;
+	}
+
+	uint32_t ThreadPool::GetDefaultWorkerCount()
+	{
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	void ThreadPool::Push(Job&& in_job)
+	{
+		{
+			JobQueue& queue = *m_queues[GetQueueIndex()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(std::move(in_job));
+		}
+		m_queuedJobs.fetch_add(1, std::memory_order_release);
+
+		// Taking the lock keeps a worker from missing this between checking for jobs and going to sleep
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+		}
+		m_sleepCondition.notify_one();
+	}
+
+	bool ThreadPool::TryRunJob()
+	{
+		Job job;
+		if (!TryPop(&job)) { return false; }
+
+		Execute(job);
+		return true;
+	}
+
+	bool ThreadPool::TryPop(Job* out_pJob)
+	{
+		if (m_queuedJobs.load(std::memory_order_acquire) == 0) { return false; }
+
+		const uint32_t queueCount = (uint32_t)m_queues.size();
+		const uint32_t own = GetQueueIndex();
+
+		// Newest job of our own first
+		{
+			JobQueue& queue = *m_queues[own];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.jobs.empty()) {
+				*out_pJob = std::move(queue.jobs.back());
+				queue.jobs.pop_back();
+				m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		// Then the oldest job of everyone else, starting next to us so thieves spread out
+		for (uint32_t i = 1; i < queueCount; i++) {
+			JobQueue& queue = *m_queues[(own + i) % queueCount];
+			std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+			if (!lock.owns_lock() || queue.jobs.empty()) { continue; }
+
+			*out_pJob = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		return false;
+	}
+
+	void ThreadPool::Execute(Job& in_job)
+	{
+		in_job.function();
+		if (in_job.pCounter != nullptr) { FinishJob(in_job.pCounter); }
+	}
+
+	void ThreadPool::FinishJob(JobCounter* in_pCounter)
+	{
+		std::vector<JobCounter::Continuation> released;
+		{
+			std::lock_guard<std::mutex> lock(in_pCounter->m_mutex);
+			if (in_pCounter->m_pending.fetch_sub(1, std::memory_order_acq_rel) != 1) { return; }
+			released.swap(in_pCounter->m_continuations);
+		}
+
+		// The counter may be gone from here on, only touch what was released
+		for (auto& continuation : released) {
+			Job job = { std::move(continuation.job), continuation.pCounter };
+			if (m_workers.empty()) { Execute(job); }
+			else { Push(std::move(job)); }
+		}
+	}
+
+	uint32_t ThreadPool::GetQueueIndex() const
+	{
+		return t_pThreadPool == this ? t_threadIndex : 0;
+	}
+
+	void ThreadPool::WorkerLoop(const uint32_t in_index)
+	{
+		t_threadIndex = in_index;
+		t_pThreadPool = this;
+
+		uint32_t idleRounds = 0;
+		while (true) {
+			if (TryRunJob()) { idleRounds = 0; continue; }
+			if (++idleRounds < THREAD_POOL_SPIN_COUNT) { std::this_thread::yield(); continue; }
+
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_sleepCondition.wait(lock, [this]() { return m_stopping || m_queuedJobs.load(std::memory_order_acquire) > 0; });
+			if (m_stopping && m_queuedJobs.load(std::memory_order_acquire) == 0) { return; }
+			idleRounds = 0;
+		}
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define THREAD_POOL_SPIN_COUNT uint32_t(64) // Failed steal rounds before a worker goes to sleep
+
+namespace Mega
+{
+	class ThreadPool;
+
+	// Number of unfinished jobs. Jobs run with a counter add to it when scheduled and take away when done,
+	// a job started with RunAfter waits for its dependency counter to hit 0. Always Wait on a counter
+	// before it goes out of scope, that is what guarantees the last job is done touching it
+	class JobCounter {
+	public:
+		JobCounter() {}
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		bool IsDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+		uint32_t GetPending() const { return m_pending.load(std::memory_order_acquire); }
+
+	private:
+		friend ThreadPool;
+
+		struct Continuation {
+			std::function<void()> job;
+			JobCounter* pCounter = nullptr;
+		};
+
+		std::atomic<uint32_t> m_pending = { 0 };
+		std::mutex m_mutex;
+		std::vector<Continuation> m_continuations; // Released into the pool when m_pending hits 0
+	};
+
+	// Work stealing job system shared by the engine systems (physics, queries, entities, asset loading,
+	// culling, ...). Every thread owns a deque, it pushes and pops its own jobs at the back (newest
+	// first, still hot in cache) and steals the oldest job off the front of someone else's when it
+	// runs dry. The calling thread always takes part in ParallelFor and Wait, so a pool with 0 workers
+	// just runs everything inline
+	class ThreadPool
+	{
+	public:
+		using JobFunction = std::function<void()>;
+		using RangeFunction = std::function<void(const uint32_t in_begin, const uint32_t in_end)>;
+
+		// in_externalThreadCount reserves slots for long lived threads that arent workers (the render
+		// thread), see AttachCurrentThread
+		void Initialize(const uint32_t in_workerCount, const uint32_t in_externalThreadCount = 0);
+		void Destroy();
+
+		// Gives the calling thread its own queue and thread index, so it can run jobs next to the main
+		// thread without sharing per thread storage with it. Detach before the thread exits
+		void AttachCurrentThread();
+		void DetachCurrentThread();
+
+		// Runs in_job on whatever thread gets to it first. in_pCounter (optional) goes up now and down
+		// once the job has finished
+		void Run(JobFunction in_job, JobCounter* in_pCounter = nullptr);
+		// Same, but the job is only released once in_pDependency reaches 0
+		void RunAfter(JobCounter* in_pDependency, JobFunction in_job, JobCounter* in_pCounter = nullptr);
+		// Runs other jobs on this thread until in_pCounter reaches 0, use it instead of blocking
+		void Wait(JobCounter* in_pCounter);
+
+		// Split [in_begin, in_end) into chunks of in_grainSize and run them on at most in_maxThreads
+		// threads (0 = all of them), returns once every chunk is done. Safe to nest
+		void ParallelFor(const uint32_t in_begin, const uint32_t in_end, const uint32_t in_grainSize, const RangeFunction& in_function, const uint32_t in_maxThreads = 0);
+
+		// Workers plus the calling thread
+		uint32_t GetThreadCount() const { return (uint32_t)m_workers.size() + 1; }
+		// Every index GetCurrentThreadIndex can return, size per thread storage with this
+		uint32_t GetThreadSlotCount() const { return (uint32_t)m_queues.size(); }
+		// 0 for any thread that is not one of our workers (the main thread), 1..N for workers, N+1.. for
+		// attached threads
+		static uint32_t GetCurrentThreadIndex();
+
+		static uint32_t GetDefaultWorkerCount();
+
+	private:
+		struct Job {
+			JobFunction function;
+			JobCounter* pCounter = nullptr;
+		};
+		struct JobQueue {
+			std::mutex mutex;
+			std::deque<Job> jobs;
+		};
+
+		void Push(Job&& in_job);
+		bool TryRunJob();
+		bool TryPop(Job* out_pJob);
+		void Execute(Job& in_job);
+		void FinishJob(JobCounter* in_pCounter);
+		uint32_t GetQueueIndex() const;
+		void WorkerLoop(const uint32_t in_index);
+
+		std::vector<std::thread> m_workers;
+		std::vector<std::unique_ptr<JobQueue>> m_queues; // [0] is shared by every thread that isnt a worker or attached
+		std::vector<uint8_t> m_externalSlotsTaken;
+		std::mutex m_externalMutex;
+
+		std::atomic<uint32_t> m_queuedJobs = { 0 };
+		std::mutex m_sleepMutex;
+		std::condition_variable m_sleepCondition;
+		std::atomic<bool> m_stopping = { false };
+	};
+}
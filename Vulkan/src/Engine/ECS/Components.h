@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include "Engine/Core/Math/Vec.h"
+#include "Engine/Physics/RigidBodyPool.h"
+#include "Engine/ECS/TransformHierarchy.h"
+
+namespace Mega
+{
+	class Model;
+}
+
+namespace Mega
+{
+	// One bit per component type in a ComponentMask, an archetype is every entity with exactly the same mask
+	enum class eComponentType : uint8_t
+	{
+		Transform = 0,
+		ModelRef = 1,
+		RigidBodyRef = 2,
+		Health = 3,
+		Velocity = 4,
+		TransformNodeRef = 5,
+		Count,
+	};
+	using ComponentMask = uint32_t;
+
+	// Components are plain data, archetypes move them around with memcpy
+	struct Transform {
+		Vec3F position = Vec3F(0.0f);
+		Vec3F rotation = Vec3F(0.0f); // Euler angles, like Model
+		Vec3F scale = Vec3F(1.0f);
+	};
+
+	// The model is owned elsewhere and has to outlive the entity, the scene draws every one of these
+	struct ModelRef {
+		Model* pModel = nullptr;
+	};
+
+	// Body in the scene's pool, its transform is synced into the ModelRef and read back into the Transform
+	struct RigidBodyRef {
+		RigidBodyHandle handle;
+	};
+
+	struct Health {
+		float current = 100.0f;
+		float max = 100.0f;
+	};
+
+	// Only moves entities without a rigid body, those are moved by physics
+	struct Velocity {
+		Vec3F linear = Vec3F(0.0f);
+		float speed = 0.0f; // Max speed, 0 = unlimited
+	};
+
+	// Node in the scene's TransformHierarchy. With a Transform, that Transform is the node's local
+	// transform (position and rotation, scale stays on the model and isnt inherited) and is only pushed
+	// into the hierarchy when it changes. A ModelRef gets the node's world transform
+	struct TransformNodeRef {
+		TransformNode node;
+		Transform applied; // What was last pushed as the local transform
+		bool hasApplied = false;
+	};
+
+	// ================== TRAITS ================ //
+	template<typename T> struct ComponentTraits;
+	template<> struct ComponentTraits<Transform>    { static constexpr eComponentType type = eComponentType::Transform; };
+	template<> struct ComponentTraits<ModelRef>     { static constexpr eComponentType type = eComponentType::ModelRef; };
+	template<> struct ComponentTraits<RigidBodyRef> { static constexpr eComponentType type = eComponentType::RigidBodyRef; };
+	template<> struct ComponentTraits<Health>       { static constexpr eComponentType type = eComponentType::Health; };
+	template<> struct ComponentTraits<Velocity>     { static constexpr eComponentType type = eComponentType::Velocity; };
+	template<> struct ComponentTraits<TransformNodeRef> { static constexpr eComponentType type = eComponentType::TransformNodeRef; };
+
+	// const T is the same component, queries use it to say they only read
+	template<typename T>
+	constexpr eComponentType GetComponentType() { return ComponentTraits<std::remove_const_t<T>>::type; }
+
+	template<typename... Ts>
+	constexpr ComponentMask MakeComponentMask() { return (ComponentMask(0) | ... | (ComponentMask(1) << (uint32_t)GetComponentType<Ts>())); }
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "Engine/ECS/Components.h"
+#include "Engine/ECS/TransformHierarchy.h"
+#include "Engine/ECS/EntityWorld.h"
+#include "Engine/ECS/SystemScheduler.h"
+#include "Engine/ECS/Systems.h"
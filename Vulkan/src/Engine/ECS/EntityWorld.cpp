@@ -0,0 +1,188 @@
+#include "EntityWorld.h"
+
+#include <cstring>
+#include <new>
+
+namespace Mega
+{
+	// Size and default constructor of every component type, what lets archetypes store them type erased
+	struct ComponentInfo {
+		uint32_t size = 0;
+		void (*construct)(void* in_pData) = nullptr;
+	};
+
+	template<typename T>
+	static ComponentInfo MakeComponentInfo()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Components are moved with memcpy");
+		return { (uint32_t)sizeof(T), [](void* in_pData) { new (in_pData) T(); } };
+	}
+
+	static const ComponentInfo s_componentInfos[(uint32_t)eComponentType::Count] = {
+		MakeComponentInfo<Transform>(),
+		MakeComponentInfo<ModelRef>(),
+		MakeComponentInfo<RigidBodyRef>(),
+		MakeComponentInfo<Health>(),
+		MakeComponentInfo<Velocity>(),
+		MakeComponentInfo<TransformNodeRef>(),
+	};
+
+	// ================== ARCHETYPE ================ //
+	Archetype::Archetype(const ComponentMask in_mask)
+		: m_mask(in_mask)
+	{
+		m_entities.reserve(ENTITY_RESERVE_PER_ARCHETYPE);
+		for (uint32_t type = 0; type < (uint32_t)eComponentType::Count; type++) {
+			if (m_mask & (ComponentMask(1) << type)) { m_columns[type].reserve((size_t)ENTITY_RESERVE_PER_ARCHETYPE * s_componentInfos[type].size); }
+		}
+	}
+
+	void* Archetype::GetComponent(const eComponentType in_type, const uint32_t in_row)
+	{
+		std::vector<uint8_t>& column = m_columns[(uint32_t)in_type];
+		return column.empty() ? nullptr : column.data() + (size_t)in_row * s_componentInfos[(uint32_t)in_type].size;
+	}
+
+	uint32_t Archetype::AddRow(const EntityHandle in_entity)
+	{
+		uint32_t out_row = (uint32_t)m_entities.size();
+		m_entities.push_back(in_entity);
+
+		for (uint32_t type = 0; type < (uint32_t)eComponentType::Count; type++) {
+			if (!(m_mask & (ComponentMask(1) << type))) { continue; }
+
+			const ComponentInfo& info = s_componentInfos[type];
+			m_columns[type].resize(m_columns[type].size() + info.size);
+			info.construct(m_columns[type].data() + (size_t)out_row * info.size);
+		}
+
+		return out_row;
+	}
+
+	EntityHandle Archetype::RemoveRow(const uint32_t in_row)
+	{
+		const uint32_t lastRow = (uint32_t)m_entities.size() - 1;
+
+		for (uint32_t type = 0; type < (uint32_t)eComponentType::Count; type++) {
+			if (!(m_mask & (ComponentMask(1) << type))) { continue; }
+
+			const uint32_t size = s_componentInfos[type].size;
+			uint8_t* pData = m_columns[type].data();
+			if (in_row != lastRow) { std::memcpy(pData + (size_t)in_row * size, pData + (size_t)lastRow * size, size); }
+			m_columns[type].resize(m_columns[type].size() - size);
+		}
+
+		EntityHandle out_moved;
+		if (in_row != lastRow) {
+			m_entities[in_row] = m_entities[lastRow];
+			out_moved = m_entities[in_row];
+		}
+		m_entities.pop_back();
+
+		return out_moved;
+	}
+
+	// ================== ENTITY WORLD ================ //
+	void EntityWorld::Destroy()
+	{
+		m_archetypes.clear();
+		m_archetypeLookup.clear();
+		m_records.clear();
+		m_freeList.clear();
+		m_liveCount = 0;
+		m_structureLocked = false;
+	}
+
+	EntityHandle EntityWorld::Create(const ComponentMask in_mask)
+	{
+		MEGA_ASSERT(!m_structureLocked, "Creating an entity while systems are running");
+
+		EntityHandle out_entity;
+		if (!m_freeList.empty()) {
+			out_entity.index = m_freeList.back();
+			m_freeList.pop_back();
+		}
+		else {
+			out_entity.index = (uint32_t)m_records.size();
+			m_records.emplace_back();
+		}
+
+		EntityRecord& record = m_records[out_entity.index];
+		out_entity.generation = record.generation;
+		record.archetype = GetOrCreateArchetype(in_mask);
+		record.row = m_archetypes[record.archetype]->AddRow(out_entity);
+
+		m_liveCount++;
+		return out_entity;
+	}
+
+	void EntityWorld::Destroy(const EntityHandle in_entity)
+	{
+		MEGA_ASSERT(!m_structureLocked, "Destroying an entity while systems are running");
+		if (!IsAlive(in_entity)) { return; }
+
+		EntityRecord& record = m_records[in_entity.index];
+		OnRowRemoved(m_archetypes[record.archetype].get(), record.row);
+
+		record.archetype = ENTITY_INVALID_INDEX;
+		record.generation++;
+		m_freeList.push_back(in_entity.index);
+		m_liveCount--;
+	}
+
+	bool EntityWorld::IsAlive(const EntityHandle in_entity) const
+	{
+		if (in_entity.index >= m_records.size()) { return false; }
+
+		const EntityRecord& record = m_records[in_entity.index];
+		return record.archetype != ENTITY_INVALID_INDEX && record.generation == in_entity.generation;
+	}
+
+	ComponentMask EntityWorld::GetMask(const EntityHandle in_entity) const
+	{
+		return IsAlive(in_entity) ? m_archetypes[m_records[in_entity.index].archetype]->GetMask() : 0;
+	}
+
+	uint32_t EntityWorld::GetOrCreateArchetype(const ComponentMask in_mask)
+	{
+		auto found = m_archetypeLookup.find(in_mask);
+		if (found != m_archetypeLookup.end()) { return found->second; }
+
+		uint32_t out_index = (uint32_t)m_archetypes.size();
+		m_archetypes.push_back(std::make_unique<Archetype>(in_mask));
+		m_archetypeLookup[in_mask] = out_index;
+
+		return out_index;
+	}
+
+	void EntityWorld::ChangeArchetype(const EntityHandle in_entity, const ComponentMask in_mask)
+	{
+		MEGA_ASSERT(!m_structureLocked, "Adding or removing components while systems are running");
+
+		EntityRecord& record = m_records[in_entity.index];
+		uint32_t newIndex = GetOrCreateArchetype(in_mask);
+		if (newIndex == record.archetype) { return; }
+
+		Archetype* pOld = m_archetypes[record.archetype].get();
+		Archetype* pNew = m_archetypes[newIndex].get();
+		uint32_t oldRow = record.row;
+		uint32_t newRow = pNew->AddRow(in_entity);
+
+		// Carry over whatever both archetypes have, new components keep their defaults
+		ComponentMask shared = pOld->GetMask() & pNew->GetMask();
+		for (uint32_t type = 0; type < (uint32_t)eComponentType::Count; type++) {
+			if (!(shared & (ComponentMask(1) << type))) { continue; }
+			std::memcpy(pNew->GetComponent((eComponentType)type, newRow), pOld->GetComponent((eComponentType)type, oldRow), s_componentInfos[type].size);
+		}
+
+		OnRowRemoved(pOld, oldRow);
+		record.archetype = newIndex;
+		record.row = newRow;
+	}
+
+	void EntityWorld::OnRowRemoved(Archetype* in_pArchetype, const uint32_t in_row)
+	{
+		EntityHandle moved = in_pArchetype->RemoveRow(in_row);
+		if (moved.IsValid()) { m_records[moved.index].row = in_row; }
+	}
+}
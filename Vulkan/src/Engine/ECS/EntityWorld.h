@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Engine/Core/Debug.h"
+#include "Engine/Core/ThreadPool.h"
+#include "Engine/ECS/Components.h"
+
+#define ENTITY_INVALID_INDEX         uint32_t(0xFFFFFFFF)
+#define ENTITY_RESERVE_PER_ARCHETYPE uint32_t(64)
+
+namespace Mega
+{
+	// Same idea as RigidBodyHandle, the generation makes handles to destroyed entities read as dead
+	struct EntityHandle {
+		uint32_t index = ENTITY_INVALID_INDEX;
+		uint32_t generation = 0;
+
+		bool IsValid() const { return index != ENTITY_INVALID_INDEX; }
+		bool operator==(const EntityHandle& in_other) const { return index == in_other.index && generation == in_other.generation; }
+		bool operator!=(const EntityHandle& in_other) const { return !(*this == in_other); }
+	};
+
+	// ================== ARCHETYPE ================ //
+	// Every entity with one exact component mask. Each component is its own tightly packed column and
+	// row i of every column (and of the entity list) is the same entity, removing swaps the last row in
+	class Archetype {
+	public:
+		Archetype(const ComponentMask in_mask);
+
+		ComponentMask GetMask() const { return m_mask; }
+		bool Matches(const ComponentMask in_required, const ComponentMask in_excluded) const { return (m_mask & in_required) == in_required && (m_mask & in_excluded) == 0; }
+
+		uint32_t GetCount() const { return (uint32_t)m_entities.size(); }
+		const EntityHandle* GetEntities() const { return m_entities.data(); }
+
+		// nullptr when the archetype doesnt have the component
+		template<typename T>
+		T* GetColumn() {
+			std::vector<uint8_t>& column = m_columns[(uint32_t)GetComponentType<T>()];
+			return column.empty() ? nullptr : reinterpret_cast<T*>(column.data());
+		}
+
+	private:
+		friend class EntityWorld;
+
+		void* GetComponent(const eComponentType in_type, const uint32_t in_row);
+		// Appends a row of default constructed components
+		uint32_t AddRow(const EntityHandle in_entity);
+		// Returns the entity that was moved into in_row, invalid if in_row was the last row
+		EntityHandle RemoveRow(const uint32_t in_row);
+
+		ComponentMask m_mask = 0;
+		std::vector<EntityHandle> m_entities;
+		std::vector<uint8_t> m_columns[(uint32_t)eComponentType::Count]; // Empty for components outside the mask
+	};
+
+	// ================== ENTITY WORLD ================ //
+	// Entities are just a handle, their components live in the archetype matching their mask. Queries walk
+	// only the archetypes that have every component asked for, one linear pass over each column. Adding or
+	// removing a component moves the entity to another archetype, so component pointers are only good
+	// until the next structural change (Create/Destroy/Add/Remove), which cant happen while systems run
+	class EntityWorld {
+	public:
+		void Destroy();
+
+		EntityHandle Create(const ComponentMask in_mask);
+		template<typename... Ts>
+		EntityHandle Create(const Ts&... in_components) {
+			EntityHandle out_entity = Create(MakeComponentMask<Ts...>());
+			((*Get<Ts>(out_entity) = in_components), ...);
+			return out_entity;
+		}
+		void Destroy(const EntityHandle in_entity);
+
+		bool IsAlive(const EntityHandle in_entity) const;
+		ComponentMask GetMask(const EntityHandle in_entity) const;
+		uint32_t GetLiveCount() const { return m_liveCount; }
+
+		// nullptr when the entity is dead or doesnt have the component
+		template<typename T>
+		T* Get(const EntityHandle in_entity) {
+			if (!IsAlive(in_entity)) { return nullptr; }
+			const EntityRecord& record = m_records[in_entity.index];
+			return static_cast<T*>(m_archetypes[record.archetype]->GetComponent(GetComponentType<T>(), record.row));
+		}
+		template<typename T>
+		bool Has(const EntityHandle in_entity) const { return (GetMask(in_entity) & MakeComponentMask<T>()) != 0; }
+
+		template<typename T>
+		T* Add(const EntityHandle in_entity, const T& in_component = T()) {
+			MEGA_ASSERT(IsAlive(in_entity), "Adding a component to a dead entity");
+			ChangeArchetype(in_entity, GetMask(in_entity) | MakeComponentMask<T>());
+
+			T* out_pComponent = Get<T>(in_entity);
+			*out_pComponent = in_component;
+			return out_pComponent;
+		}
+		template<typename T>
+		void Remove(const EntityHandle in_entity) {
+			MEGA_ASSERT(IsAlive(in_entity), "Removing a component from a dead entity");
+			ChangeArchetype(in_entity, GetMask(in_entity) & ~MakeComponentMask<T>());
+		}
+
+		// ================== QUERIES ================ //
+		// in_function(count, entities, Ts* columns...) once per matching archetype, the fastest way through
+		// the data. Ask for const T to only read. Archetypes with any in_excluded component are skipped
+		template<typename... Ts, typename Function>
+		void ForEachChunk(Function&& in_function, const ComponentMask in_excluded = 0) {
+			const ComponentMask required = MakeComponentMask<Ts...>();
+			for (auto& pArchetype : m_archetypes) {
+				if (pArchetype->GetCount() == 0 || !pArchetype->Matches(required, in_excluded)) { continue; }
+				in_function(pArchetype->GetCount(), pArchetype->GetEntities(), pArchetype->template GetColumn<Ts>()...);
+			}
+		}
+
+		// in_function(EntityHandle, Ts&...) for every matching entity
+		template<typename... Ts, typename Function>
+		void ForEach(Function&& in_function, const ComponentMask in_excluded = 0) {
+			ForEachChunk<Ts...>([&in_function](const uint32_t in_count, const EntityHandle* in_pEntities, Ts*... in_pColumns) {
+				for (uint32_t i = 0; i < in_count; i++) { in_function(in_pEntities[i], in_pColumns[i]...); }
+			}, in_excluded);
+		}
+
+		// ForEach with every archetype split into in_grainSize rows across the pool, in_function must only
+		// touch the entity it was handed
+		template<typename... Ts, typename Function>
+		void ParallelForEach(ThreadPool* in_pThreadPool, const uint32_t in_grainSize, Function&& in_function, const ComponentMask in_excluded = 0) {
+			ForEachChunk<Ts...>([&](const uint32_t in_count, const EntityHandle* in_pEntities, Ts*... in_pColumns) {
+				in_pThreadPool->ParallelFor(0, in_count, in_grainSize, [&](const uint32_t in_begin, const uint32_t in_end) {
+					for (uint32_t i = in_begin; i < in_end; i++) { in_function(in_pEntities[i], in_pColumns[i]...); }
+				});
+			}, in_excluded);
+		}
+
+		// Set by the system scheduler while systems run, structural changes assert while locked
+		void SetStructureLocked(const bool in_locked) { m_structureLocked = in_locked; }
+		bool IsStructureLocked() const { return m_structureLocked; }
+
+	private:
+		struct EntityRecord {
+			uint32_t generation = 0;
+			uint32_t archetype = ENTITY_INVALID_INDEX; // ENTITY_INVALID_INDEX while the slot is free
+			uint32_t row = 0;
+		};
+
+		uint32_t GetOrCreateArchetype(const ComponentMask in_mask);
+		void ChangeArchetype(const EntityHandle in_entity, const ComponentMask in_mask);
+		void OnRowRemoved(Archetype* in_pArchetype, const uint32_t in_row);
+
+		std::vector<std::unique_ptr<Archetype>> m_archetypes;
+		std::unordered_map<ComponentMask, uint32_t> m_archetypeLookup;
+
+		std::vector<EntityRecord> m_records;
+		std::vector<uint32_t> m_freeList;
+		uint32_t m_liveCount = 0;
+		bool m_structureLocked = false;
+	};
+}
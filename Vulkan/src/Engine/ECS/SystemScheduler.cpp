@@ -0,0 +1,90 @@
+#include "SystemScheduler.h"
+
+#include <algorithm>
+
+#include "Engine/Core/Debug.h"
+#include "Engine/Core/ThreadPool.h"
+
+namespace Mega
+{
+	void SystemScheduler::Initialize(ThreadPool* in_pThreadPool)
+	{
+		m_pThreadPool = in_pThreadPool;
+	}
+
+	void SystemScheduler::Destroy()
+	{
+		m_systems.clear();
+		m_enabled.clear();
+		m_phases.clear();
+		m_phasesDirty = true;
+		m_pThreadPool = nullptr;
+	}
+
+	uint32_t SystemScheduler::AddSystem(const SystemDesc& in_system)
+	{
+		MEGA_ASSERT(in_system.update != nullptr, "System has nothing to run");
+
+		m_systems.push_back(in_system);
+		m_enabled.push_back(1);
+		m_phasesDirty = true;
+
+		return (uint32_t)m_systems.size() - 1;
+	}
+
+	void SystemScheduler::SetSystemEnabled(const uint32_t in_system, const bool in_enabled)
+	{
+		m_enabled[in_system] = in_enabled ? 1 : 0;
+	}
+
+	void SystemScheduler::Run(EntityWorld& in_world, const float in_dt)
+	{
+		if (m_phasesDirty) { BuildPhases(); }
+
+		in_world.SetStructureLocked(true);
+		for (const auto& phase : m_phases) {
+			auto runSystems = [&](const uint32_t in_begin, const uint32_t in_end) {
+				for (uint32_t i = in_begin; i < in_end; i++) {
+					if (m_enabled[phase[i]]) { m_systems[phase[i]].update(in_world, in_dt); }
+				}
+			};
+
+			if (m_pThreadPool != nullptr && phase.size() > 1) { m_pThreadPool->ParallelFor(0, (uint32_t)phase.size(), 1, runSystems); }
+			else { runSystems(0, (uint32_t)phase.size()); }
+		}
+		in_world.SetStructureLocked(false);
+	}
+
+	const std::vector<std::vector<uint32_t>>& SystemScheduler::GetPhases()
+	{
+		if (m_phasesDirty) { BuildPhases(); }
+		return m_phases;
+	}
+
+	bool SystemScheduler::Conflicts(const SystemDesc& in_a, const SystemDesc& in_b)
+	{
+		if (in_a.exclusive || in_b.exclusive) { return true; }
+		return (in_a.writes & (in_b.reads | in_b.writes)) != 0 || (in_b.writes & in_a.reads) != 0;
+	}
+
+	void SystemScheduler::BuildPhases()
+	{
+		// Each system goes in the phase right after the last earlier system it conflicts with, so
+		// conflicting systems keep their order and everything else gets pulled as early as it can
+		std::vector<uint32_t> phaseOf(m_systems.size(), 0);
+		m_phases.clear();
+
+		for (uint32_t i = 0; i < (uint32_t)m_systems.size(); i++) {
+			uint32_t phase = 0;
+			for (uint32_t j = 0; j < i; j++) {
+				if (Conflicts(m_systems[i], m_systems[j])) { phase = std::max(phase, phaseOf[j] + 1); }
+			}
+
+			phaseOf[i] = phase;
+			if (m_phases.size() <= phase) { m_phases.resize((size_t)phase + 1); }
+			m_phases[phase].push_back(i);
+		}
+
+		m_phasesDirty = false;
+	}
+}
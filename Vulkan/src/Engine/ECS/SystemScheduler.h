@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "Engine/ECS/EntityWorld.h"
+
+namespace Mega
+{
+	class ThreadPool;
+}
+
+namespace Mega
+{
+	// What a system touches decides what it can run next to. Two systems conflict when one writes a
+	// component the other reads or writes, conflicting systems run in the order they were added
+	struct SystemDesc {
+		const char* name = "";
+		ComponentMask reads = 0;
+		ComponentMask writes = 0;
+		bool exclusive = false; // Touches shared state outside of components (scene lists, ...), never runs alongside anything
+
+		std::function<void(EntityWorld& in_world, const float in_dt)> update;
+	};
+
+	// Packs systems into phases where nothing in a phase conflicts, then runs phase by phase with every
+	// system of a phase spread across the thread pool. Systems can still ParallelForEach inside themselves
+	class SystemScheduler {
+	public:
+		void Initialize(ThreadPool* in_pThreadPool);
+		void Destroy();
+
+		uint32_t AddSystem(const SystemDesc& in_system);
+		void SetSystemEnabled(const uint32_t in_system, const bool in_enabled);
+
+		void Run(EntityWorld& in_world, const float in_dt);
+
+		// System indices per phase, rebuilt lazily after systems are added
+		const std::vector<std::vector<uint32_t>>& GetPhases();
+		const SystemDesc& GetSystem(const uint32_t in_system) const { return m_systems[in_system]; }
+		uint32_t GetSystemCount() const { return (uint32_t)m_systems.size(); }
+
+	private:
+		static bool Conflicts(const SystemDesc& in_a, const SystemDesc& in_b);
+		void BuildPhases();
+
+		ThreadPool* m_pThreadPool = nullptr;
+
+		std::vector<SystemDesc> m_systems;
+		std::vector<uint8_t> m_enabled;
+		std::vector<std::vector<uint32_t>> m_phases;
+		bool m_phasesDirty = true;
+	};
+}
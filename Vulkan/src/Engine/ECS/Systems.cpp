@@ -0,0 +1,163 @@
+#include "Systems.h"
+
+#include <GLM/geometric.hpp>
+#include <GLM/gtc/matrix_transform.hpp>
+
+#include "Engine/ECS/TransformHierarchy.h"
+#include "Engine/Graphics/Objects/Model.h"
+#include "Engine/Physics/RigidBodyPool.h"
+#include "Engine/Physics/ContactEvents.h"
+
+namespace Mega
+{
+	// Same order Model builds its matrix in, without the scale
+	static Mat4x4F MakeLocalMatrix(const Transform& in_transform)
+	{
+		Mat4x4F out_matrix = glm::translate(Mat4x4F(1.0f), in_transform.position);
+		out_matrix = glm::rotate(out_matrix, in_transform.rotation.x, Vec3F(1, 0, 0));
+		out_matrix = glm::rotate(out_matrix, in_transform.rotation.y, Vec3F(0, 1, 0));
+		out_matrix = glm::rotate(out_matrix, in_transform.rotation.z, Vec3F(0, 0, 1));
+
+		return out_matrix;
+	}
+
+	SystemDesc MakeMovementSystem(ThreadPool* in_pThreadPool)
+	{
+		SystemDesc out_system;
+		out_system.name = "Movement";
+		out_system.reads = MakeComponentMask<Velocity>();
+		out_system.writes = MakeComponentMask<Transform>();
+		out_system.update = [in_pThreadPool](EntityWorld& in_world, const float in_dt) {
+			in_world.ParallelForEach<Transform, const Velocity>(in_pThreadPool, ECS_MOVEMENT_GRAIN_SIZE, [in_dt](const EntityHandle, Transform& in_transform, const Velocity& in_velocity) {
+				// Clamped on a copy, Velocity is only read so other systems can read it alongside this one
+				Vec3F linear = in_velocity.linear;
+				float speed = glm::length(linear);
+				if (in_velocity.speed > 0.0f && speed > in_velocity.speed) { linear *= in_velocity.speed / speed; }
+
+				in_transform.position += linear * in_dt;
+			}, MakeComponentMask<RigidBodyRef>());
+		};
+
+		return out_system;
+	}
+
+	SystemDesc MakeRigidBodyTransformSystem(RigidBodyPool* in_pPool, ThreadPool* in_pThreadPool)
+	{
+		SystemDesc out_system;
+		out_system.name = "RigidBodyTransform";
+		out_system.reads = MakeComponentMask<RigidBodyRef>();
+		out_system.writes = MakeComponentMask<Transform>();
+		out_system.update = [in_pPool, in_pThreadPool](EntityWorld& in_world, const float) {
+			in_world.ParallelForEach<Transform, const RigidBodyRef>(in_pThreadPool, ECS_READBACK_GRAIN_SIZE, [in_pPool](const EntityHandle, Transform& in_transform, const RigidBodyRef& in_body) {
+				const RigidBody3D* pBody = in_pPool->Get(in_body.handle);
+				if (pBody == nullptr) { return; }
+
+				in_transform.position = pBody->GetMotionStatePosition();
+				in_transform.rotation = pBody->GetMotionStateRotation();
+			});
+		};
+
+		return out_system;
+	}
+
+	SystemDesc MakeModelTransformSystem()
+	{
+		SystemDesc out_system;
+		out_system.name = "ModelTransform";
+		out_system.reads = MakeComponentMask<Transform, RigidBodyRef, TransformNodeRef>();
+		out_system.writes = MakeComponentMask<ModelRef>();
+		out_system.update = [](EntityWorld& in_world, const float) {
+			in_world.ForEachChunk<const Transform, ModelRef>([&in_world](const uint32_t in_count, const EntityHandle* in_pEntities, const Transform* in_pTransforms, ModelRef* in_pModels) {
+				bool placedElsewhere = (in_world.GetMask(in_pEntities[0]) & MakeComponentMask<RigidBodyRef, TransformNodeRef>()) != 0;
+
+				for (uint32_t i = 0; i < in_count; i++) {
+					Model* pModel = in_pModels[i].pModel;
+					if (pModel == nullptr) { continue; }
+
+					pModel->SetScale(in_pTransforms[i].scale);
+					if (!placedElsewhere) {
+						pModel->SetPosition(in_pTransforms[i].position);
+						pModel->SetRotation(in_pTransforms[i].rotation);
+					}
+				}
+			});
+		};
+
+		return out_system;
+	}
+
+	SystemDesc MakeHierarchyLocalSystem(TransformHierarchy* in_pHierarchy)
+	{
+		SystemDesc out_system;
+		out_system.name = "HierarchyLocal";
+		out_system.reads = MakeComponentMask<Transform>();
+		out_system.writes = MakeComponentMask<TransformNodeRef>();
+		out_system.update = [in_pHierarchy](EntityWorld& in_world, const float) {
+			// Serial, SetLocal isnt thread safe. Unchanged transforms cost one compare and never dirty the hierarchy
+			in_world.ForEach<const Transform, TransformNodeRef>([in_pHierarchy](const EntityHandle, const Transform& in_transform, TransformNodeRef& in_nodeRef) {
+				if (in_nodeRef.hasApplied && in_nodeRef.applied.position == in_transform.position && in_nodeRef.applied.rotation == in_transform.rotation) { return; }
+				if (!in_pHierarchy->IsAlive(in_nodeRef.node)) { return; }
+
+				in_pHierarchy->SetLocal(in_nodeRef.node, MakeLocalMatrix(in_transform));
+				in_nodeRef.applied = in_transform;
+				in_nodeRef.hasApplied = true;
+			});
+		};
+
+		return out_system;
+	}
+
+	SystemDesc MakeHierarchyUpdateSystem(TransformHierarchy* in_pHierarchy)
+	{
+		SystemDesc out_system;
+		out_system.name = "HierarchyUpdate";
+		out_system.writes = MakeComponentMask<TransformNodeRef>(); // Doesnt touch the components, but has to run between the systems around it
+		out_system.update = [in_pHierarchy](EntityWorld&, const float) {
+			in_pHierarchy->Update();
+		};
+
+		return out_system;
+	}
+
+	SystemDesc MakeHierarchyModelSystem(const TransformHierarchy* in_pHierarchy)
+	{
+		SystemDesc out_system;
+		out_system.name = "HierarchyModel";
+		out_system.reads = MakeComponentMask<TransformNodeRef>();
+		out_system.writes = MakeComponentMask<ModelRef>();
+		out_system.update = [in_pHierarchy](EntityWorld& in_world, const float) {
+			in_world.ForEach<const TransformNodeRef, ModelRef>([in_pHierarchy](const EntityHandle, const TransformNodeRef& in_nodeRef, ModelRef& in_model) {
+				if (in_model.pModel == nullptr || !in_pHierarchy->IsAlive(in_nodeRef.node)) { return; }
+				if (!in_pHierarchy->WasUpdated(in_nodeRef.node)) { return; }
+
+				in_model.pModel->SetTransform(in_pHierarchy->GetWorld(in_nodeRef.node));
+			}, MakeComponentMask<RigidBodyRef>());
+		};
+
+		return out_system;
+	}
+
+	SystemDesc MakeContactDamageSystem(const ContactEventStream* in_pEvents, const ContactDamageInfo* in_pInfo)
+	{
+		SystemDesc out_system;
+		out_system.name = "ContactDamage";
+		out_system.reads = MakeComponentMask<RigidBodyRef>();
+		out_system.writes = MakeComponentMask<Health>();
+		out_system.update = [in_pEvents, in_pInfo](EntityWorld& in_world, const float) {
+			const ContactDamageInfo& in_info = *in_pInfo;
+			in_world.ForEach<Health, const RigidBodyRef>([in_pEvents, &in_info](const EntityHandle, Health& in_health, const RigidBodyRef& in_body) {
+				float damage = 0.0f;
+				for (const ContactEvent& event : in_pEvents->GetEvents(in_body.handle)) {
+					bool counts = event.type == eContactEventType::Begin || (in_info.includePersist && event.type == eContactEventType::Persist);
+					if (counts && event.impulse > in_info.minImpulse) {
+						damage += (event.impulse - in_info.minImpulse) * in_info.damagePerImpulse;
+					}
+				}
+
+				if (damage > 0.0f) { in_health.current -= damage; }
+			});
+		};
+
+		return out_system;
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Engine/ECS/SystemScheduler.h"
+
+#define ECS_MOVEMENT_GRAIN_SIZE  uint32_t(256)
+#define ECS_READBACK_GRAIN_SIZE  uint32_t(128)
+
+namespace Mega
+{
+	class RigidBodyPool;
+	class ContactEventStream;
+	class TransformHierarchy;
+}
+
+namespace Mega
+{
+	struct ContactDamageInfo {
+		float minImpulse = 1.0f;        // Bumps below this do nothing
+		float damagePerImpulse = 1.0f;  // Health lost per unit of impulse above the minimum
+		bool includePersist = false;    // Resting contact keeps dealing damage every step
+	};
+
+	// Transform += Velocity * dt for entities without a rigid body, clamped to Velocity::speed
+	SystemDesc MakeMovementSystem(ThreadPool* in_pThreadPool);
+	// Reads every rigid body's position/rotation back into its Transform so gameplay can read it linearly
+	SystemDesc MakeRigidBodyTransformSystem(RigidBodyPool* in_pPool, ThreadPool* in_pThreadPool);
+	// Transform -> Model. Models on a rigid body or a hierarchy node only get their scale, the pool's sync
+	// or the hierarchy writes the rest
+	SystemDesc MakeModelTransformSystem();
+	// Transforms of hierarchy entities -> their nodes' local transforms, only the ones that changed
+	SystemDesc MakeHierarchyLocalSystem(TransformHierarchy* in_pHierarchy);
+	// Propagates this frame's changes down the hierarchy
+	SystemDesc MakeHierarchyUpdateSystem(TransformHierarchy* in_pHierarchy);
+	// World transforms of the nodes that moved -> their models. Rigid bodies are left to the pool's sync
+	SystemDesc MakeHierarchyModelSystem(const TransformHierarchy* in_pHierarchy);
+	// This frame's contact impulses turned into Health damage, every entity only looks at its own events.
+	// in_pInfo is read every run so it can be tuned while playing
+	SystemDesc MakeContactDamageSystem(const ContactEventStream* in_pEvents, const ContactDamageInfo* in_pInfo);
+}
@@ -0,0 +1,326 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include "Engine/Core/Debug.h"
+#include "Engine/Core/ThreadPool.h"
+
+namespace Mega
+{
+	void TransformHierarchy::Initialize(ThreadPool* in_pThreadPool)
+	{
+		m_pThreadPool = in_pThreadPool;
+		m_updateStamp = 1; // Slots start at 0, so nothing counts as updated before the first Update
+	}
+
+	void TransformHierarchy::Destroy()
+	{
+		m_generations.clear();
+		m_slotOfNode.clear();
+		m_parentOfNode.clear();
+		m_nodeAlive.clear();
+		m_freeNodes.clear();
+		m_liveCount = 0;
+
+		m_locals.clear();
+		m_worlds.clear();
+		m_parentSlots.clear();
+		m_firstChildSlots.clear();
+		m_childCounts.clear();
+		m_nodeOfSlot.clear();
+		m_dirty.clear();
+		m_updateStamps.clear();
+
+		m_levels.clear();
+		m_layoutDirty = false;
+		m_dirtyCount = 0;
+		m_pThreadPool = nullptr;
+	}
+
+	TransformNode TransformHierarchy::Create(const Mat4x4F& in_local, const TransformNode in_parent)
+	{
+		MEGA_ASSERT((!in_parent.IsValid() || IsAlive(in_parent)), "Creating a transform node under a dead parent");
+
+		uint32_t index;
+		if (!m_freeNodes.empty()) {
+			index = m_freeNodes.back();
+			m_freeNodes.pop_back();
+		}
+		else {
+			index = (uint32_t)m_nodeAlive.size();
+			m_generations.push_back(0);
+			m_slotOfNode.push_back(TRANSFORM_NODE_INVALID);
+			m_parentOfNode.push_back(TRANSFORM_NODE_INVALID);
+			m_nodeAlive.push_back(0);
+		}
+
+		// Appended for now, the next Update sorts it into its level
+		uint32_t slot = (uint32_t)m_locals.size();
+		m_locals.push_back(in_local);
+		m_worlds.push_back(in_local);
+		m_parentSlots.push_back(TRANSFORM_NODE_INVALID);
+		m_firstChildSlots.push_back(0);
+		m_childCounts.push_back(0);
+		m_nodeOfSlot.push_back(index);
+		m_dirty.push_back(0);
+		m_updateStamps.push_back(0);
+
+		m_slotOfNode[index] = slot;
+		m_parentOfNode[index] = in_parent.IsValid() ? in_parent.index : TRANSFORM_NODE_INVALID;
+		m_nodeAlive[index] = 1;
+		m_liveCount++;
+
+		m_layoutDirty = true;
+		MarkDirty(slot);
+
+		return { index, m_generations[index] };
+	}
+
+	void TransformHierarchy::Destroy(const TransformNode in_node)
+	{
+		MEGA_ASSERT(IsAlive(in_node), "Destroying a dead transform node");
+
+		const uint32_t grandparent = m_parentOfNode[in_node.index];
+		for (uint32_t i = 0; i < (uint32_t)m_nodeAlive.size(); i++) {
+			if (!m_nodeAlive[i] || m_parentOfNode[i] != in_node.index) { continue; }
+
+			m_parentOfNode[i] = grandparent;
+			MarkDirty(m_slotOfNode[i]);
+		}
+
+		// Its slot is left behind and dropped by the next Linearize
+		m_nodeAlive[in_node.index] = 0;
+		m_parentOfNode[in_node.index] = TRANSFORM_NODE_INVALID;
+		m_generations[in_node.index]++;
+		m_freeNodes.push_back(in_node.index);
+		m_liveCount--;
+
+		m_layoutDirty = true;
+	}
+
+	bool TransformHierarchy::IsAlive(const TransformNode in_node) const
+	{
+		return in_node.index < m_nodeAlive.size() && m_nodeAlive[in_node.index] && m_generations[in_node.index] == in_node.generation;
+	}
+
+	void TransformHierarchy::SetParent(const TransformNode in_node, const TransformNode in_parent)
+	{
+		MEGA_ASSERT(IsAlive(in_node), "Reparenting a dead transform node");
+		MEGA_ASSERT((!in_parent.IsValid() || IsAlive(in_parent)), "Reparenting a transform node under a dead parent");
+
+		uint32_t parent = in_parent.IsValid() ? in_parent.index : TRANSFORM_NODE_INVALID;
+		if (m_parentOfNode[in_node.index] == parent) { return; }
+
+		for (uint32_t ancestor = parent; ancestor != TRANSFORM_NODE_INVALID; ancestor = m_parentOfNode[ancestor]) {
+			MEGA_ASSERT(ancestor != in_node.index, "Reparenting a transform node under its own child");
+		}
+
+		m_parentOfNode[in_node.index] = parent;
+		m_layoutDirty = true;
+		MarkDirty(m_slotOfNode[in_node.index]);
+	}
+
+	TransformNode TransformHierarchy::GetParent(const TransformNode in_node) const
+	{
+		MEGA_ASSERT(IsAlive(in_node), "Getting the parent of a dead transform node");
+
+		uint32_t parent = m_parentOfNode[in_node.index];
+		if (parent == TRANSFORM_NODE_INVALID) { return TransformNode(); }
+
+		return { parent, m_generations[parent] };
+	}
+
+	void TransformHierarchy::SetLocal(const TransformNode in_node, const Mat4x4F& in_local)
+	{
+		uint32_t slot = GetSlot(in_node);
+
+		m_locals[slot] = in_local;
+		MarkDirty(slot);
+	}
+
+	void TransformHierarchy::Update()
+	{
+		if (m_layoutDirty) { Linearize(); }
+
+		m_updateStamp++;
+		m_lastUpdatedCount = 0;
+		if (m_dirtyCount == 0) { return; }
+
+		const uint32_t stamp = m_updateStamp;
+		std::mutex mergeMutex;
+
+		// Hull of the slots recomputed in the level above, their children are the only ones that can inherit a change
+		uint32_t changedBegin = TRANSFORM_NODE_INVALID;
+		uint32_t changedEnd = 0;
+
+		for (Level& level : m_levels) {
+			uint32_t begin = level.dirtyBegin;
+			uint32_t end = level.dirtyEnd;
+			if (changedBegin < changedEnd) {
+				begin = std::min(begin, m_firstChildSlots[changedBegin]);
+				end = std::max(end, m_firstChildSlots[changedEnd - 1] + m_childCounts[changedEnd - 1]);
+			}
+
+			level.dirtyBegin = TRANSFORM_NODE_INVALID;
+			level.dirtyEnd = 0;
+			changedBegin = TRANSFORM_NODE_INVALID;
+			changedEnd = 0;
+			if (begin >= end) { continue; }
+
+			auto updateRange = [&](const uint32_t in_begin, const uint32_t in_end) {
+				uint32_t rangeBegin = TRANSFORM_NODE_INVALID;
+				uint32_t rangeEnd = 0;
+				uint32_t count = 0;
+
+				for (uint32_t i = in_begin; i < in_end; i++) {
+					uint32_t parent = m_parentSlots[i];
+					bool parentChanged = parent != TRANSFORM_NODE_INVALID && m_updateStamps[parent] == stamp;
+					if (!m_dirty[i] && !parentChanged) { continue; }
+
+					if (parent == TRANSFORM_NODE_INVALID) { m_worlds[i] = m_locals[i]; }
+					else { MultiplyMat4(m_worlds[parent], m_locals[i], &m_worlds[i]); }
+
+					m_dirty[i] = 0;
+					m_updateStamps[i] = stamp;
+
+					rangeBegin = std::min(rangeBegin, i);
+					rangeEnd = i + 1;
+					count++;
+				}
+
+				if (count == 0) { return; }
+
+				std::lock_guard<std::mutex> lock(mergeMutex);
+				changedBegin = std::min(changedBegin, rangeBegin);
+				changedEnd = std::max(changedEnd, rangeEnd);
+				m_lastUpdatedCount += count;
+			};
+
+			if (m_pThreadPool != nullptr) { m_pThreadPool->ParallelFor(begin, end, TRANSFORM_HIERARCHY_GRAIN_SIZE, updateRange); }
+			else { updateRange(begin, end); }
+		}
+
+		m_dirtyCount = 0;
+	}
+
+	uint32_t TransformHierarchy::GetSlot(const TransformNode in_node) const
+	{
+		MEGA_ASSERT(IsAlive(in_node), "Using a dead transform node");
+		return m_slotOfNode[in_node.index];
+	}
+
+	uint32_t TransformHierarchy::FindLevel(const uint32_t in_slot) const
+	{
+		auto it = std::upper_bound(m_levels.begin(), m_levels.end(), in_slot, [](const uint32_t in_value, const Level& in_level) {
+			return in_value < in_level.begin;
+		});
+
+		return (uint32_t)(it - m_levels.begin()) - 1;
+	}
+
+	void TransformHierarchy::MarkDirty(const uint32_t in_slot)
+	{
+		if (m_dirty[in_slot]) { return; }
+
+		m_dirty[in_slot] = 1;
+		m_dirtyCount++;
+
+		// With a stale layout Linearize recounts everything anyway
+		if (m_layoutDirty) { return; }
+
+		Level& level = m_levels[FindLevel(in_slot)];
+		level.dirtyBegin = std::min(level.dirtyBegin, in_slot);
+		level.dirtyEnd = std::max(level.dirtyEnd, in_slot + 1);
+	}
+
+	void TransformHierarchy::Linearize()
+	{
+		const uint32_t nodeCount = (uint32_t)m_nodeAlive.size();
+
+		// Group every node's children together, a counting sort on the parent
+		std::vector<uint32_t> childOffsets((size_t)nodeCount + 1, 0);
+		std::vector<uint32_t> order;
+		order.reserve(m_liveCount);
+		for (uint32_t i = 0; i < nodeCount; i++) {
+			if (!m_nodeAlive[i]) { continue; }
+
+			if (m_parentOfNode[i] == TRANSFORM_NODE_INVALID) { order.push_back(i); }
+			else { childOffsets[(size_t)m_parentOfNode[i] + 1]++; }
+		}
+		for (uint32_t i = 0; i < nodeCount; i++) { childOffsets[(size_t)i + 1] += childOffsets[i]; }
+
+		std::vector<uint32_t> children(childOffsets[nodeCount]);
+		std::vector<uint32_t> cursors(childOffsets.begin(), childOffsets.end() - 1);
+		for (uint32_t i = 0; i < nodeCount; i++) {
+			if (m_nodeAlive[i] && m_parentOfNode[i] != TRANSFORM_NODE_INVALID) { children[cursors[m_parentOfNode[i]]++] = i; }
+		}
+
+		// Breadth first from the roots, one level per pass
+		std::vector<uint32_t> firstChildOfNode(nodeCount, 0);
+		m_levels.clear();
+		uint32_t levelBegin = 0;
+		while (levelBegin < (uint32_t)order.size()) {
+			uint32_t levelEnd = (uint32_t)order.size();
+			Level level;
+			level.begin = levelBegin;
+			level.end = levelEnd;
+			m_levels.push_back(level);
+
+			for (uint32_t i = levelBegin; i < levelEnd; i++) {
+				uint32_t node = order[i];
+				firstChildOfNode[node] = (uint32_t)order.size();
+				order.insert(order.end(), children.begin() + childOffsets[node], children.begin() + childOffsets[(size_t)node + 1]);
+			}
+			levelBegin = levelEnd;
+		}
+		MEGA_ASSERT(order.size() == m_liveCount, "Transform hierarchy has nodes that cant be reached from a root");
+
+		// Move every slot's data to its new place
+		const uint32_t slotCount = (uint32_t)order.size();
+		std::vector<Mat4x4F> locals(slotCount);
+		std::vector<Mat4x4F> worlds(slotCount);
+		std::vector<uint8_t> dirty(slotCount);
+		std::vector<uint32_t> stamps(slotCount);
+		for (uint32_t s = 0; s < slotCount; s++) {
+			uint32_t oldSlot = m_slotOfNode[order[s]];
+			locals[s] = m_locals[oldSlot];
+			worlds[s] = m_worlds[oldSlot];
+			dirty[s] = m_dirty[oldSlot];
+			stamps[s] = m_updateStamps[oldSlot];
+		}
+		m_locals.swap(locals);
+		m_worlds.swap(worlds);
+		m_dirty.swap(dirty);
+		m_updateStamps.swap(stamps);
+
+		for (uint32_t s = 0; s < slotCount; s++) { m_slotOfNode[order[s]] = s; }
+
+		m_parentSlots.resize(slotCount);
+		m_firstChildSlots.resize(slotCount);
+		m_childCounts.resize(slotCount);
+		for (uint32_t s = 0; s < slotCount; s++) {
+			uint32_t node = order[s];
+			uint32_t parent = m_parentOfNode[node];
+
+			m_parentSlots[s] = parent == TRANSFORM_NODE_INVALID ? TRANSFORM_NODE_INVALID : m_slotOfNode[parent];
+			m_firstChildSlots[s] = firstChildOfNode[node];
+			m_childCounts[s] = childOffsets[(size_t)node + 1] - childOffsets[node];
+		}
+		m_nodeOfSlot.swap(order);
+
+		m_layoutDirty = false;
+
+		// Dirty ranges were not tracked while the layout was stale
+		m_dirtyCount = 0;
+		for (Level& level : m_levels) {
+			for (uint32_t s = level.begin; s < level.end; s++) {
+				if (!m_dirty[s]) { continue; }
+
+				level.dirtyBegin = std::min(level.dirtyBegin, s);
+				level.dirtyEnd = s + 1;
+				m_dirtyCount++;
+			}
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Engine/Core/Math/Math.h"
+
+#define TRANSFORM_NODE_INVALID          uint32_t(0xFFFFFFFF)
+#define TRANSFORM_HIERARCHY_GRAIN_SIZE  uint32_t(256) // Nodes per job when a level is updated across the pool
+
+namespace Mega
+{
+	class ThreadPool;
+}
+
+namespace Mega
+{
+	// Index + generation like EntityHandle, a destroyed node's slot can be reused without old handles
+	// seeing the new node
+	struct TransformNode {
+		uint32_t index = TRANSFORM_NODE_INVALID;
+		uint32_t generation = 0;
+
+		bool IsValid() const { return index != TRANSFORM_NODE_INVALID; }
+		bool operator==(const TransformNode& in_other) const { return index == in_other.index && generation == in_other.generation; }
+		bool operator!=(const TransformNode& in_other) const { return !(*this == in_other); }
+	};
+
+	// Parent/child transforms stored breadth first: every depth level is one contiguous run of slots,
+	// parents always come before their children and the children of one parent sit next to each other.
+	// Update walks the levels top down, each slot only reads its parent's world matrix (already done)
+	// and its own local one, so a level is a flat loop that can be split across the pool.
+	//
+	// Only what moved is touched. SetLocal marks a slot dirty, and Update recomputes a dirty slot plus
+	// every slot under one that was recomputed. Each level only scans the range covering its own dirty
+	// slots and the children of what changed in the level above, so a big static hierarchy costs
+	// nothing per frame and moving one branch only walks that branch.
+	//
+	// Adding, removing and reparenting nodes just marks the layout stale, the next Update re-sorts
+	// everything into breadth first order once
+	class TransformHierarchy {
+	public:
+		void Initialize(ThreadPool* in_pThreadPool);
+		void Destroy();
+
+		TransformNode Create(const Mat4x4F& in_local = Mat4x4F(1.0f), const TransformNode in_parent = TransformNode());
+		// The node's children move up to its parent, keeping their local transforms
+		void Destroy(const TransformNode in_node);
+		bool IsAlive(const TransformNode in_node) const;
+
+		// An invalid parent makes in_node a root. The local transform is kept, so the world one changes
+		void SetParent(const TransformNode in_node, const TransformNode in_parent);
+		TransformNode GetParent(const TransformNode in_node) const;
+
+		void SetLocal(const TransformNode in_node, const Mat4x4F& in_local);
+		const Mat4x4F& GetLocal(const TransformNode in_node) const { return m_locals[GetSlot(in_node)]; }
+		// As of the last Update
+		const Mat4x4F& GetWorld(const TransformNode in_node) const { return m_worlds[GetSlot(in_node)]; }
+		// True if in_node's world transform was recomputed by the last Update
+		bool WasUpdated(const TransformNode in_node) const { return m_updateStamps[GetSlot(in_node)] == m_updateStamp; }
+
+		// Propagates every change since the last call down the hierarchy
+		void Update();
+
+		uint32_t GetNodeCount() const { return m_liveCount; }
+		uint32_t GetLevelCount() const { return m_layoutDirty ? 0 : (uint32_t)m_levels.size(); }
+		uint32_t GetLastUpdatedCount() const { return m_lastUpdatedCount; }
+
+	private:
+		struct Level {
+			uint32_t begin = 0;
+			uint32_t end = 0;
+			// Hull of the slots marked dirty by SetLocal, empty when dirtyBegin >= dirtyEnd
+			uint32_t dirtyBegin = TRANSFORM_NODE_INVALID;
+			uint32_t dirtyEnd = 0;
+		};
+
+		uint32_t GetSlot(const TransformNode in_node) const;
+		uint32_t FindLevel(const uint32_t in_slot) const;
+		void MarkDirty(const uint32_t in_slot);
+		// Re-sorts the live nodes breadth first and rebuilds every per slot array
+		void Linearize();
+
+		ThreadPool* m_pThreadPool = nullptr;
+
+		// Per node, indexed by TransformNode::index. The parent links are the tree, slots just mirror it
+		std::vector<uint32_t> m_generations;
+		std::vector<uint32_t> m_slotOfNode;
+		std::vector<uint32_t> m_parentOfNode;
+		std::vector<uint8_t> m_nodeAlive;
+		std::vector<uint32_t> m_freeNodes;
+		uint32_t m_liveCount = 0;
+
+		// Per slot, breadth first
+		std::vector<Mat4x4F> m_locals;
+		std::vector<Mat4x4F> m_worlds;
+		std::vector<uint32_t> m_parentSlots;
+		std::vector<uint32_t> m_firstChildSlots; // Where the slot's children start (or would start, if it has none)
+		std::vector<uint32_t> m_childCounts;
+		std::vector<uint32_t> m_nodeOfSlot;
+		std::vector<uint8_t> m_dirty;
+		std::vector<uint32_t> m_updateStamps; // Slot was recomputed in the Update that had this stamp
+
+		std::vector<Level> m_levels;
+		bool m_layoutDirty = false;
+		uint32_t m_dirtyCount = 0;
+		uint32_t m_updateStamp = 0;
+		uint32_t m_lastUpdatedCount = 0;
+	};
+}
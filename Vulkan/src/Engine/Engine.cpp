@@ -7,8 +7,10 @@
 
 namespace Mega
 {
-	void Engine::Initialize()
+	void Engine::Initialize(const ConstructInfoEngine* in_pInfo)
 	{
+		ConstructInfoEngine info = in_pInfo ? *in_pInfo : ConstructInfoEngine();
+
 		// Initialize GLFW and create our application window
 		glfwInit();
 
@@ -31,12 +33,18 @@ namespace Mega
 		glfwShowWindow(m_pAppWindow);
 
 		// Initialize our systems
+		m_pThreadPool = new ThreadPool;
+		m_pThreadPool->Initialize(info.workerThreadCount, RENDERER_THREAD_COUNT);
+
 		m_pRenderer = new Renderer;
 		m_pRenderer->SetWindow(m_pAppWindow);
+		m_pRenderer->SetThreadPool(m_pThreadPool);
 		m_pRenderer->Initialize();
 
 		m_pScene = new Scene;
 		m_pScene->SetRenderer(m_pRenderer);
+		m_pScene->SetThreadPool(m_pThreadPool);
+		m_pScene->SetPhysicsInfo(info.physics);
 		m_pScene->Initialize();
 
 		// Initialize ImGui
@@ -44,6 +52,9 @@ namespace Mega
 		ImGui::CreateContext();
 
 		ImGui::StyleColorsDark();
+
+		// Last, everything the render thread touches has to exist first
+		m_pRenderer->SetPipelined(info.pipelinedRendering);
 	}
 
 	void Engine::Destroy()
@@ -55,6 +66,9 @@ namespace Mega
 		delete m_pScene;
 		delete m_pRenderer;
 
+		m_pThreadPool->Destroy();
+		delete m_pThreadPool;
+
 		// Delete our application window
 		glfwDestroyWindow(m_pAppWindow);
 		glfwTerminate();
@@ -13,10 +13,18 @@ namespace Mega
 
 namespace Mega
 {
+	struct ConstructInfoEngine {
+		ConstructInfoPhysicsWorld physics;
+
+		uint32_t workerThreadCount = ThreadPool::GetDefaultWorkerCount();
+		// Record and submit frames on their own thread while the next one is simulated
+		bool pipelinedRendering = true;
+	};
+
 	class Engine
 	{
 	public:
-		void Initialize();
+		void Initialize(const ConstructInfoEngine* in_pInfo = nullptr);
 		void Destroy();
 
 		inline Renderer* GetRenderer() { //MEGA_ASSERT(IsInitialized(),"Engine not initialized");
@@ -28,9 +36,13 @@ namespace Mega
 		inline GLFWwindow* GetApplicationWindow() { //MEGA_ASSERT(IsInitialized(), "Engine not initialized");
 			return m_pAppWindow;
 		}
+		inline ThreadPool* GetThreadPool() {
+			return m_pThreadPool;
+		}
 	private:
 		Renderer* m_pRenderer;
 		Scene* m_pScene;
 		GLFWwindow* m_pAppWindow;
+		ThreadPool* m_pThreadPool;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,301 @@
+#include "MeshLOD.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <unordered_map>
+
+#include "Engine/Core/Debug.h"
+
+namespace Mega
+{
+	// Symmetric 4x4, the sum of squared distances to a set of planes
+	struct LODQuadric {
+		double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+		double a11 = 0, a12 = 0, a13 = 0;
+		double a22 = 0, a23 = 0;
+		double a33 = 0;
+
+		void AddPlane(const Vec3F& in_normal, const float in_distance, const double in_weight) {
+			const double x = in_normal.x, y = in_normal.y, z = in_normal.z, d = in_distance;
+			a00 += in_weight * x * x; a01 += in_weight * x * y; a02 += in_weight * x * z; a03 += in_weight * x * d;
+			a11 += in_weight * y * y; a12 += in_weight * y * z; a13 += in_weight * y * d;
+			a22 += in_weight * z * z; a23 += in_weight * z * d;
+			a33 += in_weight * d * d;
+		}
+		void Add(const LODQuadric& in_other) {
+			a00 += in_other.a00; a01 += in_other.a01; a02 += in_other.a02; a03 += in_other.a03;
+			a11 += in_other.a11; a12 += in_other.a12; a13 += in_other.a13;
+			a22 += in_other.a22; a23 += in_other.a23;
+			a33 += in_other.a33;
+		}
+		double Evaluate(const Vec3F& in_point) const {
+			const double x = in_point.x, y = in_point.y, z = in_point.z;
+			double out_error = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+				+ a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+				+ a22 * z * z + 2 * a23 * z
+				+ a33;
+			return out_error > 0.0 ? out_error : 0.0;
+		}
+	};
+
+	struct LODCollapse {
+		double cost;
+		uint32_t from;
+		uint32_t to;
+		uint32_t fromVersion;
+		uint32_t toVersion;
+
+		bool operator>(const LODCollapse& in_other) const { return cost > in_other.cost; }
+	};
+
+	static Vec3F TriangleNormal(const Vec3F& in_a, const Vec3F& in_b, const Vec3F& in_c)
+	{
+		return glm::cross(in_b - in_a, in_c - in_a);
+	}
+
+	static uint64_t EdgeKey(const uint32_t in_a, const uint32_t in_b)
+	{
+		return in_a < in_b ? ((uint64_t)in_a << 32) | in_b : ((uint64_t)in_b << 32) | in_a;
+	}
+
+	float SimplifyMesh(const std::vector<Vertex>& in_vertices, const std::vector<INDEX_TYPE>& in_indices, const size_t in_targetIndexCount, const float in_maxError,
+		std::vector<INDEX_TYPE>* out_pIndices)
+	{
+		MEGA_ASSERT(in_indices.size() % 3 == 0, "Simplifying something that isn't a triangle list");
+		out_pIndices->clear();
+
+		// Weld by position, the collapses work on these and the real vertices are picked at the end
+		const uint32_t vertexCount = (uint32_t)in_vertices.size();
+		std::vector<uint32_t> sorted(vertexCount);
+		std::iota(sorted.begin(), sorted.end(), 0);
+		auto lessPos = [&in_vertices](const uint32_t in_a, const uint32_t in_b) {
+			const Vec3F& a = in_vertices[in_a].pos;
+			const Vec3F& b = in_vertices[in_b].pos;
+			if (a.x != b.x) { return a.x < b.x; }
+			if (a.y != b.y) { return a.y < b.y; }
+			return a.z < b.z;
+		};
+		std::sort(sorted.begin(), sorted.end(), lessPos);
+
+		std::vector<uint32_t> weldOf(vertexCount);
+		std::vector<uint32_t> weldFirst; // Welded vertex w's real vertices are sorted[weldFirst[w] .. weldFirst[w + 1]]
+		std::vector<Vec3F> positions;
+		for (uint32_t i = 0; i < vertexCount; i++) {
+			if (i == 0 || in_vertices[sorted[i]].pos != in_vertices[sorted[i - 1]].pos) {
+				weldFirst.push_back(i);
+				positions.push_back(in_vertices[sorted[i]].pos);
+			}
+			weldOf[sorted[i]] = (uint32_t)positions.size() - 1;
+		}
+		weldFirst.push_back(vertexCount);
+		const uint32_t weldCount = (uint32_t)positions.size();
+
+		// Triangles over welded vertices. Ones that are already degenerate are dropped
+		const uint32_t sourceTriangleCount = (uint32_t)(in_indices.size() / 3);
+		std::vector<uint32_t> corners;   // Real vertex, for picking attributes at the end
+		std::vector<uint32_t> welded;    // Current welded vertex, changes as things collapse
+		corners.reserve(in_indices.size());
+		welded.reserve(in_indices.size());
+		for (uint32_t t = 0; t < sourceTriangleCount; t++) {
+			uint32_t a = weldOf[in_indices[t * 3 + 0]], b = weldOf[in_indices[t * 3 + 1]], c = weldOf[in_indices[t * 3 + 2]];
+			if (a == b || b == c || a == c) { continue; }
+
+			for (int k = 0; k < 3; k++) { corners.push_back(in_indices[t * 3 + k]); }
+			welded.push_back(a); welded.push_back(b); welded.push_back(c);
+		}
+		const uint32_t triangleCount = (uint32_t)(welded.size() / 3);
+		std::vector<uint8_t> triangleAlive(triangleCount, 1);
+		uint32_t liveTriangles = triangleCount;
+
+		std::vector<std::vector<uint32_t>> trianglesOf(weldCount);
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			for (int k = 0; k < 3; k++) { trianglesOf[welded[t * 3 + k]].push_back(t); }
+		}
+
+		// Every face's plane goes to its corners, open edges also get a plane along them so borders stay put
+		std::vector<LODQuadric> quadrics(weldCount);
+		std::unordered_map<uint64_t, uint32_t> edgeUses;
+		std::unordered_map<uint64_t, uint32_t> edgeTriangle;
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			const uint32_t* tri = &welded[t * 3];
+			Vec3F normal = TriangleNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+			float length = glm::length(normal);
+			if (length > 0.0f) {
+				normal /= length;
+				for (int k = 0; k < 3; k++) { quadrics[tri[k]].AddPlane(normal, -glm::dot(normal, positions[tri[0]]), 1.0); }
+			}
+
+			for (int k = 0; k < 3; k++) {
+				uint64_t key = EdgeKey(tri[k], tri[(k + 1) % 3]);
+				edgeUses[key]++;
+				edgeTriangle[key] = t;
+			}
+		}
+		for (const auto& edge : edgeUses) {
+			if (edge.second != 1) { continue; }
+
+			uint32_t a = (uint32_t)(edge.first >> 32), b = (uint32_t)(edge.first & 0xFFFFFFFF);
+			const uint32_t* tri = &welded[edgeTriangle[edge.first] * 3];
+			Vec3F faceNormal = TriangleNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+			Vec3F borderNormal = glm::cross(positions[b] - positions[a], faceNormal);
+			float length = glm::length(borderNormal);
+			if (length <= 0.0f) { continue; }
+
+			borderNormal /= length;
+			float distance = -glm::dot(borderNormal, positions[a]);
+			quadrics[a].AddPlane(borderNormal, distance, MESH_LOD_BORDER_WEIGHT);
+			quadrics[b].AddPlane(borderNormal, distance, MESH_LOD_BORDER_WEIGHT);
+		}
+
+		// Cheapest direction of every edge. Entries go stale when either end changes, the version catches that
+		std::vector<uint32_t> versions(weldCount, 0);
+		std::vector<uint8_t> weldAlive(weldCount, 1);
+		std::priority_queue<LODCollapse, std::vector<LODCollapse>, std::greater<LODCollapse>> heap;
+		auto pushEdge = [&](const uint32_t in_a, const uint32_t in_b) {
+			LODQuadric sum = quadrics[in_a];
+			sum.Add(quadrics[in_b]);
+			double costToB = sum.Evaluate(positions[in_b]);
+			double costToA = sum.Evaluate(positions[in_a]);
+
+			LODCollapse collapse;
+			collapse.cost = std::min(costToA, costToB);
+			collapse.from = costToB <= costToA ? in_a : in_b;
+			collapse.to = costToB <= costToA ? in_b : in_a;
+			collapse.fromVersion = versions[collapse.from];
+			collapse.toVersion = versions[collapse.to];
+			heap.push(collapse);
+		};
+		for (const auto& edge : edgeUses) { pushEdge((uint32_t)(edge.first >> 32), (uint32_t)(edge.first & 0xFFFFFFFF)); }
+
+		const uint32_t targetTriangles = (uint32_t)(in_targetIndexCount / 3);
+		const double maxCost = (double)in_maxError * in_maxError;
+		double worstCost = 0.0;
+		std::vector<uint32_t> neighbors;
+
+		while (liveTriangles > targetTriangles && !heap.empty()) {
+			LODCollapse collapse = heap.top();
+			heap.pop();
+
+			if (!weldAlive[collapse.from] || !weldAlive[collapse.to]) { continue; }
+			if (versions[collapse.from] != collapse.fromVersion || versions[collapse.to] != collapse.toVersion) { continue; }
+			if (collapse.cost > maxCost) { break; }
+
+			// Moving from onto to must not turn any surviving triangle around
+			bool flips = false;
+			for (uint32_t t : trianglesOf[collapse.from]) {
+				if (!triangleAlive[t]) { continue; }
+
+				const uint32_t* tri = &welded[t * 3];
+				if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) { continue; }
+
+				Vec3F moved[3];
+				for (int k = 0; k < 3; k++) { moved[k] = tri[k] == collapse.from ? positions[collapse.to] : positions[tri[k]]; }
+				Vec3F before = TriangleNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+				Vec3F after = TriangleNormal(moved[0], moved[1], moved[2]);
+
+				float lengths = glm::length(before) * glm::length(after);
+				if (lengths <= 0.0f || glm::dot(before, after) < MESH_LOD_FLIP_LIMIT * lengths) { flips = true; break; }
+			}
+			if (flips) { continue; }
+
+			for (uint32_t t : trianglesOf[collapse.from]) {
+				if (!triangleAlive[t]) { continue; }
+
+				uint32_t* tri = &welded[t * 3];
+				if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) {
+					triangleAlive[t] = 0;
+					liveTriangles--;
+					continue;
+				}
+
+				for (int k = 0; k < 3; k++) { if (tri[k] == collapse.from) { tri[k] = collapse.to; } }
+				trianglesOf[collapse.to].push_back(t);
+			}
+			trianglesOf[collapse.from].clear();
+
+			quadrics[collapse.to].Add(quadrics[collapse.from]);
+			weldAlive[collapse.from] = 0;
+			versions[collapse.to]++;
+			worstCost = std::max(worstCost, collapse.cost);
+
+			// Only the edges around to changed cost, drop the dead triangles from its list on the way
+			std::vector<uint32_t>& around = trianglesOf[collapse.to];
+			around.erase(std::remove_if(around.begin(), around.end(), [&triangleAlive](const uint32_t in_t) { return !triangleAlive[in_t]; }), around.end());
+
+			neighbors.clear();
+			for (uint32_t t : around) {
+				for (int k = 0; k < 3; k++) { if (welded[t * 3 + k] != collapse.to) { neighbors.push_back(welded[t * 3 + k]); } }
+			}
+			std::sort(neighbors.begin(), neighbors.end());
+			neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+			for (uint32_t neighbor : neighbors) { pushEdge(collapse.to, neighbor); }
+		}
+
+		// Back to real vertices. A corner whose welded vertex moved takes the closest match at its new spot
+		auto attributeDistance = [&in_vertices](const uint32_t in_a, const uint32_t in_b) {
+			const Vertex& a = in_vertices[in_a];
+			const Vertex& b = in_vertices[in_b];
+			Vec2F uv = a.texCoord - b.texCoord;
+			Vec4F color = a.color - b.color;
+			return (1.0f - glm::dot(a.normal, b.normal)) + glm::dot(uv, uv) + glm::dot(color, color);
+		};
+
+		out_pIndices->reserve(liveTriangles * 3);
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			if (!triangleAlive[t]) { continue; }
+
+			for (int k = 0; k < 3; k++) {
+				uint32_t corner = corners[t * 3 + k];
+				uint32_t target = welded[t * 3 + k];
+				if (weldOf[corner] == target) { out_pIndices->push_back(corner); continue; }
+
+				uint32_t best = sorted[weldFirst[target]];
+				float bestDistance = attributeDistance(corner, best);
+				for (uint32_t i = weldFirst[target] + 1; i < weldFirst[target + 1]; i++) {
+					float distance = attributeDistance(corner, sorted[i]);
+					if (distance < bestDistance) { bestDistance = distance; best = sorted[i]; }
+				}
+				out_pIndices->push_back(best);
+			}
+		}
+
+		return (float)std::sqrt(worstCost);
+	}
+
+	void GenerateMeshLODs(const std::vector<Vertex>& in_vertices, const std::vector<INDEX_TYPE>& in_indices, const ConstructInfoMeshLOD* in_pInfo,
+		std::vector<MeshLODLevel>* out_pLevels)
+	{
+		ConstructInfoMeshLOD info = in_pInfo ? *in_pInfo : ConstructInfoMeshLOD();
+		MEGA_ASSERT(info.levelCount <= MESH_LOD_MAX_LEVELS, "More LOD levels than VertexData has room for");
+		out_pLevels->clear();
+
+		if (in_vertices.empty()) { return; }
+
+		Vec3F boundsMin = in_vertices[0].pos, boundsMax = in_vertices[0].pos;
+		for (const Vertex& vertex : in_vertices) {
+			boundsMin = glm::min(boundsMin, vertex.pos);
+			boundsMax = glm::max(boundsMax, vertex.pos);
+		}
+		const float maxError = info.maxError * glm::length(boundsMax - boundsMin);
+
+		size_t previousCount = in_indices.size();
+		float target = (float)in_indices.size();
+		for (uint32_t level = 1; level < info.levelCount; level++) {
+			target *= info.reduction;
+			if (target < MESH_LOD_MIN_TRIANGLES * 3) { break; }
+
+			MeshLODLevel lod;
+			lod.error = SimplifyMesh(in_vertices, in_indices, (size_t)target, maxError, &lod.indices);
+
+			// Ran into maxError before getting much smaller, coarser targets wont do better
+			if (lod.indices.empty() || lod.indices.size() > previousCount * MESH_LOD_MIN_PROGRESS) { break; }
+
+			previousCount = lod.indices.size();
+			out_pLevels->push_back(std::move(lod));
+		}
+	}
+}
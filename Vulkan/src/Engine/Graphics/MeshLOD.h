@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+#include "Engine/Graphics/Objects/ModelData.h"
+#include "Engine/Graphics/Objects/Vertex.h"
+
+#define MESH_LOD_DEFAULT_REDUCTION 0.5f  // Each level keeps about this fraction of the previous one's triangles
+#define MESH_LOD_DEFAULT_MAX_ERROR 0.05f // Largest error a level may have, as a fraction of the bounds' diagonal
+#define MESH_LOD_MIN_PROGRESS      0.9f  // A level that doesn't get below this fraction of the last one is dropped
+#define MESH_LOD_MIN_TRIANGLES     uint32_t(16)
+#define MESH_LOD_BORDER_WEIGHT     10.0  // Open edges are held in place this much harder than surfaces
+#define MESH_LOD_FLIP_LIMIT        0.2f  // Cosine between a triangle's old and new normal below which a collapse is refused
+
+namespace Mega
+{
+	struct ConstructInfoMeshLOD {
+		uint32_t levelCount = MESH_LOD_MAX_LEVELS; // Including the full mesh
+		float reduction = MESH_LOD_DEFAULT_REDUCTION;
+		float maxError = MESH_LOD_DEFAULT_MAX_ERROR;
+	};
+
+	struct MeshLODLevel {
+		std::vector<INDEX_TYPE> indices; // Into the same vertices as the full mesh
+		float error = 0.0f;              // Object space
+	};
+
+	// Quadric error edge collapse. Vertices are welded by position so the simplification sees through UV
+	// and normal seams, and every collapse moves one end of an edge onto the other, so the result only
+	// needs new indices. Corners that got moved take whichever vertex at their new position has the
+	// closest normal/uv/color. Stops at in_targetIndexCount or when the next collapse would cost more
+	// than in_maxError, and returns the error of what it did
+	float SimplifyMesh(const std::vector<Vertex>& in_vertices, const std::vector<INDEX_TYPE>& in_indices, const size_t in_targetIndexCount, const float in_maxError,
+		std::vector<INDEX_TYPE>* out_pIndices);
+
+	// Levels after the full mesh, each simplified from the full mesh with a smaller target. Fewer than
+	// levelCount - 1 come back when the mesh is too small or stops simplifying within maxError
+	void GenerateMeshLODs(const std::vector<Vertex>& in_vertices, const std::vector<INDEX_TYPE>& in_indices, const ConstructInfoMeshLOD* in_pInfo,
+		std::vector<MeshLODLevel>* out_pLevels);
+}
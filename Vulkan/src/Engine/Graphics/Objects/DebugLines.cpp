@@ -0,0 +1,97 @@
+#include "DebugLines.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <GLM/geometric.hpp>
+#include <GLM/common.hpp>
+
+#include "Engine/Graphics/Objects/Model.h"
+#include "Engine/Graphics/Objects/Light.h"
+
+namespace Mega
+{
+	uint32_t DebugLines::PackColor(const Vec4F& in_color)
+	{
+		Vec4F clamped = glm::clamp(in_color, Vec4F(0.0f), Vec4F(1.0f)) * 255.0f + 0.5f;
+
+		return (uint32_t)clamped.r | ((uint32_t)clamped.g << 8) | ((uint32_t)clamped.b << 16) | ((uint32_t)clamped.a << 24);
+	}
+
+	void DebugLines::AddBox(const Vec3F& in_min, const Vec3F& in_max, const uint32_t in_color)
+	{
+		AddBox(in_min, in_max, Mat4x4F(1.0f), in_color);
+	}
+
+	void DebugLines::AddBox(const Vec3F& in_min, const Vec3F& in_max, const Mat4x4F& in_transform, const uint32_t in_color)
+	{
+		// Corner i takes x from bit 0, y from bit 1, z from bit 2
+		Vec3F corners[8];
+		for (uint32_t i = 0; i < 8; i++) {
+			Vec3F corner((i & 1) ? in_max.x : in_min.x, (i & 2) ? in_max.y : in_min.y, (i & 4) ? in_max.z : in_min.z);
+			corners[i] = Vec3F(in_transform * Vec4F(corner, 1.0f));
+		}
+
+		static const uint8_t s_edges[12][2] = {
+			{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, // Along x
+			{ 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 }, // Along y
+			{ 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }, // Along z
+		};
+		for (const auto& edge : s_edges) {
+			AddLine(corners[edge[0]], corners[edge[1]], in_color);
+		}
+	}
+
+	void DebugLines::AddCircle(const Vec3F& in_center, const Vec3F& in_axisU, const Vec3F& in_axisV, const float in_radius, const uint32_t in_color)
+	{
+		const float step = 2.0f * PI / (float)DEBUG_LINES_CIRCLE_SEGMENTS;
+
+		Vec3F previous = in_center + in_axisU * in_radius;
+		for (uint32_t i = 1; i <= DEBUG_LINES_CIRCLE_SEGMENTS; i++) {
+			float angle = step * (float)i;
+			Vec3F current = in_center + (in_axisU * std::cos(angle) + in_axisV * std::sin(angle)) * in_radius;
+
+			AddLine(previous, current, in_color);
+			previous = current;
+		}
+	}
+
+	void DebugLines::AddSphere(const Vec3F& in_center, const float in_radius, const uint32_t in_color)
+	{
+		AddCircle(in_center, Vec3F(1.0f, 0.0f, 0.0f), Vec3F(0.0f, 1.0f, 0.0f), in_radius, in_color);
+		AddCircle(in_center, Vec3F(0.0f, 1.0f, 0.0f), Vec3F(0.0f, 0.0f, 1.0f), in_radius, in_color);
+		AddCircle(in_center, Vec3F(0.0f, 0.0f, 1.0f), Vec3F(1.0f, 0.0f, 0.0f), in_radius, in_color);
+	}
+
+	void DebugLines::AddModelBounds(const Model& in_model, const uint32_t in_color)
+	{
+		Model::PushConstant pushData;
+		in_model.GetPushConstantData(&pushData);
+
+		const VertexData* pVertexData = in_model.GetVertexData();
+		AddBox(pVertexData->boundsMin, pVertexData->boundsMax, pushData.model, in_color);
+	}
+
+	void DebugLines::AddLightRadius(const Light& in_light, const uint32_t in_color)
+	{
+		if (in_light.type == eLightTypes::Directional) {
+			AddLine(in_light.position, in_light.position + glm::normalize(in_light.direction), in_color);
+			return;
+		}
+
+		// Solve strength / (constant + linear * d + quadratic * d^2) = 1/256 for d
+		float a = in_light.quadratic;
+		float b = in_light.linear;
+		float c = in_light.constant - 256.0f * in_light.strength;
+
+		float radius = 0.0f;
+		if (a > 0.0f) { radius = (-b + std::sqrt(std::max(b * b - 4.0f * a * c, 0.0f))) / (2.0f * a); }
+		else if (b > 0.0f) { radius = -c / b; }
+		if (radius <= 0.0f) { return; }
+
+		AddSphere(in_light.position, radius, in_color);
+		if (in_light.type == eLightTypes::Spotlight) {
+			AddLine(in_light.position, in_light.position + glm::normalize(in_light.direction) * radius, in_color);
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Engine/Core/Math/Math.h"
+#include "Engine/Graphics/Objects/Vertex.h"
+
+#define DEBUG_LINES_RESERVE_VERTICES uint32_t(1 << 18)
+#define DEBUG_LINES_CIRCLE_SEGMENTS  uint32_t(24)
+
+namespace Mega
+{
+	class Model;
+	struct Light;
+}
+
+namespace Mega
+{
+	// Immediate mode line list, refilled every frame. Anything can add to it (physics debug drawing,
+	// culling bounds, gameplay code) and the renderer uploads the whole thing into one vertex buffer
+	// and draws it with a single call
+	class DebugLines {
+	public:
+		DebugLines() { m_vertices.reserve(DEBUG_LINES_RESERVE_VERTICES); }
+
+		static uint32_t PackColor(const Vec3F& in_color) { return PackColor(Vec4F(in_color, 1.0f)); }
+		static uint32_t PackColor(const Vec4F& in_color);
+
+		void Clear() { m_vertices.clear(); }
+		void Reserve(const uint32_t in_lineCount) { m_vertices.reserve((size_t)in_lineCount * 2); }
+
+		void AddLine(const Vec3F& in_from, const Vec3F& in_to, const uint32_t in_color) {
+			m_vertices.push_back({ in_from, in_color });
+			m_vertices.push_back({ in_to, in_color });
+		}
+		void AddLine(const Vec3F& in_from, const Vec3F& in_to, const Vec3F& in_color) { AddLine(in_from, in_to, PackColor(in_color)); }
+
+		void AddBox(const Vec3F& in_min, const Vec3F& in_max, const uint32_t in_color);
+		// Box in in_transform's space, how object space bounds get drawn in world space
+		void AddBox(const Vec3F& in_min, const Vec3F& in_max, const Mat4x4F& in_transform, const uint32_t in_color);
+		void AddCircle(const Vec3F& in_center, const Vec3F& in_axisU, const Vec3F& in_axisV, const float in_radius, const uint32_t in_color);
+		// Three great circles, cheap enough to draw thousands of
+		void AddSphere(const Vec3F& in_center, const float in_radius, const uint32_t in_color);
+
+		void AddModelBounds(const Model& in_model, const uint32_t in_color);
+		// Point/spot lights get a sphere where their attenuation drops below 1/256, directional lights an arrow
+		void AddLightRadius(const Light& in_light, const uint32_t in_color);
+
+		const std::vector<LineVertex>& GetVertices() const { return m_vertices; }
+		uint32_t GetLineCount() const { return (uint32_t)m_vertices.size() / 2; }
+
+	private:
+		std::vector<LineVertex> m_vertices;
+	};
+}
@@ -3,6 +3,8 @@
 #include <iostream>
 
 #include <GLM/gtc/matrix_transform.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <GLM/gtx/euler_angles.hpp>
 
 namespace Mega
 {
@@ -55,20 +57,43 @@ namespace Mega
 		SetTextureData(in_tData);
 	}
 
+	Vec3F Model::GetRotation() const
+	{
+		if (!m_useTransform) { return m_rotation; }
+
+		// Same order GetPushConstantData rotates in, scale taken out first in case the matrix has any
+		Mat4x4F rotation(1.0f);
+		rotation[0] = Vec4F(glm::normalize(Vec3F(m_transform[0])), 0.0f);
+		rotation[1] = Vec4F(glm::normalize(Vec3F(m_transform[1])), 0.0f);
+		rotation[2] = Vec4F(glm::normalize(Vec3F(m_transform[2])), 0.0f);
+
+		Vec3F out_rotation;
+		glm::extractEulerAngleXYZ(rotation, out_rotation.x, out_rotation.y, out_rotation.z);
+		return out_rotation;
+	}
+
 	void Model::GetPushConstantData(Model::PushConstant* in_pData) const
 	{
 		// Model
-		in_pData->model[3][0] = m_position.x;
-		in_pData->model[3][1] = m_position.y;
-		in_pData->model[3][2] = m_position.z;
+		if (m_useTransform) {
+			in_pData->model[0] = m_transform[0] * m_scale.x;
+			in_pData->model[1] = m_transform[1] * m_scale.y;
+			in_pData->model[2] = m_transform[2] * m_scale.z;
+			in_pData->model[3] = m_transform[3];
+		}
+		else {
+			in_pData->model[3][0] = m_position.x;
+			in_pData->model[3][1] = m_position.y;
+			in_pData->model[3][2] = m_position.z;
 
-		in_pData->model[0][0] = m_scale.x;
-		in_pData->model[1][1] = m_scale.y;
-		in_pData->model[2][2] = m_scale.z;
+			in_pData->model[0][0] = m_scale.x;
+			in_pData->model[1][1] = m_scale.y;
+			in_pData->model[2][2] = m_scale.z;
 
-		in_pData->model = glm::rotate(in_pData->model, m_rotation.x, Vec3F(1, 0, 0));
-		in_pData->model = glm::rotate(in_pData->model, m_rotation.y, Vec3F(0, 1, 0));
-		in_pData->model = glm::rotate(in_pData->model, m_rotation.z, Vec3F(0, 0, 1));
+			in_pData->model = glm::rotate(in_pData->model, m_rotation.x, Vec3F(1, 0, 0));
+			in_pData->model = glm::rotate(in_pData->model, m_rotation.y, Vec3F(0, 1, 0));
+			in_pData->model = glm::rotate(in_pData->model, m_rotation.z, Vec3F(0, 0, 1));
+		}
 
 		// Color
 		in_pData->color = m_color;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Engine/Graphics/Objects/ModelData.h"
+#include "Engine/Animation/AnimationHandle.h"
 #include "Engine/Core/Math/Math.h"
 
 #define GLM_FORCE_RADIANS
@@ -16,17 +17,47 @@ namespace Mega
 		void SetVertexData(VertexData in_data) { m_vertexData = in_data; }
 		void SetTextureData(TextureData in_data) { m_textureData = in_data; }
 
-		Vec3F GetPosition() const { return m_position; }
-		Vec3F GetRotation() const { return m_rotation; }
+		Vec3F GetPosition() const { return m_useTransform ? Vec3F(m_transform[3]) : m_position; }
+		// Euler angles (x, then y, then z), taken out of the bound matrix when there is one
+		Vec3F GetRotation() const;
 		Vec3F GetScale()    const { return m_scale; }
 
 		void SetPosition(const Vec3F& in_position) { m_position = in_position; }
 		void SetRotation(const Vec3F& in_rotation) { m_rotation = in_rotation; }
 
+		// Drive the model with a full world matrix instead of position/euler rotation (scale still applies).
+		// The physics transform sync writes straight into GetTransformStorage()
+		void SetTransform(const Mat4x4F& in_transform) { m_transform = in_transform; m_useTransform = true; }
+		Mat4x4F* GetTransformStorage() { m_useTransform = true; return &m_transform; }
+		bool UsesTransform() const { return m_useTransform; }
+
 		void SetScale(const Vec3F& in_scale) { m_scale = in_scale; }
 		void SetColor(const Vec4F& in_color) { m_color = in_color; }
 		void SetColor(const Vec3F& in_color) { m_color = Vec4F(in_color.x, in_color.y, in_color.z, 1.0f); }
 
+		// Set by Scene::AddStaticModel. Static models are baked into the scene's static batches, moving
+		// one afterwards does nothing until the batches are rebuilt
+		void SetStatic(const bool in_static) { m_static = in_static; }
+		bool IsStatic() const { return m_static; }
+
+		// Occluders are rasterized into the renderer's cpu depth buffer and hide whatever is behind them
+		// before it gets recorded. Meant for a few big, low poly models (walls, terrain, buildings)
+		void SetOccluder(const bool in_occluder) { m_occluder = in_occluder; }
+		bool IsOccluder() const { return m_occluder; }
+
+		// Last portal cell the renderer found the model in (-1 for none), checked first on the next lookup
+		void SetPortalCell(const int32_t in_cell) { m_portalCell = in_cell; }
+		int32_t GetPortalCell() const { return m_portalCell; }
+
+		// Picked by the renderer every frame from how big the simplification error looks on screen, the
+		// last pick is kept so the next one can hold on to it a little (no popping back and forth)
+		void SetLodLevel(const uint32_t in_level) { m_lodLevel = in_level; }
+		uint32_t GetLodLevel() const { return m_lodLevel; }
+
+		// Character in the scene's AnimationSystem posing this model, only used with a skinned mesh
+		void SetAnimation(const AnimationHandle in_handle) { m_animation = in_handle; }
+		AnimationHandle GetAnimation() const { return m_animation; }
+
 		void SetTileSize(const Vec2F& in_dim) { m_tileSize = in_dim; }
 		void SetTileTexCoords(const Vec2F& in_coords) { m_texCoords = in_coords; }
 
@@ -45,6 +76,12 @@ namespace Mega
 		Vec3F m_rotation = Vec3F(0.0f, 0.0f, 0.0f);
 		Vec3F m_position = Vec3F(0.0f, 0.0f, 0.0f);
 		Mat4x4F m_transform = Mat4x4F(1.0f);
+		bool m_useTransform = false;
+		bool m_static = false;
+		bool m_occluder = false;
+		uint32_t m_lodLevel = 0;
+		int32_t m_portalCell = -1;
+		AnimationHandle m_animation;
 
 		Vec4F m_color = Vec4F(1.0f);
 
@@ -4,6 +4,8 @@
 
 #include "Engine/Core/Math/Vec.h"
 
+#define MESH_LOD_MAX_LEVELS 4 // Including the full mesh
+
 namespace Mega
 {
 	enum class eModelType {
@@ -12,8 +14,27 @@ namespace Mega
 		TEXT
 	};
 
+	struct MeshLOD {
+		uint32_t indices[2] = { 0, 0 };
+		float error = 0.0f; // How far (object space) the simplified surface can be from the real one
+	};
+
 	struct VertexData {
 		uint32_t indices[2] = { 0, 0 };
+
+		// Object space bounds of the mesh, filled in when the OBJ is loaded
+		Vec3F boundsMin = Vec3F(0.0f);
+		Vec3F boundsMax = Vec3F(0.0f);
+
+		// Simplified index ranges over the same vertices, lods[0] is the full mesh and the coarsest is
+		// last. No LODs (lodCount 0) means indices is always drawn
+		MeshLOD lods[MESH_LOD_MAX_LEVELS];
+		uint32_t lodCount = 0;
+
+		// Skinned meshes only, their AnimatedVertex range in the skinning source buffer. Their indices
+		// start at 0 and are drawn against the skinned copy of these vertices
+		uint32_t skinVertices[2] = { 0, 0 };
+		bool IsSkinned() const { return skinVertices[1] > skinVertices[0]; }
 	};
 
 	struct TextureData {
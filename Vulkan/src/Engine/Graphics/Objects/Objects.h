@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Engine/Graphics/Objects/DebugLines.h"
 #include "Engine/Graphics/Objects/Light.h"
 #include "Engine/Graphics/Objects/Model.h"
 #include "Engine/Graphics/Objects/ModelData.h"
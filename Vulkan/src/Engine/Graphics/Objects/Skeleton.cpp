@@ -1,33 +1,52 @@
 #include "Skeleton.h"
 
-// bool LoadMesh(const std::string&  )
-// {
-//     // Release the previously loaded mesh (if it exists)
-//     Clear();
-// 
-//     // Create the VAO
-//     glGenVertexArrays(1, &m_VAO);
-//     glBindVertexArray(m_VAO);
-// 
-//     // Create the buffers for the vertices attributes
-//     glGenBuffers(ARRAY_SIZE_IN_ELEMENTS(m_Buffers), m_Buffers);
-// 
-//     bool Ret = false;
-// 
-//     m_pScene = m_Importer.ReadFile(Filename.c_str(), aiProcess_Triangulate | aiProcess_GenSmoothNormals |
-//         aiProcess_FlipUVs);
-// 
-//     if (m_pScene) {
-//         m_GlobalInverseTransform = m_pScene->mRootNode->mTransformation;
-//         m_GlobalInverseTransform.Inverse();
-//         Ret = InitFromScene(m_pScene, Filename);
-//     }
-//     else {
-//         printf("Error parsing '%s': '%s'\n", Filename.c_str(), m_Importer.GetErrorString());
-//     }
-// 
-//     // Make sure the VAO is not changed from the outside
-//     glBindVertexArray(0);
-// 
-//     return Ret;
-// }
\ No newline at end of file
+#include <cstdio>
+
+#include <ozz/base/io/archive.h>
+#include <ozz/base/io/stream.h>
+#include <ozz/animation/runtime/skeleton_utils.h>
+
+namespace Mega
+{
+	// Both archives are an ozz tag followed by the object, T is the runtime type the tag belongs to
+	template<typename T>
+	static bool LoadArchive(const char* in_filePath, const char* in_kind, T* out_pObject)
+	{
+		ozz::io::File file(in_filePath, "rb");
+		if (!file.opened()) {
+			printf("ERROR: Could not open %s file %s\n", in_kind, in_filePath);
+			return false;
+		}
+
+		ozz::io::IArchive archive(&file);
+		if (!archive.TestTag<T>()) {
+			printf("ERROR: %s isn't an ozz %s archive\n", in_filePath, in_kind);
+			return false;
+		}
+
+		archive >> *out_pObject;
+		return true;
+	}
+
+	bool Skeleton::Load(const char* in_filePath)
+	{
+		if (!LoadArchive(in_filePath, "skeleton", &m_skeleton)) { return false; }
+
+		BuildLeafMask();
+		return true;
+	}
+
+	void Skeleton::BuildLeafMask()
+	{
+		const ozz::span<const int16_t> parents = m_skeleton.joint_parents();
+		m_leafMask.resize(parents.size());
+		for (int32_t joint = 0; joint < m_skeleton.num_joints(); joint++) {
+			m_leafMask[joint] = parents[joint] != ozz::animation::Skeleton::kNoParent && ozz::animation::IsLeaf(m_skeleton, joint) ? 1 : 0;
+		}
+	}
+
+	bool AnimationClip::Load(const char* in_filePath)
+	{
+		return LoadArchive(in_filePath, "animation", &m_animation);
+	}
+}
@@ -1,3 +1,58 @@
 #pragma once
 
-#include "Engine/Graphics/Objects/Model.h"
\ No newline at end of file
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <ozz/animation/runtime/animation.h>
+#include <ozz/animation/runtime/skeleton.h>
+
+#include "Engine/Core/Math/Math.h"
+#include "Engine/Graphics/Objects/Vertex.h"
+
+namespace Mega
+{
+	// Joint hierarchy and rest pose, loaded from an ozz archive. Shared by every character using it and
+	// never changed after loading, so any number of jobs can read it at once
+	class Skeleton {
+	public:
+		bool Load(const char* in_filePath);
+		// Takes a skeleton built in memory (the offline builders) instead of loading one
+		void Set(ozz::animation::Skeleton&& in_skeleton) { m_skeleton = std::move(in_skeleton); BuildLeafMask(); }
+
+		uint32_t GetJointCount() const { return (uint32_t)m_skeleton.num_joints(); }
+		uint32_t GetSoaJointCount() const { return (uint32_t)m_skeleton.num_soa_joints(); }
+		const ozz::animation::Skeleton& GetRaw() const { return m_skeleton; }
+		// One per joint, set for joints without children (fingers, toes, face). Roots never are, so a
+		// masked joint always has a parent to follow
+		const std::vector<uint8_t>& GetLeafMask() const { return m_leafMask; }
+
+	private:
+		void BuildLeafMask();
+
+		ozz::animation::Skeleton m_skeleton;
+		std::vector<uint8_t> m_leafMask;
+	};
+
+	// One clip of compressed keyframes for a skeleton, read only after loading like Skeleton
+	class AnimationClip {
+	public:
+		bool Load(const char* in_filePath);
+		void Set(ozz::animation::Animation&& in_animation) { m_animation = std::move(in_animation); }
+
+		float GetDuration() const { return m_animation.duration(); }
+		uint32_t GetTrackCount() const { return (uint32_t)m_animation.num_tracks(); }
+		const ozz::animation::Animation& GetRaw() const { return m_animation; }
+
+	private:
+		ozz::animation::Animation m_animation;
+	};
+
+	// Mesh bound to a skeleton, what the renderer's LoadSkinnedMesh uploads. Bone indices in the vertices
+	// are skeleton joint indices
+	struct SkinnedMeshData {
+		std::vector<AnimatedVertex> vertices;
+		std::vector<INDEX_TYPE> indices;       // Start at 0
+		std::vector<Mat4x4F> inverseBindPoses; // One per skeleton joint, model space to joint space in the bind pose
+	};
+}
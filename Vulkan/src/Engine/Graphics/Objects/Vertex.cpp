@@ -1,5 +1,8 @@
 #include "Vertex.h"
 
+#include <cmath>
+
+#include "Engine/Core/Debug.h"
 #include "Engine/Graphics/Vulkan/VulkanInclude.h"
 
 namespace Mega
@@ -53,9 +56,9 @@ namespace Mega
 		return out_bindingDescription;
 	}
 
-	std::array<VkVertexInputAttributeDescription, 4> AnimatedVertex::GetAttributeDescriptions()
+	std::array<VkVertexInputAttributeDescription, 5> AnimatedVertex::GetAttributeDescriptions()
 	{
-		std::array<VkVertexInputAttributeDescription, 4> out_attributeDescriptions{};
+		std::array<VkVertexInputAttributeDescription, 5> out_attributeDescriptions{};
 
 		out_attributeDescriptions[0].binding = 0;
 		out_attributeDescriptions[0].location = 0;
@@ -74,24 +77,81 @@ namespace Mega
 
 		out_attributeDescriptions[3].binding = 0;
 		out_attributeDescriptions[3].location = 3;
-		out_attributeDescriptions[3].format = VK_FORMAT_R32G32B32_SFLOAT;
-		out_attributeDescriptions[3].offset = offsetof(AnimatedVertex, tangent);
+		out_attributeDescriptions[3].format = VK_FORMAT_R8G8B8A8_UINT;
+		out_attributeDescriptions[3].offset = offsetof(AnimatedVertex, boneIndices);
 
-		out_attributeDescriptions[3].binding = 0;
-		out_attributeDescriptions[3].location = 3;
-		out_attributeDescriptions[3].format = VK_FORMAT_R32G32B32_SFLOAT;
-		out_attributeDescriptions[3].offset = offsetof(AnimatedVertex, biTangent);
+		out_attributeDescriptions[4].binding = 0;
+		out_attributeDescriptions[4].location = 4;
+		out_attributeDescriptions[4].format = VK_FORMAT_R8G8B8A8_UNORM;
+		out_attributeDescriptions[4].offset = offsetof(AnimatedVertex, boneWeights);
 
-		out_attributeDescriptions[3].binding = 0;
-		out_attributeDescriptions[3].location = 3;
-		out_attributeDescriptions[3].format = VK_FORMAT_R32_SINT;
-		out_attributeDescriptions[3].offset = offsetof(AnimatedVertex, boneIDs);
+		return out_attributeDescriptions;
+	}
 
-		out_attributeDescriptions[3].binding = 0;
-		out_attributeDescriptions[3].location = 3;
-		out_attributeDescriptions[3].format = VK_FORMAT_R32_SFLOAT;
-		out_attributeDescriptions[3].offset = offsetof(AnimatedVertex, weights);
+	void AnimatedVertex::SetInfluences(const uint32_t* in_pJoints, const float* in_pWeights, const uint32_t in_count)
+	{
+		// Heaviest first, insertion sorted into a fixed size list
+		uint32_t joints[MAX_BONE_INFLUENCE] = {};
+		float weights[MAX_BONE_INFLUENCE] = {};
+		for (uint32_t i = 0; i < in_count; i++) {
+			if (in_pWeights[i] <= weights[MAX_BONE_INFLUENCE - 1]) { continue; }
+
+			uint32_t slot = MAX_BONE_INFLUENCE - 1;
+			while (slot > 0 && in_pWeights[i] > weights[slot - 1]) {
+				joints[slot] = joints[slot - 1];
+				weights[slot] = weights[slot - 1];
+				slot--;
+			}
+			joints[slot] = in_pJoints[i];
+			weights[slot] = in_pWeights[i];
+		}
+
+		float total = 0.0f;
+		for (uint32_t i = 0; i < MAX_BONE_INFLUENCE; i++) { total += weights[i]; }
+
+		// No influences at all sticks to joint 0
+		if (total <= 0.0f) {
+			joints[0] = 0;
+			weights[0] = 1.0f;
+			total = 1.0f;
+		}
+
+		// Rounding can leave the sum off by a few, the heaviest influence takes up the difference
+		int32_t sum = 0;
+		for (uint32_t i = 0; i < MAX_BONE_INFLUENCE; i++) {
+			MEGA_ASSERT(joints[i] <= UINT8_MAX, "Skinned vertices can only use the first 256 joints");
+			boneIndices[i] = (uint8_t)joints[i];
+			boneWeights[i] = (uint8_t)std::lround(weights[i] / total * 255.0f);
+			sum += boneWeights[i];
+		}
+		boneWeights[0] = (uint8_t)(boneWeights[0] + (255 - sum));
+	}
+
+	// ===================== LINE VERTEX ====================== //
+	VkVertexInputBindingDescription LineVertex::GetBindingDescription()
+	{
+		VkVertexInputBindingDescription out_bindingDescription{};
+		out_bindingDescription.binding = 0;
+		out_bindingDescription.stride = sizeof(LineVertex);
+		out_bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return out_bindingDescription;
+	}
+
+	std::array<VkVertexInputAttributeDescription, 2> LineVertex::GetAttributeDescriptions()
+	{
+		std::array<VkVertexInputAttributeDescription, 2> out_attributeDescriptions{};
+
+		out_attributeDescriptions[0].binding = 0;
+		out_attributeDescriptions[0].location = 0;
+		out_attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		out_attributeDescriptions[0].offset = offsetof(LineVertex, pos);
+
+		out_attributeDescriptions[1].binding = 0;
+		out_attributeDescriptions[1].location = 1;
+		out_attributeDescriptions[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+		out_attributeDescriptions[1].offset = offsetof(LineVertex, color);
 
 		return out_attributeDescriptions;
 	}
-}
\ No newline at end of file
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <cstring>
 
 #include "Engine/Graphics/Vulkan/VulkanDefines.h"
 #include "Engine/Core/Math/Math.h"
@@ -24,22 +26,35 @@ namespace Mega
 		}
 	};
 
+	// Source vertex for the skinning pre-pass, 40 bytes. Bone indices are 8 bit (so at most 256 joints
+	// per skeleton) and the weights unorm8 summing to 255
 	struct AnimatedVertex {
 		glm::vec3 pos = { 0.0f, 0.0f, 0.0f };
 		glm::vec3 normal = { 0.0f, 0.0f, 1.0f };
 		glm::vec2 texCoord = { 0.0f, 0.0f };
 
-		glm::vec3 tangent = { 0.0f, 0.0f, 0.0f };
-		glm::vec3 biTangent = { 0.0f, 0.0f, 0.0f };
+		uint8_t boneIndices[MAX_BONE_INFLUENCE] = { 0, 0, 0, 0 };
+		uint8_t boneWeights[MAX_BONE_INFLUENCE] = { 255, 0, 0, 0 };
 
-		int boneIDs[MAX_BONE_INFLUENCE];
-		float weights[MAX_BONE_INFLUENCE];
+		// Keeps the MAX_BONE_INFLUENCE heaviest of in_count influences and quantizes them, the weights
+		// don't have to be normalized
+		void SetInfluences(const uint32_t* in_pJoints, const float* in_pWeights, const uint32_t in_count);
 
 		static VkVertexInputBindingDescription GetBindingDescription();
-		static std::array<VkVertexInputAttributeDescription, 4> GetAttributeDescriptions();
+		static std::array<VkVertexInputAttributeDescription, 5> GetAttributeDescriptions();
 
 		bool operator==(const AnimatedVertex& other) const {
-			return pos == other.pos && normal == other.normal && texCoord == other.texCoord && tangent == other.tangent && biTangent == other.biTangent;
+			return pos == other.pos && normal == other.normal && texCoord == other.texCoord &&
+				std::memcmp(boneIndices, other.boneIndices, sizeof(boneIndices)) == 0 && std::memcmp(boneWeights, other.boneWeights, sizeof(boneWeights)) == 0;
 		}
 	};
+
+	// Debug line vertex, color packed as RGBA8 so a segment is 32 bytes
+	struct LineVertex {
+		glm::vec3 pos = { 0.0f, 0.0f, 0.0f };
+		uint32_t color = 0xFFFFFFFF;
+
+		static VkVertexInputBindingDescription GetBindingDescription();
+		static std::array<VkVertexInputAttributeDescription, 2> GetAttributeDescriptions();
+	};
 }
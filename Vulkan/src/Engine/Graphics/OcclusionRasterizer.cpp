@@ -0,0 +1,218 @@
+#include "OcclusionRasterizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <emmintrin.h>
+
+#include "Engine/Core/Debug.h"
+#include "Engine/Core/ThreadPool.h"
+
+namespace Mega
+{
+	void OcclusionRasterizer::Initialize(const ConstructInfoOcclusionRasterizer* in_pInfo)
+	{
+		ConstructInfoOcclusionRasterizer info;
+		if (in_pInfo != nullptr) { info = *in_pInfo; }
+
+		MEGA_ASSERT(info.width > 0 && info.width % 4 == 0, "Occlusion buffer width has to be a multiple of 4");
+		MEGA_ASSERT(info.height > 0, "Occlusion buffer height can't be 0");
+
+		m_width = info.width;
+		m_height = info.height;
+		m_depth.assign(m_width * m_height, FLT_MAX);
+	}
+
+	void OcclusionRasterizer::Begin(const Mat4x4F& in_viewProjection)
+	{
+		m_viewProjection = in_viewProjection;
+		m_triangles.clear();
+		std::fill(m_depth.begin(), m_depth.end(), FLT_MAX);
+	}
+
+	void OcclusionRasterizer::AddOccluder(const Vertex* in_pVertices, const INDEX_TYPE* in_pIndices, const uint32_t in_indexCount, const Mat4x4F& in_model)
+	{
+		const Mat4x4F transform = m_viewProjection * in_model;
+
+		for (uint32_t i = 0; i + 2 < in_indexCount; i += 3) {
+			Vec4F clip[3];
+			for (uint32_t c = 0; c < 3; c++) { clip[c] = transform * Vec4F(in_pVertices[in_pIndices[i + c]].pos, 1.0f); }
+
+			// Entirely off one side of the screen
+			if (clip[0].x > clip[0].w && clip[1].x > clip[1].w && clip[2].x > clip[2].w) { continue; }
+			if (clip[0].x < -clip[0].w && clip[1].x < -clip[1].w && clip[2].x < -clip[2].w) { continue; }
+			if (clip[0].y > clip[0].w && clip[1].y > clip[1].w && clip[2].y > clip[2].w) { continue; }
+			if (clip[0].y < -clip[0].w && clip[1].y < -clip[1].w && clip[2].y < -clip[2].w) { continue; }
+
+			// Clip against the near plane, a triangle comes out as nothing, one triangle or a quad
+			Vec4F polygon[4];
+			uint32_t polygonCount = 0;
+			for (uint32_t c = 0; c < 3; c++) {
+				const Vec4F& a = clip[c];
+				const Vec4F& b = clip[(c + 1) % 3];
+				bool aInside = a.w >= OCCLUSION_RASTER_NEAR_W;
+				bool bInside = b.w >= OCCLUSION_RASTER_NEAR_W;
+
+				if (aInside) { polygon[polygonCount++] = a; }
+				if (aInside != bInside) {
+					float t = (OCCLUSION_RASTER_NEAR_W - a.w) / (b.w - a.w);
+					polygon[polygonCount++] = a + (b - a) * t;
+				}
+			}
+
+			for (uint32_t c = 2; c < polygonCount; c++) { SetupTriangle(polygon[0], polygon[c - 1], polygon[c]); }
+		}
+	}
+
+	void OcclusionRasterizer::SetupTriangle(const Vec4F& in_v0, const Vec4F& in_v1, const Vec4F& in_v2)
+	{
+		// To pixels, y goes the same way as the swapchain since the projection is already flipped
+		float x[3], y[3], z[3];
+		const Vec4F* v[3] = { &in_v0, &in_v1, &in_v2 };
+		for (uint32_t c = 0; c < 3; c++) {
+			float invW = 1.0f / v[c]->w;
+			x[c] = (v[c]->x * invW * 0.5f + 0.5f) * (float)m_width;
+			y[c] = (v[c]->y * invW * 0.5f + 0.5f) * (float)m_height;
+			z[c] = v[c]->z * invW;
+		}
+
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (std::abs(area) < 1e-6f) { return; }
+		// Occluders are drawn from both sides, flip the winding so inside is always positive
+		if (area < 0.0f) {
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			std::swap(z[1], z[2]);
+			area = -area;
+		}
+
+		Triangle triangle;
+		triangle.minX = std::max((int32_t)std::floor(std::min({ x[0], x[1], x[2] })), 0);
+		triangle.maxX = std::min((int32_t)std::ceil(std::max({ x[0], x[1], x[2] })), (int32_t)m_width - 1);
+		triangle.minY = std::max((int32_t)std::floor(std::min({ y[0], y[1], y[2] })), 0);
+		triangle.maxY = std::min((int32_t)std::ceil(std::max({ y[0], y[1], y[2] })), (int32_t)m_height - 1);
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) { return; }
+
+		// Edge c runs from vertex c to the next one and is 0 at both, area at the vertex across from it
+		for (uint32_t c = 0; c < 3; c++) {
+			uint32_t n = (c + 1) % 3;
+			triangle.edgeA[c] = y[c] - y[n];
+			triangle.edgeB[c] = x[n] - x[c];
+			triangle.edgeC[c] = x[c] * y[n] - x[n] * y[c];
+		}
+
+		// Depth as a plane, the barycentric weights are the edge functions over the area
+		float invArea = 1.0f / area;
+		float weights[3] = { z[2] * invArea, z[0] * invArea, z[1] * invArea }; // Edge c is across from vertex c + 2
+		triangle.depthA = weights[0] * triangle.edgeA[0] + weights[1] * triangle.edgeA[1] + weights[2] * triangle.edgeA[2];
+		triangle.depthB = weights[0] * triangle.edgeB[0] + weights[1] * triangle.edgeB[1] + weights[2] * triangle.edgeB[2];
+		triangle.depthC = weights[0] * triangle.edgeC[0] + weights[1] * triangle.edgeC[1] + weights[2] * triangle.edgeC[2];
+
+		m_triangles.push_back(triangle);
+	}
+
+	void OcclusionRasterizer::Rasterize(ThreadPool* in_pThreadPool)
+	{
+		const uint32_t bandCount = (m_height + OCCLUSION_RASTER_BAND_HEIGHT - 1) / OCCLUSION_RASTER_BAND_HEIGHT;
+		auto bandRange = [this](const uint32_t in_begin, const uint32_t in_end) {
+			for (uint32_t band = in_begin; band < in_end; band++) {
+				RasterizeBand(band * OCCLUSION_RASTER_BAND_HEIGHT, std::min((band + 1) * OCCLUSION_RASTER_BAND_HEIGHT, m_height));
+			}
+		};
+
+		if (in_pThreadPool != nullptr) { in_pThreadPool->ParallelFor(0, bandCount, 1, bandRange); }
+		else { bandRange(0, bandCount); }
+	}
+
+	void OcclusionRasterizer::RasterizeBand(const uint32_t in_rowBegin, const uint32_t in_rowEnd)
+	{
+		const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const __m128 zero = _mm_setzero_ps();
+
+		for (const Triangle& triangle : m_triangles) {
+			int32_t rowBegin = std::max(triangle.minY, (int32_t)in_rowBegin);
+			int32_t rowEnd = std::min(triangle.maxY + 1, (int32_t)in_rowEnd);
+			if (rowBegin >= rowEnd) { continue; }
+
+			const __m128 edgeA0 = _mm_set1_ps(triangle.edgeA[0]);
+			const __m128 edgeA1 = _mm_set1_ps(triangle.edgeA[1]);
+			const __m128 edgeA2 = _mm_set1_ps(triangle.edgeA[2]);
+			const __m128 depthA = _mm_set1_ps(triangle.depthA);
+			const int32_t columnBegin = triangle.minX & ~3;
+
+			for (int32_t row = rowBegin; row < rowEnd; row++) {
+				float py = (float)row + 0.5f;
+				const __m128 rowEdge0 = _mm_set1_ps(triangle.edgeB[0] * py + triangle.edgeC[0]);
+				const __m128 rowEdge1 = _mm_set1_ps(triangle.edgeB[1] * py + triangle.edgeC[1]);
+				const __m128 rowEdge2 = _mm_set1_ps(triangle.edgeB[2] * py + triangle.edgeC[2]);
+				const __m128 rowDepth = _mm_set1_ps(triangle.depthB * py + triangle.depthC);
+				float* pRow = &m_depth[row * m_width];
+
+				for (int32_t column = columnBegin; column <= triangle.maxX; column += 4) {
+					__m128 px = _mm_add_ps(_mm_set1_ps((float)column), laneOffsets);
+
+					__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA0, px), rowEdge0), zero);
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA1, px), rowEdge1), zero));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA2, px), rowEdge2), zero));
+					if (_mm_movemask_ps(inside) == 0) { continue; }
+
+					__m128 depth = _mm_add_ps(_mm_mul_ps(depthA, px), rowDepth);
+					__m128 previous = _mm_loadu_ps(pRow + column);
+					__m128 nearest = _mm_min_ps(previous, depth);
+					_mm_storeu_ps(pRow + column, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+				}
+			}
+		}
+	}
+
+	bool OcclusionRasterizer::IsBoxOccluded(const Vec3F& in_min, const Vec3F& in_max, const Mat4x4F& in_model) const
+	{
+		const Mat4x4F transform = m_viewProjection * in_model;
+
+		float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+		float nearest = FLT_MAX;
+		for (uint32_t i = 0; i < 8; i++) {
+			Vec3F corner((i & 1) ? in_max.x : in_min.x, (i & 2) ? in_max.y : in_min.y, (i & 4) ? in_max.z : in_min.z);
+			Vec4F clip = transform * Vec4F(corner, 1.0f);
+
+			// Crosses the near plane, it is right in front of the camera
+			if (clip.w < OCCLUSION_RASTER_NEAR_W) { return false; }
+
+			float invW = 1.0f / clip.w;
+			float x = (clip.x * invW * 0.5f + 0.5f) * (float)m_width;
+			float y = (clip.y * invW * 0.5f + 0.5f) * (float)m_height;
+			minX = std::min(minX, x);
+			maxX = std::max(maxX, x);
+			minY = std::min(minY, y);
+			maxY = std::max(maxY, y);
+			nearest = std::min(nearest, clip.z * invW);
+		}
+
+		// Every pixel the rectangle touches
+		int32_t columnBegin = std::max((int32_t)std::floor(minX), 0);
+		int32_t columnEnd = std::min((int32_t)std::floor(maxX), (int32_t)m_width - 1);
+		int32_t rowBegin = std::max((int32_t)std::floor(minY), 0);
+		int32_t rowEnd = std::min((int32_t)std::floor(maxY), (int32_t)m_height - 1);
+		if (columnBegin > columnEnd || rowBegin > rowEnd) { return false; }
+
+		const __m128 laneOffsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+		const __m128 first = _mm_set1_ps((float)columnBegin);
+		const __m128 last = _mm_set1_ps((float)columnEnd);
+		const __m128 boxDepth = _mm_set1_ps(nearest);
+
+		for (int32_t row = rowBegin; row <= rowEnd; row++) {
+			const float* pRow = &m_depth[row * m_width];
+			for (int32_t column = columnBegin & ~3; column <= columnEnd; column += 4) {
+				__m128 lanes = _mm_add_ps(_mm_set1_ps((float)column), laneOffsets);
+				__m128 covered = _mm_and_ps(_mm_cmpge_ps(lanes, first), _mm_cmple_ps(lanes, last));
+
+				// Any pixel where the box could be in front of the occluders (or there are none)
+				__m128 visible = _mm_and_ps(covered, _mm_cmpge_ps(_mm_loadu_ps(pRow + column), boxDepth));
+				if (_mm_movemask_ps(visible) != 0) { return false; }
+			}
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Engine/Core/Math/Math.h"
+#include "Engine/Graphics/Objects/Vertex.h"
+
+#define OCCLUSION_RASTER_DEFAULT_WIDTH  uint32_t(256)
+#define OCCLUSION_RASTER_DEFAULT_HEIGHT uint32_t(128)
+#define OCCLUSION_RASTER_BAND_HEIGHT    uint32_t(8) // Rows per job, bands never share a pixel so nothing needs locking
+#define OCCLUSION_RASTER_NEAR_W         0.1f        // Same as the projection's near plane, occluders get clipped here
+
+namespace Mega
+{
+	class ThreadPool;
+
+	struct ConstructInfoOcclusionRasterizer {
+		uint32_t width = OCCLUSION_RASTER_DEFAULT_WIDTH;   // Multiple of 4, every SSE op covers 4 pixels of a row
+		uint32_t height = OCCLUSION_RASTER_DEFAULT_HEIGHT;
+	};
+
+	// Small software depth buffer for culling on the cpu. A handful of big, simple occluder meshes are
+	// rasterized into it (nearest depth per pixel) and every other draw's bounding box is tested against
+	// it, so draws hidden behind them are never recorded at all. Pixels are sampled at their centers and
+	// boxes cover every pixel they touch, it is cheap rather than exact
+	class OcclusionRasterizer {
+	public:
+		void Initialize(const ConstructInfoOcclusionRasterizer* in_pInfo);
+
+		// Clears the depth buffer and last frame's occluders
+		void Begin(const Mat4x4F& in_viewProjection);
+		// Transforms, near clips and sets up in_indexCount / 3 triangles. Not thread safe
+		void AddOccluder(const Vertex* in_pVertices, const INDEX_TYPE* in_pIndices, const uint32_t in_indexCount, const Mat4x4F& in_model);
+		// Draws everything added since Begin, one band of rows per job (in_pThreadPool can be nullptr)
+		void Rasterize(ThreadPool* in_pThreadPool);
+
+		// Object space box under in_model is behind the occluders everywhere it covers on screen. Thread
+		// safe once Rasterize returned
+		bool IsBoxOccluded(const Vec3F& in_min, const Vec3F& in_max, const Mat4x4F& in_model) const;
+
+		uint32_t GetTriangleCount() const { return (uint32_t)m_triangles.size(); }
+
+	private:
+		// Screen space, edge functions are positive inside and depth is a plane over x/y
+		struct Triangle {
+			float edgeA[3];
+			float edgeB[3];
+			float edgeC[3];
+			float depthA, depthB, depthC;
+			int32_t minX, maxX, minY, maxY; // Inclusive pixel bounds, clamped to the buffer
+		};
+
+		void SetupTriangle(const Vec4F& in_v0, const Vec4F& in_v1, const Vec4F& in_v2);
+		void RasterizeBand(const uint32_t in_rowBegin, const uint32_t in_rowEnd);
+
+		uint32_t m_width = 0;
+		uint32_t m_height = 0;
+		Mat4x4F m_viewProjection = Mat4x4F(1.0f);
+
+		std::vector<float> m_depth; // Row major, FLT_MAX where no occluder landed
+		std::vector<Triangle> m_triangles;
+	};
+}
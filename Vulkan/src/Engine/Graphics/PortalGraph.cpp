@@ -0,0 +1,387 @@
+#include "PortalGraph.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <unordered_map>
+
+#include <GLM/gtc/matrix_transform.hpp>
+#include <TinyObjLoader/tiny_obj_loader.h>
+
+#include "Engine/Core/ThreadPool.h"
+
+namespace Mega
+{
+	struct PortalLevelHeader {
+		uint32_t magic = PORTAL_LEVEL_MAGIC;
+		uint16_t version = PORTAL_LEVEL_VERSION;
+		uint16_t padding = 0;
+		uint32_t cellCount = 0;
+		uint32_t portalCount = 0;
+		uint32_t pvsWords = 0; // 0 when no PVS was baked
+	};
+
+	bool PortalGraph::LoadTaggedOBJ(const char* in_objPath)
+	{
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string warning, error;
+
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warning, &error, in_objPath)) {
+			std::cout << "ERROR: Could not load portal level " << in_objPath << ": " << error << std::endl;
+			return false;
+		}
+
+		Clear();
+		auto getPosition = [&attrib](const tinyobj::index_t& in_index) {
+			return Vec3F(attrib.vertices[3 * in_index.vertex_index + 0], attrib.vertices[3 * in_index.vertex_index + 1], attrib.vertices[3 * in_index.vertex_index + 2]);
+		};
+
+		// Cells first, portal names refer to them
+		std::unordered_map<std::string, uint32_t> cellsByName;
+		for (const tinyobj::shape_t& shape : shapes) {
+			if (shape.name.rfind(PORTAL_CELL_PREFIX, 0) != 0 || shape.mesh.indices.empty()) { continue; }
+
+			PortalCell cell;
+			cell.name = shape.name.substr(strlen(PORTAL_CELL_PREFIX));
+			cell.boundsMin = Vec3F(FLT_MAX);
+			cell.boundsMax = Vec3F(-FLT_MAX);
+			for (const tinyobj::index_t& index : shape.mesh.indices) {
+				cell.boundsMin = glm::min(cell.boundsMin, getPosition(index));
+				cell.boundsMax = glm::max(cell.boundsMax, getPosition(index));
+			}
+
+			cellsByName[cell.name] = (uint32_t)m_cells.size();
+			m_cells.push_back(cell);
+		}
+
+		for (const tinyobj::shape_t& shape : shapes) {
+			if (shape.name.rfind(PORTAL_PORTAL_PREFIX, 0) != 0) { continue; }
+
+			// Cell names can have underscores too, so try every split
+			std::string pair = shape.name.substr(strlen(PORTAL_PORTAL_PREFIX));
+			Portal portal;
+			bool linked = false;
+			for (size_t split = pair.find('_'); split != std::string::npos && !linked; split = pair.find('_', split + 1)) {
+				auto a = cellsByName.find(pair.substr(0, split));
+				auto b = cellsByName.find(pair.substr(split + 1));
+				if (a != cellsByName.end() && b != cellsByName.end() && a->second != b->second) {
+					portal.cells[0] = a->second;
+					portal.cells[1] = b->second;
+					linked = true;
+				}
+			}
+			if (!linked) {
+				std::cout << "WARNING: Portal " << shape.name << " doesn't name two cells, skipped" << std::endl;
+				continue;
+			}
+
+			std::vector<int> cornerIndices;
+			for (const tinyobj::index_t& index : shape.mesh.indices) {
+				if (std::find(cornerIndices.begin(), cornerIndices.end(), index.vertex_index) == cornerIndices.end()) { cornerIndices.push_back(index.vertex_index); }
+			}
+			if (cornerIndices.size() != 4) {
+				std::cout << "WARNING: Portal " << shape.name << " has " << cornerIndices.size() << " corners instead of 4, skipped" << std::endl;
+				continue;
+			}
+
+			// The triangulation mixes up the order, put the corners back around the quad
+			Vec3F center(0.0f);
+			for (uint32_t i = 0; i < 4; i++) {
+				tinyobj::index_t index;
+				index.vertex_index = cornerIndices[i];
+				portal.corners[i] = getPosition(index);
+				center += portal.corners[i] * 0.25f;
+			}
+			Vec3F normal = glm::cross(portal.corners[1] - portal.corners[0], portal.corners[2] - portal.corners[0]);
+			Vec3F axisU = glm::normalize(portal.corners[0] - center);
+			Vec3F axisV = glm::cross(glm::normalize(normal), axisU);
+			std::sort(std::begin(portal.corners), std::end(portal.corners), [&](const Vec3F& in_a, const Vec3F& in_b) {
+				return std::atan2(glm::dot(in_a - center, axisV), glm::dot(in_a - center, axisU)) < std::atan2(glm::dot(in_b - center, axisV), glm::dot(in_b - center, axisU));
+			});
+
+			m_portals.push_back(portal);
+		}
+
+		LinkPortals();
+		std::cout << "Loaded portal level " << in_objPath << ": " << m_cells.size() << " cells, " << m_portals.size() << " portals" << std::endl;
+		return !m_cells.empty();
+	}
+
+	bool PortalGraph::LoadCooked(const char* in_filePath)
+	{
+		std::ifstream file(in_filePath, std::ios::binary);
+		if (!file.is_open()) {
+			std::cout << "ERROR: Could not open portal level " << in_filePath << std::endl;
+			return false;
+		}
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		size_t offset = 0;
+		bool truncated = false;
+		auto read = [&](void* out_pData, const size_t in_size) {
+			if (offset + in_size > data.size()) { truncated = true; return; }
+			std::memcpy(out_pData, data.data() + offset, in_size);
+			offset += in_size;
+		};
+
+		PortalLevelHeader header;
+		read(&header, sizeof(header));
+		if (truncated || header.magic != PORTAL_LEVEL_MAGIC || header.version != PORTAL_LEVEL_VERSION) {
+			std::cout << "ERROR: " << in_filePath << " is not a portal level this build can read" << std::endl;
+			return false;
+		}
+
+		// Every count has to fit in what is left of the file before anything is sized by it, and the PVS
+		// has to cover every cell or IsPotentiallyVisible would read past it
+		const uint64_t pvsWords = ((uint64_t)header.cellCount + 63) / 64;
+		const uint64_t cellSize = sizeof(uint32_t) + sizeof(Vec3F) * 2; // Name length and bounds, the name comes on top
+		const uint64_t portalSize = sizeof(Portal::cells) + sizeof(Portal::corners);
+		if ((header.pvsWords != 0 && header.pvsWords != pvsWords) ||
+			header.cellCount * cellSize + header.portalCount * portalSize + (uint64_t)header.cellCount * header.pvsWords * sizeof(uint64_t) > data.size() - offset) {
+			std::cout << "ERROR: Portal level " << in_filePath << " is truncated or corrupt" << std::endl;
+			return false;
+		}
+
+		Clear();
+		m_cells.resize(header.cellCount);
+		for (PortalCell& cell : m_cells) {
+			uint32_t nameLength = 0;
+			read(&nameLength, sizeof(nameLength));
+			if (truncated || offset + nameLength > data.size()) { truncated = true; break; }
+			cell.name.assign((const char*)data.data() + offset, nameLength);
+			offset += nameLength;
+
+			read(&cell.boundsMin, sizeof(Vec3F));
+			read(&cell.boundsMax, sizeof(Vec3F));
+		}
+
+		m_portals.resize(header.portalCount);
+		for (Portal& portal : m_portals) {
+			read(portal.cells, sizeof(portal.cells));
+			read(portal.corners, sizeof(portal.corners));
+			if (portal.cells[0] >= header.cellCount || portal.cells[1] >= header.cellCount) { truncated = true; }
+		}
+
+		m_pvsWords = header.pvsWords;
+		if (m_pvsWords > 0) {
+			m_pvs.resize((size_t)header.cellCount * m_pvsWords);
+			read(m_pvs.data(), m_pvs.size() * sizeof(uint64_t));
+		}
+
+		if (truncated) {
+			std::cout << "ERROR: Portal level " << in_filePath << " is truncated or corrupt" << std::endl;
+			Clear();
+			return false;
+		}
+
+		LinkPortals();
+		return true;
+	}
+
+	bool PortalGraph::SaveCooked(const char* in_filePath) const
+	{
+		std::ofstream file(in_filePath, std::ios::binary);
+		if (!file.is_open()) {
+			std::cout << "ERROR: Could not write portal level " << in_filePath << std::endl;
+			return false;
+		}
+
+		PortalLevelHeader header;
+		header.cellCount = (uint32_t)m_cells.size();
+		header.portalCount = (uint32_t)m_portals.size();
+		header.pvsWords = m_pvsWords;
+		file.write((const char*)&header, sizeof(header));
+
+		for (const PortalCell& cell : m_cells) {
+			uint32_t nameLength = (uint32_t)cell.name.size();
+			file.write((const char*)&nameLength, sizeof(nameLength));
+			file.write(cell.name.data(), nameLength);
+			file.write((const char*)&cell.boundsMin, sizeof(Vec3F));
+			file.write((const char*)&cell.boundsMax, sizeof(Vec3F));
+		}
+		for (const Portal& portal : m_portals) {
+			file.write((const char*)portal.cells, sizeof(portal.cells));
+			file.write((const char*)portal.corners, sizeof(portal.corners));
+		}
+		if (!m_pvs.empty()) { file.write((const char*)m_pvs.data(), m_pvs.size() * sizeof(uint64_t)); }
+
+		return file.good();
+	}
+
+	void PortalGraph::Clear()
+	{
+		m_cells.clear();
+		m_portals.clear();
+		m_pvs.clear();
+		m_pvsWords = 0;
+	}
+
+	void PortalGraph::BakePVS(const ConstructInfoPortalBake* in_pInfo, ThreadPool* in_pThreadPool)
+	{
+		ConstructInfoPortalBake info;
+		if (in_pInfo != nullptr) { info = *in_pInfo; }
+
+		const uint32_t cellCount = (uint32_t)m_cells.size();
+		const uint32_t words = (cellCount + 63) / 64;
+		std::vector<uint64_t> pvs((size_t)cellCount * words, 0);
+
+		// Every portal's plane, facing into the cell on its cells[1] side
+		std::vector<Vec4F> planes(m_portals.size());
+		for (uint32_t i = 0; i < m_portals.size(); i++) {
+			const Portal& portal = m_portals[i];
+			Vec3F center = (portal.corners[0] + portal.corners[1] + portal.corners[2] + portal.corners[3]) * 0.25f;
+			Vec3F normal = glm::normalize(glm::cross(portal.corners[1] - portal.corners[0], portal.corners[2] - portal.corners[0]));
+
+			const PortalCell& from = m_cells[portal.cells[0]];
+			const PortalCell& to = m_cells[portal.cells[1]];
+			if (glm::dot(normal, (to.boundsMin + to.boundsMax) - (from.boundsMin + from.boundsMax)) < 0.0f) { normal = -normal; }
+			planes[i] = Vec4F(normal, -glm::dot(normal, center));
+		}
+
+		auto bakeRange = [&](const uint32_t in_begin, const uint32_t in_end) {
+			std::vector<uint8_t> visible(cellCount), path(cellCount);
+			std::vector<Vec4F> chain;
+			for (uint32_t cell = in_begin; cell < in_end; cell++) {
+				std::fill(visible.begin(), visible.end(), 0);
+				BakeFrom(cell, planes, info.maxDepth, &chain, &path, &visible, 0);
+
+				uint64_t* pRow = &pvs[(size_t)cell * words];
+				for (uint32_t other = 0; other < cellCount; other++) {
+					if (visible[other]) { pRow[other / 64] |= uint64_t(1) << (other % 64); }
+				}
+			}
+		};
+
+		if (in_pThreadPool != nullptr) { in_pThreadPool->ParallelFor(0, cellCount, 1, bakeRange); }
+		else { bakeRange(0, cellCount); }
+
+		m_pvsWords = words;
+		m_pvs = std::move(pvs);
+
+		uint64_t visiblePairs = 0;
+		for (uint64_t word : m_pvs) { visiblePairs += std::bitset<64>(word).count(); }
+		std::cout << "Baked PVS: " << cellCount << " cells, " << (cellCount > 0 ? (float)visiblePairs / (float)cellCount : 0.0f) << " potentially visible from each on average" << std::endl;
+	}
+
+	void PortalGraph::BakeFrom(const uint32_t in_cell, const std::vector<Vec4F>& in_planes, const uint32_t in_maxDepth, std::vector<Vec4F>* io_pChain,
+		std::vector<uint8_t>* io_pPath, std::vector<uint8_t>* out_pVisible, const uint32_t in_depth) const
+	{
+		(*out_pVisible)[in_cell] = 1;
+		if (in_depth >= in_maxDepth) { return; }
+
+		(*io_pPath)[in_cell] = 1;
+		for (uint32_t portalIndex : m_cells[in_cell].portals) {
+			const Portal& portal = m_portals[portalIndex];
+			uint32_t next = portal.cells[0] == in_cell ? portal.cells[1] : portal.cells[0];
+			if ((*io_pPath)[next]) { continue; }
+
+			// A sight line stays on the far side of every portal it has gone through, so some part of
+			// this one has to be past all of their planes
+			bool reachable = true;
+			for (const Vec4F& plane : *io_pChain) {
+				float farthest = -FLT_MAX;
+				for (const Vec3F& corner : portal.corners) { farthest = std::max(farthest, glm::dot(Vec3F(plane), corner) + plane.w); }
+				if (farthest < -PORTAL_BAKE_EPSILON) { reachable = false; break; }
+			}
+			if (!reachable) { continue; }
+
+			io_pChain->push_back(portal.cells[0] == in_cell ? in_planes[portalIndex] : -in_planes[portalIndex]);
+			BakeFrom(next, in_planes, in_maxDepth, io_pChain, io_pPath, out_pVisible, in_depth + 1);
+			io_pChain->pop_back();
+		}
+		(*io_pPath)[in_cell] = 0;
+	}
+
+	int32_t PortalGraph::FindCell(const Vec3F& in_point, const int32_t in_hint) const
+	{
+		auto contains = [&in_point](const PortalCell& in_cell) {
+			return in_point.x >= in_cell.boundsMin.x && in_point.y >= in_cell.boundsMin.y && in_point.z >= in_cell.boundsMin.z &&
+				in_point.x <= in_cell.boundsMax.x && in_point.y <= in_cell.boundsMax.y && in_point.z <= in_cell.boundsMax.z;
+		};
+
+		if (in_hint >= 0 && in_hint < (int32_t)m_cells.size() && contains(m_cells[in_hint])) { return in_hint; }
+		for (uint32_t i = 0; i < m_cells.size(); i++) {
+			if (contains(m_cells[i])) { return (int32_t)i; }
+		}
+		return -1;
+	}
+
+	bool PortalGraph::FindVisibleCells(const Vec3F& in_eye, const Mat4x4F& in_viewProjection, std::vector<uint8_t>* out_pVisible) const
+	{
+		int32_t start = FindCell(in_eye);
+		if (start < 0) { return false; }
+
+		out_pVisible->assign(m_cells.size(), 0);
+		std::vector<uint8_t> path(m_cells.size(), 0);
+		const ScreenRect fullScreen = { { -1.0f, -1.0f }, { 1.0f, 1.0f } };
+		Traverse((uint32_t)start, fullScreen, in_viewProjection, (uint32_t)start, HasPVS(), &path, out_pVisible, 0);
+		return true;
+	}
+
+	void PortalGraph::Traverse(const uint32_t in_cell, const ScreenRect& in_rect, const Mat4x4F& in_viewProjection, const uint32_t in_startCell, const bool in_usePVS,
+		std::vector<uint8_t>* io_pPath, std::vector<uint8_t>* out_pVisible, const uint32_t in_depth) const
+	{
+		(*out_pVisible)[in_cell] = 1;
+		if (in_depth >= PORTAL_MAX_DEPTH) { return; }
+
+		// Cells already on the way here are skipped, looking back through a portal never shows anything new
+		(*io_pPath)[in_cell] = 1;
+		for (uint32_t portalIndex : m_cells[in_cell].portals) {
+			const Portal& portal = m_portals[portalIndex];
+			uint32_t next = portal.cells[0] == in_cell ? portal.cells[1] : portal.cells[0];
+			if ((*io_pPath)[next]) { continue; }
+			if (in_usePVS && !IsPotentiallyVisible(in_startCell, next)) { continue; }
+
+			// Clip the quad against the near plane, then bound what is left on screen
+			Vec4F clip[4];
+			for (uint32_t i = 0; i < 4; i++) { clip[i] = in_viewProjection * Vec4F(portal.corners[i], 1.0f); }
+
+			ScreenRect portalRect = { { FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX } };
+			bool anyInFront = false;
+			auto addPoint = [&portalRect, &anyInFront](const Vec4F& in_point) {
+				float invW = 1.0f / in_point.w;
+				for (uint32_t axis = 0; axis < 2; axis++) {
+					portalRect.min[axis] = std::min(portalRect.min[axis], in_point[axis] * invW);
+					portalRect.max[axis] = std::max(portalRect.max[axis], in_point[axis] * invW);
+				}
+				anyInFront = true;
+			};
+			for (uint32_t i = 0; i < 4; i++) {
+				const Vec4F& a = clip[i];
+				const Vec4F& b = clip[(i + 1) % 4];
+				bool aInside = a.w >= PORTAL_NEAR_W;
+				bool bInside = b.w >= PORTAL_NEAR_W;
+
+				if (aInside) { addPoint(a); }
+				if (aInside != bInside) { addPoint(a + (b - a) * ((PORTAL_NEAR_W - a.w) / (b.w - a.w))); }
+			}
+			if (!anyInFront) { continue; }
+
+			ScreenRect narrowed;
+			for (uint32_t axis = 0; axis < 2; axis++) {
+				narrowed.min[axis] = std::max(in_rect.min[axis], portalRect.min[axis]);
+				narrowed.max[axis] = std::min(in_rect.max[axis], portalRect.max[axis]);
+			}
+			if (narrowed.min[0] >= narrowed.max[0] || narrowed.min[1] >= narrowed.max[1]) { continue; }
+
+			Traverse(next, narrowed, in_viewProjection, in_startCell, in_usePVS, io_pPath, out_pVisible, in_depth + 1);
+		}
+		(*io_pPath)[in_cell] = 0;
+	}
+
+	void PortalGraph::LinkPortals()
+	{
+		for (PortalCell& cell : m_cells) { cell.portals.clear(); }
+		for (uint32_t i = 0; i < m_portals.size(); i++) {
+			m_cells[m_portals[i].cells[0]].portals.push_back(i);
+			m_cells[m_portals[i].cells[1]].portals.push_back(i);
+		}
+	}
+}
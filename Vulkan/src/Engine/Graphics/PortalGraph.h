@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Engine/Core/Math/Math.h"
+
+#define PORTAL_LEVEL_MAGIC           uint32_t(0x4C50454D) // "MEPL"
+#define PORTAL_LEVEL_VERSION         uint16_t(2) // 2: the PVS is baked from portal to portal reachability
+#define PORTAL_CELL_PREFIX           "cell_"   // OBJ objects tagged as cells, their bounds are the cell
+#define PORTAL_PORTAL_PREFIX         "portal_" // portal_<cell a>_<cell b>, a quad between two cells
+#define PORTAL_MAX_DEPTH             uint32_t(32) // Longest chain of portals one traversal follows
+#define PORTAL_NEAR_W                0.01f
+#define PORTAL_BAKE_EPSILON          0.001f // How far behind a portal's plane a corner may be and still count as past it
+
+namespace Mega
+{
+	class ThreadPool;
+
+	struct PortalCell {
+		std::string name;
+		Vec3F boundsMin = Vec3F(0.0f);
+		Vec3F boundsMax = Vec3F(0.0f);
+		std::vector<uint32_t> portals; // Every portal touching this cell, filled in after loading
+	};
+
+	struct Portal {
+		uint32_t cells[2] = { 0, 0 };
+		Vec3F corners[4];  // Going around the quad
+	};
+
+	struct ConstructInfoPortalBake {
+		uint32_t maxDepth = PORTAL_MAX_DEPTH; // Longest chain of portals followed, the runtime walk never goes further either
+	};
+
+	// Cells and the portals between them for indoor levels. At runtime the camera's cell is found and
+	// the view is walked through every portal it can see, each step narrowing the screen rectangle to the
+	// portal's, so only cells visible through a chain of portals are drawn. A baked potentially visible
+	// set (one bit per cell pair) prunes the walk and gives constant time cell to cell lookups
+	class PortalGraph {
+	public:
+		// Objects named cell_<name> become cells (their bounds), objects named portal_<a>_<b> the quad
+		// between cells a and b. Everything else in the file is ignored
+		bool LoadTaggedOBJ(const char* in_objPath);
+		// The cooked level file, cells, portals and the PVS if it was baked
+		bool LoadCooked(const char* in_filePath);
+		bool SaveCooked(const char* in_filePath) const;
+		void Clear();
+
+		// Offline. A cell is potentially visible from another when some chain of portals leads there with
+		// every portal at least partly past the planes of the ones before it, which any sight line through
+		// them needs. That over-includes but never misses a cell, so it is safe to prune the walk with
+		void BakePVS(const ConstructInfoPortalBake* in_pInfo, ThreadPool* in_pThreadPool);
+		bool HasPVS() const { return !m_pvs.empty(); }
+		bool IsPotentiallyVisible(const uint32_t in_fromCell, const uint32_t in_toCell) const {
+			if (!HasPVS()) { return true; }
+			return (m_pvs[in_fromCell * m_pvsWords + in_toCell / 64] >> (in_toCell % 64)) & 1;
+		}
+
+		// -1 when in_point isnt in any cell. in_hint is checked first, pass the last cell found
+		int32_t FindCell(const Vec3F& in_point, const int32_t in_hint = -1) const;
+		// One byte per cell, set for every cell seen from in_eye. Returns false (and sets nothing) when
+		// the eye is outside every cell, the caller should draw everything then
+		bool FindVisibleCells(const Vec3F& in_eye, const Mat4x4F& in_viewProjection, std::vector<uint8_t>* out_pVisible) const;
+
+		bool IsEmpty() const { return m_cells.empty(); }
+		const std::vector<PortalCell>& GetCells() const { return m_cells; }
+		const std::vector<Portal>& GetPortals() const { return m_portals; }
+
+	private:
+		// Normalized device coordinates
+		struct ScreenRect {
+			float min[2];
+			float max[2];
+		};
+
+		void Traverse(const uint32_t in_cell, const ScreenRect& in_rect, const Mat4x4F& in_viewProjection, const uint32_t in_startCell, const bool in_usePVS,
+			std::vector<uint8_t>* io_pPath, std::vector<uint8_t>* out_pVisible, const uint32_t in_depth) const;
+		// in_planes face from each portal's cells[0] into cells[1], io_pChain holds the ones crossed so far
+		void BakeFrom(const uint32_t in_cell, const std::vector<Vec4F>& in_planes, const uint32_t in_maxDepth, std::vector<Vec4F>* io_pChain,
+			std::vector<uint8_t>* io_pPath, std::vector<uint8_t>* out_pVisible, const uint32_t in_depth) const;
+		void LinkPortals();
+
+		std::vector<PortalCell> m_cells;
+		std::vector<Portal> m_portals;
+
+		uint32_t m_pvsWords = 0;     // 64 bit words per row
+		std::vector<uint64_t> m_pvs; // Row per cell, bit j of row i is set when cell j may be seen from cell i
+	};
+}
@@ -0,0 +1,64 @@
+#include "RenderSnapshot.h"
+
+namespace Mega
+{
+	RenderSnapshotUI::~RenderSnapshotUI()
+	{
+		for (ImDrawList* pList : m_lists) { IM_DELETE(pList); }
+		m_lists.clear();
+	}
+
+	void RenderSnapshotUI::Copy(const ImDrawData* in_pDrawData)
+	{
+		m_drawData.Clear();
+		if (in_pDrawData == nullptr || !in_pDrawData->Valid) { return; }
+
+		const int listCount = in_pDrawData->CmdListsCount;
+		while ((int)m_lists.size() < listCount) {
+			m_lists.push_back(IM_NEW(ImDrawList)(in_pDrawData->CmdLists[m_lists.size()]->_Data));
+		}
+
+		// Only what the backend reads, the rest of a draw list is ImGui's building state
+		for (int i = 0; i < listCount; i++) {
+			const ImDrawList* pSource = in_pDrawData->CmdLists[i];
+			ImDrawList* pCopy = m_lists[i];
+
+			pCopy->CmdBuffer = pSource->CmdBuffer;
+			pCopy->IdxBuffer = pSource->IdxBuffer;
+			pCopy->VtxBuffer = pSource->VtxBuffer;
+			pCopy->Flags = pSource->Flags;
+		}
+
+		m_drawData = *in_pDrawData;
+		m_drawData.CmdLists = m_lists.data();
+	}
+
+	void RenderSnapshot::Clear()
+	{
+		draws.clear();
+		lights.clear();
+		lineVertices.clear();
+		bonePalette.clear();
+		ui.Clear();
+	}
+
+	bool RenderSnapshotBuffer::Publish()
+	{
+		// Release so everything written into the snapshot is visible to whoever acquires it
+		uint8_t previous = m_ready.exchange(m_writeIndex | RENDER_SNAPSHOT_FRESH_BIT, std::memory_order_acq_rel);
+		m_writeIndex = previous & RENDER_SNAPSHOT_INDEX_MASK;
+
+		return (previous & RENDER_SNAPSHOT_FRESH_BIT) != 0;
+	}
+
+	RenderSnapshot* RenderSnapshotBuffer::Acquire()
+	{
+		// Only the consumer clears the fresh bit, so once it is seen it stays set until the exchange below
+		if (!HasFresh()) { return nullptr; }
+
+		uint8_t previous = m_ready.exchange(m_readIndex, std::memory_order_acq_rel);
+		m_readIndex = previous & RENDER_SNAPSHOT_INDEX_MASK;
+
+		return &m_snapshots[m_readIndex];
+	}
+}
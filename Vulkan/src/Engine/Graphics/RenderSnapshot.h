@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "ImGui/imgui.h"
+
+#include "Engine/Camera.h"
+#include "Engine/Graphics/Objects/Model.h"
+#include "Engine/Graphics/Objects/Light.h"
+#include "Engine/Graphics/Objects/Vertex.h"
+
+#define RENDER_SNAPSHOT_COUNT      uint8_t(3)
+#define RENDER_SNAPSHOT_INDEX_MASK uint8_t(0x3)
+#define RENDER_SNAPSHOT_FRESH_BIT  uint8_t(0x4) // Set on the ready slot when it holds something the renderer hasnt seen
+
+namespace Mega
+{
+	// One model as the simulation left it, nothing in here points back into the scene
+	struct RenderSnapshotDraw {
+		Model::PushConstant pushData;
+		VertexData vertexData;
+		bool occluder = false;
+		uint32_t paletteOffset = 0; // First of the draw's joint matrices in bonePalette, skinned draws only
+	};
+
+	// Owned copy of ImGui's draw data. ImGui reuses its own draw lists on the next NewFrame, so the
+	// render thread can never be handed ImGui::GetDrawData() directly
+	class RenderSnapshotUI {
+	public:
+		RenderSnapshotUI() {}
+		RenderSnapshotUI(const RenderSnapshotUI&) = delete;
+		RenderSnapshotUI& operator=(const RenderSnapshotUI&) = delete;
+		~RenderSnapshotUI();
+
+		void Copy(const ImDrawData* in_pDrawData);
+		void Clear() { m_drawData.Clear(); }
+
+		// nullptr when there was nothing to draw
+		ImDrawData* GetDrawData() { return m_drawData.Valid ? &m_drawData : nullptr; }
+
+	private:
+		ImDrawData m_drawData;
+		std::vector<ImDrawList*> m_lists; // Kept between frames so their buffers dont get reallocated every copy
+	};
+
+	// Everything the renderer needs to draw one frame, built by the simulation thread and never touched
+	// by it again once published
+	struct RenderSnapshot {
+		using Clock = std::chrono::steady_clock;
+
+		ViewData viewData;
+		std::vector<RenderSnapshotDraw> draws;
+		std::vector<Light> lights;
+		std::vector<LineVertex> lineVertices;
+		std::vector<Mat4x4F> bonePalette; // Model space joint matrices of every animated character
+		RenderSnapshotUI ui;
+
+		uint64_t frameIndex = 0;
+		// Window framebuffer size, read by the simulation thread because GLFW only allows it on the main one
+		uint32_t framebufferWidth = 0;
+		uint32_t framebufferHeight = 0;
+		Clock::time_point frameStart; // When the simulation started on this frame (input sampled), latency is measured from here
+		Clock::time_point published;
+
+		void Clear();
+	};
+
+	// Lock free triple buffer between one producer (simulation) and one consumer (render thread). The
+	// producer always owns one snapshot, the consumer another, and the third sits in the middle as the
+	// newest finished frame. Publishing swaps the producer's snapshot with the middle one and acquiring
+	// swaps the consumer's, so the handoff itself never waits on the other side. If the renderer falls
+	// behind, the unread snapshot in the middle is simply overwritten and the renderer always draws the
+	// newest frame (the Renderer holds the producer back before that happens, see DisplayScene)
+	class RenderSnapshotBuffer {
+	public:
+		// Only the producer may touch this until Publish
+		RenderSnapshot* GetWriteSnapshot() { return &m_snapshots[m_writeIndex]; }
+		// Returns true if it replaced a snapshot the consumer never picked up
+		bool Publish();
+
+		// Newest published snapshot, or nullptr if nothing new was published since the last call. The
+		// snapshot belongs to the consumer until its next Acquire
+		RenderSnapshot* Acquire();
+		bool HasFresh() const { return (m_ready.load(std::memory_order_acquire) & RENDER_SNAPSHOT_FRESH_BIT) != 0; }
+
+	private:
+		RenderSnapshot m_snapshots[RENDER_SNAPSHOT_COUNT];
+
+		uint8_t m_writeIndex = 0; // Producer only
+		uint8_t m_readIndex = 1;  // Consumer only
+		std::atomic<uint8_t> m_ready = { 2 };
+	};
+}
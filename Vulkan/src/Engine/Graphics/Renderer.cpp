@@ -1,15 +1,46 @@
 #include "Renderer.h"
 
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <memory>
 
 #include "Engine/Graphics/Vulkan/Vulkan.h"
+#include "Engine/Core/ThreadPool.h"
 #include "Engine/Camera.h"
 #include "Engine/Scene.h"
+#include "Engine/Graphics/Objects/Skeleton.h"
 
 namespace Mega
 {
+	// Picks the coarsest LOD whose error stays under RENDERER_LOD_PIXEL_ERROR on screen, starting from
+	// the model's last pick. Going coarser needs the error to be well under the limit, going finer happens
+	// as soon as it's over, so something sitting right at the limit doesn't flicker between two levels
+	static uint32_t SelectLod(const VertexData& in_vertexData, const Mat4x4F& in_model, const Vec3F& in_eye, const float in_pixelsPerUnit, const uint32_t in_lastLevel)
+	{
+		if (in_vertexData.lodCount <= 1) { return 0; }
+
+		// Closest the bounding sphere gets to the eye, scaled the same as the mesh
+		Vec3F center = Vec3F(in_model * Vec4F((in_vertexData.boundsMin + in_vertexData.boundsMax) * 0.5f, 1.0f));
+		float scale = std::max(glm::length(Vec3F(in_model[0])), std::max(glm::length(Vec3F(in_model[1])), glm::length(Vec3F(in_model[2]))));
+		float radius = glm::length(in_vertexData.boundsMax - in_vertexData.boundsMin) * 0.5f * scale;
+		float distance = std::max(glm::length(center - in_eye) - radius, 0.1f);
+
+		auto pixelError = [&](const uint32_t in_level) { return in_vertexData.lods[in_level].error * scale / distance * in_pixelsPerUnit; };
+
+		uint32_t level = std::min(in_lastLevel, in_vertexData.lodCount - 1);
+		while (level + 1 < in_vertexData.lodCount && pixelError(level + 1) <= RENDERER_LOD_PIXEL_ERROR * (1.0f - RENDERER_LOD_HYSTERESIS)) { level++; }
+		while (level > 0 && pixelError(level) > RENDERER_LOD_PIXEL_ERROR) { level--; }
+
+		return level;
+	}
+
+	static float ToMilliseconds(const RenderSnapshot::Clock::duration in_duration)
+	{
+		return std::chrono::duration<float, std::milli>(in_duration).count();
+	}
+
 	void Renderer::OnInitialize()
 	{
 		MEGA_ASSERT(m_pWindow != nullptr, "Initializing Renderer without a scene; Set scene first");
@@ -17,32 +48,376 @@ namespace Mega
 		std::cout << "Initializing Renderer..." << std::endl;
 
 		m_pVulkanInstance = new Vulkan;
+		m_pVulkanInstance->m_pThreadPool = m_pThreadPool;
 		m_pVulkanInstance->Initialize(this, m_pWindow);
 	}
 
 	void Renderer::OnDestroy()
 	{
+		SetPipelined(false);
+
 		// Destroy our Vulkan instance
 		m_pVulkanInstance->Destroy();
 		delete m_pVulkanInstance;
 	}
 
 	void Renderer::DisplayScene(Scene* in_scene) {
-		const ViewData& viewData = Camera::GetConstViewData();
-		m_pVulkanInstance->SetViewData(viewData);
-
-		m_pVulkanInstance->DrawFrame(in_scene->GetModelDrawList(), in_scene->GetLightDrawList());
+		RenderSnapshot* pSnapshot = IsPipelined() ? m_snapshots.GetWriteSnapshot() : &m_inlineSnapshot;
+		BuildSnapshot(in_scene, Camera::GetConstViewData(), pSnapshot);
+		SubmitSnapshot(pSnapshot);
 	}
 
 	void Renderer::DisplayScene(Scene* in_scene, const Camera& in_camera) {
-		const ViewData& viewData = in_camera.GetViewData();
-		m_pVulkanInstance->SetViewData(viewData);
+		RenderSnapshot* pSnapshot = IsPipelined() ? m_snapshots.GetWriteSnapshot() : &m_inlineSnapshot;
+		BuildSnapshot(in_scene, in_camera.GetViewData(), pSnapshot);
+		SubmitSnapshot(pSnapshot);
+	}
+
+	void Renderer::SetPipelined(const bool in_pipelined)
+	{
+		if (in_pipelined == IsPipelined()) { return; }
+
+		if (in_pipelined) {
+			m_stopRenderThread = false;
+			m_renderThread = std::thread(&Renderer::RenderThreadLoop, this);
+		}
+		else {
+			{
+				std::lock_guard<std::mutex> lock(m_wakeMutex);
+				m_stopRenderThread = true;
+			}
+			m_wakeCondition.notify_all();
+			m_renderThread.join();
+		}
+
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.pipelined = in_pipelined;
+	}
+
+	RenderPipelineStats Renderer::GetPipelineStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		return m_stats;
+	}
+
+	void Renderer::BuildSnapshot(Scene* in_scene, const ViewData& in_viewData, RenderSnapshot* out_pSnapshot)
+	{
+		const std::vector<Model*>& pModels = in_scene->GetModelDrawList();
+		const std::vector<Light*>& pLights = in_scene->GetLightDrawList();
+
+		out_pSnapshot->Clear();
+		out_pSnapshot->viewData = in_viewData;
+		out_pSnapshot->frameIndex = m_frameIndex++;
+		out_pSnapshot->frameStart = m_frameStart == RenderSnapshot::Clock::time_point() ? RenderSnapshot::Clock::now() : m_frameStart;
+
+		int framebufferWidth, framebufferHeight;
+		glfwGetFramebufferSize(m_pWindow, &framebufferWidth, &framebufferHeight);
+		out_pSnapshot->framebufferWidth = (uint32_t)framebufferWidth;
+		out_pSnapshot->framebufferHeight = (uint32_t)framebufferHeight;
+
+		// Screen pixels covered by one world unit at distance one, from the size the frame will actually be
+		// drawn at (the swapchain follows the framebuffer). Minimized windows report 0
+		const float screenWidth = (float)std::max(out_pSnapshot->framebufferWidth, 1u);
+		const float screenHeight = (float)std::max(out_pSnapshot->framebufferHeight, 1u);
+		const float pixelsPerUnit = screenHeight / (2.0f * std::tan(glm::radians(PROJECTION_FOV_Y) * 0.5f));
+
+		Mat4x4F view = glm::lookAt(in_viewData.eye, in_viewData.target, in_viewData.up);
+		Mat4x4F projection = glm::perspective(glm::radians(PROJECTION_FOV_Y), screenWidth / screenHeight, 0.1f, 1000.0f);
+		projection[1][1] *= -1;
+		const Mat4x4F viewProjection = projection * view;
+
+		// Cells the camera can see through the portals, models whose bounds touch none of them don't get a
+		// draw. Models centered outside every cell (and every model when the camera is) are always drawn
+		const PortalGraph& portalGraph = in_scene->GetPortalGraph();
+		std::vector<uint8_t> visibleCells;
+		std::vector<const PortalCell*> pVisibleCells;
+		bool portalCulling = false;
+		if (!portalGraph.IsEmpty()) {
+			portalCulling = portalGraph.FindVisibleCells(in_viewData.eye, viewProjection, &visibleCells);
+			for (uint32_t i = 0; portalCulling && i < visibleCells.size(); i++) {
+				if (visibleCells[i]) { pVisibleCells.push_back(&portalGraph.GetCells()[i]); }
+			}
+		}
+		auto isCellHidden = [&](const VertexData& in_vertexData, const Mat4x4F& in_model, const int32_t in_hint, int32_t* out_pCell) {
+			// World bounds, anything straddling a portal is kept while either side of it can be seen
+			Vec3F center = Vec3F(in_model * Vec4F((in_vertexData.boundsMin + in_vertexData.boundsMax) * 0.5f, 1.0f));
+			Vec3F halfSize = (in_vertexData.boundsMax - in_vertexData.boundsMin) * 0.5f;
+			Vec3F extent = glm::abs(Vec3F(in_model[0])) * halfSize.x + glm::abs(Vec3F(in_model[1])) * halfSize.y + glm::abs(Vec3F(in_model[2])) * halfSize.z;
+			Vec3F boundsMin = center - extent;
+			Vec3F boundsMax = center + extent;
+
+			*out_pCell = portalGraph.FindCell(center, in_hint);
+			if (*out_pCell < 0) { return false; }
+			for (const PortalCell* pCell : pVisibleCells) {
+				if (boundsMin.x <= pCell->boundsMax.x && boundsMin.y <= pCell->boundsMax.y && boundsMin.z <= pCell->boundsMax.z &&
+					boundsMax.x >= pCell->boundsMin.x && boundsMax.y >= pCell->boundsMin.y && boundsMax.z >= pCell->boundsMin.z) {
+					return false;
+				}
+			}
+			return true;
+		};
+
+		AnimationSystem& animation = in_scene->GetAnimation();
+		const uint32_t modelCount = (uint32_t)pModels.size();
+
+		// Evaluating every model matrix is most of the work, so it is spread across the pool
+		out_pSnapshot->draws.resize(modelCount);
+		std::vector<uint8_t> hidden(modelCount, 0);
+		std::atomic<uint64_t> trianglesFull(0);
+		std::atomic<uint64_t> trianglesDrawn(0);
+		std::atomic<uint32_t> portalCulled(0);
+		std::atomic<uint32_t> hiddenCount(0);
+		auto copyRange = [&](const uint32_t in_begin, const uint32_t in_end) {
+			uint64_t full = 0, drawn = 0;
+			uint32_t culled = 0, skipped = 0;
+			for (uint32_t i = in_begin; i < in_end; i++) {
+				RenderSnapshotDraw& draw = out_pSnapshot->draws[i];
+				pModels[i]->GetPushConstantData(&draw.pushData);
+				draw.vertexData = *pModels[i]->GetVertexData();
+				draw.occluder = pModels[i]->IsOccluder();
+				full += (draw.vertexData.indices[1] - draw.vertexData.indices[0]) / 3;
+
+				// A skinned mesh with no character posing it has nothing to be skinned with. Its joints'
+				// spot in the palette is filled in once the characters are evaluated below
+				if (draw.vertexData.IsSkinned() && !animation.IsAlive(pModels[i]->GetAnimation())) {
+					hidden[i] = 1;
+					skipped++;
+					continue;
+				}
+
+				if (portalCulling) {
+					int32_t cell;
+					bool cellHidden = isCellHidden(draw.vertexData, draw.pushData.model, pModels[i]->GetPortalCell(), &cell);
+					pModels[i]->SetPortalCell(cell);
+					if (cellHidden) {
+						hidden[i] = 1;
+						culled++;
+						skipped++;
+						continue;
+					}
+				}
+
+				if (draw.vertexData.lodCount > 1) {
+					uint32_t level = SelectLod(draw.vertexData, draw.pushData.model, in_viewData.eye, pixelsPerUnit, pModels[i]->GetLodLevel());
+					pModels[i]->SetLodLevel(level);
+					draw.vertexData.indices[0] = draw.vertexData.lods[level].indices[0];
+					draw.vertexData.indices[1] = draw.vertexData.lods[level].indices[1];
+				}
+				drawn += (draw.vertexData.indices[1] - draw.vertexData.indices[0]) / 3;
+			}
+			trianglesFull += full;
+			trianglesDrawn += drawn;
+			portalCulled += culled;
+			hiddenCount += skipped;
+		};
+
+		if (m_pThreadPool != nullptr) { m_pThreadPool->ParallelFor(0, modelCount, RENDERER_SNAPSHOT_GRAIN_SIZE, copyRange); }
+		else { copyRange(0, modelCount); }
+
+		// Animation LODs go by how big each character is on screen, and characters only know that through
+		// the skinned models they pose. Their matrices were just worked out above, culled ones included
+		animation.SetLodView(in_viewData.eye, Frustum::FromViewProjection(viewProjection), pixelsPerUnit);
+		for (uint32_t i = 0; i < modelCount; i++) {
+			const RenderSnapshotDraw& draw = out_pSnapshot->draws[i];
+			if (!draw.vertexData.IsSkinned() || !animation.IsAlive(pModels[i]->GetAnimation())) { continue; }
+
+			const Mat4x4F& model = draw.pushData.model;
+			const VertexData* pVertexData = pModels[i]->GetVertexData();
+			Vec3F center = Vec3F(model * Vec4F((pVertexData->boundsMin + pVertexData->boundsMax) * 0.5f, 1.0f));
+			float scale = std::max(glm::length(Vec3F(model[0])), std::max(glm::length(Vec3F(model[1])), glm::length(Vec3F(model[2]))));
+			animation.SetBounds(pModels[i]->GetAnimation(), center, glm::length(pVertexData->boundsMax - pVertexData->boundsMin) * 0.5f * scale);
+		}
+
+		// Poses go straight into the snapshot, the render thread copies them to the GPU in one go
+		animation.Evaluate(&out_pSnapshot->bonePalette);
+		for (uint32_t i = 0; i < modelCount; i++) {
+			RenderSnapshotDraw& draw = out_pSnapshot->draws[i];
+			if (!hidden[i] && draw.vertexData.IsSkinned()) { draw.paletteOffset = animation.GetPaletteOffset(pModels[i]->GetAnimation()); }
+		}
+
+		// Squeeze out the hidden ones, keeping the order
+		if (hiddenCount > 0) {
+			uint32_t kept = 0;
+			for (uint32_t i = 0; i < modelCount; i++) {
+				if (!hidden[i]) { out_pSnapshot->draws[kept++] = out_pSnapshot->draws[i]; }
+			}
+			out_pSnapshot->draws.resize(kept);
+		}
+
+		// Static batches are already in world space, they only need their texture
+		for (const StaticBatch& batch : in_scene->GetStaticBatches()) {
+			trianglesFull += (batch.vertexData.indices[1] - batch.vertexData.indices[0]) / 3;
+
+			int32_t cell;
+			if (portalCulling && isCellHidden(batch.vertexData, Mat4x4F(1.0f), -1, &cell)) {
+				portalCulled++;
+				continue;
+			}
+
+			RenderSnapshotDraw draw;
+			draw.pushData.textureData = batch.textureIndex;
+			draw.vertexData = batch.vertexData;
+			out_pSnapshot->draws.push_back(draw);
+
+			trianglesDrawn += (batch.vertexData.indices[1] - batch.vertexData.indices[0]) / 3;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_statsMutex);
+			m_stats.trianglesFull = trianglesFull;
+			m_stats.trianglesDrawn = trianglesDrawn;
+			m_stats.portalCulledDraws = portalCulled;
+		}
+
+		out_pSnapshot->lights.reserve(pLights.size());
+		for (const Light* pLight : pLights) { out_pSnapshot->lights.push_back(*pLight); }
+
+		const std::vector<LineVertex>& lineVertices = in_scene->GetDebugLines().GetVertices();
+		out_pSnapshot->lineVertices.assign(lineVertices.begin(), lineVertices.end());
+
+		// ImGui::Render() has to have been called by now, and on this thread
+		out_pSnapshot->ui.Copy(ImGui::GetDrawData());
+	}
+
+	void Renderer::SubmitSnapshot(RenderSnapshot* in_pSnapshot)
+	{
+		RenderSnapshot::Clock::time_point now = RenderSnapshot::Clock::now();
+		in_pSnapshot->published = now;
+		{
+			std::lock_guard<std::mutex> lock(m_statsMutex);
+			if (m_lastPublish != RenderSnapshot::Clock::time_point()) { RecordSample(&m_stats.simulationFrame, ToMilliseconds(now - m_lastPublish)); }
+		}
+		m_lastPublish = now;
+
+		if (!IsPipelined()) {
+			std::lock_guard<std::mutex> lock(m_vulkanMutex);
+			DrawSnapshot(*in_pSnapshot);
+			return;
+		}
+
+		// Back pressure: the simulation only gets one frame ahead of the render thread. Without it nothing
+		// holds the simulation back under vsync, it would spin through frames that are overwritten unseen
+		RenderSnapshot::Clock::time_point waitStart = RenderSnapshot::Clock::now();
+		{
+			std::unique_lock<std::mutex> lock(m_wakeMutex);
+			m_consumedCondition.wait(lock, [this]() { return !m_snapshots.HasFresh(); });
+		}
+		float waited = ToMilliseconds(RenderSnapshot::Clock::now() - waitStart);
+
+		bool dropped = m_snapshots.Publish();
+		{
+			std::lock_guard<std::mutex> lock(m_statsMutex);
+			RecordSample(&m_stats.simulationWait, waited);
+			if (dropped) { m_stats.droppedSnapshots++; }
+		}
+
+		// Taking the lock keeps the render thread from missing this between checking and going to sleep
+		{
+			std::lock_guard<std::mutex> lock(m_wakeMutex);
+		}
+		m_wakeCondition.notify_one();
+	}
+
+	void Renderer::DrawSnapshot(RenderSnapshot& in_snapshot)
+	{
+		RenderSnapshot::Clock::time_point workStart = RenderSnapshot::Clock::now();
+		m_pVulkanInstance->DrawFrame(in_snapshot);
+		RenderSnapshot::Clock::time_point submitted = RenderSnapshot::Clock::now();
+
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		RecordSample(&m_stats.renderWork, ToMilliseconds(submitted - workStart));
+		if (m_lastSubmit != RenderSnapshot::Clock::time_point()) { RecordSample(&m_stats.renderFrame, ToMilliseconds(submitted - m_lastSubmit)); }
+		m_lastSubmit = submitted;
+
+		m_stats.cpuOccludedDraws = m_pVulkanInstance->m_cpuOccludedCount;
+		m_stats.occlusionCulling = m_pVulkanInstance->m_occlusionCuller.IsEnabled();
+		m_stats.occludedDraws = m_pVulkanInstance->m_occlusionCuller.GetOccludedCount();
+		m_stats.recoveredDraws = m_pVulkanInstance->m_occlusionCuller.GetRecoveredCount();
+		m_stats.skinnedVertices = m_pVulkanInstance->m_skinner.GetSkinnedVertexCount();
+
+		// Passes come and go (occlusion off), an average only carries over while
+		// the same pass is in the same place
+		const std::vector<RenderGraphPassTiming>& timings = m_pVulkanInstance->m_renderGraph.GetTimings();
+		m_stats.passes.resize(timings.size());
+		for (size_t i = 0; i < timings.size(); i++) {
+			RenderPassStats& pass = m_stats.passes[i];
+			if (pass.name != timings[i].name) { pass.name = timings[i].name; pass.gpuTime = 0.0f; }
+			pass.culled = timings[i].culled;
+			if (!pass.culled) { RecordSample(&pass.gpuTime, timings[i].milliseconds); }
+		}
+		m_stats.transientBytes = m_pVulkanInstance->m_renderGraph.GetTransientBytes();
+		m_stats.transientAllocatedBytes = m_pVulkanInstance->m_renderGraph.GetTransientAllocatedBytes();
+
+		float latency = ToMilliseconds(submitted - in_snapshot.frameStart);
+		RecordSample(&m_stats.latency, latency);
+		m_latencyWorstWindow = std::max(m_latencyWorstWindow, latency);
+		if (++m_latencyWindowFrames >= RENDERER_LATENCY_WINDOW) {
+			m_stats.latencyWorst = m_latencyWorstWindow;
+			m_latencyWorstWindow = 0.0f;
+			m_latencyWindowFrames = 0;
+		}
+	}
+
+	void Renderer::RenderThreadLoop()
+	{
+		// Culling jobs from here shouldnt share per thread storage with the simulation thread
+		if (m_pThreadPool != nullptr) { m_pThreadPool->AttachCurrentThread(); }
+
+		while (true) {
+			RenderSnapshot* pSnapshot = m_snapshots.Acquire();
+			if (pSnapshot == nullptr) {
+				std::unique_lock<std::mutex> lock(m_wakeMutex);
+				m_wakeCondition.wait(lock, [this]() { return m_stopRenderThread.load() || m_snapshots.HasFresh(); });
+
+				// Whatever was published before stopping still gets drawn
+				if (m_stopRenderThread.load() && !m_snapshots.HasFresh()) { break; }
+				continue;
+			}
+
+			// The middle slot is free again, let a simulation waiting to publish go on
+			{
+				std::lock_guard<std::mutex> lock(m_wakeMutex);
+			}
+			m_consumedCondition.notify_one();
+
+			std::lock_guard<std::mutex> lock(m_vulkanMutex);
+			DrawSnapshot(*pSnapshot);
+		}
 
-		m_pVulkanInstance->DrawFrame(in_scene->GetModelDrawList(), in_scene->GetLightDrawList());
+		if (m_pThreadPool != nullptr) { m_pThreadPool->DetachCurrentThread(); }
+	}
+
+	void Renderer::RecordSample(float* in_pAverage, const float in_sample)
+	{
+		*in_pAverage = *in_pAverage == 0.0f ? in_sample : *in_pAverage + (in_sample - *in_pAverage) * RENDERER_STATS_SMOOTHING;
+	}
+
+	std::unique_lock<std::mutex> Renderer::LockForUpload()
+	{
+		std::unique_lock<std::mutex> out_lock(m_vulkanMutex);
+		vkDeviceWaitIdle(m_pVulkanInstance->m_device);
+
+		return out_lock;
+	}
+
+	bool Renderer::IsPresentVsyncLimited() const
+	{
+		return m_pVulkanInstance->m_presentMode == VK_PRESENT_MODE_FIFO_KHR ||
+			   m_pVulkanInstance->m_presentMode == VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+	}
+
+	double Renderer::GetDisplayRefreshRate() const
+	{
+		GLFWmonitor* monitor = glfwGetWindowMonitor(m_pWindow);
+		if (monitor == nullptr) { monitor = glfwGetPrimaryMonitor(); }
+
+		const GLFWvidmode* mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+		return mode ? (double)mode->refreshRate : 0.0;
 	}
 
 	VertexData Renderer::LoadOBJ(const char* in_filepath)
 	{
+		std::unique_lock<std::mutex> lock = LockForUpload();
+
 		VertexData out_vertexData;
 		m_pVulkanInstance->LoadVertexData(in_filepath, &out_vertexData);
 
@@ -52,8 +427,48 @@ namespace Mega
 		return out_vertexData;
 	}
 
+	std::vector<VertexData> Renderer::LoadOBJs(const std::vector<const char*>& in_filepaths)
+	{
+		std::unique_lock<std::mutex> lock = LockForUpload();
+
+		std::vector<VertexData> out_vertexDatas;
+		m_pVulkanInstance->LoadVertexData(in_filepaths, &out_vertexDatas);
+
+		m_pVulkanInstance->UpdateLoadedVertexData();
+		m_pVulkanInstance->UpdateLoadedIndexData();
+
+		return out_vertexDatas;
+	}
+
+	std::vector<StaticBatch> Renderer::BuildStaticBatches(const std::vector<Model*>& in_pModels, const ConstructInfoStaticBatch* in_pInfo)
+	{
+		std::unique_lock<std::mutex> lock = LockForUpload();
+
+		StaticBatchGeometry geometry;
+		BuildStaticBatchGeometry(in_pModels, m_pVulkanInstance->m_vertices, m_pVulkanInstance->m_indices, in_pInfo, &geometry);
+		m_pVulkanInstance->AppendStaticGeometry(&geometry);
+
+		std::cout << "Static batching: " << in_pModels.size() << " models into " << geometry.batches.size() << " draws" << std::endl;
+
+		return geometry.batches;
+	}
+
+	VertexData Renderer::LoadSkinnedMesh(const SkinnedMeshData& in_mesh)
+	{
+		std::unique_lock<std::mutex> lock = LockForUpload();
+
+		VertexData out_vertexData;
+		m_pVulkanInstance->LoadSkinnedMesh(in_mesh, &out_vertexData);
+
+		m_pVulkanInstance->UpdateLoadedIndexData();
+
+		return out_vertexData;
+	}
+
 	TextureData Renderer::LoadTexture(const char* in_filepath)
 	{
+		std::unique_lock<std::mutex> lock = LockForUpload();
+
 		TextureData out_textureData;
 		m_pVulkanInstance->LoadTextureData(in_filepath, &out_textureData);
 
@@ -1,8 +1,17 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "Engine/Graphics/Objects/ModelData.h"
+#include "Engine/Graphics/RenderSnapshot.h"
+#include "Engine/Graphics/StaticBatch.h"
 #include "Engine/Camera.h"
 #include "Engine/Core/SystemGuard.h"
 
@@ -11,16 +20,57 @@
 //#define RENDERER_PARALLEL_PROJECTION uint8_t(128)
 //#define RENDERER_WIREFRAME_DRAWING   uint8_t(64)
 
+#define RENDERER_SNAPSHOT_GRAIN_SIZE uint32_t(64)
+#define RENDERER_THREAD_COUNT        uint32_t(1) // Threads the renderer attaches to the thread pool (the render thread)
+#define RENDERER_STATS_SMOOTHING     0.05f // Weight of the newest sample in the running averages
+#define RENDERER_LATENCY_WINDOW      uint32_t(60) // Frames the worst latency is taken over
+#define RENDERER_LOD_PIXEL_ERROR     1.0f  // A LOD is used while its error covers less than this many pixels
+#define RENDERER_LOD_HYSTERESIS      0.5f  // A coarser LOD has to be this much under the limit before it's switched to
+
 struct GLFWwindow;
 namespace Mega
 {
 	class Engine;
 	class Scene;
 	class Vulkan;
+	class ThreadPool;
+	class Model;
+	struct SkinnedMeshData;
 }
 
 namespace Mega
 {
+	// Gpu time of one render graph pass, averaged like the rest while the frame keeps the same passes
+	struct RenderPassStats {
+		std::string name;
+		float gpuTime = 0.0f;
+		bool culled = false; // Declared but nothing used what it wrote
+	};
+
+	// Running averages in milliseconds, sampled the same way whether or not the render thread is on so
+	// the two modes can be compared directly
+	struct RenderPipelineStats {
+		float simulationFrame = 0.0f; // Between snapshots built, the simulation's throughput
+		float renderFrame = 0.0f;     // Between frames submitted, what actually reaches the screen
+		float renderWork = 0.0f;      // Cpu time spent recording and submitting one frame
+		float latency = 0.0f;         // From the start of a simulation frame to its frame being submitted
+		float latencyWorst = 0.0f;    // Over the last RENDERER_LATENCY_WINDOW frames
+		float simulationWait = 0.0f;  // Simulation blocked on the render thread picking up its last snapshot
+		uint64_t droppedSnapshots = 0; // Published but replaced before the renderer got to them
+		uint64_t trianglesFull = 0;    // Last snapshot, before LOD selection (and before culling)
+		uint64_t trianglesDrawn = 0;   // Last snapshot, after LOD selection (and portal culling)
+		uint32_t portalCulledDraws = 0; // In cells the camera can't see through the portals
+		uint32_t cpuOccludedDraws = 0; // Hidden behind occluders in the cpu depth buffer, never recorded
+		uint32_t occludedDraws = 0;    // Hidden by the gpu occlusion cull, a couple of frames behind
+		uint32_t recoveredDraws = 0;   // Hidden by last frame's depth but visible after this frame's first pass
+		uint32_t skinnedVertices = 0;  // Skinned by the compute pre-pass last frame
+		std::vector<RenderPassStats> passes; // In the order they ran, from the last frame with timestamps back
+		uint64_t transientBytes = 0;         // Every render graph transient on its own
+		uint64_t transientAllocatedBytes = 0; // What they take once the ones never alive at once share memory
+		bool occlusionCulling = false;
+		bool pipelined = false;
+	};
+
 	class Renderer : public SystemGuard {
 	public:
 		friend Engine;
@@ -28,16 +78,70 @@ namespace Mega
 		void OnInitialize();
 		void OnDestroy();
 
+		// Snapshots the scene (transforms, lights, debug lines, ImGui's draw data) and draws it. With the
+		// render thread running this only publishes the snapshot and returns, the frame is recorded and
+		// submitted while the simulation moves on to the next one. It waits first if the render thread
+		// hasn't picked up the previous snapshot yet, so the simulation is never more than a frame ahead
 		void DisplayScene(Scene* in_scene);
 		void DisplayScene(Scene* in_scene, const Camera& in_camera);
+
+		// Call when the simulation starts a frame (before input is read), latency is measured from here
+		void BeginFrame() { m_frameStart = RenderSnapshot::Clock::now(); }
+
+		// Starts or stops the render thread, frames in between are drawn on the calling thread
+		void SetPipelined(const bool in_pipelined);
+		bool IsPipelined() const { return m_renderThread.joinable(); }
+		RenderPipelineStats GetPipelineStats() const;
 		VertexData LoadOBJ(const char* in_filepath);
+		// Parses all of them in parallel and uploads the vertex/index buffers once
+		std::vector<VertexData> LoadOBJs(const std::vector<const char*>& in_filepaths);
 		TextureData LoadTexture(const char* in_filepath);
+		// Skinned models draw with it once an animated character is set on them (Model::SetAnimation)
+		VertexData LoadSkinnedMesh(const SkinnedMeshData& in_mesh);
+		// Bakes in_pModels into world space batches at the end of the geometry buffers, replacing the
+		// ones from the last call. The models have to be done loading and can't move after this
+		std::vector<StaticBatch> BuildStaticBatches(const std::vector<Model*>& in_pModels, const ConstructInfoStaticBatch* in_pInfo);
+
+		// True when the chosen present mode blocks on vblank (FIFO), used to avoid limiting the frame rate twice
+		bool IsPresentVsyncLimited() const;
+		double GetDisplayRefreshRate() const;
 
 	private:
 		void SetWindow(GLFWwindow* in_pWindow) { m_pWindow = in_pWindow; }
+		void SetThreadPool(ThreadPool* in_pThreadPool) { m_pThreadPool = in_pThreadPool; }
+
+		void BuildSnapshot(Scene* in_scene, const ViewData& in_viewData, RenderSnapshot* out_pSnapshot);
+		void SubmitSnapshot(RenderSnapshot* in_pSnapshot);
+		void DrawSnapshot(RenderSnapshot& in_snapshot);
+		void RenderThreadLoop();
+		void RecordSample(float* in_pAverage, const float in_sample);
+		// Frames still in flight may read the buffers an upload replaces, so this also waits for the gpu
+		std::unique_lock<std::mutex> LockForUpload();
 
 		Vulkan* m_pVulkanInstance = nullptr;
 		GLFWwindow* m_pWindow = nullptr;
+		ThreadPool* m_pThreadPool = nullptr;
+
+		// Snapshots
+		RenderSnapshotBuffer m_snapshots;
+		RenderSnapshot m_inlineSnapshot; // Used instead of the buffer while there is no render thread
+		uint64_t m_frameIndex = 0;
+		RenderSnapshot::Clock::time_point m_frameStart;
+		RenderSnapshot::Clock::time_point m_lastPublish;
+		RenderSnapshot::Clock::time_point m_lastSubmit;
+
+		// Render thread
+		std::thread m_renderThread;
+		std::atomic<bool> m_stopRenderThread = { false };
+		std::mutex m_wakeMutex; // Only for sleeping on the other side, the handoff itself is lock free
+		std::condition_variable m_wakeCondition;     // Render thread waiting for a snapshot
+		std::condition_variable m_consumedCondition; // Simulation waiting for the last one to be picked up
+		std::mutex m_vulkanMutex; // Held for every frame drawn and every asset upload
+
+		mutable std::mutex m_statsMutex;
+		RenderPipelineStats m_stats;
+		float m_latencyWorstWindow = 0.0f;
+		uint32_t m_latencyWindowFrames = 0;
 
 		uint8_t m_bitFieldRenderFlags = 0;
 	};
@@ -0,0 +1,111 @@
+#include "StaticBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Engine/Core/Debug.h"
+#include "Engine/Graphics/Objects/Model.h"
+
+#define STATIC_BATCH_UNMAPPED INDEX_TYPE(0xFFFFFFFF)
+
+namespace Mega
+{
+	struct StaticBatchKey {
+		int32_t cell[3];
+		int32_t textureIndex;
+
+		bool operator<(const StaticBatchKey& in_other) const {
+			if (cell[0] != in_other.cell[0]) { return cell[0] < in_other.cell[0]; }
+			if (cell[1] != in_other.cell[1]) { return cell[1] < in_other.cell[1]; }
+			if (cell[2] != in_other.cell[2]) { return cell[2] < in_other.cell[2]; }
+			return textureIndex < in_other.textureIndex;
+		}
+		bool operator==(const StaticBatchKey& in_other) const { return !(*this < in_other) && !(in_other < *this); }
+	};
+
+	void BuildStaticBatchGeometry(const std::vector<Model*>& in_pModels, const std::vector<Vertex>& in_vertices, const std::vector<INDEX_TYPE>& in_indices,
+		const ConstructInfoStaticBatch* in_pInfo, StaticBatchGeometry* out_pGeometry)
+	{
+		ConstructInfoStaticBatch info = in_pInfo ? *in_pInfo : ConstructInfoStaticBatch();
+		MEGA_ASSERT(info.cellSize > 0.0f, "Static batch cells need a size");
+
+		out_pGeometry->vertices.clear();
+		out_pGeometry->indices.clear();
+		out_pGeometry->batches.clear();
+
+		// Every model's push constants are what it would have drawn with, that is what gets baked
+		struct Entry {
+			StaticBatchKey key;
+			Model::PushConstant pushData;
+			const VertexData* pVertexData;
+		};
+		std::vector<Entry> entries;
+		entries.reserve(in_pModels.size());
+
+		for (const Model* pModel : in_pModels) {
+			Entry entry;
+			pModel->GetPushConstantData(&entry.pushData);
+			entry.pVertexData = pModel->GetVertexData();
+
+			// Cell of the world space center of the model's bounds
+			Vec3F center = Vec3F(entry.pushData.model * Vec4F((entry.pVertexData->boundsMin + entry.pVertexData->boundsMax) * 0.5f, 1.0f));
+			for (int axis = 0; axis < 3; axis++) { entry.key.cell[axis] = (int32_t)std::floor(center[axis] / info.cellSize); }
+			entry.key.textureIndex = entry.pushData.textureData;
+
+			entries.push_back(entry);
+		}
+
+		std::stable_sort(entries.begin(), entries.end(), [](const Entry& in_a, const Entry& in_b) { return in_a.key < in_b.key; });
+
+		// Old vertex index -> merged vertex index, only for the mesh being copied. Reset through the touched list
+		std::vector<INDEX_TYPE> remap(in_vertices.size(), STATIC_BATCH_UNMAPPED);
+		std::vector<INDEX_TYPE> touched;
+
+		for (size_t first = 0; first < entries.size();) {
+			size_t last = first;
+			while (last < entries.size() && entries[last].key == entries[first].key) { last++; }
+
+			StaticBatch batch;
+			batch.textureIndex = entries[first].key.textureIndex;
+			batch.modelCount = (uint32_t)(last - first);
+			batch.vertexData.indices[0] = (uint32_t)out_pGeometry->indices.size();
+			batch.vertexData.boundsMin = Vec3F(std::numeric_limits<float>::max());
+			batch.vertexData.boundsMax = Vec3F(-std::numeric_limits<float>::max());
+
+			for (size_t e = first; e < last; e++) {
+				const Entry& entry = entries[e];
+				const Mat4x4F& model = entry.pushData.model;
+				const glm::mat3 normalMatrix = glm::mat3(model); // Same as the vertex shader does with the model matrix
+
+				for (uint32_t i = entry.pVertexData->indices[0]; i < entry.pVertexData->indices[1]; i++) {
+					INDEX_TYPE source = in_indices[i];
+					if (remap[source] == STATIC_BATCH_UNMAPPED) {
+						Vertex vertex = in_vertices[source];
+						vertex.pos = Vec3F(model * Vec4F(vertex.pos, 1.0f));
+						vertex.normal = normalMatrix * vertex.normal;
+						vertex.color *= entry.pushData.color;
+						vertex.texCoord = vertex.texCoord * entry.pushData.texCoordMult + entry.pushData.texCoordAdd;
+
+						batch.vertexData.boundsMin = glm::min(batch.vertexData.boundsMin, vertex.pos);
+						batch.vertexData.boundsMax = glm::max(batch.vertexData.boundsMax, vertex.pos);
+
+						remap[source] = (INDEX_TYPE)out_pGeometry->vertices.size();
+						touched.push_back(source);
+						out_pGeometry->vertices.push_back(vertex);
+					}
+
+					out_pGeometry->indices.push_back(remap[source]);
+				}
+
+				for (INDEX_TYPE source : touched) { remap[source] = STATIC_BATCH_UNMAPPED; }
+				touched.clear();
+			}
+
+			batch.vertexData.indices[1] = (uint32_t)out_pGeometry->indices.size();
+			if (batch.vertexData.indices[1] > batch.vertexData.indices[0]) { out_pGeometry->batches.push_back(batch); }
+
+			first = last;
+		}
+	}
+}
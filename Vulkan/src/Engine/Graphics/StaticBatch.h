@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Engine/Graphics/Objects/ModelData.h"
+#include "Engine/Graphics/Objects/Vertex.h"
+
+#define STATIC_BATCH_DEFAULT_CELL_SIZE 32.0f // World units per side of a culling cell
+
+namespace Mega
+{
+	class Model;
+}
+
+namespace Mega
+{
+	struct ConstructInfoStaticBatch {
+		float cellSize = STATIC_BATCH_DEFAULT_CELL_SIZE;
+	};
+
+	// Every static model in one cell that uses one texture, already in world space. Drawn with an
+	// identity model matrix, vertexData's bounds are world space too
+	struct StaticBatch {
+		VertexData vertexData;
+		int32_t textureIndex = -1;
+		uint32_t modelCount = 0;
+	};
+
+	// Merged geometry before it goes into the renderer's buffers. Indices point into vertices and the
+	// batches' index ranges point into indices, both start at 0
+	struct StaticBatchGeometry {
+		std::vector<Vertex> vertices;
+		std::vector<INDEX_TYPE> indices;
+		std::vector<StaticBatch> batches;
+	};
+
+	// Pre-transforms every model's mesh (read out of the shared in_vertices/in_indices) into world space
+	// with its color baked into the vertices, then merges the models that land in the same cell (by the
+	// center of their bounds) and share a texture. Batches come out sorted by cell, then texture
+	void BuildStaticBatchGeometry(const std::vector<Model*>& in_pModels, const std::vector<Vertex>& in_vertices, const std::vector<INDEX_TYPE>& in_indices,
+		const ConstructInfoStaticBatch* in_pInfo, StaticBatchGeometry* out_pGeometry);
+}
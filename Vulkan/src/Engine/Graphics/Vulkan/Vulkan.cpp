@@ -5,6 +5,7 @@
 #include <array>
 #include <cstring>
 #include <cstdlib>
+#include <cfloat>
 #include <optional>
 #include <set>
 #include <unordered_set>
@@ -12,9 +13,11 @@
 #include <algorithm>
 #include <fstream>
 #include <chrono>
+#include <atomic>
 #include <iostream>
 
 #include "VulkanImgui.h"
+#include "Engine/Core/ThreadPool.h"
 #include "Engine/Graphics/Objects/Objects.h"
 #include "Engine/Graphics/Renderer.h"
 
@@ -37,6 +40,10 @@ void Vulkan::Initialize(Renderer* in_pRenderer, GLFWwindow* in_pWindow)
 	m_pRenderer = in_pRenderer;
 	m_pWindow = in_pWindow;
 
+	int width, height;
+	glfwGetFramebufferSize(m_pWindow, &width, &height);
+	m_windowExtent = { (uint32_t)width, (uint32_t)height };
+
 	// Initialize Vulkan
 	CreateInstance(); // Create and store instance
 
@@ -49,8 +56,9 @@ void Vulkan::Initialize(Renderer* in_pRenderer, GLFWwindow* in_pWindow)
 	RetrieveSwapchainImages(m_swapchainImages, m_swapchain);
 	CreateSwapchainImageViews(m_swapchainImageViews, m_swapchainImages); // Create image views for swapchain
 
-	CreateRenderPass();
-	CreateDepthResources(m_depthObject);
+	m_renderGraph.Initialize(this);
+	// Pipelines are made against the graph's render passes, depth is one of its transients
+	m_renderPass = m_renderGraph.GetCompatibleRenderPass({ m_surfaceFormat.format }, FindDepthFormat());
 
 	CreateDrawCommandPools(m_drawCommandPools);
 
@@ -64,29 +72,29 @@ void Vulkan::Initialize(Renderer* in_pRenderer, GLFWwindow* in_pWindow)
 
 	CreateDescriptorSetLayout(m_device, m_descriptorSetLayout);
 	CreateGraphicsPipeline(m_vertShaderModule, m_fragShaderModule, m_graphicsPipeline);
-	CreateFramebuffers(m_swapchainFramebuffers);
+	LoadLineShaders();
+	CreateLinePipeline();
 
 	CreateDrawCommands(m_drawCommandBuffers, m_drawCommandPools);
 
 	CreateUniformBuffers();
-	PrepareOffscreen();
 	CreateDescriptorPool();
 	CreateDescriptorSets();
 
 	CreateSyncObjects();
 
+	m_occlusionRasterizer.Initialize(nullptr);
+	m_occlusionCuller.Initialize(this);
+
+	m_boneBuffers.resize(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+	m_boneBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+	m_boneBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT, nullptr);
+	m_boneBufferCapacities.resize(MAX_FRAMES_IN_FLIGHT, 0);
+	m_skinner.Initialize(this);
+	m_bloom.Initialize(this);
+
 	m_imguiObject.Initialize(m_pWindow);
 	m_imguiObject.CreateRenderData(this);
-
-	// =================== OPTIMIZATION OCTOBER ============================ //
-	// uint32_t queryCount = 5;
-	// 
-	// VkQueryPoolCreateInfo queryCreateInfo{};
-	// queryCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
-	// queryCreateInfo.queryCount = queryCount;
-	// 
-	// vkCreateQueryPool(m_device, &queryCreateInfo, nullptr, &m_queryPool);
-	// ===================================================================== //
 }
 
 void Vulkan::Destroy()
@@ -102,6 +110,10 @@ void Vulkan::Destroy()
 	
 	// Cleanup Vulkan
 	CleanupSwapchain(&m_swapchain);
+	m_occlusionCuller.Destroy(this);
+	m_skinner.Destroy(this);
+	m_bloom.Destroy(this);
+	m_renderGraph.Destroy();
 
 	vkDestroySampler(m_device, m_sampler, nullptr);
 	for (auto& t : m_textures) { ImageObject::Destroy(&m_device, &t); }
@@ -116,6 +128,11 @@ void Vulkan::Destroy()
 	vkDestroyShaderModule(m_device, m_vertShaderModule, nullptr);
 	vkDestroyShaderModule(m_device, m_fragShaderModule, nullptr);
 
+	for (size_t i = 0; i < m_lineBuffers.size(); i++) { DestroyLineBuffer(i); }
+	for (size_t i = 0; i < m_boneBuffers.size(); i++) { DestroyBoneBuffer(i); }
+	if (m_lineVertShaderModule != VK_NULL_HANDLE) { vkDestroyShaderModule(m_device, m_lineVertShaderModule, nullptr); }
+	if (m_lineFragShaderModule != VK_NULL_HANDLE) { vkDestroyShaderModule(m_device, m_lineFragShaderModule, nullptr); }
+
 	for (auto& pool : m_drawCommandPools) {
 		vkDestroyCommandPool(m_device, pool, nullptr);
 	}
@@ -136,15 +153,16 @@ void Vulkan::Destroy()
 }
 void Vulkan::CleanupSwapchain(VkSwapchainKHR* in_swapchain)
 {
-	ImageObject::Destroy(&m_device, &m_depthObject);
-
-	for (size_t i = 0; i < m_swapchainFramebuffers.size(); i++) {
-		vkDestroyFramebuffer(m_device, m_swapchainFramebuffers[i], nullptr);
-	}
+	m_occlusionCuller.DestroySwapchainResources(this);
+	m_bloom.DestroySwapchainResources(this);
+	m_renderGraph.DestroySwapchainResources();
 
 	vkDestroyPipeline(m_device, m_graphicsPipeline, nullptr);
+	if (m_linePipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(m_device, m_linePipeline, nullptr);
+		m_linePipeline = VK_NULL_HANDLE;
+	}
 	vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
-	vkDestroyRenderPass(m_device, m_renderPass, nullptr);
 
 	for (size_t i = 0; i < m_swapchainImageViews.size(); i++) {
 		vkDestroyImageView(m_device, m_swapchainImageViews[i], nullptr);
@@ -177,14 +195,16 @@ void Vulkan::RecreateSwapchain()
 	CleanupSwapchain(&m_swapchain);
 
 	CreateSwapchain(m_pWindow, m_surface, m_swapchain);
+	RetrieveSwapchainImages(m_swapchainImages, m_swapchain); // The new swapchain has new images, the old handles are gone
 	CreateSwapchainImageViews(m_swapchainImageViews, m_swapchainImages); // Create image views for swapchain
-	CreateRenderPass();
+	m_renderPass = m_renderGraph.GetCompatibleRenderPass({ m_surfaceFormat.format }, FindDepthFormat());
 	CreateGraphicsPipeline(m_vertShaderModule, m_fragShaderModule, m_graphicsPipeline);
-	CreateDepthResources(m_depthObject);
-	CreateFramebuffers(m_swapchainFramebuffers);
+	CreateLinePipeline();
 	CreateDescriptorPool();
 	CreateDescriptorSets();
 	CreateDrawCommands(m_drawCommandBuffers, m_drawCommandPools);
+	m_occlusionCuller.CreateSwapchainResources(this);
+	m_bloom.CreateSwapchainResources(this);
 
 	// ImGui //
 	//ImGui_ImplVulkan_SetMinImageCount(2);
@@ -192,10 +212,14 @@ void Vulkan::RecreateSwapchain()
 		//static_cast<uint32_t>(m_queueFamilyIndices.graphicsFamily.value()), VK_NULL_HANDLE, 500, 500, uint32_t(1));
 }
 
-void Vulkan::DrawFrame(const std::vector<Model*>& in_pModels, const std::vector<Light*>& in_pLights)
+void Vulkan::DrawFrame(RenderSnapshot& in_snapshot)
 {
+	m_viewData = in_snapshot.viewData;
+	if (in_snapshot.framebufferWidth != 0 && in_snapshot.framebufferHeight != 0) { m_windowExtent = { in_snapshot.framebufferWidth, in_snapshot.framebufferHeight }; }
 
 	vkWaitForFences(m_device, 1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
+	m_occlusionCuller.ReadCounters(m_currentFrame);
+	m_renderGraph.Begin(m_currentFrame);
 
 	uint32_t imageIndex;
 	VkResult result = vkAcquireNextImageKHR(m_device, m_swapchain, UINT64_MAX, m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &imageIndex);
@@ -220,18 +244,24 @@ void Vulkan::DrawFrame(const std::vector<Model*>& in_pModels, const std::vector<
 	VkSemaphore waitSemaphores[] = { m_imageAvailableSemaphores[m_currentFrame] };
 	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 
-	UpdateUniformBuffer(imageIndex, in_pLights);
+	UpdateUniformBuffer(imageIndex, in_snapshot.lights);
+	uint32_t lineVertexCount = UploadDebugLines(in_snapshot.lineVertices);
+	UploadBonePalette(in_snapshot.bonePalette);
+	PrepareDraws(in_snapshot.draws);
+	// After culling so only visible skinned draws get skinned
+	m_skinner.Prepare(this, m_currentFrame, in_snapshot.draws, &m_drawVisible, &m_drawVertexOffsets);
+
+	// Without the culler everything goes in one pass like before
+	bool occlusion = m_occlusionCuller.IsEnabled();
+	if (occlusion) {
+		m_occlusionCuller.Upload(this, m_currentFrame, in_snapshot.draws, m_drawVisible, m_drawVertexOffsets);
+	}
 
 	// ======================= Draw Shit =============== //
 
 	auto* commandBuffer = &m_drawCommandBuffers[imageIndex];
 	// auto* commandBuffer = &m_imguiObject.m_frames[imageIndex].CommandBuffer;
 
-	// Multiple colors for the depth and image attachment
-	std::array<VkClearValue, 2> clearValues{};
-	clearValues[0].color = { { CLEAR_COLOR } };
-	clearValues[1].depthStencil = { 1.0f, 0 };
-
 	VkCommandBufferBeginInfo beginInfo{};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	beginInfo.flags = 0; // Optional
@@ -240,63 +270,126 @@ void Vulkan::DrawFrame(const std::vector<Model*>& in_pModels, const std::vector<
 	result = vkBeginCommandBuffer(*commandBuffer, &beginInfo);
 	assert(result == VK_SUCCESS && "vkBeginCommandBuffer() did not return success");
 
-	VkRenderPassBeginInfo renderPassInfo{};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = m_renderPass;
-	renderPassInfo.framebuffer = m_swapchainFramebuffers[imageIndex]; // Remember, framebuffers reference VkImageView objects which represent the attachments 
-	renderPassInfo.renderArea.offset = { 0, 0 };
-	renderPassInfo.renderArea.extent = m_swapchainExtent;
-	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-	renderPassInfo.pClearValues = clearValues.data();
-
-	vkCmdBeginRenderPass(*commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	// Everything below only declares passes, the graph places the barriers between them and records
+	// them in order in Execute. The image was just acquired so whatever was in it is discarded
+	RenderGraphResource backbuffer = m_renderGraph.ImportImage("Backbuffer", m_swapchainImages[imageIndex], m_swapchainImageViews[imageIndex],
+		m_surfaceFormat.format, m_swapchainExtent, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, true);
+	RenderGraphResource depth = m_renderGraph.CreateImage("Depth", { FindDepthFormat(), m_swapchainExtent, 1 });
 
-	vkCmdBindPipeline(*commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+	RenderGraphResource skinned = m_skinner.AddPass(&m_renderGraph, m_currentFrame);
 
-	vkCmdBindDescriptorSets(*commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSets[imageIndex], 0, nullptr);
+	Mat4x4F view, projection;
+	GetViewProjection(&view, &projection);
 
 	// ==================== Models 3D ================== //
 
-	VkBuffer vertexBuffers1[] = { m_vertexBuffer };
-	VkDeviceSize offsets1[] = { 0 };
-	vkCmdBindVertexBuffers(*commandBuffer, 0, 1, vertexBuffers1, offsets1);
-	vkCmdBindIndexBuffer(*commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	// in_phase < 0 draws directly, otherwise the culler's commands for that phase decide what shows up
+	auto recordModels = [&](VkCommandBuffer in_command, const int32_t in_phase) {
+		vkCmdBindPipeline(in_command, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+
+		vkCmdBindDescriptorSets(in_command, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSets[imageIndex], 0, nullptr);
+
+		VkBuffer vertexBuffers1[] = { m_vertexBuffer };
+		VkDeviceSize offsets1[] = { 0 };
+		vkCmdBindVertexBuffers(in_command, 0, 1, vertexBuffers1, offsets1);
+		vkCmdBindIndexBuffer(in_command, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+		VkBuffer boundVertexBuffer = m_vertexBuffer;
+
+		for (size_t i = 0; i < in_snapshot.draws.size(); i++) {
+			if (!m_drawVisible[i]) { continue; }
+			const RenderSnapshotDraw& draw = in_snapshot.draws[i];
+
+			// Skinned draws read the pre-pass's output, everything else the shared vertex buffer
+			VkBuffer vertexBuffer = draw.vertexData.IsSkinned() ? m_skinner.GetOutputBuffer(m_currentFrame) : m_vertexBuffer;
+			if (vertexBuffer != boundVertexBuffer) {
+				vkCmdBindVertexBuffers(in_command, 0, 1, &vertexBuffer, offsets1);
+				boundVertexBuffer = vertexBuffer;
+			}
+
+			// Push constants
+			vkCmdPushConstants(in_command, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Model::PushConstant), &draw.pushData);
 
-	// vkCmdWriteTimestamp(*commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, 0);
+			if (in_phase < 0) {
+				uint32_t s = draw.vertexData.indices[0];
+				uint32_t e = draw.vertexData.indices[1];
 
-	for (const auto& pModel : in_pModels) {
-		// Push constants
-		Model::PushConstant pushData;
+				vkCmdDrawIndexed(in_command, e - s, 1, s, m_drawVertexOffsets[i], 0);
+			}
+			else {
+				vkCmdDrawIndexedIndirect(in_command, m_occlusionCuller.m_commandBuffer, m_occlusionCuller.GetCommandOffset((uint32_t)in_phase, (uint32_t)i), 1, sizeof(VkDrawIndexedIndirectCommand));
+			}
+		}
+	};
+
+	// ================== Debug Lines ================= //
 
-		pModel->GetPushConstantData(&pushData);
+	// Same pipeline layout as the models so the descriptor set bound by them stays valid
+	auto recordLines = [&](VkCommandBuffer in_command) {
+		if (lineVertexCount == 0) { return; }
 
-		vkCmdPushConstants(*commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Model::PushConstant), &pushData);
+		vkCmdBindPipeline(in_command, VK_PIPELINE_BIND_POINT_GRAPHICS, m_linePipeline);
 
-		uint32_t s = pModel->GetVertexData()->indices[0];
-		uint32_t e = pModel->GetVertexData()->indices[1];
+		VkDeviceSize lineOffsets[] = { 0 };
+		vkCmdBindVertexBuffers(in_command, 0, 1, &m_lineBuffers[m_currentFrame], lineOffsets);
+		vkCmdDraw(in_command, lineVertexCount, 1, 0, 0);
+	};
+
+	// The second phase keeps what the first drew, the lines go in whichever pass is last
+	auto addScenePass = [&](const char* in_name, const int32_t in_phase, const bool in_last) {
+		RenderGraphPass pass = m_renderGraph.AddPass(in_name, eRenderGraphPass::Graphics, [=, &recordModels, &recordLines](VkCommandBuffer in_command) {
+			recordModels(in_command, in_phase);
+			if (in_last) { recordLines(in_command); }
+		});
+
+		VkAttachmentLoadOp loadOp = in_phase > 0 ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+		VkClearValue colorClear{};
+		colorClear.color = { { CLEAR_COLOR } };
+		VkClearValue depthClear{};
+		depthClear.depthStencil = { 1.0f, 0 };
+		m_renderGraph.Use(pass, backbuffer, eRenderGraphAccess::ColorAttachment, loadOp, colorClear);
+		m_renderGraph.Use(pass, depth, eRenderGraphAccess::DepthAttachment, loadOp, depthClear);
+
+		if (skinned != RENDER_GRAPH_NO_RESOURCE) {
+			m_renderGraph.Use(pass, skinned, eRenderGraphAccess::VertexBuffer);
+		}
+		if (in_phase >= 0) {
+			m_renderGraph.Use(pass, m_occlusionCuller.GetCommandResource(), eRenderGraphAccess::IndirectBuffer);
+		}
+	};
 
-		vkCmdDrawIndexed(*commandBuffer, e - s, 1, s, 0, 0);
+	if (occlusion) {
+		// Rebuild the pyramid from what the first phase drew and give everything it hid a second chance
+		m_occlusionCuller.AddCullPass(&m_renderGraph, m_currentFrame, projection * view, 0);
+		addScenePass("Scene", 0, false);
+		m_occlusionCuller.AddPyramidPass(&m_renderGraph, depth);
+		m_occlusionCuller.AddCullPass(&m_renderGraph, m_currentFrame, projection * view, 1);
+		addScenePass("Scene (second phase)", 1, true);
+	}
+	else {
+		addScenePass("Scene", -1, true);
 	}
 
-	// vkCmdWriteTimestamp(*commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, 1);
-	// 
-	// uint64_t data[2];
-	// vkGetQueryPoolResults(m_device, m_queryPool, 0, 2, 2*sizeof(uint64_t), &data, 0, VK_QUERY_RESULT_64_BIT);
-	// std::cout << "TIME STAMP 1: " << data[0] << std::endl;
-	// std::cout << "TIME STAMP 2: " << data[1] << std::endl;
+	// ===================== Bloom ===================== //
 
-	// ================================================= //
+	// After the scene and before the UI, so the UI never glows
+	if (m_bloom.IsEnabled()) {
+		m_bloom.AddPasses(&m_renderGraph, backbuffer, imageIndex);
+	}
 
 	// ======================= ImGui =================== //
 
-	if (ImGui::GetDrawData())
+	// The snapshot's own copy, ImGui may already be building the next frame on the simulation thread
+	if (ImDrawData* pDrawData = in_snapshot.ui.GetDrawData())
 	{
-		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), *commandBuffer, NULL);
+		RenderGraphPass uiPass = m_renderGraph.AddPass("UI", eRenderGraphPass::Graphics, [pDrawData](VkCommandBuffer in_command) {
+			ImGui_ImplVulkan_RenderDrawData(pDrawData, in_command, NULL);
+		});
+		m_renderGraph.Use(uiPass, backbuffer, eRenderGraphAccess::ColorAttachment);
 	}
 
 	// ================================================= //
 
-	vkCmdEndRenderPass(*commandBuffer);
+	m_renderGraph.Execute(*commandBuffer);
 
 	result = vkEndCommandBuffer(*commandBuffer);
 	assert(result == VK_SUCCESS && "ERROR: vkEndCommandBuffer() did not return success");
@@ -434,25 +527,56 @@ void Vulkan::LoadVertexData(const char* in_objPath, VertexData* in_pVertexData,
 	// Loads and stores data into vertex and index buffer given a customobj file and
 	// fills in_pVertexData with proper data to access the data stored in those buffers
 
+	OBJMeshData mesh;
+	ParseOBJ(in_objPath, in_MTLDir, &mesh);
+	AppendMesh(mesh, in_pVertexData);
+}
+
+void Vulkan::LoadVertexData(const std::vector<const char*>& in_objPaths, std::vector<VertexData>* out_pVertexDatas, const char* in_MTLDir)
+{
+	std::vector<OBJMeshData> meshes(in_objPaths.size());
+	std::vector<std::string> errors(in_objPaths.size());
+
+	// An exception cant leave a job, hand it back to this thread instead
+	JobCounter parsed;
+	for (size_t i = 0; i < in_objPaths.size(); i++) {
+		auto parse = [&, i]() {
+			try { ParseOBJ(in_objPaths[i], in_MTLDir, &meshes[i]); }
+			catch (const std::exception& error) { errors[i] = std::string(in_objPaths[i]) + ": " + error.what(); }
+		};
+
+		if (m_pThreadPool != nullptr) { m_pThreadPool->Run(parse, &parsed); }
+		else { parse(); }
+	}
+	if (m_pThreadPool != nullptr) { m_pThreadPool->Wait(&parsed); }
+
+	for (const auto& error : errors) {
+		if (!error.empty()) { MEGA_RUNTIME_ERROR("Failed to load OBJ " + error); }
+	}
+
+	out_pVertexDatas->resize(in_objPaths.size());
+	for (size_t i = 0; i < meshes.size(); i++) {
+		AppendMesh(meshes[i], &(*out_pVertexDatas)[i]);
+	}
+}
+
+void Vulkan::ParseOBJ(const char* in_objPath, const char* in_MTLDir, OBJMeshData* out_pMesh)
+{
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
 	std::vector<tinyobj::material_t> materials;
-	std::string warning, error;
+	std::string error;
 
-	bool result = tinyobj::LoadObj(&attrib, &shapes, &materials, &warning, &error, in_objPath, in_MTLDir);
+	bool result = tinyobj::LoadObj(&attrib, &shapes, &materials, &out_pMesh->warning, &error, in_objPath, in_MTLDir);
 	if (!result) {
 		throw std::exception(error.c_str());
 		std::cout << "Failed to load OBJ" << std::endl;
 	};
-	std::cout << "Warning: " + warning << std::endl;
-
-	std::vector<VertexData> m_vertexDatas(materials.size());
-
-	// Set vertex data indices start
-	in_pVertexData->indices[0] = m_indices.size();
 
 	// Fill it into are format
 	std::unordered_map<Vertex, INDEX_TYPE> uniqueVertices;
+	Vec3F boundsMin = Vec3F(FLT_MAX);
+	Vec3F boundsMax = Vec3F(-FLT_MAX);
 	for (const auto& shape : shapes) {
 		for (const auto& index : shape.mesh.indices) {
 			Vertex vertex{};
@@ -466,6 +590,9 @@ void Vulkan::LoadVertexData(const char* in_objPath, VertexData* in_pVertexData,
 					attrib.vertices[3 * index.vertex_index + 1],
 					attrib.vertices[3 * index.vertex_index + 2]
 				};
+
+				boundsMin = glm::min(boundsMin, vertex.pos);
+				boundsMax = glm::max(boundsMax, vertex.pos);
 			}
 
 			// Texture Coordinate
@@ -494,24 +621,138 @@ void Vulkan::LoadVertexData(const char* in_objPath, VertexData* in_pVertexData,
 
 			// Unique Indices
 			if (uniqueVertices.count(vertex) == 0) {
-				uniqueVertices[vertex] = static_cast<INDEX_TYPE>(m_vertices.size());
-				m_vertices.push_back(vertex);
+				uniqueVertices[vertex] = static_cast<INDEX_TYPE>(out_pMesh->vertices.size());
+				out_pMesh->vertices.push_back(vertex);
 			}
 
-			m_indices.push_back(uniqueVertices[vertex]);
+			out_pMesh->indices.push_back(uniqueVertices[vertex]);
 		}
 	}
 
+	for (const auto& m : materials) {
+		out_pMesh->materialNames.push_back(m.name);
+	}
+
+	if (boundsMin.x <= boundsMax.x) {
+		out_pMesh->boundsMin = boundsMin;
+		out_pMesh->boundsMax = boundsMax;
+	}
+
+	// Cooked here so LoadOBJs simplifies every mesh in parallel too
+	GenerateMeshLODs(out_pMesh->vertices, out_pMesh->indices, nullptr, &out_pMesh->lods);
+}
+
+void Vulkan::AppendMesh(const OBJMeshData& in_mesh, VertexData* out_pVertexData)
+{
+	std::cout << "Warning: " + in_mesh.warning << std::endl;
 	std::cout << "=============================== MATERIALS: ==========================================\n" << std::endl;
 
-	for (const auto& m : materials)
+	for (const auto& name : in_mesh.materialNames)
 	{
-		std::cout << m.name << std::endl;
+		std::cout << name << std::endl;
 		std::cout << "Here" << std::endl;
 	}
 
-	// Set vertex data indices end
-	in_pVertexData->indices[1] = m_indices.size();
+	// The mesh's indices start at 0, move them past everything already loaded
+	INDEX_TYPE vertexOffset = static_cast<INDEX_TYPE>(m_vertices.size());
+
+	out_pVertexData->indices[0] = m_indices.size();
+	m_vertices.insert(m_vertices.end(), in_mesh.vertices.begin(), in_mesh.vertices.end());
+	m_indices.reserve(m_indices.size() + in_mesh.indices.size());
+	for (INDEX_TYPE index : in_mesh.indices) {
+		m_indices.push_back(index + vertexOffset);
+	}
+	out_pVertexData->indices[1] = m_indices.size();
+
+	out_pVertexData->boundsMin = in_mesh.boundsMin;
+	out_pVertexData->boundsMax = in_mesh.boundsMax;
+
+	// Every level's indices go right after the full mesh's, pointing at the same vertices
+	out_pVertexData->lodCount = 0;
+	if (!in_mesh.lods.empty()) {
+		out_pVertexData->lods[0].indices[0] = out_pVertexData->indices[0];
+		out_pVertexData->lods[0].indices[1] = out_pVertexData->indices[1];
+		out_pVertexData->lods[0].error = 0.0f;
+		out_pVertexData->lodCount = 1;
+
+		for (const MeshLODLevel& level : in_mesh.lods) {
+			if (out_pVertexData->lodCount >= MESH_LOD_MAX_LEVELS) { break; }
+
+			MeshLOD& lod = out_pVertexData->lods[out_pVertexData->lodCount++];
+			lod.indices[0] = m_indices.size();
+			for (INDEX_TYPE index : level.indices) {
+				m_indices.push_back(index + vertexOffset);
+			}
+			lod.indices[1] = m_indices.size();
+			lod.error = level.error;
+		}
+	}
+}
+void Vulkan::AppendStaticGeometry(StaticBatchGeometry* io_pGeometry)
+{
+	// Drop the old batches if they are still the last thing in the buffers, otherwise they just stay as dead space
+	if (m_staticIndexEnd > m_staticIndexBegin) {
+		if (m_staticVertexEnd == m_vertices.size() && m_staticIndexEnd == m_indices.size()) {
+			m_vertices.resize(m_staticVertexBegin);
+			m_indices.resize(m_staticIndexBegin);
+		}
+		else {
+			std::cout << "WARNING: Models were loaded after the last static batches, their geometry stays in the buffers" << std::endl;
+		}
+	}
+
+	INDEX_TYPE vertexOffset = static_cast<INDEX_TYPE>(m_vertices.size());
+	uint32_t indexOffset = static_cast<uint32_t>(m_indices.size());
+
+	m_staticVertexBegin = m_vertices.size();
+	m_staticIndexBegin = m_indices.size();
+
+	m_vertices.insert(m_vertices.end(), io_pGeometry->vertices.begin(), io_pGeometry->vertices.end());
+	m_indices.reserve(m_indices.size() + io_pGeometry->indices.size());
+	for (INDEX_TYPE index : io_pGeometry->indices) {
+		m_indices.push_back(index + vertexOffset);
+	}
+
+	m_staticVertexEnd = m_vertices.size();
+	m_staticIndexEnd = m_indices.size();
+
+	for (StaticBatch& batch : io_pGeometry->batches) {
+		batch.vertexData.indices[0] += indexOffset;
+		batch.vertexData.indices[1] += indexOffset;
+	}
+
+	// Nothing left to draw would mean a zero sized buffer
+	if (!m_vertices.empty() && !m_indices.empty()) {
+		UpdateLoadedVertexData();
+		UpdateLoadedIndexData();
+	}
+}
+
+void Vulkan::LoadSkinnedMesh(const SkinnedMeshData& in_mesh, VertexData* out_pVertexData)
+{
+	MEGA_ASSERT(!in_mesh.vertices.empty() && !in_mesh.indices.empty(), "Skinned mesh has no geometry");
+
+	// Indices stay 0 based, each draw gets its vertexOffset into the skinner's output instead
+	out_pVertexData->indices[0] = m_indices.size();
+	m_indices.insert(m_indices.end(), in_mesh.indices.begin(), in_mesh.indices.end());
+	out_pVertexData->indices[1] = m_indices.size();
+
+	out_pVertexData->skinVertices[0] = m_skinner.AppendSource(this, in_mesh.vertices);
+	out_pVertexData->skinVertices[1] = out_pVertexData->skinVertices[0] + (uint32_t)in_mesh.vertices.size();
+
+	// Only the bind pose is known here, padded so the culled bounds still hold most poses
+	Vec3F boundsMin = in_mesh.vertices[0].pos;
+	Vec3F boundsMax = in_mesh.vertices[0].pos;
+	for (const AnimatedVertex& vertex : in_mesh.vertices) {
+		boundsMin = glm::min(boundsMin, vertex.pos);
+		boundsMax = glm::max(boundsMax, vertex.pos);
+	}
+	const Vec3F padding = (boundsMax - boundsMin) * SKINNING_BOUNDS_PADDING;
+	out_pVertexData->boundsMin = boundsMin - padding;
+	out_pVertexData->boundsMax = boundsMax + padding;
+
+	// Generated levels would need their own skinned vertices
+	out_pVertexData->lodCount = 0;
 }
 
 // ================================ Private Functions ============================= //
@@ -881,7 +1122,7 @@ void Vulkan::CreateSwapchain(GLFWwindow* in_pWindow, const VkSurfaceKHR in_surfa
 	std::cout << "SwapSupportDetails.formats size: " << swapSupportDetails.formats.size() << std::endl;
 	m_surfaceFormat = Vulkan::ChooseSwapSurfaceFormat(swapSupportDetails.formats);
 	m_presentMode = Vulkan::ChooseSwapPresentMode(swapSupportDetails.presentModes);
-	m_swapchainExtent = Vulkan::ChooseSwapExtent(swapSupportDetails.surfaceCapabilities, in_pWindow); // Store the swapchain extent for later use
+	m_swapchainExtent = Vulkan::ChooseSwapExtent(swapSupportDetails.surfaceCapabilities); // Store the swapchain extent for later use
 
 	uint32_t imageQueueCount = swapSupportDetails.surfaceCapabilities.minImageCount + 1; // Set number of images in queue
 	uint32_t maxImages = swapSupportDetails.surfaceCapabilities.maxImageCount; // Cap it to the surface's maximum
@@ -896,6 +1137,8 @@ void Vulkan::CreateSwapchain(GLFWwindow* in_pWindow, const VkSurfaceKHR in_surfa
 	createInfo.imageExtent = m_swapchainExtent;
 	createInfo.imageArrayLayers = 1;
 	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	// Bloom's bright pass reads the finished scene straight from the swapchain image
+	if (swapSupportDetails.surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_SAMPLED_BIT) { createInfo.imageUsage |= VK_IMAGE_USAGE_SAMPLED_BIT; }
 	//createInfo.imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
 	QueueFamilyIndices indices = FindQueueFamilies(m_physicalDevice, in_surface);
@@ -950,19 +1193,13 @@ VkPresentModeKHR Vulkan::ChooseSwapPresentMode(const std::vector<VkPresentModeKH
 
 	return VK_PRESENT_MODE_FIFO_KHR; // Guaranteed to be available
 }
-VkExtent2D Vulkan::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& in_capabilities, GLFWwindow* in_pWindow)
+VkExtent2D Vulkan::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& in_capabilities)
 {
 	// Choose VkExtent2D (resoluion of the swap chain images)
 	// currentExtent (width/height of surface) is 0xFFFFFFFF if the "surface size [is] determined by the extent of a swapchain targeting the surface" 
 	if (in_capabilities.currentExtent.width != UINT32_MAX) { return in_capabilities.currentExtent; }
 
-	int width, height;
-	glfwGetFramebufferSize(in_pWindow, &width, &height);
-
-	VkExtent2D actualExtent = {
-		static_cast<uint32_t>(width),
-		static_cast<uint32_t>(height)
-	};
+	VkExtent2D actualExtent = m_windowExtent;
 
 	actualExtent.width = std::clamp(actualExtent.width, in_capabilities.minImageExtent.width, in_capabilities.maxImageExtent.width);
 	actualExtent.height = std::clamp(actualExtent.height, in_capabilities.minImageExtent.height, in_capabilities.maxImageExtent.height);
@@ -1025,15 +1262,6 @@ void Vulkan::CreateDescriptorPool()
 	poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	poolSizes[2].descriptorCount = static_cast<uint32_t>(m_swapchainImages.size()) * MAX_TEXTURE_COUNT;
 
-	// Bloom
-	std::array<VkDescriptorPoolSize, 3> bloomPoolSizes{};
-	bloomPoolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	bloomPoolSizes[0].descriptorCount = static_cast<uint32_t>(m_swapchainImages.size());
-	bloomPoolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	bloomPoolSizes[1].descriptorCount = static_cast<uint32_t>(m_swapchainImages.size());
-	bloomPoolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	bloomPoolSizes[2].descriptorCount = static_cast<uint32_t>(m_swapchainImages.size());
-
 	VkDescriptorPoolCreateInfo poolInfo{};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
@@ -1043,15 +1271,6 @@ void Vulkan::CreateDescriptorPool()
 	VkResult result = vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool);
 	assert(result == VK_SUCCESS && "ERROR: vkCreateDescriptorPool() did not return success");
 
-	// Bloom
-	VkDescriptorPoolCreateInfo bloomPoolInfo{};
-	bloomPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	bloomPoolInfo.poolSizeCount = static_cast<uint32_t>(bloomPoolSizes.size());
-	bloomPoolInfo.pPoolSizes = bloomPoolSizes.data();
-	bloomPoolInfo.maxSets = static_cast<uint32_t>(m_swapchainImages.size());
-
-	result = vkCreateDescriptorPool(m_device, &bloomPoolInfo, nullptr, &m_offscreenDescriptorPool);
-	assert(result == VK_SUCCESS && "ERROR: vkCreateDescriptorPool() (bloom) did not return success");
 }
 
 void Vulkan::CreateDescriptorSetLayout(const VkDevice in_device, VkDescriptorSetLayout& in_descriptorSetLayout) 
@@ -1087,43 +1306,6 @@ void Vulkan::CreateDescriptorSetLayout(const VkDevice in_device, VkDescriptorSet
 
 	VkResult result = vkCreateDescriptorSetLayout(in_device, &layoutInfo, nullptr, &in_descriptorSetLayout);
 	assert(result == VK_SUCCESS && "ERROR: vkCreateDescriptorSetLayout() did not return success");
-
-
-
-	// Bloom
-	VkDescriptorSetLayoutBinding bloomFragmentSampler{};
-	bloomFragmentSampler.binding = 0;
-	bloomFragmentSampler.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	bloomFragmentSampler.descriptorCount = 0;
-	bloomFragmentSampler.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-	VkDescriptorSetLayoutBinding bloomFragmentUBO{};
-	bloomFragmentUBO.binding = 1;
-	bloomFragmentUBO.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	bloomFragmentUBO.descriptorCount = 1;
-	bloomFragmentUBO.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-	std::array<VkDescriptorSetLayoutBinding, 2> setLayoutBindings =
-	{
-		bloomFragmentSampler,
-		bloomFragmentUBO
-	};
-
-	VkDescriptorSetLayoutCreateInfo bloomLayoutInfo{};
-	bloomLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	bloomLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
-	bloomLayoutInfo.pBindings = setLayoutBindings.data();
-
-	result = vkCreateDescriptorSetLayout(m_device, &bloomLayoutInfo, nullptr, &m_offscreenDescriptorSetLayout);
-	assert(result == VK_SUCCESS && "vkCreateDescriptorSetLayout() in CreateDescriptorSetLayout (bloom) did not return success");
-
-	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
-	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutCreateInfo.pSetLayouts = &m_offscreenDescriptorSetLayout;
-	pipelineLayoutCreateInfo.pSetLayouts = &m_offscreenDescriptorSetLayout;
-
-	result = vkCreatePipelineLayout(m_device, &pipelineLayoutCreateInfo, nullptr, &m_offscreenPipelineLayout);
-	assert(result == VK_SUCCESS && "vkCreatePipelineLayout() in CreateDescriptorSetLayout() (bloom) did not return success");
 }
 void Vulkan::CreateDescriptorSets()
 {
@@ -1140,22 +1322,6 @@ void Vulkan::CreateDescriptorSets()
 	std::cout << result << std::endl;
 	assert(result == VK_SUCCESS && "vkAllocateDescriptorSets() did not return success");
 
-	// Bloom
-	VkDescriptorSetAllocateInfo bloomAllocInfo{};
-	bloomAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	bloomAllocInfo.descriptorPool = m_offscreenDescriptorPool;
-	bloomAllocInfo.descriptorSetCount = 1;
-	bloomAllocInfo.pSetLayouts = &m_offscreenDescriptorSetLayout;
-
-	// Allocate
-	// Vert
-	result = vkAllocateDescriptorSets(m_device, &bloomAllocInfo, &m_offscreenDescriptorSetVert);
-	assert(result == VK_SUCCESS && "vkAllocateDescriptorSets() (bloom vert) did not return success");
-
-	// Horz
-	result = vkAllocateDescriptorSets(m_device, &bloomAllocInfo, &m_offscreenDescriptorSetHorz);
-	assert(result == VK_SUCCESS && "vkAllocateDescriptorSets() (bloom horz) did not return success");
-
 	UpdateDescriptorSets();
 }
 void Vulkan::UpdateDescriptorSets()
@@ -1211,55 +1377,6 @@ void Vulkan::UpdateDescriptorSets()
 	{
 		std::cout << "\n====================================================\n" << std::endl;
 	}
-
-	// Bloom
-	for (int i = 0; i < m_swapchainImageViews.size(); ++i)
-	{
-		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = m_bloomUniformBuffers[i];
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(UBOBlurParams);
-
-		// Vert
-		std::array<VkWriteDescriptorSet, 2> writeDescriptorSets{};
-		writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[0].dstSet = m_offscreenDescriptorSetVert;
-		writeDescriptorSets[0].dstBinding = 0;
-		writeDescriptorSets[0].dstArrayElement = 0;
-		writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		writeDescriptorSets[0].descriptorCount = 1;
-		writeDescriptorSets[0].pImageInfo = &m_offscreenDescriptorImageInfos[i];
-
-		writeDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[1].dstSet = m_offscreenDescriptorSetVert;
-		writeDescriptorSets[1].dstBinding = 1;
-		writeDescriptorSets[1].dstArrayElement = 0;
-		writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		writeDescriptorSets[1].descriptorCount = 1;
-		writeDescriptorSets[1].pBufferInfo = &bufferInfo;
-
-
-		vkUpdateDescriptorSets(m_device, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, NULL);
-
-		// Horizontal
-		writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[0].dstSet = m_offscreenDescriptorSetHorz;
-		writeDescriptorSets[0].dstBinding = 0;
-		writeDescriptorSets[0].dstArrayElement = 0;
-		writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		writeDescriptorSets[0].descriptorCount = 1;
-		writeDescriptorSets[0].pImageInfo = &m_offscreenDescriptorImageInfos[i];
-
-		writeDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSets[1].dstSet = m_offscreenDescriptorSetHorz;
-		writeDescriptorSets[1].dstBinding = 1;
-		writeDescriptorSets[1].dstArrayElement = 0;
-		writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		writeDescriptorSets[1].descriptorCount = 1;
-		writeDescriptorSets[1].pBufferInfo = &bufferInfo;
-
-		vkUpdateDescriptorSets(m_device, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, NULL);
-	}
 }
 
 void Vulkan::CreateVertexBuffer(std::vector<Vertex>& in_vertices, VkBuffer& in_buffer, VkDeviceMemory& in_memory)
@@ -1380,20 +1497,8 @@ void Vulkan::CreateUniformBuffers()
 		CreateBuffer(bufferSizeFrag, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_uniformBuffersFrag[i], m_uniformBuffersMemoryFrag[i]);
 	}
-
-	// Bloom
-	bufferSizeVert = sizeof(UBOBlurParams);
-
-	m_bloomUniformBuffers.resize(m_swapchainImages.size());
-	m_bloomUniformBuffersMemory.resize(m_swapchainImages.size());
-
-	for (size_t i = 0; i < m_swapchainImages.size(); i++) {
-		CreateBuffer(bufferSizeVert, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_bloomUniformBuffers[i], m_bloomUniformBuffersMemory[i]);
-	}
-
 }
-void Vulkan::UpdateUniformBuffer(uint32_t in_imageIndex, const std::vector<Light*>& in_pLights)
+void Vulkan::UpdateUniformBuffer(uint32_t in_imageIndex, const std::vector<Light>& in_lights)
 {
 	static auto startTime = std::chrono::high_resolution_clock::now();
 
@@ -1402,9 +1507,7 @@ void Vulkan::UpdateUniformBuffer(uint32_t in_imageIndex, const std::vector<Light
 
 	// Vertex UBO
 	UniformBufferObjectVert uboVert{};
-	uboVert.view = glm::lookAt(m_viewData.eye, m_viewData.target, m_viewData.up);
-	uboVert.proj = glm::perspective(glm::radians(45.0f), m_swapchainExtent.width / (float)m_swapchainExtent.height, 0.1f, 1000.0f);
-	uboVert.proj[1][1] *= -1; // Flipping the Y coordinates because opengl uses inverted y coordinates
+	GetViewProjection(&uboVert.view, &uboVert.proj);
 
 	void* dataVert;
 	vkMapMemory(m_device, m_uniformBuffersMemoryVert[in_imageIndex], 0, sizeof(uboVert), 0, &dataVert);
@@ -1417,9 +1520,9 @@ void Vulkan::UpdateUniformBuffer(uint32_t in_imageIndex, const std::vector<Light
 	uboFrag.viewDir = m_viewData.target - m_viewData.eye;
 	uboFrag.viewPos = m_viewData.eye;
 
-	uboFrag.lightCount = in_pLights.size();
+	uboFrag.lightCount = in_lights.size();
 	for (uint32_t i = 0; i < uboFrag.lightCount; i++) {
-		uboFrag.lights[i] = *in_pLights[i];
+		uboFrag.lights[i] = in_lights[i];
 	}
 
 	void* dataFrag;
@@ -1428,6 +1531,68 @@ void Vulkan::UpdateUniformBuffer(uint32_t in_imageIndex, const std::vector<Light
 	vkUnmapMemory(m_device, m_uniformBuffersMemoryFrag[in_imageIndex]);
 }
 
+void Vulkan::GetViewProjection(Mat4x4F* out_pView, Mat4x4F* out_pProjection) const
+{
+	*out_pView = glm::lookAt(m_viewData.eye, m_viewData.target, m_viewData.up);
+	*out_pProjection = glm::perspective(glm::radians(PROJECTION_FOV_Y), m_swapchainExtent.width / (float)m_swapchainExtent.height, 0.1f, 1000.0f);
+	(*out_pProjection)[1][1] *= -1; // Flipping the Y coordinates because opengl uses inverted y coordinates
+}
+
+void Vulkan::PrepareDraws(const std::vector<RenderSnapshotDraw>& in_draws)
+{
+	const uint32_t drawCount = (uint32_t)in_draws.size();
+	m_drawVisible.resize(drawCount);
+
+	Mat4x4F view, projection;
+	GetViewProjection(&view, &projection);
+	const Frustum frustum = Frustum::FromViewProjection(projection * view);
+
+	auto cullRange = [&](const uint32_t in_begin, const uint32_t in_end) {
+		for (uint32_t i = in_begin; i < in_end; i++) {
+			const RenderSnapshotDraw& draw = in_draws[i];
+			m_drawVisible[i] = frustum.IntersectsBox(draw.vertexData.boundsMin, draw.vertexData.boundsMax, draw.pushData.model) ? 1 : 0;
+		}
+	};
+
+	if (m_pThreadPool != nullptr) { m_pThreadPool->ParallelFor(0, drawCount, DRAW_PREPARE_GRAIN_SIZE, cullRange); }
+	else { cullRange(0, drawCount); }
+
+	// Occluders that survived the frustum go into the cpu depth buffer
+	m_cpuOccludedCount = 0;
+	m_occlusionRasterizer.Begin(projection * view);
+	for (uint32_t i = 0; i < drawCount; i++) {
+		const RenderSnapshotDraw& draw = in_draws[i];
+		// Skinned indices point into the skinner's vertices, not m_vertices
+		if (!draw.occluder || !m_drawVisible[i] || draw.vertexData.IsSkinned()) { continue; }
+
+		uint32_t s = draw.vertexData.indices[0];
+		uint32_t e = draw.vertexData.indices[1];
+		m_occlusionRasterizer.AddOccluder(m_vertices.data(), m_indices.data() + s, e - s, draw.pushData.model);
+	}
+	if (m_occlusionRasterizer.GetTriangleCount() == 0) { return; }
+
+	m_occlusionRasterizer.Rasterize(m_pThreadPool);
+
+	std::atomic<uint32_t> occludedCount(0);
+	auto occlusionRange = [&](const uint32_t in_begin, const uint32_t in_end) {
+		uint32_t occluded = 0;
+		for (uint32_t i = in_begin; i < in_end; i++) {
+			const RenderSnapshotDraw& draw = in_draws[i];
+			if (draw.occluder || !m_drawVisible[i]) { continue; }
+
+			if (m_occlusionRasterizer.IsBoxOccluded(draw.vertexData.boundsMin, draw.vertexData.boundsMax, draw.pushData.model)) {
+				m_drawVisible[i] = 0;
+				occluded++;
+			}
+		}
+		occludedCount += occluded;
+	};
+
+	if (m_pThreadPool != nullptr) { m_pThreadPool->ParallelFor(0, drawCount, DRAW_PREPARE_GRAIN_SIZE, occlusionRange); }
+	else { occlusionRange(0, drawCount); }
+	m_cpuOccludedCount = occludedCount;
+}
+
 void Vulkan::CreateGraphicsPipeline(VkShaderModule& in_vertShaderModule, VkShaderModule& in_fragShaderModule, VkPipeline& in_pipeline)
 {
 	std::cout << "Creating graphics pipeline..." << std::endl;
@@ -1607,106 +1772,6 @@ void Vulkan::CreateGraphicsPipeline(VkShaderModule& in_vertShaderModule, VkShade
 	result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &in_pipeline);
 	assert(result == VK_SUCCESS && "ERROR: vkCreateGraphicsPipelines() did not return sucess");
 }
-void Vulkan::CreateRenderPass()
-{
-	// Set up to expect a framebuffer, which is used as render target
-
-	std::cout << "Creating render pass..." << std::endl;
-
-	assert(m_device != nullptr && "Cannot create a render pass with a null logical device");
-
-	// "The attachments specified during render pass creation are bound by wrapping them into a VkFramebuffer object.
-	// A framebuffer object references all of the VkImageView objects that represent the attachments.
-	// In our case that will be only a single one : the color attachment."
-	// In other words, a framebuffer object refernces the corresponding VkImageView object that represents the attachments
-	VkAttachmentDescription colorAttachment{};
-	colorAttachment.format = m_surfaceFormat.format;
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentReference colorAttachmentRef{};
-	colorAttachmentRef.attachment = 0;
-	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentDescription depthAttachment{};
-	depthAttachment.format = FindDepthFormat();
-	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference depthAttachmentRef{};
-	depthAttachmentRef.attachment = 1;
-	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpass{};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorAttachmentRef;
-	subpass.pDepthStencilAttachment = &depthAttachmentRef;
-
-	VkSubpassDependency dependency{};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-	std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
-	VkRenderPassCreateInfo renderPassInfo{};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-	renderPassInfo.pAttachments = attachments.data();
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
-
-	VkResult result = vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_renderPass);
-	assert(result == VK_SUCCESS && "ERROR: vkCreateRenderPass() did not return success");
-}
-void Vulkan::CreateFramebuffers(std::vector<VkFramebuffer>& in_swapchainFramebuffers)
-{
-	// Framebuffers are used as the render target in the render pass
-
-	std::cout << "Creating framebuffers..." << std::endl;
-
-	assert(m_device != nullptr && "Cannot create framebuffers with a null logical device");
-
-	in_swapchainFramebuffers.resize(m_swapchainImageViews.size());
-
-	for (size_t i = 0; i < m_swapchainImageViews.size(); i++) {
-		std::array<VkImageView, 2> attachments = {
-			m_swapchainImageViews[i],
-			m_depthObject.view
-		};
-
-		VkFramebufferCreateInfo framebufferInfo{};
-		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass = m_renderPass;
-		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-		framebufferInfo.pAttachments = attachments.data();
-		framebufferInfo.width = m_swapchainExtent.width;
-		framebufferInfo.height = m_swapchainExtent.height;
-		framebufferInfo.layers = 1;
-
-		VkResult result = vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &in_swapchainFramebuffers[i]);
-		assert(result == VK_SUCCESS && "ERROR: vkCreateFramebuffer() did not return success");
-	}
-}
-
 void Vulkan::CreateDrawCommands(std::vector<VkCommandBuffer>& in_buffers, std::vector<VkCommandPool>& in_pools)
 {
 	// Creates a command buffer for each image in the swapchain
@@ -1716,9 +1781,9 @@ void Vulkan::CreateDrawCommands(std::vector<VkCommandBuffer>& in_buffers, std::v
 	assert(m_device != nullptr && "ERROR: Cannot create a commands without a logical device");
 	assert(m_renderPass != nullptr && "ERROR: Cannot create a commands without a render pass");
 
-	in_buffers.resize(m_swapchainFramebuffers.size());
+	in_buffers.resize(m_swapchainImageViews.size());
 
-	for (int i = 0; i < m_swapchainFramebuffers.size(); ++i) {
+	for (int i = 0; i < m_swapchainImageViews.size(); ++i) {
 		assert(in_pools[i] != nullptr && "ERROR: Cannot create a command without a command pool");
 
 		AllocateCommandBuffer(in_buffers[i], in_pools[i]);
@@ -1805,29 +1870,6 @@ void Vulkan::EndSingleTimeCommand(const VkCommandPool& in_pool, VkCommandBuffer
 	vkFreeCommandBuffers(m_device, in_pool, 1, &in_command);
 }
 
-void Vulkan::CreateDepthResources(ImageObject& in_depthObject)
-{
-	VkFormat depthFormat = FindDepthFormat();	
-
-	VkImageCreateInfo imageInfo{};
-	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-	imageInfo.imageType = VK_IMAGE_TYPE_2D;
-	imageInfo.extent.width = static_cast<uint32_t>(m_swapchainExtent.width);
-	imageInfo.extent.height = static_cast<uint32_t>(m_swapchainExtent.height);
-	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = 1;
-	imageInfo.arrayLayers = 1;
-	imageInfo.format = depthFormat;
-	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-	imageInfo.flags = 0; // Optional
-
-	CreateImageObject(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, in_depthObject.image, in_depthObject.memory);
-	CreateImageView(in_depthObject.view, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, in_depthObject.image);
-}
 VkFormat Vulkan::FindSupportedFormat(const std::vector<VkFormat>& in_candidates, VkImageTiling in_tiling, VkFormatFeatureFlags in_features)
 {
 	// Some helpers to find if the supported image format is available for the depth image
@@ -2032,173 +2074,94 @@ void Vulkan::CreateImageView(VkImageView& in_view, VkFormat in_format, VkImageAs
 	assert(result == VK_SUCCESS && "ERROR: vkCreateImageView() did not return success");
 }
 
-// ==================================== Bloom ============================================ //
-void Vulkan::PrepareOffscreenFramebuffer()
+// ================================== Debug Lines ========================================= //
+
+void Vulkan::LoadLineShaders()
 {
-	// Create offscreen image object
-	m_offscreenImageObjects.resize(m_swapchainImageViews.size());
-	m_offscreenDepthObjects.resize(m_swapchainImageViews.size());
-	m_offscreenFramebuffers.resize(m_swapchainImageViews.size());
-	m_offscreenDescriptorImageInfos.resize(m_swapchainImageViews.size());
+	// Optional, without the compiled shaders debug lines are just skipped
+	if (!std::ifstream(SHADER_PATH_LINE_VERT).good() || !std::ifstream(SHADER_PATH_LINE_FRAG).good()) {
+		std::cout << "WARNING: Debug line shaders (" << SHADER_PATH_LINE_VERT << ", " << SHADER_PATH_LINE_FRAG << ") not found, debug lines are disabled" << std::endl;
+		return;
+	}
 
-	for (int i = 0; i < m_swapchainImageViews.size(); ++i)
-	{
-		VkImageCreateInfo imageInfo{};
-		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-		imageInfo.imageType = VK_IMAGE_TYPE_2D;
-		imageInfo.format = m_surfaceFormat.format;
-		imageInfo.extent.width = m_swapchainExtent.width;
-		imageInfo.extent.height = m_swapchainExtent.height;
-		imageInfo.extent.depth = 1;
-		imageInfo.mipLevels = 1;
-		imageInfo.arrayLayers = 1;
-		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT; // "We will sample directly from the color attachment"
-
-		CreateImageObject(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_offscreenImageObjects[i].image, m_offscreenImageObjects[i].memory);
-		CreateImageView(m_offscreenImageObjects[i].view, m_surfaceFormat.format, VK_IMAGE_ASPECT_COLOR_BIT, m_offscreenImageObjects[i].image);
-
-		// Create offscreen depth object
-		CreateDepthResources(m_offscreenDepthObjects[i]);
-
-		// Create offscreen frame buffer using those attachments
-		std::array<VkImageView, 2> attachments;
-		attachments[0] = m_offscreenImageObjects[i].view;
-		attachments[1] = m_offscreenDepthObjects[i].view;
-
-		VkFramebufferCreateInfo framebufferInfo{};
-		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass = m_offscreenRenderPass;
-		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-		framebufferInfo.pAttachments = attachments.data();
-		framebufferInfo.width = m_swapchainExtent.width;
-		framebufferInfo.height = m_swapchainExtent.height;
-		framebufferInfo.layers = 1;
-
-		VkResult result = vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &m_offscreenFramebuffers[i]);
-		assert(result == VK_SUCCESS && "ERROR: vkCreateFramebuffer() in PrepareOffscreenFramebuffers did not return success");
-
-		// "Fill a descriptor for later use in a descriptor set"
-		m_offscreenDescriptorImageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		m_offscreenDescriptorImageInfos[i].imageView = m_offscreenImageObjects[i].view;
-		m_offscreenDescriptorImageInfos[i].sampler = m_offscreenSampler;
-	}
-}
-
-void Vulkan::PrepareOffscreen()
-{
-	// m_offscreenRenderPass.width = m_swapchainExtent.width;
-	// m_offscreenRenderPass.height = m_swapchainExtent.height;
-
-	VkFormat depthFormat = FindDepthFormat();
-
-	std::array<VkAttachmentDescription, 2> attchmentDescriptions = {};
-	// Color attachment
-	attchmentDescriptions[0].format = m_surfaceFormat.format;
-	attchmentDescriptions[0].samples = VK_SAMPLE_COUNT_1_BIT;
-	attchmentDescriptions[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	attchmentDescriptions[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	attchmentDescriptions[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	attchmentDescriptions[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	attchmentDescriptions[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	attchmentDescriptions[0].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	// Depth attachment
-	attchmentDescriptions[1].format = FindDepthFormat();
-	attchmentDescriptions[1].samples = VK_SAMPLE_COUNT_1_BIT;
-	attchmentDescriptions[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	attchmentDescriptions[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	attchmentDescriptions[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	attchmentDescriptions[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	attchmentDescriptions[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	attchmentDescriptions[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
-	VkAttachmentReference depthReference = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
-
-	VkSubpassDescription subpassDescription = {};
-	subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpassDescription.colorAttachmentCount = 1;
-	subpassDescription.pColorAttachments = &colorReference;
-	subpassDescription.pDepthStencilAttachment = &depthReference;
-
-	// Use subpass dependencies for layout transitions
-	std::array<VkSubpassDependency, 2> dependencies;
-
-	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependencies[0].dstSubpass = 0;
-	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-	dependencies[1].srcSubpass = 0;
-	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-	// Create the actual renderpass
-	VkRenderPassCreateInfo renderPassInfo = {};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = static_cast<uint32_t>(attchmentDescriptions.size());
-	renderPassInfo.pAttachments = attchmentDescriptions.data();
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.pSubpasses = &subpassDescription;
-	renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
-	renderPassInfo.pDependencies = dependencies.data();
-
-	VkResult result = vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_offscreenRenderPass);
-	assert(result == VK_SUCCESS && "ERROR: vkCreateRenderPass() in PrepareOffscreen() did not return success");
-
-	// Create sampler to sample from the color attachments
-	VkSamplerCreateInfo sampler{};
-	sampler.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-	sampler.magFilter = VK_FILTER_LINEAR;
-	sampler.minFilter = VK_FILTER_LINEAR;
-	sampler.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-	sampler.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-	sampler.addressModeV = sampler.addressModeU;
-	sampler.addressModeW = sampler.addressModeU;
-	sampler.mipLodBias = 0.0f;
-	sampler.maxAnisotropy = 1.0f;
-	sampler.minLod = 0.0f;
-	sampler.maxLod = 1.0f;
-	sampler.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-	result = vkCreateSampler(m_device, &sampler, nullptr, &m_offscreenSampler);
-	assert(result == VK_SUCCESS && "vkCreateSampler() in PrepareOffscreen() did not return success");
-
-	// Create two frame buffers
-	PrepareOffscreenFramebuffer();
-	PrepareOffscreenFramebuffer();
-}
-
-void Vulkan::PreparePipelineBloom()
+	m_lineVertShaderModule = CreateShaderModule(m_device, ReadFile(SHADER_PATH_LINE_VERT));
+	m_lineFragShaderModule = CreateShaderModule(m_device, ReadFile(SHADER_PATH_LINE_FRAG));
+
+	m_lineBuffers.resize(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+	m_lineBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+	m_lineBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT, nullptr);
+	m_lineBufferCapacities.resize(MAX_FRAMES_IN_FLIGHT, 0);
+}
+
+void Vulkan::CreateLinePipeline()
 {
-	VkPipelineInputAssemblyStateCreateInfo inputAssembly{}; // Basically how Vulkan will draw the vertices we give it
+	if (m_lineVertShaderModule == VK_NULL_HANDLE) { return; }
+
+	std::cout << "Creating debug line pipeline..." << std::endl;
+
+	VkPipelineShaderStageCreateInfo shaderStages[2]{};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = m_lineVertShaderModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = m_lineFragShaderModule;
+	shaderStages[1].pName = "main";
+
+	auto bindingDescription = LineVertex::GetBindingDescription();
+	auto attributeDescriptions = LineVertex::GetAttributeDescriptions();
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
 	inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-	VkPipelineRasterizationStateCreateInfo rasterizer{}; // Performs depth testing, face cullingand the scissor test
+	// Tested against the scene but never written, lines shouldnt hide each other
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_FALSE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+	VkViewport viewport{};
+	viewport.width = (float)m_swapchainExtent.width;
+	viewport.height = (float)m_swapchainExtent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = m_swapchainExtent;
+
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.pViewports = &viewport;
+	viewportState.scissorCount = 1;
+	viewportState.pScissors = &scissor;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
 	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizer.depthClampEnable = VK_FALSE;
-	rasterizer.rasterizerDiscardEnable = VK_FALSE;
 	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-	rasterizer.lineWidth = 1.0f;
+	rasterizer.lineWidth = 1.0f; // Anything else needs the wideLines feature
 	rasterizer.cullMode = VK_CULL_MODE_NONE;
 	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-	rasterizer.depthBiasEnable = VK_TRUE;
-	rasterizer.depthBiasConstantFactor = 0.0f; // Optional
-	rasterizer.depthBiasClamp = 0.0f; // Optional
-	rasterizer.depthBiasSlopeFactor = 0.0f; // Optional
+
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
 	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
 	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE;
+	colorBlendAttachment.blendEnable = VK_TRUE;
 	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
 	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
 	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
@@ -2208,163 +2171,122 @@ void Vulkan::PreparePipelineBloom()
 
 	VkPipelineColorBlendStateCreateInfo colorBlending{};
 	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlending.logicOpEnable = VK_FALSE;
-	colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
 	colorBlending.attachmentCount = 1;
 	colorBlending.pAttachments = &colorBlendAttachment;
-	colorBlending.blendConstants[0] = 0.0f; // Optional
-	colorBlending.blendConstants[1] = 0.0f; // Optional
-	colorBlending.blendConstants[2] = 0.0f; // Optional
-	colorBlending.blendConstants[3] = 0.0f; // Optional
-
-	VkPipelineDepthStencilStateCreateInfo depthStencil{};
-	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	depthStencil.depthTestEnable = VK_TRUE;
-	depthStencil.depthWriteEnable = VK_TRUE;
-	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS; // VK_COMPARE_OP_LESS_OR_EQUAL
-	depthStencil.depthBoundsTestEnable = VK_FALSE;
-	depthStencil.minDepthBounds = 0.0f; // Optional
-	depthStencil.maxDepthBounds = 1.0f; // Optional
-	depthStencil.stencilTestEnable = VK_FALSE;
-	depthStencil.front = {}; // Optional
-	depthStencil.back = {}; // Optional
-
-	VkPipelineViewportStateCreateInfo viewportState{};
-	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportState.viewportCount = 1;
-	//viewportState.pViewports = &viewport;
-	viewportState.scissorCount = 1;
-	//viewportState.pScissors = &scissor;
-
-	VkPipelineMultisampleStateCreateInfo multisampling{};
-	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampling.sampleShadingEnable = VK_FALSE;
-	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-	std::vector<VkDynamicState> dynamicStates = {
-		VK_DYNAMIC_STATE_VIEWPORT,
-		VK_DYNAMIC_STATE_SCISSOR,
-	};
-	VkPipelineDynamicStateCreateInfo dynamicState{}; // Stuff that can be changed without recreating the pipeline
-	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	dynamicState.dynamicStateCount = dynamicStates.size();
-	dynamicState.pDynamicStates = dynamicStates.data();
-
-	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{};
 
+	// Shares the model pipeline's layout (view/proj UBO at binding 0), the push constants just go unused
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
-	pipelineInfo.pStages = shaderStages.data();
-	//pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
 	pipelineInfo.pInputAssemblyState = &inputAssembly;
 	pipelineInfo.pViewportState = &viewportState;
 	pipelineInfo.pRasterizationState = &rasterizer;
 	pipelineInfo.pMultisampleState = &multisampling;
 	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDepthStencilState = &depthStencil;
 	pipelineInfo.layout = m_pipelineLayout;
 	pipelineInfo.renderPass = m_renderPass;
 	pipelineInfo.subpass = 0;
-	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-	pipelineInfo.pDepthStencilState = &depthStencil;
-	
-	// Shaders
 
-	auto vertShaderCode = ReadFile(SHADER_PATH_BLOOM_VERT);
-	auto fragShaderCode = ReadFile(SHADER_PATH_BLOOM_FRAG);
+	VkResult result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_linePipeline);
+	assert(result == VK_SUCCESS && "ERROR: vkCreateGraphicsPipelines() for m_linePipeline did not return success");
+}
 
-	m_vertShaderModuleBloom = CreateShaderModule(m_device, vertShaderCode);
-	m_fragShaderModuleBloom = CreateShaderModule(m_device, fragShaderCode);
+void Vulkan::CreateLineBuffer(const size_t in_frame, const uint32_t in_vertexCapacity)
+{
+	VkDeviceSize size = (VkDeviceSize)in_vertexCapacity * sizeof(LineVertex);
+	CreateBuffer(size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		m_lineBuffers[in_frame], m_lineBuffersMemory[in_frame]);
 
-	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertShaderStageInfo.module = m_vertShaderModuleBloom;
-	vertShaderStageInfo.pName = "main";
+	// Mapped for as long as the buffer lives, coherent so there is nothing to flush
+	VkResult result = vkMapMemory(m_device, m_lineBuffersMemory[in_frame], 0, size, 0, &m_lineBuffersMapped[in_frame]);
+	assert(result == VK_SUCCESS && "ERROR: vkMapMemory() for a debug line buffer did not return success");
 
-	VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragShaderStageInfo.module = m_fragShaderModuleBloom;
-	fragShaderStageInfo.pName = "main";
+	m_lineBufferCapacities[in_frame] = in_vertexCapacity;
+}
 
-	shaderStages = { vertShaderStageInfo, fragShaderStageInfo };
+void Vulkan::DestroyLineBuffer(const size_t in_frame)
+{
+	if (m_lineBuffers[in_frame] == VK_NULL_HANDLE) { return; }
 
-	VkPipelineVertexInputStateCreateInfo emptyInputState{};
+	vkUnmapMemory(m_device, m_lineBuffersMemory[in_frame]);
+	vkDestroyBuffer(m_device, m_lineBuffers[in_frame], nullptr);
+	vkFreeMemory(m_device, m_lineBuffersMemory[in_frame], nullptr);
 
-	pipelineInfo.pVertexInputState = &emptyInputState;
-	pipelineInfo.layout = m_offscreenPipelineLayout;
+	m_lineBuffers[in_frame] = VK_NULL_HANDLE;
+	m_lineBuffersMemory[in_frame] = VK_NULL_HANDLE;
+	m_lineBuffersMapped[in_frame] = nullptr;
+	m_lineBufferCapacities[in_frame] = 0;
+}
 
-	colorBlendAttachment.colorWriteMask = 0xF;
-	colorBlendAttachment.blendEnable = VK_TRUE;
-	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_DST_ALPHA;
-
-	VkPipelineVertexInputStateCreateInfo empytInputState{};
-	empytInputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-
-	// Use specialization constants to select between horizontal and vertical blur
-	uint32_t blurdirection = 0;
-	VkSpecializationMapEntry specializationMapEntry{};
-	specializationMapEntry.constantID = 0;
-	specializationMapEntry.offset = 0;
-	specializationMapEntry.size = sizeof(uint32_t);
-
-	VkSpecializationInfo specializationInfo{}; // = vks::initializers::specializationInfo(1, &specializationMapEntry, sizeof(uint32_t), &blurdirection);
-	specializationInfo.mapEntryCount = 1;
-	specializationInfo.pMapEntries = &specializationMapEntry;
-	specializationInfo.dataSize = sizeof(uint32_t);
-	specializationInfo.pData = &blurdirection;
-
-	shaderStages[1].pSpecializationInfo = &specializationInfo;
-	// Vertical blur pipeline
-	pipelineInfo.renderPass = m_offscreenRenderPass;
-	VkResult result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipelineBlurVert);
-	assert(result == VK_SUCCESS && "vkCreateGraphicsPipelines() for m_pipelineBlurVert did not return success");
-
-	// Horizontal blur pipeline
-	blurdirection = 1;
-	pipelineInfo.renderPass = m_renderPass;
-	result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipelineBlurHorz);
-	assert(result == VK_SUCCESS && "vkCreateGraphicsPipelines() for m_pipelineBlurHorz did not return success");
+uint32_t Vulkan::UploadDebugLines(const std::vector<LineVertex>& in_vertices)
+{
+	if (m_linePipeline == VK_NULL_HANDLE || in_vertices.empty()) { return 0; }
 
-	// Color only pass (offscreen blur base)
-	auto codeVert = ReadFile(SHADER_PATH_BLOOM_COLOR_PASS_VERT);
-	auto codeFrag = ReadFile(SHADER_PATH_BLOOM_COLOR_PASS_FRAG);
-	auto shaderModuleVert = CreateShaderModule(m_device, codeVert);
-	auto shaderModuleFrag = CreateShaderModule(m_device, codeFrag);
+	// DrawFrame already waited on this frame's fence, so the GPU is done with its buffer and it can be
+	// rewritten or regrown without any extra sync
+	uint32_t vertexCount = (uint32_t)in_vertices.size();
+	if (vertexCount > m_lineBufferCapacities[m_currentFrame]) {
+		uint32_t capacity = std::max(DEBUG_LINE_BUFFER_MIN_VERTICES, m_lineBufferCapacities[m_currentFrame]);
+		while (capacity < vertexCount) { capacity *= 2; }
 
-	VkPipelineShaderStageCreateInfo vertShaderStageInfoBloomCP{};
-	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertShaderStageInfo.module = shaderModuleVert;
-	vertShaderStageInfo.pName = "main";
+		DestroyLineBuffer(m_currentFrame);
+		CreateLineBuffer(m_currentFrame, capacity);
+	}
 
-	VkPipelineShaderStageCreateInfo fragShaderStageInfoCP{};
-	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragShaderStageInfo.module = shaderModuleFrag;
-	fragShaderStageInfo.pName = "main";
+	memcpy(m_lineBuffersMapped[m_currentFrame], in_vertices.data(), in_vertices.size() * sizeof(LineVertex));
+
+	return vertexCount;
+}
 
-	shaderStages = { vertShaderStageInfoBloomCP, fragShaderStageInfoCP };
+// ================================== Bone Palette ======================================== //
 
-	pipelineInfo.renderPass = m_offscreenRenderPass;
-	result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipelineGlowPass);
-	assert(result == VK_SUCCESS && "vkCreateGraphicsPipelines() for m_pipelineGlowPass did not return success");
+void Vulkan::CreateBoneBuffer(const size_t in_frame, const uint32_t in_matrixCapacity)
+{
+	VkDeviceSize size = (VkDeviceSize)in_matrixCapacity * sizeof(Mat4x4F);
+	CreateBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		m_boneBuffers[in_frame], m_boneBuffersMemory[in_frame]);
+
+	VkResult result = vkMapMemory(m_device, m_boneBuffersMemory[in_frame], 0, size, 0, &m_boneBuffersMapped[in_frame]);
+	assert(result == VK_SUCCESS && "ERROR: vkMapMemory() for a bone palette buffer did not return success");
+
+	m_boneBufferCapacities[in_frame] = in_matrixCapacity;
 }
 
-void Vulkan::UpdateUniformBufferBloom(uint32_t in_imageIndex)
+void Vulkan::DestroyBoneBuffer(const size_t in_frame)
 {
-	void* pData;
-	vkMapMemory(m_device, m_bloomUniformBuffersMemory[in_imageIndex], 0, sizeof(UBOBlurParams), 0, &pData);
-	memcpy(pData, &m_uboBlurParams, sizeof(UBOBlurParams));
-	vkUnmapMemory(m_device, m_bloomUniformBuffersMemory[in_imageIndex]);
+	if (m_boneBuffers[in_frame] == VK_NULL_HANDLE) { return; }
+
+	vkUnmapMemory(m_device, m_boneBuffersMemory[in_frame]);
+	vkDestroyBuffer(m_device, m_boneBuffers[in_frame], nullptr);
+	vkFreeMemory(m_device, m_boneBuffersMemory[in_frame], nullptr);
+
+	m_boneBuffers[in_frame] = VK_NULL_HANDLE;
+	m_boneBuffersMemory[in_frame] = VK_NULL_HANDLE;
+	m_boneBuffersMapped[in_frame] = nullptr;
+	m_boneBufferCapacities[in_frame] = 0;
 }
 
+uint32_t Vulkan::UploadBonePalette(const std::vector<Mat4x4F>& in_palette)
+{
+	if (in_palette.empty()) { return 0; }
+
+	// Same as the debug lines, this frame's fence has been waited on so its buffer is free
+	uint32_t matrixCount = (uint32_t)in_palette.size();
+	if (matrixCount > m_boneBufferCapacities[m_currentFrame]) {
+		uint32_t capacity = std::max(BONE_PALETTE_MIN_MATRICES, m_boneBufferCapacities[m_currentFrame]);
+		while (capacity < matrixCount) { capacity *= 2; }
+
+		DestroyBoneBuffer(m_currentFrame);
+		CreateBoneBuffer(m_currentFrame, capacity);
+	}
+
+	memcpy(m_boneBuffersMapped[m_currentFrame], in_palette.data(), in_palette.size() * sizeof(Mat4x4F));
+
+	return matrixCount;
+}
 
 // ================================ Shader Functions ============================= //
 
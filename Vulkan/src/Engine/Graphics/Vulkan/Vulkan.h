@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <vector>
 
 #include <GLM/common.hpp>
@@ -7,11 +8,20 @@
 
 #include "Engine/Core/Math/Vec.h"
 #include "Engine/Graphics/Objects/Vertex.h"
+#include "Engine/Graphics/Objects/Model.h"
+#include "Engine/Graphics/RenderSnapshot.h"
+#include "Engine/Graphics/StaticBatch.h"
+#include "Engine/Graphics/MeshLOD.h"
+#include "Engine/Graphics/OcclusionRasterizer.h"
 #include "Engine/Camera.h"
 
 #include "VulkanInclude.h"
 #include "VulkanObjects.h"
 #include "VulkanImgui.h"
+#include "VulkanOcclusion.h"
+#include "VulkanSkinning.h"
+#include "VulkanBloom.h"
+#include "VulkanRenderGraph.h"
 
 #ifdef NDEBUG
 const bool g_enableValidationLayers = false;
@@ -28,6 +38,9 @@ namespace Mega
 	class Model;
 	class VertexData;
 	class TextureData;
+	class DebugLines;
+	class ThreadPool;
+	struct SkinnedMeshData;
 }
 
 namespace std {
@@ -42,6 +55,18 @@ namespace std {
 
 namespace Mega
 {
+	// One OBJ parsed into its own vertex/index lists, indices start at 0 until the mesh is appended
+	struct OBJMeshData {
+		std::vector<Vertex> vertices;
+		std::vector<INDEX_TYPE> indices;
+		Vec3F boundsMin = Vec3F(0.0f);
+		Vec3F boundsMax = Vec3F(0.0f);
+		std::vector<MeshLODLevel> lods; // After the full mesh
+
+		std::string warning;
+		std::vector<std::string> materialNames;
+	};
+
 	enum class eVulkanInitState {
 		Created,
 		Initialzed,
@@ -52,6 +77,10 @@ namespace Mega
 	private:
 		friend Renderer;
 		friend ImguiObject;
+		friend OcclusionCuller;
+		friend Skinner;
+		friend Bloom;
+		friend RenderGraph;
 
 		VertexData* m_pBoxVertexData;
 
@@ -60,12 +89,17 @@ namespace Mega
 		void RecreateSwapchain();
 		void CleanupSwapchain(VkSwapchainKHR* in_pSwapchain);
 
-		void DrawFrame(const std::vector<Model*>& in_pModels, const std::vector<Light*>& in_pLights);
+		// Everything is read from in_snapshot, so this can run on the render thread while the scene moves on
+		void DrawFrame(RenderSnapshot& in_snapshot);
 
 		void SetViewData(const ViewData& in_viewData);
 
 		void LoadVertexData(const char* in_objPath, VertexData* in_pVertexData, const char* in_MTLDir = MTL_BASE_DIR);
+		// Every OBJ is parsed as its own job, then appended in order
+		void LoadVertexData(const std::vector<const char*>& in_objPaths, std::vector<VertexData>* out_pVertexDatas, const char* in_MTLDir = MTL_BASE_DIR);
 		void LoadTextureData(const char* in_texPath, TextureData* in_pTextureData);
+		// Indices go in the shared index buffer, vertices in the skinner's source buffer. Needs the GPU idle
+		void LoadSkinnedMesh(const SkinnedMeshData& in_mesh, VertexData* out_pVertexData);
 
 		void UpdateLoadedVertexData();
 		void UpdateLoadedIndexData();
@@ -91,17 +125,14 @@ namespace Mega
 
 		VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& in_availableFormats);
 		VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& in_availableModes);
-		VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& in_capabilities, GLFWwindow* in_pWindow);
+		VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& in_capabilities);
 
 		void RetrieveSwapchainImages(std::vector<VkImage>& in_images, VkSwapchainKHR in_swapchain);
 		void CreateSwapchainImageViews(std::vector<VkImageView>& in_imageViews, const std::vector<VkImage>& in_images);
 
 		void CreateDescriptorSetLayout(const VkDevice in_device, VkDescriptorSetLayout& in_descriptorSetLayout);
-		void CreateRenderPass();
 		void CreateGraphicsPipeline(VkShaderModule& in_vertShaderModule, VkShaderModule& in_fragShaderModule, VkPipeline& in_pipeline);
 
-		void CreateFramebuffers(std::vector<VkFramebuffer>& in_swapchainFramebuffers);
-
 		void CreateDrawCommandPools(std::vector<VkCommandPool>& in_pools);
 		void CreateDrawCommands(std::vector<VkCommandBuffer>& in_buffers, std::vector<VkCommandPool>& in_pools);
 		void AllocateCommandBuffer(VkCommandBuffer& in_buffer, const VkCommandPool& in_pool);
@@ -109,7 +140,6 @@ namespace Mega
 		VkCommandBuffer BeginSingleTimeCommand(const VkCommandPool& in_pool);
 		void EndSingleTimeCommand(const VkCommandPool& in_pool, VkCommandBuffer in_command);
 
-		void CreateDepthResources(ImageObject& in_depthObject);
 		VkFormat FindSupportedFormat(const std::vector<VkFormat>& in_candidates, VkImageTiling in_tiling, VkFormatFeatureFlags in_features);
 		VkFormat FindDepthFormat();
 		bool HasStencilComponent(VkFormat format);
@@ -122,7 +152,7 @@ namespace Mega
 		void CreateIndexBuffer(std::vector<INDEX_TYPE>& in_indices, VkBuffer& in_buffer, VkDeviceMemory& in_memory);
 
 		void CreateUniformBuffers();
-		void UpdateUniformBuffer(uint32_t in_imageIndex, const std::vector<Light*>& in_pLights);
+		void UpdateUniformBuffer(uint32_t in_imageIndex, const std::vector<Light>& in_lights);
 
 		void CreateSyncObjects();
 
@@ -135,11 +165,29 @@ namespace Mega
 		void CopyBufferToImage(VkBuffer& in_buffer, VkImage& in_image, uint32_t in_width, uint32_t in_height);
 		void CreateImageView(VkImageView& in_view, VkFormat in_format, VkImageAspectFlags in_aspectFlags, VkImage& in_image);
 
-		// Bloom stuff
-		void PrepareOffscreenFramebuffer();
-		void PrepareOffscreen();
-		void PreparePipelineBloom();
-		void UpdateUniformBufferBloom(uint32_t in_imageIndex);
+		// Parsing only touches out_pMesh, so any number can run at once
+		static void ParseOBJ(const char* in_objPath, const char* in_MTLDir, OBJMeshData* out_pMesh);
+		void AppendMesh(const OBJMeshData& in_mesh, VertexData* out_pVertexData);
+		// Puts baked static batches at the end of the geometry buffers, replacing the last ones if nothing
+		// was loaded after them. Moves io_pGeometry's batch ranges to where they landed
+		void AppendStaticGeometry(StaticBatchGeometry* io_pGeometry);
+
+		// Frustum culls every draw across the thread pool, then hides the ones behind occluders. Recording
+		// then only has to walk m_drawVisible
+		void PrepareDraws(const std::vector<RenderSnapshotDraw>& in_draws);
+		void GetViewProjection(Mat4x4F* out_pView, Mat4x4F* out_pProjection) const;
+
+		// Debug lines
+		void LoadLineShaders();
+		void CreateLinePipeline();
+		void CreateLineBuffer(const size_t in_frame, const uint32_t in_vertexCapacity);
+		void DestroyLineBuffer(const size_t in_frame);
+		uint32_t UploadDebugLines(const std::vector<LineVertex>& in_vertices);
+
+		// Bone palette, the snapshot's joint matrices copied into this frame's storage buffer
+		void CreateBoneBuffer(const size_t in_frame, const uint32_t in_matrixCapacity);
+		void DestroyBoneBuffer(const size_t in_frame);
+		uint32_t UploadBonePalette(const std::vector<Mat4x4F>& in_palette);
 
 		// Shader functions
 		std::vector<char> ReadFile(const std::string& in_fileName);
@@ -160,10 +208,31 @@ namespace Mega
 
 		// Other member variables
 		Renderer* m_pRenderer;
+		ThreadPool* m_pThreadPool = nullptr;
 		ViewData m_viewData;
 
+		// Visibility of this frame's draws, index i belongs to the snapshot's i'th draw
+		std::vector<uint8_t> m_drawVisible;
+		// Occluder draws go in, everything else is tested against it in PrepareDraws
+		OcclusionRasterizer m_occlusionRasterizer;
+		uint32_t m_cpuOccludedCount = 0;
+
+		OcclusionCuller m_occlusionCuller;
+
+		Skinner m_skinner;
+		// vertexOffset of each draw this frame, where a skinned draw's vertices landed in the skinner's output
+		std::vector<int32_t> m_drawVertexOffsets;
+
+		Bloom m_bloom;
+
+		// Every frame is declared as passes on it, it owns the render passes, framebuffers and depth
+		RenderGraph m_renderGraph;
+
 		// GLFW member variables
 		GLFWwindow* m_pWindow;
+		// Window framebuffer size as last read on the main thread (GLFW only allows it there), the render
+		// thread recreates the swapchain from this
+		VkExtent2D m_windowExtent = { 0, 0 };
 
 		// ImGui
 		ImguiObject m_imguiObject;
@@ -188,7 +257,7 @@ namespace Mega
 		VkShaderModule m_vertShaderModule;
 		VkShaderModule m_fragShaderModule;
 
-		VkRenderPass m_renderPass;
+		VkRenderPass m_renderPass; // The render graph's, compatible with the scene passes
 		VkRenderPass m_imguiRenderPass;
 
 		VkSwapchainKHR m_swapchain;
@@ -199,7 +268,6 @@ namespace Mega
 
 		std::vector<VkImage> m_swapchainImages;
 		std::vector<VkImageView> m_swapchainImageViews;
-		std::vector<VkFramebuffer> m_swapchainFramebuffers;
 
 		std::vector<VkCommandPool> m_drawCommandPools;
 		std::vector<VkCommandBuffer> m_drawCommandBuffers;
@@ -226,9 +294,6 @@ namespace Mega
 		std::vector<const char*> m_validationLayers = { "VK_LAYER_KHRONOS_validation" };
 		std::vector<const char*> m_physicalDeviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
-		// Z-Buffering
-		ImageObject m_depthObject;
-
 		// Vertices
 		std::vector<Vertex> m_vertices;
 		VkBuffer m_vertexBuffer;
@@ -238,7 +303,11 @@ namespace Mega
 		VkBuffer m_indexBuffer;
 		VkDeviceMemory m_indexBufferMemory;
 
-		VkQueryPool m_queryPool;
+		// Where the static batch geometry sits in m_vertices/m_indices, empty when nothing is baked
+		size_t m_staticVertexBegin = 0;
+		size_t m_staticVertexEnd = 0;
+		size_t m_staticIndexBegin = 0;
+		size_t m_staticIndexEnd = 0;
 
 		// Assets
 		VkSampler m_sampler;
@@ -246,30 +315,20 @@ namespace Mega
 		std::vector<ImageObject> m_textures;
 		uint32_t m_loadedTextureCount = 0;
 
-		// Bloom
-		std::vector<ImageObject> m_offscreenImageObjects;
-		std::vector<ImageObject> m_offscreenDepthObjects;
-		std::vector<VkFramebuffer> m_offscreenFramebuffers;
-		VkSampler m_offscreenSampler;
-
-		VkShaderModule m_vertShaderModuleBloom;
-		VkShaderModule m_fragShaderModuleBloom;
-
-		VkRenderPass m_offscreenRenderPass;
-		VkPipelineLayout m_offscreenPipelineLayout;
-		VkPipeline m_pipelineBlurVert;
-		VkPipeline m_pipelineBlurHorz;
-		VkPipeline m_pipelineGlowPass;
-
-		std::vector<VkBuffer> m_bloomUniformBuffers;
-		std::vector<VkDeviceMemory> m_bloomUniformBuffersMemory;
-		UBOBlurParams m_uboBlurParams;
-
-		VkDescriptorPool m_offscreenDescriptorPool;
-		std::vector<VkDescriptorImageInfo> m_offscreenDescriptorImageInfos;
-
-		VkDescriptorSetLayout m_offscreenDescriptorSetLayout;
-		VkDescriptorSet m_offscreenDescriptorSetVert;
-		VkDescriptorSet m_offscreenDescriptorSetHorz;
+		// Debug lines, one persistently mapped host visible buffer per frame in flight
+		VkShaderModule m_lineVertShaderModule = VK_NULL_HANDLE;
+		VkShaderModule m_lineFragShaderModule = VK_NULL_HANDLE;
+		VkPipeline m_linePipeline = VK_NULL_HANDLE;
+
+		std::vector<VkBuffer> m_lineBuffers;
+		std::vector<VkDeviceMemory> m_lineBuffersMemory;
+		std::vector<void*> m_lineBuffersMapped;
+		std::vector<uint32_t> m_lineBufferCapacities;
+
+		// Bone palette, persistently mapped storage buffers like the debug lines
+		std::vector<VkBuffer> m_boneBuffers;
+		std::vector<VkDeviceMemory> m_boneBuffersMemory;
+		std::vector<void*> m_boneBuffersMapped;
+		std::vector<uint32_t> m_boneBufferCapacities;
 	};
 }
\ No newline at end of file
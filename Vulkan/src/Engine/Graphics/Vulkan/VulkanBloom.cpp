@@ -0,0 +1,468 @@
+#include "VulkanBloom.h"
+#include "Vulkan.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iostream>
+
+namespace Mega
+{
+	void Bloom::Initialize(Vulkan* v)
+	{
+		m_device = v->m_device;
+
+		// Optional like occlusion culling, without the compiled shaders the scene is presented as it is
+		if (!std::ifstream(SHADER_PATH_BLOOM_DOWNSAMPLE).good() || !std::ifstream(SHADER_PATH_BLOOM_UPSAMPLE).good() ||
+			!std::ifstream(SHADER_PATH_BLOOM_COMPOSITE_VERT).good() || !std::ifstream(SHADER_PATH_BLOOM_COMPOSITE_FRAG).good()) {
+			std::cout << "WARNING: Bloom shaders (" << SHADER_PATH_BLOOM_DOWNSAMPLE << ", " << SHADER_PATH_BLOOM_UPSAMPLE << ", "
+				<< SHADER_PATH_BLOOM_COMPOSITE_VERT << ", " << SHADER_PATH_BLOOM_COMPOSITE_FRAG << ") not found, bloom is disabled" << std::endl;
+			return;
+		}
+
+		// The bright pass samples the swapchain image itself instead of rendering the scene somewhere else first
+		SwapChainSupportDetails swapSupportDetails = v->QuerySwapChainSupport(v->m_physicalDevice, v->m_surface);
+		VkFormatProperties sceneProperties;
+		vkGetPhysicalDeviceFormatProperties(v->m_physicalDevice, v->m_surfaceFormat.format, &sceneProperties);
+		if (!(swapSupportDetails.surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_SAMPLED_BIT) ||
+			!(sceneProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
+			std::cout << "WARNING: The swapchain images can't be sampled, bloom is disabled" << std::endl;
+			return;
+		}
+
+		m_downsampleShaderModule = v->CreateShaderModule(m_device, v->ReadFile(SHADER_PATH_BLOOM_DOWNSAMPLE));
+		m_upsampleShaderModule = v->CreateShaderModule(m_device, v->ReadFile(SHADER_PATH_BLOOM_UPSAMPLE));
+		m_compositeVertShaderModule = v->CreateShaderModule(m_device, v->ReadFile(SHADER_PATH_BLOOM_COMPOSITE_VERT));
+		m_compositeFragShaderModule = v->CreateShaderModule(m_device, v->ReadFile(SHADER_PATH_BLOOM_COMPOSITE_FRAG));
+
+		// Bilinear, the 13 taps and the tent both lean on it to cover 4 texels per fetch
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_LINEAR;
+		samplerInfo.minFilter = VK_FILTER_LINEAR;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.maxLod = 0.0f;
+
+		VkResult result = vkCreateSampler(m_device, &samplerInfo, nullptr, &m_sampler);
+		assert(result == VK_SUCCESS && "ERROR: vkCreateSampler() for bloom did not return success");
+
+		CreatePipelines(v);
+		CreateSwapchainResources(v);
+	}
+
+	void Bloom::Destroy(Vulkan* v)
+	{
+		if (!IsEnabled()) { return; }
+
+		DestroySwapchainResources(v);
+
+		vkDestroyPipeline(m_device, m_upsamplePipeline, nullptr);
+		vkDestroyPipeline(m_device, m_downsamplePipeline, nullptr);
+		vkDestroyPipelineLayout(m_device, m_compositePipelineLayout, nullptr);
+		vkDestroyPipelineLayout(m_device, m_chainPipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(m_device, m_compositeSetLayout, nullptr);
+		vkDestroyDescriptorSetLayout(m_device, m_chainSetLayout, nullptr);
+		vkDestroyShaderModule(m_device, m_compositeFragShaderModule, nullptr);
+		vkDestroyShaderModule(m_device, m_compositeVertShaderModule, nullptr);
+		vkDestroyShaderModule(m_device, m_upsampleShaderModule, nullptr);
+		vkDestroyShaderModule(m_device, m_downsampleShaderModule, nullptr);
+		vkDestroySampler(m_device, m_sampler, nullptr);
+
+		m_downsamplePipeline = VK_NULL_HANDLE;
+	}
+
+	void Bloom::CreateSwapchainResources(Vulkan* v)
+	{
+		if (!IsEnabled()) { return; }
+
+		CreateCompositePipeline(v);
+		SizeChain(v);
+		CreateDescriptorSets(v);
+	}
+
+	void Bloom::DestroySwapchainResources(Vulkan* v)
+	{
+		if (!IsEnabled() || m_compositePipeline == VK_NULL_HANDLE) { return; }
+
+		vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+		m_brightSets.clear();
+		m_downsampleSets.clear();
+		m_upsampleSets.clear();
+		m_compositeSet = VK_NULL_HANDLE;
+		m_sceneViews.clear();
+		m_chainImage = VK_NULL_HANDLE;
+
+		vkDestroyPipeline(m_device, m_compositePipeline, nullptr);
+		m_compositePipeline = VK_NULL_HANDLE;
+	}
+
+	void Bloom::AddPasses(RenderGraph* io_pGraph, const RenderGraphResource in_scene, const uint32_t in_imageIndex)
+	{
+		RenderGraphResource chain = io_pGraph->CreateImage("Bloom chain", { BLOOM_FORMAT, GetLevelExtent(0), m_levels });
+
+		RenderGraphPass downsample = io_pGraph->AddPass("Bloom downsample", eRenderGraphPass::Compute, [this, io_pGraph, chain, in_imageIndex](VkCommandBuffer in_command) {
+			if (m_chainGeneration != io_pGraph->GetTransientGeneration()) { WriteChainDescriptors(io_pGraph, chain); }
+			if (m_settings.intensity > 0.0f) { RecordDownsample(in_command, in_imageIndex); }
+		});
+		io_pGraph->Use(downsample, in_scene, eRenderGraphAccess::Sampled);
+		io_pGraph->Use(downsample, chain, eRenderGraphAccess::ImageWrite);
+
+		RenderGraphPass upsample = io_pGraph->AddPass("Bloom upsample", eRenderGraphPass::Compute, [this](VkCommandBuffer in_command) {
+			if (m_settings.intensity > 0.0f) { RecordUpsample(in_command); }
+		});
+		io_pGraph->Use(upsample, chain, eRenderGraphAccess::ImageWrite);
+
+		// Declared at zero intensity too, culling would drop the chain and the graph would idle the device to reallocate
+		RenderGraphPass composite = io_pGraph->AddPass("Bloom composite", eRenderGraphPass::Graphics, [this](VkCommandBuffer in_command) {
+			if (m_settings.intensity > 0.0f) { RecordComposite(in_command); }
+		});
+		io_pGraph->Use(composite, in_scene, eRenderGraphAccess::ColorAttachment);
+		io_pGraph->Use(composite, chain, eRenderGraphAccess::ImageRead);
+	}
+
+	void Bloom::RecordDownsample(VkCommandBuffer in_command, const uint32_t in_imageIndex)
+	{
+		BloomPush push{};
+		push.threshold = m_settings.threshold;
+		push.knee = m_settings.knee;
+		push.intensity = m_settings.intensity;
+		push.radius = m_settings.radius;
+
+		// The first level straight from the scene
+		vkCmdBindPipeline(in_command, VK_PIPELINE_BIND_POINT_COMPUTE, m_downsamplePipeline);
+		push.brightPass = 1;
+		RecordLevel(in_command, m_brightSets[in_imageIndex], m_sceneExtent, 0, &push);
+		push.brightPass = 0;
+		for (uint32_t level = 1; level < m_levels; level++) {
+			RecordLevel(in_command, m_downsampleSets[level], GetLevelExtent(level - 1), level, &push);
+		}
+	}
+
+	void Bloom::RecordUpsample(VkCommandBuffer in_command)
+	{
+		BloomPush push{};
+		push.intensity = m_settings.intensity;
+		push.radius = m_settings.radius;
+
+		// Every level adds the (already accumulated) one below it
+		vkCmdBindPipeline(in_command, VK_PIPELINE_BIND_POINT_COMPUTE, m_upsamplePipeline);
+		for (uint32_t level = m_levels - 1; level-- > 0;) {
+			RecordLevel(in_command, m_upsampleSets[level], GetLevelExtent(level + 1), level, &push);
+		}
+	}
+
+	void Bloom::RecordLevel(VkCommandBuffer in_command, VkDescriptorSet in_set, const VkExtent2D in_source, const uint32_t in_target, BloomPush* io_pPush)
+	{
+		VkExtent2D target = GetLevelExtent(in_target);
+		io_pPush->sourceTexel[0] = 1.0f / in_source.width;
+		io_pPush->sourceTexel[1] = 1.0f / in_source.height;
+		io_pPush->targetSize[0] = (int32_t)target.width;
+		io_pPush->targetSize[1] = (int32_t)target.height;
+
+		vkCmdBindDescriptorSets(in_command, VK_PIPELINE_BIND_POINT_COMPUTE, m_chainPipelineLayout, 0, 1, &in_set, 0, nullptr);
+		vkCmdPushConstants(in_command, m_chainPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BloomPush), io_pPush);
+		vkCmdDispatch(in_command, (target.width + BLOOM_GROUP_SIZE - 1) / BLOOM_GROUP_SIZE, (target.height + BLOOM_GROUP_SIZE - 1) / BLOOM_GROUP_SIZE, 1);
+
+		// What the dispatch wrote, ready for the next one to sample (or the upsample to add to). The graph
+		// only orders whole passes, so the levels inside one are left to us
+		VkImageMemoryBarrier levelDone{};
+		levelDone.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		levelDone.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		levelDone.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		levelDone.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		levelDone.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		levelDone.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		levelDone.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		levelDone.image = m_chainImage;
+		levelDone.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, in_target, 1, 0, 1 };
+		vkCmdPipelineBarrier(in_command, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &levelDone);
+	}
+
+	void Bloom::RecordComposite(VkCommandBuffer in_command)
+	{
+		VkViewport viewport{};
+		viewport.width = (float)m_sceneExtent.width;
+		viewport.height = (float)m_sceneExtent.height;
+		viewport.maxDepth = 1.0f;
+		VkRect2D scissor{};
+		scissor.extent = m_sceneExtent;
+
+		VkExtent2D source = GetLevelExtent(0);
+		BloomPush push{};
+		push.sourceTexel[0] = 1.0f / source.width;
+		push.sourceTexel[1] = 1.0f / source.height;
+		push.targetSize[0] = (int32_t)m_sceneExtent.width;
+		push.targetSize[1] = (int32_t)m_sceneExtent.height;
+		push.intensity = m_settings.intensity;
+		push.radius = m_settings.radius;
+
+		vkCmdBindPipeline(in_command, VK_PIPELINE_BIND_POINT_GRAPHICS, m_compositePipeline);
+		vkCmdSetViewport(in_command, 0, 1, &viewport);
+		vkCmdSetScissor(in_command, 0, 1, &scissor);
+		vkCmdBindDescriptorSets(in_command, VK_PIPELINE_BIND_POINT_GRAPHICS, m_compositePipelineLayout, 0, 1, &m_compositeSet, 0, nullptr);
+		vkCmdPushConstants(in_command, m_compositePipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(BloomPush), &push);
+		vkCmdDraw(in_command, 3, 1, 0, 0);
+	}
+
+	VkExtent2D Bloom::GetLevelExtent(const uint32_t in_level) const
+	{
+		return { std::max(m_sceneExtent.width >> (in_level + 1), 1u), std::max(m_sceneExtent.height >> (in_level + 1), 1u) };
+	}
+
+	void Bloom::CreatePipelines(Vulkan* v)
+	{
+		// Down and up: a level (or the scene) sampled in, a level out
+		std::array<VkDescriptorSetLayoutBinding, 2> chainBindings{};
+		chainBindings[0].binding = 0;
+		chainBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		chainBindings[0].descriptorCount = 1;
+		chainBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		chainBindings[1].binding = 1;
+		chainBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		chainBindings[1].descriptorCount = 1;
+		chainBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = static_cast<uint32_t>(chainBindings.size());
+		layoutInfo.pBindings = chainBindings.data();
+
+		VkResult result = vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_chainSetLayout);
+		assert(result == VK_SUCCESS && "ERROR: vkCreateDescriptorSetLayout() for the bloom chain did not return success");
+
+		// Composite: only the first level
+		VkDescriptorSetLayoutBinding compositeBinding = chainBindings[0];
+		compositeBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &compositeBinding;
+
+		result = vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_compositeSetLayout);
+		assert(result == VK_SUCCESS && "ERROR: vkCreateDescriptorSetLayout() for the bloom composite did not return success");
+
+		auto createLayout = [this](VkDescriptorSetLayout in_setLayout, const VkShaderStageFlags in_stage, VkPipelineLayout* out_pLayout) {
+			VkPushConstantRange pushRange{};
+			pushRange.stageFlags = in_stage;
+			pushRange.offset = 0;
+			pushRange.size = sizeof(BloomPush);
+
+			VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+			pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+			pipelineLayoutInfo.setLayoutCount = 1;
+			pipelineLayoutInfo.pSetLayouts = &in_setLayout;
+			pipelineLayoutInfo.pushConstantRangeCount = 1;
+			pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+
+			VkResult result = vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, out_pLayout);
+			assert(result == VK_SUCCESS && "ERROR: vkCreatePipelineLayout() for bloom did not return success");
+		};
+
+		createLayout(m_chainSetLayout, VK_SHADER_STAGE_COMPUTE_BIT, &m_chainPipelineLayout);
+		createLayout(m_compositeSetLayout, VK_SHADER_STAGE_FRAGMENT_BIT, &m_compositePipelineLayout);
+
+		auto createPipeline = [this](VkShaderModule in_module, VkPipeline* out_pPipeline) {
+			VkComputePipelineCreateInfo pipelineInfo{};
+			pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+			pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+			pipelineInfo.stage.module = in_module;
+			pipelineInfo.stage.pName = "main";
+			pipelineInfo.layout = m_chainPipelineLayout;
+
+			VkResult result = vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, out_pPipeline);
+			assert(result == VK_SUCCESS && "ERROR: vkCreateComputePipelines() for bloom did not return success");
+		};
+
+		createPipeline(m_downsampleShaderModule, &m_downsamplePipeline);
+		createPipeline(m_upsampleShaderModule, &m_upsamplePipeline);
+	}
+
+	void Bloom::CreateCompositePipeline(Vulkan* v)
+	{
+		// Fullscreen triangle from gl_VertexIndex, no vertex buffer
+		std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{};
+		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		shaderStages[0].module = m_compositeVertShaderModule;
+		shaderStages[0].pName = "main";
+		shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		shaderStages[1].module = m_compositeFragShaderModule;
+		shaderStages[1].pName = "main";
+
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+		VkPipelineViewportStateCreateInfo viewportState{};
+		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportState.viewportCount = 1;
+		viewportState.scissorCount = 1;
+
+		VkPipelineRasterizationStateCreateInfo rasterizer{};
+		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizer.lineWidth = 1.0f;
+		rasterizer.cullMode = VK_CULL_MODE_NONE;
+		rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+		VkPipelineMultisampleStateCreateInfo multisampling{};
+		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		VkPipelineDepthStencilStateCreateInfo depthStencil{};
+		depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depthStencil.depthTestEnable = VK_FALSE;
+		depthStencil.depthWriteEnable = VK_FALSE;
+
+		// Added on top of the scene, alpha left alone
+		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		colorBlendAttachment.blendEnable = VK_TRUE;
+		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+		colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+		VkPipelineColorBlendStateCreateInfo colorBlending{};
+		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlending.attachmentCount = 1;
+		colorBlending.pAttachments = &colorBlendAttachment;
+
+		std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+		VkPipelineDynamicStateCreateInfo dynamicState{};
+		dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+		dynamicState.pDynamicStates = dynamicStates.data();
+
+		VkGraphicsPipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+		pipelineInfo.pStages = shaderStages.data();
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+		pipelineInfo.pInputAssemblyState = &inputAssembly;
+		pipelineInfo.pViewportState = &viewportState;
+		pipelineInfo.pRasterizationState = &rasterizer;
+		pipelineInfo.pMultisampleState = &multisampling;
+		pipelineInfo.pDepthStencilState = &depthStencil;
+		pipelineInfo.pColorBlendState = &colorBlending;
+		pipelineInfo.pDynamicState = &dynamicState;
+		pipelineInfo.layout = m_compositePipelineLayout;
+		pipelineInfo.renderPass = v->m_renderGraph.GetCompatibleRenderPass({ v->m_surfaceFormat.format }, VK_FORMAT_UNDEFINED); // The composite pass only has the scene
+		pipelineInfo.subpass = 0;
+
+		VkResult result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_compositePipeline);
+		assert(result == VK_SUCCESS && "ERROR: vkCreateGraphicsPipelines() for the bloom composite did not return success");
+	}
+
+	void Bloom::SizeChain(Vulkan* v)
+	{
+		m_sceneExtent = v->m_swapchainExtent;
+		m_sceneViews = v->m_swapchainImageViews;
+
+		// Stops early on tiny windows, the last level is never under 1x1
+		m_levels = 1;
+		while (m_levels < BLOOM_MAX_LEVELS && ((m_sceneExtent.width >> (m_levels + 1)) > 0 || (m_sceneExtent.height >> (m_levels + 1)) > 0)) { m_levels++; }
+	}
+
+	void Bloom::CreateDescriptorSets(Vulkan* v)
+	{
+		uint32_t sceneCount = static_cast<uint32_t>(m_sceneViews.size());
+		uint32_t chainSetCount = sceneCount + (m_levels - 1) * 2;
+
+		std::array<VkDescriptorPoolSize, 2> poolSizes{};
+		poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSizes[0].descriptorCount = chainSetCount + 1;
+		poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		poolSizes[1].descriptorCount = chainSetCount;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolInfo.pPoolSizes = poolSizes.data();
+		poolInfo.maxSets = chainSetCount + 1;
+
+		VkResult result = vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool);
+		assert(result == VK_SUCCESS && "ERROR: vkCreateDescriptorPool() for bloom did not return success");
+
+		std::vector<VkDescriptorSetLayout> chainLayouts(chainSetCount, m_chainSetLayout);
+		std::vector<VkDescriptorSet> chainSets(chainSetCount);
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_descriptorPool;
+		allocInfo.descriptorSetCount = chainSetCount;
+		allocInfo.pSetLayouts = chainLayouts.data();
+
+		result = vkAllocateDescriptorSets(m_device, &allocInfo, chainSets.data());
+		assert(result == VK_SUCCESS && "ERROR: vkAllocateDescriptorSets() for the bloom chain did not return success");
+
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &m_compositeSetLayout;
+		result = vkAllocateDescriptorSets(m_device, &allocInfo, &m_compositeSet);
+		assert(result == VK_SUCCESS && "ERROR: vkAllocateDescriptorSets() for the bloom composite did not return success");
+
+		m_brightSets.assign(chainSets.begin(), chainSets.begin() + sceneCount);
+		m_downsampleSets.assign(m_levels, VK_NULL_HANDLE);
+		m_upsampleSets.assign(m_levels - 1, VK_NULL_HANDLE);
+		for (uint32_t level = 1; level < m_levels; level++) {
+			m_downsampleSets[level] = chainSets[sceneCount + (level - 1) * 2];
+			m_upsampleSets[level - 1] = chainSets[sceneCount + (level - 1) * 2 + 1];
+		}
+
+		// Written once the graph has the chain
+		m_chainGeneration = 0;
+	}
+
+	void Bloom::WriteChainDescriptors(RenderGraph* io_pGraph, const RenderGraphResource in_chain)
+	{
+		m_chainImage = io_pGraph->GetImage(in_chain);
+
+		auto write = [this](VkDescriptorSet in_set, VkImageView in_source, const VkImageLayout in_sourceLayout, VkImageView in_target) {
+			VkDescriptorImageInfo sourceInfo{};
+			sourceInfo.sampler = m_sampler;
+			sourceInfo.imageView = in_source;
+			sourceInfo.imageLayout = in_sourceLayout;
+
+			VkDescriptorImageInfo targetInfo{};
+			targetInfo.imageView = in_target;
+			targetInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+			std::array<VkWriteDescriptorSet, 2> writes{};
+			writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[0].dstSet = in_set;
+			writes[0].dstBinding = 0;
+			writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[0].descriptorCount = 1;
+			writes[0].pImageInfo = &sourceInfo;
+			writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[1].dstSet = in_set;
+			writes[1].dstBinding = 1;
+			writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			writes[1].descriptorCount = 1;
+			writes[1].pImageInfo = &targetInfo;
+
+			// The composite set only has the sampler
+			uint32_t writeCount = in_target != VK_NULL_HANDLE ? 2 : 1;
+			vkUpdateDescriptorSets(m_device, writeCount, writes.data(), 0, nullptr);
+		};
+
+		auto levelView = [io_pGraph, in_chain](const uint32_t in_level) { return io_pGraph->GetLevelView(in_chain, in_level); };
+		for (uint32_t i = 0; i < m_brightSets.size(); i++) {
+			write(m_brightSets[i], m_sceneViews[i], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, levelView(0));
+		}
+		for (uint32_t level = 1; level < m_levels; level++) {
+			write(m_downsampleSets[level], levelView(level - 1), VK_IMAGE_LAYOUT_GENERAL, levelView(level));
+			write(m_upsampleSets[level - 1], levelView(level), VK_IMAGE_LAYOUT_GENERAL, levelView(level - 1));
+		}
+		write(m_compositeSet, levelView(0), VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE);
+
+		m_chainGeneration = io_pGraph->GetTransientGeneration();
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vector>
+
+#include "VulkanInclude.h"
+#include "VulkanObjects.h"
+#include "VulkanRenderGraph.h"
+
+#define BLOOM_GROUP_SIZE uint32_t(8)                         // local_size_x/y of ShaderBloomDownsample.comp and ShaderBloomUpsample.comp
+#define BLOOM_MAX_LEVELS uint32_t(5)                         // 1/2 down to 1/32 of the screen
+#define BLOOM_FORMAT     VK_FORMAT_R16G16B16A16_SFLOAT
+#define BLOOM_THRESHOLD  0.8f // Linear brightness where bloom starts
+#define BLOOM_KNEE       0.3f // How far under the threshold it fades in instead of cutting off
+#define BLOOM_INTENSITY  0.2f // Every level adds the bright pass again on the way up, so 1/BLOOM_MAX_LEVELS keeps it about as bright as the source
+#define BLOOM_RADIUS     1.0f // Tent filter size in source texels, bigger spreads further at the cost of softer detail
+
+namespace Mega
+{
+	class Vulkan;
+
+	struct BloomSettings {
+		float threshold = BLOOM_THRESHOLD;
+		float knee = BLOOM_KNEE;
+		float intensity = BLOOM_INTENSITY;
+		float radius = BLOOM_RADIUS;
+	};
+
+	// Layout matches the push constants of every bloom shader
+	struct BloomPush {
+		float sourceTexel[2]; // 1 / size of what is sampled
+		int32_t targetSize[2];
+		float threshold;
+		float knee;
+		float intensity;
+		float radius;
+		uint32_t brightPass;
+	};
+
+	// Bloom on the finished scene, after the models and before the UI:
+	//  1. Bright pass: the swapchain image is read back and what is above the threshold is written to
+	//     the first level at half size, 13 taps with a Karis average so single bright pixels dont flicker
+	//  2. Downsample: the same 13 taps halve every level into the next, down to 1/32
+	//  3. Upsample: back up the chain, each level adds a 3x3 tent of the one below it
+	//  4. Composite: a fullscreen triangle adds the first level (one more tent) to the swapchain image
+	// Every level lives in one render graph transient, a third of a full size image in total. Depth is done
+	// by the time it's written, so the graph usually puts both in the same memory. Disabled (no bloom) when
+	// the shaders arent compiled or the swapchain can't be sampled
+	class Bloom {
+	public:
+		friend Vulkan;
+
+		void Initialize(Vulkan* v);
+		void Destroy(Vulkan* v);
+
+		// The chain's size and the descriptor sets follow the swapchain
+		void CreateSwapchainResources(Vulkan* v);
+		void DestroySwapchainResources(Vulkan* v);
+
+		bool IsEnabled() const { return m_downsamplePipeline != VK_NULL_HANDLE; }
+		const BloomSettings& GetSettings() const { return m_settings; }
+		void SetSettings(const BloomSettings& in_settings) { m_settings = in_settings; }
+
+	private:
+		// After the scene's passes, on in_scene (the swapchain image). Without intensity the passes stay
+		// declared but record nothing, so the chain keeps its transient
+		void AddPasses(RenderGraph* io_pGraph, const RenderGraphResource in_scene, const uint32_t in_imageIndex);
+
+		// Bright pass and down the chain, then back up it. Each level waits on the one before it inside the pass
+		void RecordDownsample(VkCommandBuffer in_command, const uint32_t in_imageIndex);
+		void RecordUpsample(VkCommandBuffer in_command);
+		void RecordLevel(VkCommandBuffer in_command, VkDescriptorSet in_set, const VkExtent2D in_source, const uint32_t in_target, BloomPush* io_pPush);
+		// Inside the composite pass, before the UI
+		void RecordComposite(VkCommandBuffer in_command);
+
+		void CreatePipelines(Vulkan* v);
+		void CreateCompositePipeline(Vulkan* v);
+		void SizeChain(Vulkan* v);
+		void CreateDescriptorSets(Vulkan* v);
+		// The chain is a graph transient, every set is rewritten when the graph reallocates it
+		void WriteChainDescriptors(RenderGraph* io_pGraph, const RenderGraphResource in_chain);
+
+		// Where level in_level's dispatch reads from and writes to
+		VkExtent2D GetLevelExtent(const uint32_t in_level) const;
+
+		VkDevice m_device = VK_NULL_HANDLE;
+		BloomSettings m_settings;
+
+		VkShaderModule m_downsampleShaderModule = VK_NULL_HANDLE;
+		VkShaderModule m_upsampleShaderModule = VK_NULL_HANDLE;
+		VkShaderModule m_compositeVertShaderModule = VK_NULL_HANDLE;
+		VkShaderModule m_compositeFragShaderModule = VK_NULL_HANDLE;
+		VkDescriptorSetLayout m_chainSetLayout = VK_NULL_HANDLE;     // Sampled source, storage target
+		VkDescriptorSetLayout m_compositeSetLayout = VK_NULL_HANDLE; // Sampled first level
+		VkPipelineLayout m_chainPipelineLayout = VK_NULL_HANDLE;
+		VkPipelineLayout m_compositePipelineLayout = VK_NULL_HANDLE;
+		VkPipeline m_downsamplePipeline = VK_NULL_HANDLE;
+		VkPipeline m_upsamplePipeline = VK_NULL_HANDLE;
+		VkPipeline m_compositePipeline = VK_NULL_HANDLE;
+		VkSampler m_sampler = VK_NULL_HANDLE;
+
+		// The graph's while its passes record, every level in GENERAL
+		VkImage m_chainImage = VK_NULL_HANDLE;
+		uint32_t m_chainGeneration = 0; // The graph's transient generation the sets were written for, 0 for never
+		VkExtent2D m_sceneExtent = { 0, 0 };
+		uint32_t m_levels = 0;
+
+		std::vector<VkImageView> m_sceneViews; // The swapchain's, what the bright pass reads
+
+		VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> m_brightSets;     // Per swapchain image
+		std::vector<VkDescriptorSet> m_downsampleSets; // Per level, 0 is unused (the bright pass)
+		std::vector<VkDescriptorSet> m_upsampleSets;   // Per level but the last
+		VkDescriptorSet m_compositeSet = VK_NULL_HANDLE;
+	};
+}
@@ -3,10 +3,15 @@
 #define INDEX_TYPE uint32_t
 #define SHADER_PATH_VERT "Shaders/vert.spv"
 #define SHADER_PATH_FRAG "Shaders/fragPBR.spv"
-#define SHADER_PATH_BLOOM_VERT "Shaders/vert.spv"
-#define SHADER_PATH_BLOOM_FRAG "Shaders/fragPBR.spv"
-#define SHADER_PATH_BLOOM_COLOR_PASS_VERT "Shaders/fragPBR.spv"
-#define SHADER_PATH_BLOOM_COLOR_PASS_FRAG "Shaders/fragPBR.spv"
+#define SHADER_PATH_LINE_VERT "Shaders/vertLine.spv"
+#define SHADER_PATH_LINE_FRAG "Shaders/fragLine.spv"
+#define SHADER_PATH_HIZ_BUILD "Shaders/compHiZBuild.spv"
+#define SHADER_PATH_HIZ_CULL "Shaders/compHiZCull.spv"
+#define SHADER_PATH_SKINNING "Shaders/compSkinning.spv"
+#define SHADER_PATH_BLOOM_DOWNSAMPLE "Shaders/compBloomDownsample.spv"
+#define SHADER_PATH_BLOOM_UPSAMPLE "Shaders/compBloomUpsample.spv"
+#define SHADER_PATH_BLOOM_COMPOSITE_VERT "Shaders/vertBloomComposite.spv"
+#define SHADER_PATH_BLOOM_COMPOSITE_FRAG "Shaders/fragBloomComposite.spv"
 
 //#define CULL_MODE VK_CULL_MODE_BACK_BIT
 #define CULL_MODE VK_CULL_MODE_NONE
@@ -16,9 +21,16 @@
 //#define LIGHT_POS 0.0f, 0.0f, 1.0f
 //#define LIGHT_COUNT 1
 
+#define PROJECTION_FOV_Y 45.0f // Degrees
+
 #define MAX_TEXTURE_COUNT 10
 #define MAX_LIGHT_COUNT 99
 
-#define MAX_BONE_INFLUENCE 10
+#define MAX_BONE_INFLUENCE 4 // Packed into one uint8x4 of indices and one unorm8x4 of weights
+
+#define DRAW_PREPARE_GRAIN_SIZE uint32_t(64) // Draws culled per job
+
+#define DEBUG_LINE_BUFFER_MIN_VERTICES uint32_t(1 << 16) // Per frame in flight, grows to fit
+#define BONE_PALETTE_MIN_MATRICES      uint32_t(1 << 14) // Same, 16k joints is a couple hundred characters
 
 #define MTL_BASE_DIR "Assets/Models"
\ No newline at end of file
@@ -36,7 +36,8 @@ namespace Mega
 		initInfo.Allocator = nullptr;
 		initInfo.MinImageCount = v->m_swapchainImageViews.size();;
 		initInfo.ImageCount = v->m_swapchainImageViews.size();
-		ImGui_ImplVulkan_Init(&initInfo, v->m_renderPass);
+		// The UI pass on the render graph only has the swapchain image
+		ImGui_ImplVulkan_Init(&initInfo, v->m_renderGraph.GetCompatibleRenderPass({ v->m_surfaceFormat.format }, VK_FORMAT_UNDEFINED));
 
 		VkCommandBuffer commandBuffer = v->BeginSingleTimeCommand(v->m_drawCommandPools[0]);
 		ImGui_ImplVulkan_CreateFontsTexture(commandBuffer);
@@ -71,13 +72,12 @@ namespace Mega
 
 	void ImguiObject::CreateFrameData(Vulkan* v)
 	{
-		for (int i = 0; i < v->m_swapchainFramebuffers.size(); ++i) {
+		for (int i = 0; i < v->m_swapchainImageViews.size(); ++i) {
 			ImGui_ImplVulkanH_Frame frame;
 			m_frames.push_back(frame);
 
 			frame.CommandBuffer = v->m_drawCommandBuffers[i];
 			frame.CommandPool = v->m_drawCommandPools[i];
-			frame.Framebuffer = v->m_swapchainFramebuffers[i];
 
 			m_frames[i] = frame;
 		}
@@ -7,11 +7,6 @@
 #include "Engine/Core/Math/Math.h"
 #include "Engine/Graphics/Objects/Light.h"
 
-struct UBOBlurParams {
-	float blurScale = 1.0f;
-	float blurStrength = 1.5f;
-};
-
 struct ImguiVertex {
 	glm::vec4 pos;
 
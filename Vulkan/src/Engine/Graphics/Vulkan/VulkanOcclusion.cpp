@@ -0,0 +1,505 @@
+#include "VulkanOcclusion.h"
+#include "Vulkan.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace Mega
+{
+	void OcclusionCuller::Initialize(Vulkan* v)
+	{
+		m_device = v->m_device;
+		m_framesInFlight = (uint32_t)v->MAX_FRAMES_IN_FLIGHT;
+
+		// Optional like the debug lines, without the compiled shaders everything draws in one pass
+		if (!std::ifstream(SHADER_PATH_HIZ_BUILD).good() || !std::ifstream(SHADER_PATH_HIZ_CULL).good()) {
+			std::cout << "WARNING: Occlusion culling shaders (" << SHADER_PATH_HIZ_BUILD << ", " << SHADER_PATH_HIZ_CULL << ") not found, occlusion culling is disabled" << std::endl;
+			return;
+		}
+
+		// The pyramid is built straight from the depth attachment
+		VkFormatProperties depthProperties;
+		vkGetPhysicalDeviceFormatProperties(v->m_physicalDevice, v->FindDepthFormat(), &depthProperties);
+		if (!(depthProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+			std::cout << "WARNING: The depth format can't be sampled, occlusion culling is disabled" << std::endl;
+			return;
+		}
+
+		m_buildShaderModule = v->CreateShaderModule(m_device, v->ReadFile(SHADER_PATH_HIZ_BUILD));
+		m_cullShaderModule = v->CreateShaderModule(m_device, v->ReadFile(SHADER_PATH_HIZ_CULL));
+
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+		VkResult result = vkCreateSampler(m_device, &samplerInfo, nullptr, &m_sampler);
+		assert(result == VK_SUCCESS && "ERROR: vkCreateSampler() for the depth pyramid did not return success");
+
+		CreatePipelines(v);
+
+		m_counterBuffers.resize(m_framesInFlight, VK_NULL_HANDLE);
+		m_counterBuffersMemory.resize(m_framesInFlight, VK_NULL_HANDLE);
+		m_counterBuffersMapped.resize(m_framesInFlight, nullptr);
+		for (uint32_t i = 0; i < m_framesInFlight; i++) {
+			v->CreateBuffer(sizeof(OcclusionCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				m_counterBuffers[i], m_counterBuffersMemory[i]);
+			vkMapMemory(m_device, m_counterBuffersMemory[i], 0, sizeof(OcclusionCounters), 0, &m_counterBuffersMapped[i]);
+			memset(m_counterBuffersMapped[i], 0, sizeof(OcclusionCounters));
+		}
+
+		CreateDrawBuffers(v, OCCLUSION_MIN_DRAW_CAPACITY);
+		CreateSwapchainResources(v);
+	}
+
+	void OcclusionCuller::Destroy(Vulkan* v)
+	{
+		if (!IsEnabled()) { return; }
+
+		DestroySwapchainResources(v);
+		DestroyDrawBuffers(v);
+
+		for (uint32_t i = 0; i < m_framesInFlight; i++) {
+			vkUnmapMemory(m_device, m_counterBuffersMemory[i]);
+			vkDestroyBuffer(m_device, m_counterBuffers[i], nullptr);
+			vkFreeMemory(m_device, m_counterBuffersMemory[i], nullptr);
+		}
+
+		vkDestroyPipeline(m_device, m_cullPipeline, nullptr);
+		vkDestroyPipeline(m_device, m_buildPipeline, nullptr);
+		vkDestroyPipelineLayout(m_device, m_cullPipelineLayout, nullptr);
+		vkDestroyPipelineLayout(m_device, m_buildPipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(m_device, m_cullSetLayout, nullptr);
+		vkDestroyDescriptorSetLayout(m_device, m_buildSetLayout, nullptr);
+		vkDestroyShaderModule(m_device, m_cullShaderModule, nullptr);
+		vkDestroyShaderModule(m_device, m_buildShaderModule, nullptr);
+		vkDestroySampler(m_device, m_sampler, nullptr);
+
+		m_cullPipeline = VK_NULL_HANDLE;
+	}
+
+	void OcclusionCuller::CreateSwapchainResources(Vulkan* v)
+	{
+		if (!IsEnabled()) { return; }
+
+		CreatePyramid(v);
+		CreateDescriptorSets(v);
+	}
+
+	void OcclusionCuller::DestroySwapchainResources(Vulkan* v)
+	{
+		if (!IsEnabled() || m_descriptorPool == VK_NULL_HANDLE) { return; }
+
+		vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+		m_descriptorPool = VK_NULL_HANDLE;
+		m_buildSets.clear();
+		m_cullSets.clear();
+
+		vkDestroyImageView(m_device, m_pyramidView, nullptr);
+		for (VkImageView view : m_pyramidLevelViews) { vkDestroyImageView(m_device, view, nullptr); }
+		m_pyramidLevelViews.clear();
+		vkDestroyImage(m_device, m_pyramidImage, nullptr);
+		vkFreeMemory(m_device, m_pyramidMemory, nullptr);
+	}
+
+	void OcclusionCuller::ReadCounters(const size_t in_frame)
+	{
+		if (!IsEnabled()) { return; }
+
+		memcpy(&m_lastCounters, m_counterBuffersMapped[in_frame], sizeof(OcclusionCounters));
+		memset(m_counterBuffersMapped[in_frame], 0, sizeof(OcclusionCounters));
+	}
+
+	void OcclusionCuller::Upload(Vulkan* v, const size_t in_frame, const std::vector<RenderSnapshotDraw>& in_draws, const std::vector<uint8_t>& in_visible, const std::vector<int32_t>& in_vertexOffsets)
+	{
+		m_drawCount = (uint32_t)in_draws.size();
+		if (m_drawCount > m_drawCapacity) {
+			// The command and state buffers are shared by every frame in flight
+			vkDeviceWaitIdle(m_device);
+
+			uint32_t capacity = m_drawCapacity;
+			while (capacity < m_drawCount) { capacity *= 2; }
+
+			DestroyDrawBuffers(v);
+			CreateDrawBuffers(v, capacity);
+			WriteCullDescriptors(v);
+		}
+
+		OcclusionCullDraw* pDraws = (OcclusionCullDraw*)m_drawBuffersMapped[in_frame];
+		for (uint32_t i = 0; i < m_drawCount; i++) {
+			const RenderSnapshotDraw& draw = in_draws[i];
+			pDraws[i].model = draw.pushData.model;
+			pDraws[i].boundsMin = Vec4F(draw.vertexData.boundsMin, 1.0f);
+			pDraws[i].boundsMax = Vec4F(draw.vertexData.boundsMax, 1.0f);
+			pDraws[i].indexCount = draw.vertexData.indices[1] - draw.vertexData.indices[0];
+			pDraws[i].firstIndex = draw.vertexData.indices[0];
+			pDraws[i].visible = in_visible[i];
+			pDraws[i].vertexOffset = in_vertexOffsets[i];
+		}
+	}
+
+	void OcclusionCuller::AddCullPass(RenderGraph* io_pGraph, const size_t in_frame, const Mat4x4F& in_viewProj, const uint32_t in_phase)
+	{
+		if (in_phase == 0) {
+			// The pyramid carries over from last frame, so it isn't discarded and stays in whatever layout the build left it
+			m_commandResource = io_pGraph->ImportBuffer("Occlusion commands", m_commandBuffer);
+			m_stateResource = io_pGraph->ImportBuffer("Occlusion states", m_stateBuffer);
+			m_pyramidResource = io_pGraph->ImportImage("Depth pyramid", m_pyramidImage, m_pyramidView, VK_FORMAT_R32_SFLOAT, m_pyramidExtent, VK_IMAGE_LAYOUT_UNDEFINED, false);
+		}
+
+		RenderGraphPass pass = io_pGraph->AddPass(in_phase == 0 ? "Occlusion cull" : "Occlusion cull (second phase)", eRenderGraphPass::Compute,
+			[this, in_frame, in_viewProj, in_phase](VkCommandBuffer in_command) { RecordCull(in_command, in_frame, in_viewProj, in_phase); });
+		io_pGraph->Use(pass, m_commandResource, eRenderGraphAccess::BufferWrite);
+		io_pGraph->Use(pass, m_stateResource, eRenderGraphAccess::BufferWrite);
+		io_pGraph->Use(pass, m_pyramidResource, eRenderGraphAccess::ImageRead);
+	}
+
+	void OcclusionCuller::AddPyramidPass(RenderGraph* io_pGraph, const RenderGraphResource in_depth)
+	{
+		RenderGraphPass pass = io_pGraph->AddPass("Depth pyramid", eRenderGraphPass::Compute, [this, io_pGraph, in_depth](VkCommandBuffer in_command) {
+			// Depth is a graph transient, its view changes whenever the graph reallocates
+			if (m_depthGeneration != io_pGraph->GetTransientGeneration()) {
+				VkDescriptorImageInfo sourceInfo{};
+				sourceInfo.sampler = m_sampler;
+				sourceInfo.imageView = io_pGraph->GetImageView(in_depth);
+				sourceInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+				VkWriteDescriptorSet write{};
+				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				write.dstSet = m_buildSets[0];
+				write.dstBinding = 0;
+				write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				write.descriptorCount = 1;
+				write.pImageInfo = &sourceInfo;
+				vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+
+				m_depthGeneration = io_pGraph->GetTransientGeneration();
+			}
+
+			RecordPyramid(in_command);
+		});
+		io_pGraph->Use(pass, in_depth, eRenderGraphAccess::Sampled);
+		io_pGraph->Use(pass, m_pyramidResource, eRenderGraphAccess::ImageWrite);
+	}
+
+	void OcclusionCuller::RecordCull(VkCommandBuffer in_command, const size_t in_frame, const Mat4x4F& in_viewProj, const uint32_t in_phase)
+	{
+		if (m_drawCount > 0) {
+			OcclusionCullPush push;
+			push.viewProj = in_viewProj;
+			push.pyramidSize[0] = (int32_t)m_pyramidExtent.width;
+			push.pyramidSize[1] = (int32_t)m_pyramidExtent.height;
+			push.drawCount = m_drawCount;
+			push.phase = in_phase;
+			push.commandBase = in_phase == 0 ? 0 : m_drawCapacity;
+			push.mipCount = (int32_t)m_pyramidLevels;
+			push.pyramidValid = m_pyramidValid ? 1 : 0;
+
+			vkCmdBindPipeline(in_command, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline);
+			vkCmdBindDescriptorSets(in_command, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 0, 1, &m_cullSets[in_frame], 0, nullptr);
+			vkCmdPushConstants(in_command, m_cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(OcclusionCullPush), &push);
+			vkCmdDispatch(in_command, (m_drawCount + OCCLUSION_CULL_GROUP_SIZE - 1) / OCCLUSION_CULL_GROUP_SIZE, 1, 1);
+		}
+	}
+
+	void OcclusionCuller::RecordPyramid(VkCommandBuffer in_command)
+	{
+		// The graph already has every level in GENERAL and the depth readable
+		vkCmdBindPipeline(in_command, VK_PIPELINE_BIND_POINT_COMPUTE, m_buildPipeline);
+
+		VkExtent2D source = m_depthExtent;
+		for (uint32_t level = 0; level < m_pyramidLevels; level++) {
+			VkExtent2D target = { std::max(m_pyramidExtent.width >> level, 1u), std::max(m_pyramidExtent.height >> level, 1u) };
+			int32_t push[4] = { (int32_t)source.width, (int32_t)source.height, (int32_t)target.width, (int32_t)target.height };
+
+			vkCmdBindDescriptorSets(in_command, VK_PIPELINE_BIND_POINT_COMPUTE, m_buildPipelineLayout, 0, 1, &m_buildSets[level], 0, nullptr);
+			vkCmdPushConstants(in_command, m_buildPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), push);
+			vkCmdDispatch(in_command, (target.width + OCCLUSION_BUILD_GROUP_SIZE - 1) / OCCLUSION_BUILD_GROUP_SIZE, (target.height + OCCLUSION_BUILD_GROUP_SIZE - 1) / OCCLUSION_BUILD_GROUP_SIZE, 1);
+
+			// The next level reads this one, within the pass so the graph can't place it
+			VkImageMemoryBarrier levelDone{};
+			levelDone.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			levelDone.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			levelDone.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			levelDone.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+			levelDone.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+			levelDone.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			levelDone.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			levelDone.image = m_pyramidImage;
+			levelDone.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+			vkCmdPipelineBarrier(in_command, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &levelDone);
+
+			source = target;
+		}
+
+		m_pyramidValid = true;
+	}
+
+	VkDeviceSize OcclusionCuller::GetCommandOffset(const uint32_t in_phase, const uint32_t in_draw) const
+	{
+		uint32_t index = (in_phase == 0 ? 0 : m_drawCapacity) + in_draw;
+		return (VkDeviceSize)index * sizeof(VkDrawIndexedIndirectCommand);
+	}
+
+	void OcclusionCuller::CreatePipelines(Vulkan* v)
+	{
+		// Build: previous level (or the depth attachment) in, next level out
+		std::array<VkDescriptorSetLayoutBinding, 2> buildBindings{};
+		buildBindings[0].binding = 0;
+		buildBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		buildBindings[0].descriptorCount = 1;
+		buildBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		buildBindings[1].binding = 1;
+		buildBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		buildBindings[1].descriptorCount = 1;
+		buildBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = static_cast<uint32_t>(buildBindings.size());
+		layoutInfo.pBindings = buildBindings.data();
+
+		VkResult result = vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_buildSetLayout);
+		assert(result == VK_SUCCESS && "ERROR: vkCreateDescriptorSetLayout() for the pyramid build did not return success");
+
+		// Cull: draws, commands, states, pyramid, counters
+		std::array<VkDescriptorSetLayoutBinding, 5> cullBindings{};
+		for (uint32_t i = 0; i < cullBindings.size(); i++) {
+			cullBindings[i].binding = i;
+			cullBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			cullBindings[i].descriptorCount = 1;
+			cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+		cullBindings[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+		layoutInfo.bindingCount = static_cast<uint32_t>(cullBindings.size());
+		layoutInfo.pBindings = cullBindings.data();
+
+		result = vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_cullSetLayout);
+		assert(result == VK_SUCCESS && "ERROR: vkCreateDescriptorSetLayout() for the occlusion cull did not return success");
+
+		auto createPipeline = [this](VkShaderModule in_module, VkDescriptorSetLayout in_setLayout, const uint32_t in_pushSize, VkPipelineLayout* out_pLayout, VkPipeline* out_pPipeline) {
+			VkPushConstantRange pushRange{};
+			pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			pushRange.offset = 0;
+			pushRange.size = in_pushSize;
+
+			VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+			pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+			pipelineLayoutInfo.setLayoutCount = 1;
+			pipelineLayoutInfo.pSetLayouts = &in_setLayout;
+			pipelineLayoutInfo.pushConstantRangeCount = 1;
+			pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+
+			VkResult result = vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, out_pLayout);
+			assert(result == VK_SUCCESS && "ERROR: vkCreatePipelineLayout() for occlusion culling did not return success");
+
+			VkComputePipelineCreateInfo pipelineInfo{};
+			pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+			pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+			pipelineInfo.stage.module = in_module;
+			pipelineInfo.stage.pName = "main";
+			pipelineInfo.layout = *out_pLayout;
+
+			result = vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, out_pPipeline);
+			assert(result == VK_SUCCESS && "ERROR: vkCreateComputePipelines() for occlusion culling did not return success");
+		};
+
+		createPipeline(m_buildShaderModule, m_buildSetLayout, sizeof(int32_t) * 4, &m_buildPipelineLayout, &m_buildPipeline);
+		createPipeline(m_cullShaderModule, m_cullSetLayout, sizeof(OcclusionCullPush), &m_cullPipelineLayout, &m_cullPipeline);
+	}
+
+	void OcclusionCuller::CreatePyramid(Vulkan* v)
+	{
+		// Largest power of two that fits, so every level after the first is an exact 2x2 reduction
+		m_depthExtent = v->m_swapchainExtent;
+		m_pyramidExtent = { 1, 1 };
+		while (m_pyramidExtent.width * 2 <= m_depthExtent.width) { m_pyramidExtent.width *= 2; }
+		while (m_pyramidExtent.height * 2 <= m_depthExtent.height) { m_pyramidExtent.height *= 2; }
+
+		m_pyramidLevels = 1;
+		while (m_pyramidLevels < OCCLUSION_MAX_PYRAMID_LEVELS && ((m_pyramidExtent.width >> m_pyramidLevels) > 0 || (m_pyramidExtent.height >> m_pyramidLevels) > 0)) { m_pyramidLevels++; }
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent = { m_pyramidExtent.width, m_pyramidExtent.height, 1 };
+		imageInfo.mipLevels = m_pyramidLevels;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = VK_FORMAT_R32_SFLOAT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+		v->CreateImageObject(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_pyramidImage, m_pyramidMemory);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = m_pyramidImage;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R32_SFLOAT;
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_pyramidLevels, 0, 1 };
+
+		VkResult result = vkCreateImageView(m_device, &viewInfo, nullptr, &m_pyramidView);
+		assert(result == VK_SUCCESS && "ERROR: vkCreateImageView() for the depth pyramid did not return success");
+
+		m_pyramidLevelViews.resize(m_pyramidLevels);
+		for (uint32_t level = 0; level < m_pyramidLevels; level++) {
+			viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+			result = vkCreateImageView(m_device, &viewInfo, nullptr, &m_pyramidLevelViews[level]);
+			assert(result == VK_SUCCESS && "ERROR: vkCreateImageView() for a depth pyramid level did not return success");
+		}
+
+		m_pyramidValid = false;
+	}
+
+	void OcclusionCuller::CreateDescriptorSets(Vulkan* v)
+	{
+		std::array<VkDescriptorPoolSize, 3> poolSizes{};
+		poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSizes[0].descriptorCount = m_pyramidLevels + m_framesInFlight;
+		poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		poolSizes[1].descriptorCount = m_pyramidLevels;
+		poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSizes[2].descriptorCount = m_framesInFlight * 4;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolInfo.pPoolSizes = poolSizes.data();
+		poolInfo.maxSets = m_pyramidLevels + m_framesInFlight;
+
+		VkResult result = vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool);
+		assert(result == VK_SUCCESS && "ERROR: vkCreateDescriptorPool() for occlusion culling did not return success");
+
+		std::vector<VkDescriptorSetLayout> buildLayouts(m_pyramidLevels, m_buildSetLayout);
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_descriptorPool;
+		allocInfo.descriptorSetCount = m_pyramidLevels;
+		allocInfo.pSetLayouts = buildLayouts.data();
+
+		m_buildSets.resize(m_pyramidLevels);
+		result = vkAllocateDescriptorSets(m_device, &allocInfo, m_buildSets.data());
+		assert(result == VK_SUCCESS && "ERROR: vkAllocateDescriptorSets() for the pyramid build did not return success");
+
+		std::vector<VkDescriptorSetLayout> cullLayouts(m_framesInFlight, m_cullSetLayout);
+		allocInfo.descriptorSetCount = m_framesInFlight;
+		allocInfo.pSetLayouts = cullLayouts.data();
+
+		m_cullSets.resize(m_framesInFlight);
+		result = vkAllocateDescriptorSets(m_device, &allocInfo, m_cullSets.data());
+		assert(result == VK_SUCCESS && "ERROR: vkAllocateDescriptorSets() for the occlusion cull did not return success");
+
+		// Level 0 reads the depth attachment, written by AddPyramidPass once the graph has it. Every other
+		// level reads the one before it
+		m_depthGeneration = 0;
+		for (uint32_t level = 0; level < m_pyramidLevels; level++) {
+			VkDescriptorImageInfo sourceInfo{};
+			sourceInfo.sampler = m_sampler;
+			sourceInfo.imageView = level == 0 ? VK_NULL_HANDLE : m_pyramidLevelViews[level - 1];
+			sourceInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+			VkDescriptorImageInfo targetInfo{};
+			targetInfo.imageView = m_pyramidLevelViews[level];
+			targetInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+			std::array<VkWriteDescriptorSet, 2> writes{};
+			writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[0].dstSet = m_buildSets[level];
+			writes[0].dstBinding = 0;
+			writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[0].descriptorCount = 1;
+			writes[0].pImageInfo = &sourceInfo;
+			writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[1].dstSet = m_buildSets[level];
+			writes[1].dstBinding = 1;
+			writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			writes[1].descriptorCount = 1;
+			writes[1].pImageInfo = &targetInfo;
+
+			uint32_t first = level == 0 ? 1 : 0;
+			vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()) - first, writes.data() + first, 0, nullptr);
+		}
+
+		WriteCullDescriptors(v);
+	}
+
+	void OcclusionCuller::CreateDrawBuffers(Vulkan* v, const uint32_t in_capacity)
+	{
+		m_drawCapacity = in_capacity;
+
+		m_drawBuffers.resize(m_framesInFlight, VK_NULL_HANDLE);
+		m_drawBuffersMemory.resize(m_framesInFlight, VK_NULL_HANDLE);
+		m_drawBuffersMapped.resize(m_framesInFlight, nullptr);
+		VkDeviceSize drawSize = (VkDeviceSize)in_capacity * sizeof(OcclusionCullDraw);
+		for (uint32_t i = 0; i < m_framesInFlight; i++) {
+			v->CreateBuffer(drawSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				m_drawBuffers[i], m_drawBuffersMemory[i]);
+			vkMapMemory(m_device, m_drawBuffersMemory[i], 0, drawSize, 0, &m_drawBuffersMapped[i]);
+		}
+
+		v->CreateBuffer((VkDeviceSize)in_capacity * 2 * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_commandBuffer, m_commandBufferMemory);
+		v->CreateBuffer((VkDeviceSize)in_capacity * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_stateBuffer, m_stateBufferMemory);
+	}
+
+	void OcclusionCuller::DestroyDrawBuffers(Vulkan* v)
+	{
+		for (uint32_t i = 0; i < m_drawBuffers.size(); i++) {
+			vkUnmapMemory(m_device, m_drawBuffersMemory[i]);
+			vkDestroyBuffer(m_device, m_drawBuffers[i], nullptr);
+			vkFreeMemory(m_device, m_drawBuffersMemory[i], nullptr);
+		}
+		m_drawBuffers.clear();
+		m_drawBuffersMemory.clear();
+		m_drawBuffersMapped.clear();
+
+		vkDestroyBuffer(m_device, m_commandBuffer, nullptr);
+		vkFreeMemory(m_device, m_commandBufferMemory, nullptr);
+		vkDestroyBuffer(m_device, m_stateBuffer, nullptr);
+		vkFreeMemory(m_device, m_stateBufferMemory, nullptr);
+		m_drawCapacity = 0;
+	}
+
+	void OcclusionCuller::WriteCullDescriptors(Vulkan* v)
+	{
+		if (m_cullSets.empty()) { return; }
+
+		for (uint32_t i = 0; i < m_framesInFlight; i++) {
+			VkDescriptorBufferInfo drawInfo = { m_drawBuffers[i], 0, VK_WHOLE_SIZE };
+			VkDescriptorBufferInfo commandInfo = { m_commandBuffer, 0, VK_WHOLE_SIZE };
+			VkDescriptorBufferInfo stateInfo = { m_stateBuffer, 0, VK_WHOLE_SIZE };
+			VkDescriptorBufferInfo counterInfo = { m_counterBuffers[i], 0, VK_WHOLE_SIZE };
+			VkDescriptorImageInfo pyramidInfo = { m_sampler, m_pyramidView, VK_IMAGE_LAYOUT_GENERAL };
+
+			std::array<VkWriteDescriptorSet, 5> writes{};
+			for (uint32_t binding = 0; binding < writes.size(); binding++) {
+				writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				writes[binding].dstSet = m_cullSets[i];
+				writes[binding].dstBinding = binding;
+				writes[binding].descriptorCount = 1;
+				writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			}
+			writes[0].pBufferInfo = &drawInfo;
+			writes[1].pBufferInfo = &commandInfo;
+			writes[2].pBufferInfo = &stateInfo;
+			writes[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[3].pImageInfo = &pyramidInfo;
+			writes[4].pBufferInfo = &counterInfo;
+
+			vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+		}
+	}
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <vector>
+
+#include "VulkanInclude.h"
+#include "VulkanObjects.h"
+#include "VulkanRenderGraph.h"
+#include "Engine/Core/Math/Math.h"
+#include "Engine/Graphics/RenderSnapshot.h"
+
+#define OCCLUSION_CULL_GROUP_SIZE   uint32_t(64) // local_size_x of ShaderHiZCull.comp
+#define OCCLUSION_BUILD_GROUP_SIZE  uint32_t(8)  // local_size_x/y of ShaderHiZBuild.comp
+#define OCCLUSION_MIN_DRAW_CAPACITY uint32_t(256)
+#define OCCLUSION_MAX_PYRAMID_LEVELS uint32_t(16)
+
+namespace Mega
+{
+	class Vulkan;
+
+	// Layouts match ShaderHiZCull.comp
+	struct OcclusionCullDraw {
+		Mat4x4F model;
+		Vec4F boundsMin;
+		Vec4F boundsMax;
+		uint32_t indexCount;
+		uint32_t firstIndex;
+		uint32_t visible;
+		int32_t vertexOffset;
+	};
+	struct OcclusionCullPush {
+		Mat4x4F viewProj;
+		int32_t pyramidSize[2];
+		uint32_t drawCount;
+		uint32_t phase;
+		uint32_t commandBase;
+		int32_t mipCount;
+		uint32_t pyramidValid;
+	};
+	struct OcclusionCounters {
+		uint32_t drawnFirst;
+		uint32_t drawnSecond;
+		uint32_t occluded;
+	};
+
+	// Hi-Z occlusion culling in two phases around a split scene pass, each step a render graph pass:
+	//  1. HiZCull (phase 0) tests every draw against the pyramid left from last frame, what passes is
+	//     drawn in the first pass
+	//  2. The pyramid is rebuilt from that pass's depth (HiZBuild, one dispatch per level)
+	//  3. HiZCull (phase 1) retests only what phase 0 hid, against the new pyramid. What turns out to be
+	//     visible after all (just came around a corner) is drawn in the second pass, with everything else
+	// Each draw still gets its own push constants, so it is one vkCmdDrawIndexedIndirect per draw with the
+	// GPU deciding the instance count. Disabled (the old single pass) when the shaders arent compiled
+	class OcclusionCuller {
+	public:
+		friend Vulkan;
+
+		void Initialize(Vulkan* v);
+		void Destroy(Vulkan* v);
+
+		// The pyramid follows the swapchain
+		void CreateSwapchainResources(Vulkan* v);
+		void DestroySwapchainResources(Vulkan* v);
+
+		bool IsEnabled() const { return m_cullPipeline != VK_NULL_HANDLE; }
+		// Draws still hidden after the second phase, from the last frame the GPU finished
+		uint32_t GetOccludedCount() const { return m_lastCounters.occluded; }
+		uint32_t GetRecoveredCount() const { return m_lastCounters.drawnSecond; }
+
+	private:
+		// After the frame's fence was waited on, its counters are done
+		void ReadCounters(const size_t in_frame);
+		// in_vertexOffsets is where each draw's vertices start, only skinned draws have one
+		void Upload(Vulkan* v, const size_t in_frame, const std::vector<RenderSnapshotDraw>& in_draws, const std::vector<uint8_t>& in_visible, const std::vector<int32_t>& in_vertexOffsets);
+
+		// Phase 0 comes first, it imports the command and state buffers and the pyramid into the frame's graph
+		void AddCullPass(RenderGraph* io_pGraph, const size_t in_frame, const Mat4x4F& in_viewProj, const uint32_t in_phase);
+		// Between the two scene passes, in_depth is what the first one drew
+		void AddPyramidPass(RenderGraph* io_pGraph, const RenderGraphResource in_depth);
+		// What the scene passes read their indirect draws from
+		RenderGraphResource GetCommandResource() const { return m_commandResource; }
+
+		void RecordCull(VkCommandBuffer in_command, const size_t in_frame, const Mat4x4F& in_viewProj, const uint32_t in_phase);
+		void RecordPyramid(VkCommandBuffer in_command);
+		// Offset of draw in_draw's command in GetCommandBuffer() for in_phase
+		VkDeviceSize GetCommandOffset(const uint32_t in_phase, const uint32_t in_draw) const;
+
+		void CreatePipelines(Vulkan* v);
+		void CreatePyramid(Vulkan* v);
+		void CreateDescriptorSets(Vulkan* v);
+		void CreateDrawBuffers(Vulkan* v, const uint32_t in_capacity);
+		void DestroyDrawBuffers(Vulkan* v);
+		void WriteCullDescriptors(Vulkan* v);
+
+		VkDevice m_device = VK_NULL_HANDLE;
+		uint32_t m_framesInFlight = 0;
+
+		VkShaderModule m_buildShaderModule = VK_NULL_HANDLE;
+		VkShaderModule m_cullShaderModule = VK_NULL_HANDLE;
+		VkDescriptorSetLayout m_buildSetLayout = VK_NULL_HANDLE;
+		VkDescriptorSetLayout m_cullSetLayout = VK_NULL_HANDLE;
+		VkPipelineLayout m_buildPipelineLayout = VK_NULL_HANDLE;
+		VkPipelineLayout m_cullPipelineLayout = VK_NULL_HANDLE;
+		VkPipeline m_buildPipeline = VK_NULL_HANDLE;
+		VkPipeline m_cullPipeline = VK_NULL_HANDLE;
+		VkSampler m_sampler = VK_NULL_HANDLE;
+
+		// Depth pyramid, R32F in GENERAL. One view per level for building, one over all of them for culling
+		VkImage m_pyramidImage = VK_NULL_HANDLE;
+		VkDeviceMemory m_pyramidMemory = VK_NULL_HANDLE;
+		std::vector<VkImageView> m_pyramidLevelViews;
+		VkImageView m_pyramidView = VK_NULL_HANDLE;
+		VkExtent2D m_pyramidExtent = { 0, 0 };
+		VkExtent2D m_depthExtent = { 0, 0 };
+		uint32_t m_depthGeneration = 0; // The graph's transient generation level 0's source was written for, 0 for never
+		uint32_t m_pyramidLevels = 0;
+		bool m_pyramidValid = false; // False until the first build after (re)creation
+
+		VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> m_buildSets; // Per level
+		std::vector<VkDescriptorSet> m_cullSets;  // Per frame in flight
+
+		// Per frame in flight, host written
+		std::vector<VkBuffer> m_drawBuffers;
+		std::vector<VkDeviceMemory> m_drawBuffersMemory;
+		std::vector<void*> m_drawBuffersMapped;
+		std::vector<VkBuffer> m_counterBuffers;
+		std::vector<VkDeviceMemory> m_counterBuffersMemory;
+		std::vector<void*> m_counterBuffersMapped;
+
+		// GPU only, the render graph orders them between passes and frames
+		VkBuffer m_commandBuffer = VK_NULL_HANDLE; // Both phases, phase 1 starts at m_drawCapacity
+		VkDeviceMemory m_commandBufferMemory = VK_NULL_HANDLE;
+		VkBuffer m_stateBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory m_stateBufferMemory = VK_NULL_HANDLE;
+		uint32_t m_drawCapacity = 0;
+		uint32_t m_drawCount = 0;
+
+		// This frame's, set by phase 0
+		RenderGraphResource m_commandResource = RENDER_GRAPH_NO_RESOURCE;
+		RenderGraphResource m_stateResource = RENDER_GRAPH_NO_RESOURCE;
+		RenderGraphResource m_pyramidResource = RENDER_GRAPH_NO_RESOURCE;
+
+		OcclusionCounters m_lastCounters = {};
+	};
+}
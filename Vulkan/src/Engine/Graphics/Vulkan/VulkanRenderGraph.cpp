@@ -0,0 +1,720 @@
+#include "VulkanRenderGraph.h"
+#include "Vulkan.h"
+
+#include <algorithm>
+#include <iostream>
+
+#define RENDER_GRAPH_WRITE_ACCESS (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT)
+
+namespace Mega
+{
+	static VkImageAspectFlags GetAspect(const VkFormat in_format)
+	{
+		switch (in_format) {
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		default:
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+	}
+
+	static uint64_t GetHandleKey(VkImage in_image) { return (uint64_t)in_image; }
+	static uint64_t GetHandleKey(VkBuffer in_buffer) { return (uint64_t)in_buffer; }
+
+	void RenderGraph::Initialize(Vulkan* v)
+	{
+		m_device = v->m_device;
+		m_physicalDevice = v->m_physicalDevice;
+		m_recordedPasses.resize(v->MAX_FRAMES_IN_FLIGHT);
+
+		// Timings are optional, the graph works the same without them
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &familyCount, families.data());
+
+		uint32_t validBits = families[v->m_queueFamilyIndices.graphicsFamily.value()].timestampValidBits;
+		if (validBits == 0 || !v->m_physicalDeviceProperties.limits.timestampComputeAndGraphics) {
+			std::cout << "WARNING: The graphics queue has no timestamps, render graph pass timings are off" << std::endl;
+			return;
+		}
+		m_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+		m_timestampPeriod = v->m_physicalDeviceProperties.limits.timestampPeriod;
+
+		VkQueryPoolCreateInfo queryInfo{};
+		queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryInfo.queryCount = RENDER_GRAPH_MAX_PASSES * 2 * (uint32_t)m_recordedPasses.size();
+
+		VkResult result = vkCreateQueryPool(m_device, &queryInfo, nullptr, &m_queryPool);
+		assert(result == VK_SUCCESS && "ERROR: vkCreateQueryPool() for the render graph did not return success");
+	}
+
+	void RenderGraph::Destroy()
+	{
+		DestroySwapchainResources();
+
+		for (auto& renderPass : m_renderPasses) { vkDestroyRenderPass(m_device, renderPass.second, nullptr); }
+		m_renderPasses.clear();
+
+		if (m_queryPool != VK_NULL_HANDLE) { vkDestroyQueryPool(m_device, m_queryPool, nullptr); }
+		m_queryPool = VK_NULL_HANDLE;
+	}
+
+	void RenderGraph::DestroySwapchainResources()
+	{
+		DestroyTransients();
+
+		// New swapchain images and whatever else was made with them may reuse the old handles
+		m_importedStates.clear();
+		m_passes.clear();
+		m_resources.clear();
+	}
+
+	void RenderGraph::Begin(const size_t in_frame)
+	{
+		m_frame = in_frame;
+		m_passes.clear();
+		m_resources.clear();
+
+		ReadTimings(in_frame);
+	}
+
+	RenderGraphResource RenderGraph::ImportImage(const char* in_name, VkImage in_image, VkImageView in_view, const VkFormat in_format, const VkExtent2D in_extent,
+		const VkImageLayout in_finalLayout, const bool in_discard)
+	{
+		Resource resource;
+		resource.name = in_name;
+		resource.isImage = true;
+		resource.imported = true;
+		resource.image = in_image;
+		resource.view = in_view;
+		resource.info = { in_format, in_extent, 1 };
+		resource.finalLayout = in_finalLayout;
+
+		auto found = m_importedStates.find(GetHandleKey(in_image));
+		if (found != m_importedStates.end()) { resource.state = found->second; }
+		if (in_discard) {
+			resource.state = State();
+			resource.state.writeStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		}
+
+		m_resources.push_back(resource);
+		return (RenderGraphResource)(m_resources.size() - 1);
+	}
+
+	RenderGraphResource RenderGraph::ImportBuffer(const char* in_name, VkBuffer in_buffer)
+	{
+		Resource resource;
+		resource.name = in_name;
+		resource.imported = true;
+		resource.buffer = in_buffer;
+
+		auto found = m_importedStates.find(GetHandleKey(in_buffer));
+		if (found != m_importedStates.end()) { resource.state = found->second; }
+
+		m_resources.push_back(resource);
+		return (RenderGraphResource)(m_resources.size() - 1);
+	}
+
+	RenderGraphResource RenderGraph::CreateImage(const char* in_name, const RenderGraphImageInfo& in_info)
+	{
+		Resource resource;
+		resource.name = in_name;
+		resource.isImage = true;
+		resource.info = in_info;
+
+		m_resources.push_back(resource);
+		return (RenderGraphResource)(m_resources.size() - 1);
+	}
+
+	RenderGraphPass RenderGraph::AddPass(const char* in_name, const eRenderGraphPass in_type, std::function<void(VkCommandBuffer)> in_record)
+	{
+		assert(m_passes.size() < RENDER_GRAPH_MAX_PASSES && "ERROR: Too many render graph passes, raise RENDER_GRAPH_MAX_PASSES");
+
+		Pass pass;
+		pass.name = in_name;
+		pass.type = in_type;
+		pass.record = std::move(in_record);
+
+		m_passes.push_back(std::move(pass));
+		return (RenderGraphPass)(m_passes.size() - 1);
+	}
+
+	void RenderGraph::Use(const RenderGraphPass in_pass, const RenderGraphResource in_resource, const eRenderGraphAccess in_access,
+		const VkAttachmentLoadOp in_loadOp, const VkClearValue in_clear)
+	{
+		assert(in_resource < m_resources.size() && "ERROR: Render graph pass used a resource that was never declared");
+		m_passes[in_pass].uses.push_back({ in_resource, in_access, in_loadOp, in_clear });
+	}
+
+	void RenderGraph::Execute(VkCommandBuffer in_command)
+	{
+		Cull();
+		AllocateTransients();
+
+		uint32_t queryBase = (uint32_t)m_frame * RENDER_GRAPH_MAX_PASSES * 2;
+		if (m_queryPool != VK_NULL_HANDLE) {
+			vkCmdResetQueryPool(in_command, m_queryPool, queryBase, RENDER_GRAPH_MAX_PASSES * 2);
+		}
+
+		std::vector<RenderGraphPassTiming>& recorded = m_recordedPasses[m_frame];
+		recorded.clear();
+
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		for (uint32_t p = 0; p < m_passes.size(); p++) {
+			Pass& pass = m_passes[p];
+
+			RenderGraphPassTiming timing;
+			timing.name = pass.name;
+			timing.culled = !pass.kept;
+			recorded.push_back(timing);
+			if (!pass.kept) { continue; }
+
+			imageBarriers.clear();
+			VkMemoryBarrier memoryBarrier{};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			VkPipelineStageFlags srcStages = 0, dstStages = 0;
+			for (const PassUse& use : pass.uses) {
+				AddBarrier(p, use, &imageBarriers, &memoryBarrier, &srcStages, &dstStages);
+			}
+			if (dstStages != 0) {
+				uint32_t memoryBarrierCount = memoryBarrier.dstAccessMask != 0 ? 1 : 0;
+				vkCmdPipelineBarrier(in_command, srcStages, dstStages, 0, memoryBarrierCount, &memoryBarrier, 0, nullptr,
+					static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+			}
+
+			if (m_queryPool != VK_NULL_HANDLE) { vkCmdWriteTimestamp(in_command, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, queryBase + p * 2); }
+
+			if (pass.type == eRenderGraphPass::Graphics) {
+				BeginRenderPass(in_command, p);
+				pass.record(in_command);
+				vkCmdEndRenderPass(in_command);
+			}
+			else {
+				pass.record(in_command);
+			}
+
+			if (m_queryPool != VK_NULL_HANDLE) { vkCmdWriteTimestamp(in_command, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, queryBase + p * 2 + 1); }
+		}
+
+		// Imported images are left how the rest of the frame expects them (the swapchain image ready to present)
+		imageBarriers.clear();
+		VkPipelineStageFlags srcStages = 0;
+		for (Resource& resource : m_resources) {
+			if (!resource.imported || !resource.isImage) { continue; }
+
+			State& state = resource.state;
+			if (resource.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED && state.layout != resource.finalLayout) {
+				VkImageMemoryBarrier barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				barrier.srcAccessMask = state.writeAccess;
+				barrier.dstAccessMask = 0;
+				barrier.oldLayout = state.layout;
+				barrier.newLayout = resource.finalLayout;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.image = resource.image;
+				barrier.subresourceRange = { GetAspect(resource.info.format), 0, VK_REMAINING_MIP_LEVELS, 0, 1 };
+				imageBarriers.push_back(barrier);
+
+				srcStages |= state.writeStages | state.readStages;
+				state.layout = resource.finalLayout;
+			}
+			m_importedStates[GetHandleKey(resource.image)] = state;
+		}
+		if (!imageBarriers.empty()) {
+			vkCmdPipelineBarrier(in_command, srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+				static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+		}
+
+		for (const Resource& resource : m_resources) {
+			if (resource.imported && !resource.isImage) { m_importedStates[GetHandleKey(resource.buffer)] = resource.state; }
+		}
+	}
+
+	VkImageView RenderGraph::GetLevelView(const RenderGraphResource in_resource, const uint32_t in_level) const
+	{
+		const Resource& resource = m_resources[in_resource];
+		if (resource.transient == RENDER_GRAPH_NO_RESOURCE || resource.info.levels <= 1) { return resource.view; }
+		return m_transients[resource.transient].levelViews[in_level];
+	}
+
+	VkRenderPass RenderGraph::GetCompatibleRenderPass(const std::vector<VkFormat>& in_colorFormats, const VkFormat in_depthFormat)
+	{
+		// Compatibility ignores load and store ops, so any will do
+		std::vector<AttachmentKey> colors;
+		for (VkFormat format : in_colorFormats) { colors.push_back({ format, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE }); }
+		AttachmentKey depth = { in_depthFormat, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE };
+
+		return GetRenderPass(colors, in_depthFormat != VK_FORMAT_UNDEFINED ? &depth : nullptr);
+	}
+
+	RenderGraph::AccessInfo RenderGraph::GetAccessInfo(const Pass& in_pass, const PassUse& in_use) const
+	{
+		bool graphics = in_pass.type == eRenderGraphPass::Graphics;
+		VkPipelineStageFlags imageStage = graphics ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		VkPipelineStageFlags bufferStage = graphics ? VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		bool loads = in_use.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+
+		switch (in_use.access) {
+		case eRenderGraphAccess::ColorAttachment:
+			return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, loads, true };
+		case eRenderGraphAccess::DepthAttachment:
+			return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, loads, true };
+		case eRenderGraphAccess::Sampled: {
+			bool depth = (GetAspect(m_resources[in_use.resource].info.format) & VK_IMAGE_ASPECT_DEPTH_BIT) != 0;
+			return { imageStage, VK_ACCESS_SHADER_READ_BIT, depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true, false };
+		}
+		case eRenderGraphAccess::ImageRead:
+			return { imageStage, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, true, false };
+		case eRenderGraphAccess::ImageWrite:
+			return { imageStage, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true, true };
+		case eRenderGraphAccess::VertexBuffer:
+			return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, true, false };
+		case eRenderGraphAccess::IndirectBuffer:
+			return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, true, false };
+		case eRenderGraphAccess::BufferRead:
+			return { bufferStage, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, true, false };
+		case eRenderGraphAccess::BufferWrite:
+			return { bufferStage, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, true, true };
+		}
+
+		assert(false && "ERROR: Unknown render graph access");
+		return {};
+	}
+
+	void RenderGraph::Cull()
+	{
+		// Walking back from the end: a pass is kept when it writes something imported or something a kept
+		// pass after it reads
+		std::vector<uint8_t> needed(m_resources.size(), 0);
+		for (uint32_t p = (uint32_t)m_passes.size(); p-- > 0;) {
+			Pass& pass = m_passes[p];
+
+			pass.kept = false;
+			for (const PassUse& use : pass.uses) {
+				if (GetAccessInfo(pass, use).writes && (m_resources[use.resource].imported || needed[use.resource])) { pass.kept = true; }
+			}
+			if (!pass.kept) { continue; }
+
+			// What it overwrites without reading isn't needed from the passes before it, what it reads is
+			for (const PassUse& use : pass.uses) {
+				AccessInfo info = GetAccessInfo(pass, use);
+				if (info.writes && !info.reads) { needed[use.resource] = 0; }
+			}
+			for (const PassUse& use : pass.uses) {
+				if (GetAccessInfo(pass, use).reads) { needed[use.resource] = 1; }
+			}
+		}
+	}
+
+	void RenderGraph::AllocateTransients()
+	{
+		// Lifetimes and usage over the kept passes only, culled passes never touch anything
+		for (uint32_t p = 0; p < m_passes.size(); p++) {
+			if (!m_passes[p].kept) { continue; }
+
+			for (const PassUse& use : m_passes[p].uses) {
+				Resource& resource = m_resources[use.resource];
+				resource.firstPass = std::min(resource.firstPass, p);
+				resource.lastPass = p;
+
+				switch (use.access) {
+				case eRenderGraphAccess::ColorAttachment: resource.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; break;
+				case eRenderGraphAccess::DepthAttachment: resource.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; break;
+				case eRenderGraphAccess::Sampled:         resource.usage |= VK_IMAGE_USAGE_SAMPLED_BIT; break;
+				case eRenderGraphAccess::ImageRead:       resource.usage |= VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT; break;
+				case eRenderGraphAccess::ImageWrite:      resource.usage |= VK_IMAGE_USAGE_STORAGE_BIT; break;
+				default: break;
+				}
+			}
+		}
+
+		// By first use, so the greedy aliasing below sees them in the order they come alive
+		std::vector<uint32_t> order;
+		for (uint32_t i = 0; i < m_resources.size(); i++) {
+			if (!m_resources[i].imported && m_resources[i].firstPass != RENDER_GRAPH_NO_RESOURCE) { order.push_back(i); }
+		}
+		std::stable_sort(order.begin(), order.end(), [this](const uint32_t a, const uint32_t b) { return m_resources[a].firstPass < m_resources[b].firstPass; });
+
+		// Which earlier transients each one is alive with rather than pass numbers, so a pass coming and going
+		// elsewhere in the frame doesn't force a reallocation when the aliasing would come out the same
+		std::vector<uint64_t> signature;
+		for (uint32_t t = 0; t < order.size(); t++) {
+			const Resource& resource = m_resources[order[t]];
+			signature.insert(signature.end(), { (uint64_t)resource.info.format, resource.info.extent.width, resource.info.extent.height, resource.info.levels,
+				resource.usage });
+			for (uint32_t earlier = 0; earlier < t; earlier++) {
+				if (m_resources[order[earlier]].lastPass >= resource.firstPass) { signature.push_back(earlier); }
+			}
+			signature.push_back(RENDER_GRAPH_NO_RESOURCE);
+		}
+
+		if (signature != m_transientSignature || m_transients.size() != order.size()) {
+			// Frames in flight may still be using the old ones
+			if (!m_transients.empty()) {
+				vkDeviceWaitIdle(m_device);
+				DestroyTransients();
+			}
+
+			m_transients.resize(order.size());
+			std::vector<VkMemoryRequirements> requirements(order.size());
+			for (uint32_t t = 0; t < order.size(); t++) {
+				const Resource& resource = m_resources[order[t]];
+
+				VkImageCreateInfo imageInfo{};
+				imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+				imageInfo.imageType = VK_IMAGE_TYPE_2D;
+				imageInfo.extent = { resource.info.extent.width, resource.info.extent.height, 1 };
+				imageInfo.mipLevels = resource.info.levels;
+				imageInfo.arrayLayers = 1;
+				imageInfo.format = resource.info.format;
+				imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+				imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				imageInfo.usage = resource.usage;
+				imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+				imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+				VkResult result = vkCreateImage(m_device, &imageInfo, nullptr, &m_transients[t].image);
+				assert(result == VK_SUCCESS && "ERROR: vkCreateImage() for a render graph transient did not return success");
+				vkGetImageMemoryRequirements(m_device, m_transients[t].image, &requirements[t]);
+				m_transientBytes += requirements[t].size;
+
+				// The first block whose last user is done before this one starts. Every image is bound at
+				// offset 0, so any alignment holds
+				uint32_t block = RENDER_GRAPH_NO_RESOURCE;
+				for (uint32_t b = 0; b < m_blocks.size(); b++) {
+					if (m_blocks[b].lastPass < resource.firstPass && FindDeviceLocalMemoryType(m_blocks[b].typeBits & requirements[t].memoryTypeBits) != RENDER_GRAPH_NO_RESOURCE) {
+						block = b;
+						break;
+					}
+				}
+				if (block == RENDER_GRAPH_NO_RESOURCE) {
+					m_blocks.push_back(MemoryBlock());
+					m_blocks.back().typeBits = requirements[t].memoryTypeBits;
+					block = (uint32_t)m_blocks.size() - 1;
+				}
+
+				MemoryBlock& memoryBlock = m_blocks[block];
+				memoryBlock.size = std::max(memoryBlock.size, requirements[t].size);
+				memoryBlock.typeBits &= requirements[t].memoryTypeBits;
+				memoryBlock.lastPass = resource.lastPass;
+				m_transients[t].block = block;
+			}
+
+			for (MemoryBlock& block : m_blocks) {
+				VkMemoryAllocateInfo allocInfo{};
+				allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+				allocInfo.allocationSize = block.size;
+				allocInfo.memoryTypeIndex = FindDeviceLocalMemoryType(block.typeBits);
+
+				VkResult result = vkAllocateMemory(m_device, &allocInfo, nullptr, &block.memory);
+				assert(result == VK_SUCCESS && "ERROR: vkAllocateMemory() for render graph transients did not return success");
+				m_transientAllocatedBytes += block.size;
+			}
+
+			for (uint32_t t = 0; t < order.size(); t++) {
+				const Resource& resource = m_resources[order[t]];
+				Transient& transient = m_transients[t];
+				vkBindImageMemory(m_device, transient.image, m_blocks[transient.block].memory, 0);
+
+				VkImageViewCreateInfo viewInfo{};
+				viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+				viewInfo.image = transient.image;
+				viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+				viewInfo.format = resource.info.format;
+				viewInfo.subresourceRange = { GetAspect(resource.info.format) & ~VK_IMAGE_ASPECT_STENCIL_BIT, 0, resource.info.levels, 0, 1 };
+
+				VkResult result = vkCreateImageView(m_device, &viewInfo, nullptr, &transient.view);
+				assert(result == VK_SUCCESS && "ERROR: vkCreateImageView() for a render graph transient did not return success");
+
+				for (uint32_t level = 0; resource.info.levels > 1 && level < resource.info.levels; level++) {
+					viewInfo.subresourceRange.baseMipLevel = level;
+					viewInfo.subresourceRange.levelCount = 1;
+					transient.levelViews.push_back(VK_NULL_HANDLE);
+					result = vkCreateImageView(m_device, &viewInfo, nullptr, &transient.levelViews.back());
+					assert(result == VK_SUCCESS && "ERROR: vkCreateImageView() for a render graph transient level did not return success");
+				}
+			}
+
+			m_transientSignature = signature;
+			m_transientGeneration++;
+		}
+
+		for (uint32_t t = 0; t < order.size(); t++) {
+			Resource& resource = m_resources[order[t]];
+			resource.transient = t;
+			resource.image = m_transients[t].image;
+			resource.view = m_transients[t].view;
+		}
+	}
+
+	void RenderGraph::DestroyTransients()
+	{
+		// Any of them may hold a transient view, and a new view can come back with the same handle
+		for (auto& framebuffer : m_framebuffers) { vkDestroyFramebuffer(m_device, framebuffer.second, nullptr); }
+		m_framebuffers.clear();
+
+		for (Transient& transient : m_transients) {
+			for (VkImageView view : transient.levelViews) { vkDestroyImageView(m_device, view, nullptr); }
+			vkDestroyImageView(m_device, transient.view, nullptr);
+			vkDestroyImage(m_device, transient.image, nullptr);
+		}
+		for (MemoryBlock& block : m_blocks) { vkFreeMemory(m_device, block.memory, nullptr); }
+
+		m_transients.clear();
+		m_blocks.clear();
+		m_transientSignature.clear();
+		m_transientBytes = 0;
+		m_transientAllocatedBytes = 0;
+	}
+
+	void RenderGraph::AddBarrier(const uint32_t in_pass, const PassUse& in_use, std::vector<VkImageMemoryBarrier>* io_pImageBarriers, VkMemoryBarrier* io_pMemoryBarrier,
+		VkPipelineStageFlags* io_pSrcStages, VkPipelineStageFlags* io_pDstStages)
+	{
+		Resource& resource = m_resources[in_use.resource];
+		State& state = resource.state;
+		AccessInfo info = GetAccessInfo(m_passes[in_pass], in_use);
+
+		// A transient starts out undefined, after whatever used its memory last (an alias, or itself last frame)
+		MemoryBlock* pBlock = resource.transient != RENDER_GRAPH_NO_RESOURCE ? &m_blocks[m_transients[resource.transient].block] : nullptr;
+		if (pBlock != nullptr && resource.firstPass == in_pass) {
+			state = State();
+			state.writeStages = pBlock->stages;
+			state.writeAccess = pBlock->writeAccess;
+			pBlock->stages = 0;
+			pBlock->writeAccess = 0;
+		}
+
+		bool layoutChange = resource.isImage && state.layout != info.layout;
+		bool needed = false;
+		VkPipelineStageFlags srcStages = 0;
+		if (layoutChange || info.writes) {
+			// Write after anything, or a transition (which writes too)
+			srcStages = state.writeStages | state.readStages;
+			needed = layoutChange || srcStages != 0;
+		}
+		else {
+			// Read after a write that hasn't been made visible to this stage yet
+			srcStages = state.writeStages;
+			needed = srcStages != 0 && ((state.visibleStages & info.stages) != info.stages || (state.visibleAccess & info.access) != info.access);
+		}
+
+		if (needed) {
+			if (resource.isImage) {
+				VkImageMemoryBarrier barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				barrier.srcAccessMask = state.writeAccess;
+				barrier.dstAccessMask = info.access;
+				barrier.oldLayout = state.layout;
+				barrier.newLayout = info.layout;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.image = resource.image;
+				barrier.subresourceRange = { GetAspect(resource.info.format), 0, VK_REMAINING_MIP_LEVELS, 0, 1 };
+				io_pImageBarriers->push_back(barrier);
+			}
+			else {
+				io_pMemoryBarrier->srcAccessMask |= state.writeAccess;
+				io_pMemoryBarrier->dstAccessMask |= info.access;
+			}
+			*io_pSrcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			*io_pDstStages |= info.stages;
+		}
+
+		if (info.writes) {
+			state.writeStages = info.stages;
+			state.writeAccess = info.access & RENDER_GRAPH_WRITE_ACCESS;
+			state.readStages = 0;
+			state.visibleStages = 0;
+			state.visibleAccess = 0;
+		}
+		else if (layoutChange) {
+			// The transition is the last write, this read already waited on it
+			state.writeStages = info.stages;
+			state.writeAccess = 0;
+			state.readStages = info.stages;
+			state.visibleStages = info.stages;
+			state.visibleAccess = info.access;
+		}
+		else {
+			state.readStages |= info.stages;
+			if (needed) {
+				state.visibleStages |= info.stages;
+				state.visibleAccess |= info.access;
+			}
+		}
+		if (resource.isImage) { state.layout = info.layout; }
+
+		if (pBlock != nullptr) {
+			pBlock->stages |= info.stages;
+			pBlock->writeAccess |= info.access & RENDER_GRAPH_WRITE_ACCESS;
+		}
+	}
+
+	void RenderGraph::BeginRenderPass(VkCommandBuffer in_command, const uint32_t in_pass)
+	{
+		const Pass& pass = m_passes[in_pass];
+
+		std::vector<AttachmentKey> colors;
+		AttachmentKey depth = {};
+		bool hasDepth = false;
+		std::vector<VkImageView> views;
+		std::vector<VkClearValue> clearValues;
+		VkImageView depthView = VK_NULL_HANDLE;
+		VkClearValue depthClear = {};
+		VkExtent2D extent = { 0, 0 };
+
+		for (const PassUse& use : pass.uses) {
+			if (use.access != eRenderGraphAccess::ColorAttachment && use.access != eRenderGraphAccess::DepthAttachment) { continue; }
+
+			// Transients nothing after this pass touches are never written back
+			const Resource& resource = m_resources[use.resource];
+			VkAttachmentStoreOp storeOp = !resource.imported && resource.lastPass <= in_pass ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+			AttachmentKey key = { resource.info.format, use.loadOp, storeOp };
+
+			assert((extent.width == 0 || (extent.width == resource.info.extent.width && extent.height == resource.info.extent.height)) && "ERROR: Render graph pass attachments differ in size");
+			extent = resource.info.extent;
+
+			if (use.access == eRenderGraphAccess::ColorAttachment) {
+				colors.push_back(key);
+				views.push_back(resource.view);
+				clearValues.push_back(use.clear);
+			}
+			else {
+				depth = key;
+				hasDepth = true;
+				depthView = resource.view;
+				depthClear = use.clear;
+			}
+		}
+		if (hasDepth) {
+			views.push_back(depthView);
+			clearValues.push_back(depthClear);
+		}
+
+		VkRenderPass renderPass = GetRenderPass(colors, hasDepth ? &depth : nullptr);
+
+		std::vector<uint64_t> framebufferKey = { (uint64_t)renderPass, extent.width, extent.height };
+		for (VkImageView view : views) { framebufferKey.push_back((uint64_t)view); }
+
+		VkFramebuffer& framebuffer = m_framebuffers[framebufferKey];
+		if (framebuffer == VK_NULL_HANDLE) {
+			VkFramebufferCreateInfo framebufferInfo{};
+			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			framebufferInfo.renderPass = renderPass;
+			framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+			framebufferInfo.pAttachments = views.data();
+			framebufferInfo.width = extent.width;
+			framebufferInfo.height = extent.height;
+			framebufferInfo.layers = 1;
+
+			VkResult result = vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &framebuffer);
+			assert(result == VK_SUCCESS && "ERROR: vkCreateFramebuffer() for the render graph did not return success");
+		}
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = renderPass;
+		renderPassInfo.framebuffer = framebuffer;
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = extent;
+		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+		renderPassInfo.pClearValues = clearValues.data();
+
+		vkCmdBeginRenderPass(in_command, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	}
+
+	VkRenderPass RenderGraph::GetRenderPass(const std::vector<AttachmentKey>& in_colors, const AttachmentKey* in_pDepth)
+	{
+		std::vector<uint32_t> key = { (uint32_t)in_colors.size() };
+		for (const AttachmentKey& color : in_colors) { key.insert(key.end(), { (uint32_t)color.format, (uint32_t)color.loadOp, (uint32_t)color.storeOp }); }
+		if (in_pDepth != nullptr) { key.insert(key.end(), { (uint32_t)in_pDepth->format, (uint32_t)in_pDepth->loadOp, (uint32_t)in_pDepth->storeOp }); }
+
+		VkRenderPass& renderPass = m_renderPasses[key];
+		if (renderPass != VK_NULL_HANDLE) { return renderPass; }
+
+		// Attachments stay in their attachment layout, the graph's barriers move them in and out of it
+		std::vector<VkAttachmentDescription> attachments;
+		std::vector<VkAttachmentReference> colorRefs;
+		auto addAttachment = [&attachments](const AttachmentKey& in_key, const VkImageLayout in_layout) {
+			VkAttachmentDescription attachment{};
+			attachment.format = in_key.format;
+			attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+			attachment.loadOp = in_key.loadOp;
+			attachment.storeOp = in_key.storeOp;
+			attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachment.initialLayout = in_layout;
+			attachment.finalLayout = in_layout;
+			attachments.push_back(attachment);
+		};
+
+		for (const AttachmentKey& color : in_colors) {
+			colorRefs.push_back({ (uint32_t)attachments.size(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+			addAttachment(color, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		}
+		VkAttachmentReference depthRef = { (uint32_t)attachments.size(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+		if (in_pDepth != nullptr) { addAttachment(*in_pDepth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL); }
+
+		VkSubpassDescription subpass{};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+		subpass.pColorAttachments = colorRefs.data();
+		subpass.pDepthStencilAttachment = in_pDepth != nullptr ? &depthRef : nullptr;
+
+		VkRenderPassCreateInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		renderPassInfo.pAttachments = attachments.data();
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+
+		VkResult result = vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &renderPass);
+		assert(result == VK_SUCCESS && "ERROR: vkCreateRenderPass() for the render graph did not return success");
+		return renderPass;
+	}
+
+	uint32_t RenderGraph::FindDeviceLocalMemoryType(const uint32_t in_typeBits) const
+	{
+		VkPhysicalDeviceMemoryProperties memoryProps;
+		vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memoryProps);
+
+		for (uint32_t i = 0; i < memoryProps.memoryTypeCount; i++) {
+			if ((in_typeBits & (1 << i)) && (memoryProps.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) { return i; }
+		}
+		return RENDER_GRAPH_NO_RESOURCE;
+	}
+
+	void RenderGraph::ReadTimings(const size_t in_frame)
+	{
+		const std::vector<RenderGraphPassTiming>& recorded = m_recordedPasses[in_frame];
+		if (recorded.empty()) { return; }
+
+		m_timings = recorded;
+		if (m_queryPool == VK_NULL_HANDLE) { return; }
+
+		// Value and availability per query, culled passes never wrote theirs
+		std::vector<uint64_t> results(recorded.size() * 4);
+		vkGetQueryPoolResults(m_device, m_queryPool, (uint32_t)in_frame * RENDER_GRAPH_MAX_PASSES * 2, (uint32_t)recorded.size() * 2,
+			results.size() * sizeof(uint64_t), results.data(), sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+		for (size_t p = 0; p < m_timings.size(); p++) {
+			const uint64_t* pBegin = &results[p * 4];
+			const uint64_t* pEnd = &results[p * 4 + 2];
+			if (m_timings[p].culled || pBegin[1] == 0 || pEnd[1] == 0) { continue; }
+
+			uint64_t ticks = ((pEnd[0] & m_timestampMask) - (pBegin[0] & m_timestampMask)) & m_timestampMask;
+			m_timings[p].milliseconds = (float)(ticks * (double)m_timestampPeriod * 1e-6);
+		}
+	}
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "VulkanInclude.h"
+#include "VulkanObjects.h"
+
+#define RENDER_GRAPH_MAX_PASSES   uint32_t(32)         // Per frame, two timestamps each
+#define RENDER_GRAPH_NO_RESOURCE  uint32_t(0xFFFFFFFF) // What a feature that is off hands out instead of a resource
+
+namespace Mega
+{
+	class Vulkan;
+
+	typedef uint32_t RenderGraphResource;
+	typedef uint32_t RenderGraphPass;
+
+	enum class eRenderGraphPass {
+		Graphics, // Recorded inside a render pass the graph begins over its attachments
+		Compute
+	};
+
+	// How a pass touches a resource. Stages, access masks and layouts all follow from it
+	enum class eRenderGraphAccess {
+		ColorAttachment, // Loaded (or cleared) and written
+		DepthAttachment, // Same, depth tested and written
+		Sampled,         // Read through a sampler, SHADER_READ_ONLY (DEPTH_STENCIL_READ_ONLY for depth)
+		ImageRead,       // Storage image or sampled in GENERAL
+		ImageWrite,      // Storage image in GENERAL, read and written
+		VertexBuffer,
+		IndirectBuffer,
+		BufferRead,      // Storage buffer
+		BufferWrite      // Storage buffer, read and written
+	};
+
+	// Transient images are created by the graph, their usage follows from how the passes use them
+	struct RenderGraphImageInfo {
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent = { 0, 0 };
+		uint32_t levels = 1;
+	};
+
+	// Gpu time of one pass, from the frame that last used the same frame in flight
+	struct RenderGraphPassTiming {
+		std::string name;
+		float milliseconds = 0.0f;
+		bool culled = false; // Declared but nothing kept used what it wrote, never recorded
+	};
+
+	// Rebuilt every frame: passes declare what they read and write, then Execute records them in order.
+	//  - Barriers and layout transitions come from those declarations, one vkCmdPipelineBarrier per pass
+	//    at most. Imported resources (swapchain images, persistent buffers) keep their state between
+	//    frames, so work from the last frame on the same queue is waited on too
+	//  - Passes nothing kept reads from are culled, walking back from what they write to imported
+	//    resources
+	//  - Transient images whose passes don't overlap share memory. The graph only reallocates when the
+	//    set of transients changes, and GetTransientGeneration() tells the passes to rewrite descriptors
+	//  - Graphics passes get their render pass and framebuffer from caches, attachments are stored only
+	//    when something after the pass reads them
+	// Tracking is per whole image and per buffer. Passes that depend on themselves (mip chains) still
+	// place their own barriers between levels
+	class RenderGraph {
+	public:
+		friend Vulkan;
+
+		void Initialize(Vulkan* v);
+		void Destroy();
+
+		// Framebuffers and transients reference swapchain sized views
+		void DestroySwapchainResources();
+
+		// After in_frame's fence was waited on, its timestamps are done
+		void Begin(const size_t in_frame);
+
+		// in_finalLayout is what the image is left in at the end of the frame (UNDEFINED leaves it as the
+		// last pass did). in_discard drops whatever was in it before the frame, like a freshly acquired
+		// swapchain image, the first barrier then only waits on COLOR_ATTACHMENT_OUTPUT (where the acquire
+		// semaphore is waited on)
+		RenderGraphResource ImportImage(const char* in_name, VkImage in_image, VkImageView in_view, const VkFormat in_format, const VkExtent2D in_extent,
+			const VkImageLayout in_finalLayout, const bool in_discard);
+		RenderGraphResource ImportBuffer(const char* in_name, VkBuffer in_buffer);
+		RenderGraphResource CreateImage(const char* in_name, const RenderGraphImageInfo& in_info);
+
+		// Passes are recorded in the order they're added, in_record runs inside Execute
+		RenderGraphPass AddPass(const char* in_name, const eRenderGraphPass in_type, std::function<void(VkCommandBuffer)> in_record);
+		// in_loadOp and in_clear only mean something for attachments
+		void Use(const RenderGraphPass in_pass, const RenderGraphResource in_resource, const eRenderGraphAccess in_access,
+			const VkAttachmentLoadOp in_loadOp = VK_ATTACHMENT_LOAD_OP_LOAD, const VkClearValue in_clear = {});
+
+		void Execute(VkCommandBuffer in_command);
+
+		// Valid while passes record, transients change whenever the generation does
+		VkImage GetImage(const RenderGraphResource in_resource) const { return m_resources[in_resource].image; }
+		VkImageView GetImageView(const RenderGraphResource in_resource) const { return m_resources[in_resource].view; }
+		VkImageView GetLevelView(const RenderGraphResource in_resource, const uint32_t in_level) const;
+		uint32_t GetTransientGeneration() const { return m_transientGeneration; }
+
+		const std::vector<RenderGraphPassTiming>& GetTimings() const { return m_timings; }
+		// Summed over every transient, and what they take once aliased
+		uint64_t GetTransientBytes() const { return m_transientBytes; }
+		uint64_t GetTransientAllocatedBytes() const { return m_transientAllocatedBytes; }
+
+		// For pipelines, compatible with what graphics passes with those attachments are recorded in.
+		// Kept until Destroy
+		VkRenderPass GetCompatibleRenderPass(const std::vector<VkFormat>& in_colorFormats, const VkFormat in_depthFormat);
+
+	private:
+		struct PassUse {
+			RenderGraphResource resource;
+			eRenderGraphAccess access;
+			VkAttachmentLoadOp loadOp;
+			VkClearValue clear;
+		};
+		struct Pass {
+			std::string name;
+			eRenderGraphPass type;
+			std::function<void(VkCommandBuffer)> record;
+			std::vector<PassUse> uses;
+			bool kept = false;
+		};
+
+		// What the last accesses to a resource left to wait on
+		struct State {
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags writeStages = 0;
+			VkAccessFlags writeAccess = 0;
+			VkPipelineStageFlags readStages = 0;    // Since the last write
+			VkPipelineStageFlags visibleStages = 0; // The last write was made visible to these
+			VkAccessFlags visibleAccess = 0;
+		};
+		struct Resource {
+			std::string name;
+			bool isImage = false;
+			bool imported = false;
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkBuffer buffer = VK_NULL_HANDLE;
+			RenderGraphImageInfo info;
+			VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkImageUsageFlags usage = 0;
+			uint32_t transient = RENDER_GRAPH_NO_RESOURCE; // Index into m_transients once allocated
+			uint32_t firstPass = RENDER_GRAPH_NO_RESOURCE;
+			uint32_t lastPass = 0;
+			State state;
+		};
+
+		// Live until the set of transients changes
+		struct Transient {
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			std::vector<VkImageView> levelViews;
+			uint32_t block = 0;
+		};
+		// Memory shared by transients that are never alive at once. Whatever touched it last (this frame
+		// or the one before) is waited on before the next one starts using it
+		struct MemoryBlock {
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+			uint32_t typeBits = 0;
+			uint32_t lastPass = 0; // Only meaningful while allocating
+			VkPipelineStageFlags stages = 0;
+			VkAccessFlags writeAccess = 0;
+		};
+
+		struct AccessInfo {
+			VkPipelineStageFlags stages;
+			VkAccessFlags access;
+			VkImageLayout layout;
+			bool reads;  // Needs what was there before
+			bool writes;
+		};
+		AccessInfo GetAccessInfo(const Pass& in_pass, const PassUse& in_use) const;
+
+		void Cull();
+		void AllocateTransients();
+		void DestroyTransients();
+		// Adds what in_use needs to wait on to the pass's barriers and moves the resource's state on
+		void AddBarrier(const uint32_t in_pass, const PassUse& in_use, std::vector<VkImageMemoryBarrier>* io_pImageBarriers, VkMemoryBarrier* io_pMemoryBarrier,
+			VkPipelineStageFlags* io_pSrcStages, VkPipelineStageFlags* io_pDstStages);
+		void BeginRenderPass(VkCommandBuffer in_command, const uint32_t in_pass);
+		void ReadTimings(const size_t in_frame);
+
+		struct AttachmentKey {
+			VkFormat format;
+			VkAttachmentLoadOp loadOp;
+			VkAttachmentStoreOp storeOp;
+		};
+		VkRenderPass GetRenderPass(const std::vector<AttachmentKey>& in_colors, const AttachmentKey* in_pDepth);
+		uint32_t FindDeviceLocalMemoryType(const uint32_t in_typeBits) const;
+
+		VkDevice m_device = VK_NULL_HANDLE;
+		VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+		size_t m_frame = 0;
+
+		std::vector<Pass> m_passes;
+		std::vector<Resource> m_resources;
+
+		// Imported resources between frames, by handle
+		std::unordered_map<uint64_t, State> m_importedStates;
+
+		std::vector<Transient> m_transients;
+		std::vector<MemoryBlock> m_blocks;
+		std::vector<uint64_t> m_transientSignature; // What m_transients were made for
+		uint32_t m_transientGeneration = 0;
+		uint64_t m_transientBytes = 0;
+		uint64_t m_transientAllocatedBytes = 0;
+
+		std::map<std::vector<uint32_t>, VkRenderPass> m_renderPasses;
+		std::map<std::vector<uint64_t>, VkFramebuffer> m_framebuffers;
+
+		// Two timestamps per pass, RENDER_GRAPH_MAX_PASSES passes per frame in flight
+		VkQueryPool m_queryPool = VK_NULL_HANDLE;
+		float m_timestampPeriod = 0.0f; // Nanoseconds per tick
+		uint64_t m_timestampMask = 0;
+		std::vector<std::vector<RenderGraphPassTiming>> m_recordedPasses; // Per frame in flight, waiting on their timestamps
+		std::vector<RenderGraphPassTiming> m_timings;
+	};
+}
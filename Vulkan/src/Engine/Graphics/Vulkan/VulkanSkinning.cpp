@@ -0,0 +1,257 @@
+#include "VulkanSkinning.h"
+#include "Vulkan.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace Mega
+{
+	void Skinner::Initialize(Vulkan* v)
+	{
+		m_device = v->m_device;
+		m_framesInFlight = (uint32_t)v->MAX_FRAMES_IN_FLIGHT;
+
+		// Optional like the occlusion culler, without the shader skinned draws are skipped
+		if (!std::ifstream(SHADER_PATH_SKINNING).good()) {
+			std::cout << "WARNING: Skinning shader (" << SHADER_PATH_SKINNING << ") not found, skinned meshes are not drawn" << std::endl;
+			return;
+		}
+
+		m_shaderModule = v->CreateShaderModule(m_device, v->ReadFile(SHADER_PATH_SKINNING));
+
+		// Source vertices, bone palette, skinned output
+		std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+		for (uint32_t i = 0; i < bindings.size(); i++) {
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		layoutInfo.pBindings = bindings.data();
+
+		VkResult result = vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_setLayout);
+		assert(result == VK_SUCCESS && "ERROR: vkCreateDescriptorSetLayout() for skinning did not return success");
+
+		VkPushConstantRange pushRange{};
+		pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushRange.offset = 0;
+		pushRange.size = sizeof(SkinningPush);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &m_setLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+
+		result = vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout);
+		assert(result == VK_SUCCESS && "ERROR: vkCreatePipelineLayout() for skinning did not return success");
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = m_shaderModule;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = m_pipelineLayout;
+
+		result = vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline);
+		assert(result == VK_SUCCESS && "ERROR: vkCreateComputePipelines() for skinning did not return success");
+
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSize.descriptorCount = m_framesInFlight * static_cast<uint32_t>(bindings.size());
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		poolInfo.maxSets = m_framesInFlight;
+
+		result = vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool);
+		assert(result == VK_SUCCESS && "ERROR: vkCreateDescriptorPool() for skinning did not return success");
+
+		std::vector<VkDescriptorSetLayout> setLayouts(m_framesInFlight, m_setLayout);
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_descriptorPool;
+		allocInfo.descriptorSetCount = m_framesInFlight;
+		allocInfo.pSetLayouts = setLayouts.data();
+
+		m_sets.resize(m_framesInFlight);
+		result = vkAllocateDescriptorSets(m_device, &allocInfo, m_sets.data());
+		assert(result == VK_SUCCESS && "ERROR: vkAllocateDescriptorSets() for skinning did not return success");
+
+		m_outputBuffers.resize(m_framesInFlight, VK_NULL_HANDLE);
+		m_outputBuffersMemory.resize(m_framesInFlight, VK_NULL_HANDLE);
+		m_outputCapacities.resize(m_framesInFlight, 0);
+	}
+
+	void Skinner::Destroy(Vulkan* v)
+	{
+		if (!IsEnabled()) { return; }
+
+		for (size_t i = 0; i < m_outputBuffers.size(); i++) { DestroyOutputBuffer(i); }
+		if (m_sourceBuffer != VK_NULL_HANDLE) {
+			vkDestroyBuffer(m_device, m_sourceBuffer, nullptr);
+			vkFreeMemory(m_device, m_sourceBufferMemory, nullptr);
+			m_sourceBuffer = VK_NULL_HANDLE;
+		}
+
+		vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+		m_sets.clear();
+		vkDestroyPipeline(m_device, m_pipeline, nullptr);
+		vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+		vkDestroyShaderModule(m_device, m_shaderModule, nullptr);
+
+		m_pipeline = VK_NULL_HANDLE;
+	}
+
+	uint32_t Skinner::AppendSource(Vulkan* v, const std::vector<AnimatedVertex>& in_vertices)
+	{
+		uint32_t first = (uint32_t)m_sourceVertices.size();
+		m_sourceVertices.insert(m_sourceVertices.end(), in_vertices.begin(), in_vertices.end());
+		if (!IsEnabled() || m_sourceVertices.empty()) { return first; }
+
+		VkDeviceSize bufferSize = sizeof(AnimatedVertex) * m_sourceVertices.size();
+
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		v->CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+		void* data;
+		vkMapMemory(m_device, stagingBufferMemory, 0, bufferSize, 0, &data);
+		memcpy(data, m_sourceVertices.data(), (size_t)bufferSize);
+		vkUnmapMemory(m_device, stagingBufferMemory);
+
+		if (m_sourceBuffer != VK_NULL_HANDLE) {
+			vkDestroyBuffer(m_device, m_sourceBuffer, nullptr);
+			vkFreeMemory(m_device, m_sourceBufferMemory, nullptr);
+		}
+		v->CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_sourceBuffer, m_sourceBufferMemory);
+
+		v->CopyBuffer(stagingBuffer, m_sourceBuffer, bufferSize);
+
+		vkDestroyBuffer(m_device, stagingBuffer, nullptr);
+		vkFreeMemory(m_device, stagingBufferMemory, nullptr);
+
+		return first;
+	}
+
+	void Skinner::Prepare(Vulkan* v, const size_t in_frame, const std::vector<RenderSnapshotDraw>& in_draws, std::vector<uint8_t>* io_pVisible, std::vector<int32_t>* out_pVertexOffsets)
+	{
+		const uint32_t drawCount = (uint32_t)in_draws.size();
+		out_pVertexOffsets->assign(drawCount, 0);
+		m_dispatches.clear();
+		m_outputCount = 0;
+
+		// Without a palette this frame (no live characters) nothing skinned has a pose to be drawn in
+		const bool canSkin = IsEnabled() && m_sourceBuffer != VK_NULL_HANDLE && v->m_boneBuffers[in_frame] != VK_NULL_HANDLE;
+
+		for (uint32_t i = 0; i < drawCount; i++) {
+			const RenderSnapshotDraw& draw = in_draws[i];
+			if (!draw.vertexData.IsSkinned() || !(*io_pVisible)[i]) { continue; }
+			if (!canSkin) {
+				(*io_pVisible)[i] = 0;
+				continue;
+			}
+
+			SkinningPush push;
+			push.sourceOffset = draw.vertexData.skinVertices[0];
+			push.vertexCount = draw.vertexData.skinVertices[1] - draw.vertexData.skinVertices[0];
+			push.paletteOffset = draw.paletteOffset;
+			push.outputOffset = m_outputCount;
+			m_dispatches.push_back(push);
+
+			(*out_pVertexOffsets)[i] = (int32_t)m_outputCount;
+			m_outputCount += push.vertexCount;
+		}
+		if (m_dispatches.empty()) { return; }
+
+		// This frame's fence was waited on, so its output buffer is free to regrow
+		if (m_outputCount > m_outputCapacities[in_frame]) {
+			uint32_t capacity = std::max(SKINNING_MIN_OUTPUT_VERTICES, m_outputCapacities[in_frame]);
+			while (capacity < m_outputCount) { capacity *= 2; }
+
+			DestroyOutputBuffer(in_frame);
+			CreateOutputBuffer(v, in_frame, capacity);
+		}
+
+		// The palette buffer may have grown since last time, the set isnt in use so just rewrite it
+		WriteDescriptors(v, in_frame);
+	}
+
+	RenderGraphResource Skinner::AddPass(RenderGraph* io_pGraph, const size_t in_frame)
+	{
+		if (m_dispatches.empty()) { return RENDER_GRAPH_NO_RESOURCE; }
+
+		RenderGraphResource output = io_pGraph->ImportBuffer("Skinned vertices", m_outputBuffers[in_frame]);
+		RenderGraphPass pass = io_pGraph->AddPass("Skinning", eRenderGraphPass::Compute, [this, in_frame](VkCommandBuffer in_command) { Record(in_command, in_frame); });
+		io_pGraph->Use(pass, output, eRenderGraphAccess::BufferWrite);
+
+		return output;
+	}
+
+	void Skinner::Record(VkCommandBuffer in_command, const size_t in_frame)
+	{
+		if (m_dispatches.empty()) { return; }
+
+		vkCmdBindPipeline(in_command, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+		vkCmdBindDescriptorSets(in_command, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_sets[in_frame], 0, nullptr);
+
+		for (const SkinningPush& push : m_dispatches) {
+			vkCmdPushConstants(in_command, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SkinningPush), &push);
+			vkCmdDispatch(in_command, (push.vertexCount + SKINNING_GROUP_SIZE - 1) / SKINNING_GROUP_SIZE, 1, 1);
+		}
+	}
+
+	void Skinner::CreateOutputBuffer(Vulkan* v, const size_t in_frame, const uint32_t in_vertexCapacity)
+	{
+		VkDeviceSize size = (VkDeviceSize)in_vertexCapacity * sizeof(Vertex);
+		v->CreateBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			m_outputBuffers[in_frame], m_outputBuffersMemory[in_frame]);
+
+		m_outputCapacities[in_frame] = in_vertexCapacity;
+	}
+
+	void Skinner::DestroyOutputBuffer(const size_t in_frame)
+	{
+		if (m_outputBuffers[in_frame] == VK_NULL_HANDLE) { return; }
+
+		vkDestroyBuffer(m_device, m_outputBuffers[in_frame], nullptr);
+		vkFreeMemory(m_device, m_outputBuffersMemory[in_frame], nullptr);
+
+		m_outputBuffers[in_frame] = VK_NULL_HANDLE;
+		m_outputBuffersMemory[in_frame] = VK_NULL_HANDLE;
+		m_outputCapacities[in_frame] = 0;
+	}
+
+	void Skinner::WriteDescriptors(Vulkan* v, const size_t in_frame)
+	{
+		VkDescriptorBufferInfo sourceInfo = { m_sourceBuffer, 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo paletteInfo = { v->m_boneBuffers[in_frame], 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo outputInfo = { m_outputBuffers[in_frame], 0, VK_WHOLE_SIZE };
+
+		std::array<VkWriteDescriptorSet, 3> writes{};
+		for (uint32_t binding = 0; binding < writes.size(); binding++) {
+			writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[binding].dstSet = m_sets[in_frame];
+			writes[binding].dstBinding = binding;
+			writes[binding].descriptorCount = 1;
+			writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		}
+		writes[0].pBufferInfo = &sourceInfo;
+		writes[1].pBufferInfo = &paletteInfo;
+		writes[2].pBufferInfo = &outputInfo;
+
+		vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+
+#include "VulkanInclude.h"
+#include "VulkanObjects.h"
+#include "VulkanRenderGraph.h"
+#include "Engine/Graphics/Objects/Vertex.h"
+#include "Engine/Graphics/RenderSnapshot.h"
+
+#define SKINNING_GROUP_SIZE          uint32_t(64)      // local_size_x of ShaderSkinning.comp
+#define SKINNING_MIN_OUTPUT_VERTICES uint32_t(1 << 16) // Per frame in flight, grows to fit
+#define SKINNING_BOUNDS_PADDING      0.25f             // Bind pose bounds grow by this much of their size on every side so poses stay inside for culling
+
+namespace Mega
+{
+	class Vulkan;
+
+	// Layout matches ShaderSkinning.comp
+	struct SkinningPush {
+		uint32_t sourceOffset;
+		uint32_t vertexCount;
+		uint32_t paletteOffset;
+		uint32_t outputOffset;
+	};
+
+	// Compute pre-pass that skins every visible skinned draw once per frame, before anything is drawn.
+	// The results land in a per frame buffer laid out like Vertex, so every pass after it (both occlusion
+	// passes, anything else drawing the models) binds that buffer and uses the regular pipelines instead
+	// of skinning again in its own vertex shader. Disabled, with skinned draws hidden, when the shader
+	// isnt compiled
+	class Skinner {
+	public:
+		friend Vulkan;
+
+		void Initialize(Vulkan* v);
+		void Destroy(Vulkan* v);
+
+		bool IsEnabled() const { return m_pipeline != VK_NULL_HANDLE; }
+		// Last frame's, summed over every skinned draw
+		uint32_t GetSkinnedVertexCount() const { return m_outputCount; }
+
+	private:
+		// Adds a mesh's vertices to the source buffer and returns where they start. Replaces the buffer,
+		// so the GPU has to be idle (the renderer's upload lock)
+		uint32_t AppendSource(Vulkan* v, const std::vector<AnimatedVertex>& in_vertices);
+
+		// Gives every visible skinned draw its range of this frame's output buffer. out_pVertexOffsets
+		// gets the offset to draw each one with (0 for everything else). Skinned draws that can't be
+		// skinned this frame are hidden in io_pVisible
+		void Prepare(Vulkan* v, const size_t in_frame, const std::vector<RenderSnapshotDraw>& in_draws, std::vector<uint8_t>* io_pVisible, std::vector<int32_t>* out_pVertexOffsets);
+		// Adds the "Skinning" pass ahead of everything that draws, returns this frame's output buffer for
+		// the passes reading it as vertices. RENDER_GRAPH_NO_RESOURCE when nothing is skinned this frame
+		RenderGraphResource AddPass(RenderGraph* io_pGraph, const size_t in_frame);
+		// Inside that pass, the graph waits on it before the vertices are read
+		void Record(VkCommandBuffer in_command, const size_t in_frame);
+
+		VkBuffer GetOutputBuffer(const size_t in_frame) const { return m_outputBuffers[in_frame]; }
+
+		void CreateOutputBuffer(Vulkan* v, const size_t in_frame, const uint32_t in_vertexCapacity);
+		void DestroyOutputBuffer(const size_t in_frame);
+		void WriteDescriptors(Vulkan* v, const size_t in_frame);
+
+		VkDevice m_device = VK_NULL_HANDLE;
+		uint32_t m_framesInFlight = 0;
+
+		VkShaderModule m_shaderModule = VK_NULL_HANDLE;
+		VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+		VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline m_pipeline = VK_NULL_HANDLE;
+		VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> m_sets; // Per frame in flight, rewritten every frame
+
+		// Every skinned mesh's AnimatedVertices, device local and only replaced while the GPU is idle
+		std::vector<AnimatedVertex> m_sourceVertices;
+		VkBuffer m_sourceBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory m_sourceBufferMemory = VK_NULL_HANDLE;
+
+		// Per frame in flight, written by the pre-pass and read as a vertex buffer
+		std::vector<VkBuffer> m_outputBuffers;
+		std::vector<VkDeviceMemory> m_outputBuffersMemory;
+		std::vector<uint32_t> m_outputCapacities;
+		uint32_t m_outputCount = 0;
+
+		std::vector<SkinningPush> m_dispatches; // This frame's, one per skinned draw
+	};
+}
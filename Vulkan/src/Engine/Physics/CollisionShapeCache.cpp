@@ -0,0 +1,92 @@
+#include "CollisionShapeCache.h"
+
+#include <functional>
+
+#include <Bullet3D/btBulletCollisionCommon.h>
+
+#include "Engine/Core/Debug.h"
+
+namespace Mega
+{
+	CollisionShapeCache& CollisionShapeCache::GetInstance()
+	{
+		static CollisionShapeCache s_instance;
+		return s_instance;
+	}
+
+	btCollisionShape* CollisionShapeCache::AcquireBox(const btVector3& in_halfExtents)
+	{
+		return Acquire({ eCollisionShapeType::Box, { in_halfExtents.getX(), in_halfExtents.getY(), in_halfExtents.getZ() } });
+	}
+
+	btCollisionShape* CollisionShapeCache::AcquireSphere(const btScalar in_radius)
+	{
+		return Acquire({ eCollisionShapeType::Sphere, { in_radius, 0.0, 0.0 } });
+	}
+
+	void CollisionShapeCache::Release(btCollisionShape* in_pShape)
+	{
+		if (in_pShape == nullptr) { return; }
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto keyIt = m_keysByShape.find(in_pShape);
+		MEGA_ASSERT(keyIt != m_keysByShape.end(), "Releasing a collision shape that didnt come from the shape cache");
+		if (keyIt == m_keysByShape.end()) { return; }
+
+		auto entryIt = m_shapes.find(keyIt->second);
+		if (--entryIt->second.refCount == 0) {
+			delete entryIt->second.pShape;
+			m_shapes.erase(entryIt);
+			m_keysByShape.erase(keyIt);
+		}
+	}
+
+	uint32_t CollisionShapeCache::GetUniqueShapeCount()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return (uint32_t)m_shapes.size();
+	}
+
+	btCollisionShape* CollisionShapeCache::Acquire(const ShapeKey& in_key)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		ShapeEntry& entry = m_shapes[in_key];
+		if (entry.pShape == nullptr) {
+			switch (in_key.type) {
+			case (eCollisionShapeType::Box): {
+				btVector3 halfExtents(in_key.params[0], in_key.params[1], in_key.params[2]);
+				btBoxShape* box = new btBoxShape(halfExtents);
+				box->setImplicitShapeDimensions(halfExtents);
+				entry.pShape = box;
+				break;
+			}
+			case (eCollisionShapeType::Sphere): {
+				btScalar radius = in_key.params[0];
+				btSphereShape* sphere = new btSphereShape(radius);
+				sphere->setImplicitShapeDimensions(btVector3(radius, radius, radius));
+				entry.pShape = sphere;
+				break;
+			}
+			default:
+				MEGA_RUNTIME_ERROR("Unknown collision shape type");
+			}
+
+			m_keysByShape[entry.pShape] = in_key;
+		}
+
+		entry.refCount++;
+		return entry.pShape;
+	}
+
+	size_t CollisionShapeCache::ShapeKeyHash::operator()(const ShapeKey& in_key) const
+	{
+		size_t out_hash = std::hash<uint8_t>()((uint8_t)in_key.type);
+		for (btScalar param : in_key.params) {
+			out_hash ^= std::hash<btScalar>()(param) + 0x9e3779b9 + (out_hash << 6) + (out_hash >> 2);
+		}
+
+		return out_hash;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include <Bullet3D/LinearMath/btScalar.h>
+#include <Bullet3D/LinearMath/btVector3.h>
+
+class btCollisionShape;
+
+namespace Mega
+{
+	enum class eCollisionShapeType : uint8_t
+	{
+		Box = 0,
+		Sphere = 1,
+	};
+
+	// Bullet shapes hold no per body state so every body with the same shape parameters can share
+	// one instance. Shapes are reference counted and deleted when the last body releases them
+	class CollisionShapeCache
+	{
+	public:
+		static CollisionShapeCache& GetInstance();
+
+		btCollisionShape* AcquireBox(const btVector3& in_halfExtents);
+		btCollisionShape* AcquireSphere(const btScalar in_radius);
+		void Release(btCollisionShape* in_pShape);
+
+		uint32_t GetUniqueShapeCount();
+
+	private:
+		struct ShapeKey {
+			eCollisionShapeType type;
+			btScalar params[3];
+
+			bool operator==(const ShapeKey& in_other) const {
+				return type == in_other.type && params[0] == in_other.params[0] && params[1] == in_other.params[1] && params[2] == in_other.params[2];
+			}
+		};
+		struct ShapeKeyHash {
+			size_t operator()(const ShapeKey& in_key) const;
+		};
+		struct ShapeEntry {
+			btCollisionShape* pShape = nullptr;
+			uint32_t refCount = 0;
+		};
+
+		btCollisionShape* Acquire(const ShapeKey& in_key);
+
+		std::mutex m_mutex;
+		std::unordered_map<ShapeKey, ShapeEntry, ShapeKeyHash> m_shapes;
+		std::unordered_map<btCollisionShape*, ShapeKey> m_keysByShape;
+	};
+}
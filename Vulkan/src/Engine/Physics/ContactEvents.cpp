@@ -0,0 +1,174 @@
+#include "ContactEvents.h"
+
+#include <algorithm>
+
+#include <GLM/geometric.hpp>
+
+#include <Bullet3D/btBulletCollisionCommon.h>
+
+namespace Mega
+{
+	void ContactEventStream::BeginFrame()
+	{
+		m_stepEvents.clear();
+		m_events.clear();
+		std::fill(m_offsets.begin(), m_offsets.end(), 0u);
+	}
+
+	void ContactEventStream::GatherStep(btDispatcher* in_pDispatcher, const RigidBodyPool* in_pPool)
+	{
+		m_pPool = in_pPool;
+		std::swap(m_previousPairs, m_currentPairs);
+		m_currentPairs.clear();
+
+		// Single pass over the manifolds, only pairs with at least one penetrating point count as touching
+		const int manifoldCount = in_pDispatcher->getNumManifolds();
+		for (int i = 0; i < manifoldCount; i++) {
+			const btPersistentManifold* pManifold = in_pDispatcher->getManifoldByIndexInternal(i);
+			if (pManifold->getNumContacts() == 0) { continue; }
+
+			RigidBodyHandle handleA = RigidBodyPool::GetHandle(pManifold->getBody0());
+			RigidBodyHandle handleB = RigidBodyPool::GetHandle(pManifold->getBody1());
+			if (!handleA.IsValid() && !handleB.IsValid()) { continue; }
+
+			ContactPair pair;
+			for (int p = 0; p < pManifold->getNumContacts(); p++) {
+				const btManifoldPoint& point = pManifold->getContactPoint(p);
+				if (point.getDistance() > btScalar(0.0)) { continue; }
+
+				btVector3 midpoint = (point.getPositionWorldOnA() + point.getPositionWorldOnB()) * btScalar(0.5);
+				pair.point += Vec3F(midpoint.getX(), midpoint.getY(), midpoint.getZ());
+				pair.normalOnB += Vec3F(point.m_normalWorldOnB.getX(), point.m_normalWorldOnB.getY(), point.m_normalWorldOnB.getZ());
+				pair.impulse += (float)point.getAppliedImpulse();
+				pair.pointCount++;
+			}
+			if (pair.pointCount == 0) { continue; }
+
+			// Order the pair by pool index so the same two bodies always produce the same key
+			if (handleB.index < handleA.index) {
+				std::swap(handleA, handleB);
+				pair.normalOnB = -pair.normalOnB;
+			}
+			pair.bodyA = handleA;
+			pair.bodyB = handleB;
+			pair.key = ((uint64_t)handleA.index << 32) | (uint64_t)handleB.index;
+
+			m_currentPairs.push_back(pair);
+		}
+
+		// Compound bodies can have several manifolds for one pair, fold them together
+		std::sort(m_currentPairs.begin(), m_currentPairs.end(), [](const ContactPair& in_a, const ContactPair& in_b) { return in_a.key < in_b.key; });
+
+		size_t writeIndex = 0;
+		for (size_t readIndex = 0; readIndex < m_currentPairs.size(); readIndex++) {
+			if (writeIndex > 0 && m_currentPairs[writeIndex - 1].SameBodies(m_currentPairs[readIndex])) {
+				ContactPair& merged = m_currentPairs[writeIndex - 1];
+				merged.impulse += m_currentPairs[readIndex].impulse;
+				merged.point += m_currentPairs[readIndex].point;
+				merged.normalOnB += m_currentPairs[readIndex].normalOnB;
+				merged.pointCount += m_currentPairs[readIndex].pointCount;
+			}
+			else {
+				m_currentPairs[writeIndex++] = m_currentPairs[readIndex];
+			}
+		}
+		m_currentPairs.resize(writeIndex);
+
+		for (auto& pair : m_currentPairs) {
+			pair.point /= (float)pair.pointCount;
+			float length = glm::length(pair.normalOnB);
+			if (length > 0.0f) { pair.normalOnB /= length; }
+		}
+
+		// Both lists are sorted by key, walk them together to classify every pair
+		size_t current = 0, previous = 0;
+		while (current < m_currentPairs.size() || previous < m_previousPairs.size()) {
+			if (previous == m_previousPairs.size() ||
+				(current < m_currentPairs.size() && m_currentPairs[current].key < m_previousPairs[previous].key)) {
+				EmitPair(eContactEventType::Begin, m_currentPairs[current++]);
+			}
+			else if (current == m_currentPairs.size() || m_previousPairs[previous].key < m_currentPairs[current].key) {
+				ContactPair ended = m_previousPairs[previous++];
+				ended.impulse = 0.0f;
+				EmitPair(eContactEventType::End, ended);
+			}
+			else {
+				// Same slots, but a despawned body whose slot got reused is a different pair
+				if (m_currentPairs[current].SameBodies(m_previousPairs[previous])) {
+					EmitPair(eContactEventType::Persist, m_currentPairs[current]);
+				}
+				else {
+					ContactPair ended = m_previousPairs[previous];
+					ended.impulse = 0.0f;
+					EmitPair(eContactEventType::End, ended);
+					EmitPair(eContactEventType::Begin, m_currentPairs[current]);
+				}
+				current++;
+				previous++;
+			}
+		}
+	}
+
+	void ContactEventStream::EndFrame(const uint32_t in_bodyCapacity)
+	{
+		// Counting sort on the self body's pool index, stable so step order is kept within a body
+		m_offsets.assign((size_t)in_bodyCapacity + 1, 0u);
+		for (const auto& event : m_stepEvents) {
+			if (event.self.index < in_bodyCapacity) { m_offsets[event.self.index + 1]++; }
+		}
+		for (uint32_t i = 0; i < in_bodyCapacity; i++) {
+			m_offsets[i + 1] += m_offsets[i];
+		}
+
+		m_events.resize(m_offsets[in_bodyCapacity]);
+		std::vector<uint32_t> cursor(m_offsets.begin(), m_offsets.end() - 1);
+		for (const auto& event : m_stepEvents) {
+			if (event.self.index < in_bodyCapacity) { m_events[cursor[event.self.index]++] = event; }
+		}
+	}
+
+	ContactEventRange ContactEventStream::GetEvents(const RigidBodyHandle in_body) const
+	{
+		if (!in_body.IsValid() || (size_t)in_body.index + 1 >= m_offsets.size()) { return ContactEventRange(); }
+
+		const uint32_t begin = m_offsets[in_body.index];
+		const uint32_t end = m_offsets[in_body.index + 1];
+
+		// Bucketed by slot, make sure the slot still holds the body that was asked about
+		if (begin == end || !(m_events[begin].self == in_body)) { return ContactEventRange(); }
+
+		return { m_events.data() + begin, m_events.data() + end };
+	}
+
+	bool ContactEventStream::HasContact(const RigidBodyHandle in_bodyA, const RigidBodyHandle in_bodyB) const
+	{
+		for (const auto& event : GetEvents(in_bodyA)) {
+			if (event.other == in_bodyB && event.type != eContactEventType::End) { return true; }
+		}
+
+		return false;
+	}
+
+	void ContactEventStream::EmitPair(const eContactEventType in_type, const ContactPair& in_pair)
+	{
+		ContactEvent event;
+		event.type = in_type;
+		event.impulse = in_pair.impulse;
+		event.point = in_pair.point;
+
+		// Despawned bodies still get End events delivered to whoever they were touching, but never
+		// events of their own, so every per body bucket only ever holds one generation
+		if (m_pPool->Get(in_pair.bodyA) != nullptr) {
+			event.self = in_pair.bodyA;
+			event.other = in_pair.bodyB;
+			event.normal = in_pair.normalOnB; // Bullet's normal on B points towards A
+			m_stepEvents.push_back(event);
+		}
+		if (m_pPool->Get(in_pair.bodyB) != nullptr) {
+			event.self = in_pair.bodyB;
+			event.other = in_pair.bodyA;
+			event.normal = -in_pair.normalOnB;
+			m_stepEvents.push_back(event);
+		}
+	}
+}
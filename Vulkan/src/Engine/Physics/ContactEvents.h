@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Engine/Core/Math/Vec.h"
+#include "Engine/Physics/RigidBodyPool.h"
+
+class btDispatcher;
+
+namespace Mega
+{
+	enum class eContactEventType : uint8_t
+	{
+		Begin = 0,   // The pair started touching this step
+		Persist = 1, // Still touching
+		End = 2,     // Was touching last step and isnt anymore (or one of the bodies was removed)
+	};
+
+	// One event per body per touching pair, written from the point of view of self
+	struct ContactEvent {
+		eContactEventType type = eContactEventType::Begin;
+		RigidBodyHandle self;
+		RigidBodyHandle other;
+
+		float impulse = 0.0f; // Sum of the impulses the solver applied at the contact points this step
+		Vec3F point = Vec3F(0.0f);  // World space, averaged over the contact points
+		Vec3F normal = Vec3F(0.0f); // Points from other into self
+	};
+
+	// Contiguous run of events belonging to one body
+	struct ContactEventRange {
+		const ContactEvent* pBegin = nullptr;
+		const ContactEvent* pEnd = nullptr;
+
+		const ContactEvent* begin() const { return pBegin; }
+		const ContactEvent* end() const { return pEnd; }
+		size_t size() const { return (size_t)(pEnd - pBegin); }
+		bool empty() const { return pBegin == pEnd; }
+	};
+
+	// Reads the dispatcher's manifolds once per physics step and turns them into begin/persist/end
+	// events by diffing the sorted list of touching pairs against the previous step. After the frame's
+	// steps the events are bucketed per body (counting sort keyed by pool index) so asking for a body's
+	// contacts is a single offset lookup
+	class ContactEventStream {
+	public:
+		// Drop the last frame's events, the touching pairs are kept so the next step can diff against them
+		void BeginFrame();
+		void GatherStep(btDispatcher* in_pDispatcher, const RigidBodyPool* in_pPool);
+		void EndFrame(const uint32_t in_bodyCapacity);
+
+		// Everything from this frame's steps, grouped by self body
+		const std::vector<ContactEvent>& GetEvents() const { return m_events; }
+		// What touched in_body during this frame's steps, O(1)
+		ContactEventRange GetEvents(const RigidBodyHandle in_body) const;
+		bool HasContact(const RigidBodyHandle in_bodyA, const RigidBodyHandle in_bodyB) const;
+
+	private:
+		struct ContactPair {
+			uint64_t key = 0; // Lower pool index in the high bits so sorting groups pairs deterministically
+			RigidBodyHandle bodyA;
+			RigidBodyHandle bodyB;
+
+			float impulse = 0.0f;
+			Vec3F point = Vec3F(0.0f);
+			Vec3F normalOnB = Vec3F(0.0f); // Bullet's convention, points from B towards A
+			uint32_t pointCount = 0;
+
+			bool SameBodies(const ContactPair& in_other) const { return key == in_other.key && bodyA == in_other.bodyA && bodyB == in_other.bodyB; }
+		};
+
+		void EmitPair(const eContactEventType in_type, const ContactPair& in_pair);
+
+		const RigidBodyPool* m_pPool = nullptr;
+
+		std::vector<ContactPair> m_currentPairs;
+		std::vector<ContactPair> m_previousPairs;
+
+		std::vector<ContactEvent> m_stepEvents; // Unsorted, filled by GatherStep
+		std::vector<ContactEvent> m_events;     // Bucketed by self body in EndFrame
+		std::vector<uint32_t> m_offsets;        // m_events[m_offsets[i], m_offsets[i + 1]) belongs to pool index i
+	};
+}
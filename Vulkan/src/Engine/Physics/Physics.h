@@ -1,3 +1,9 @@
 #pragma once
 
-#include "Engine/Physics/RigidBody.h"
\ No newline at end of file
+#include "Engine/Physics/RigidBody.h"
+#include "Engine/Physics/PhysicsWorld.h"
+#include "Engine/Physics/RigidBodyPool.h"
+#include "Engine/Physics/ContactEvents.h"
+#include "Engine/Physics/SceneQuery.h"
+#include "Engine/Physics/PhysicsRecorder.h"
+#include "Engine/Physics/PhysicsReplay.h"
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "PhysicsBenchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+#include <Bullet3D/btBulletDynamicsCommon.h>
+
+#include "Engine/Core/ThreadPool.h"
+#include "Engine/Physics/PhysicsWorld.h"
+
+namespace Mega
+{
+	struct PhysicsBenchmarkResult {
+		float averageMs = 0.0f;
+		float p95Ms = 0.0f;
+	};
+
+	static PhysicsBenchmarkResult RunPhysicsBenchmarkCase(const ConstructInfoPhysicsBenchmark& in_info, ThreadPool* in_pThreadPool, const uint32_t in_bodyCount, const uint32_t in_threadCount)
+	{
+		ConstructInfoPhysicsWorld worldInfo;
+		worldInfo.multithreaded = true;
+		worldInfo.threadCount = in_threadCount;
+
+		PhysicsWorld world;
+		world.Initialize(&worldInfo, in_pThreadPool);
+		btDiscreteDynamicsWorld* pWorld = world.GetRawWorld();
+
+		// Every box shares one shape, only the bodies scale with the count
+		btBoxShape groundShape(btVector3(500.0, 1.0, 500.0));
+		btBoxShape boxShape(btVector3(0.5, 0.5, 0.5));
+		btVector3 boxInertia;
+		boxShape.calculateLocalInertia(1.0, boxInertia);
+
+		std::vector<btDefaultMotionState> motionStates;
+		std::vector<btRigidBody*> bodies;
+		motionStates.reserve(in_bodyCount + 1);
+		bodies.reserve(in_bodyCount + 1);
+
+		motionStates.emplace_back(btTransform(btQuaternion::getIdentity(), btVector3(0.0, -1.0, 0.0)));
+		bodies.push_back(new btRigidBody(btRigidBody::btRigidBodyConstructionInfo(0.0, &motionStates.back(), &groundShape)));
+		pWorld->addRigidBody(bodies.back());
+
+		// Square layers of boxes with a small gap so they start apart and pile up as they fall
+		const uint32_t side = (uint32_t)std::ceil(std::cbrt((double)in_bodyCount));
+		for (uint32_t i = 0; i < in_bodyCount; i++) {
+			btVector3 position(
+				(btScalar)(i % side) * 1.1 - side * 0.55,
+				(btScalar)(i / (side * side)) * 1.1 + 1.0,
+				(btScalar)((i / side) % side) * 1.1 - side * 0.55);
+
+			motionStates.emplace_back(btTransform(btQuaternion::getIdentity(), position));
+			bodies.push_back(new btRigidBody(btRigidBody::btRigidBodyConstructionInfo(1.0, &motionStates.back(), &boxShape, boxInertia)));
+			pWorld->addRigidBody(bodies.back());
+		}
+
+		for (uint32_t i = 0; i < in_info.warmupSteps; i++) {
+			world.StepSimulation(in_info.timeStep);
+		}
+
+		std::vector<float> stepTimes(in_info.measuredSteps);
+		for (auto& stepTime : stepTimes) {
+			world.StepSimulation(in_info.timeStep);
+			stepTime = world.GetLastStepTime();
+		}
+
+		PhysicsBenchmarkResult out_result;
+		for (float stepTime : stepTimes) { out_result.averageMs += stepTime; }
+		out_result.averageMs /= (float)std::max<size_t>(stepTimes.size(), 1);
+
+		if (!stepTimes.empty()) {
+			size_t p95 = std::min(stepTimes.size() - 1, (size_t)(0.95f * (float)(stepTimes.size() - 1) + 0.5f));
+			std::nth_element(stepTimes.begin(), stepTimes.begin() + p95, stepTimes.end());
+			out_result.p95Ms = stepTimes[p95];
+		}
+
+		for (auto pBody : bodies) {
+			pWorld->removeRigidBody(pBody);
+			delete pBody;
+		}
+		world.Destroy();
+
+		return out_result;
+	}
+
+	void RunPhysicsBenchmark(const ConstructInfoPhysicsBenchmark* in_pInfo)
+	{
+		ConstructInfoPhysicsBenchmark info = in_pInfo ? *in_pInfo : ConstructInfoPhysicsBenchmark();
+
+		uint32_t maxThreads = info.maxThreads != 0 ? info.maxThreads : std::max(std::thread::hardware_concurrency(), 1u);
+
+		ThreadPool threadPool;
+		threadPool.Initialize(maxThreads - 1);
+
+#if !BT_THREADSAFE
+		std::printf("NOTE: Bullet was built without BT_THREADSAFE, every thread count will step serially\n");
+#endif
+		std::printf("Physics step time, %u warmup + %u measured steps of %.4fs\n", info.warmupSteps, info.measuredSteps, info.timeStep);
+		std::printf("%8s %8s %12s %12s %10s\n", "bodies", "threads", "avg (ms)", "p95 (ms)", "speedup");
+
+		for (uint32_t bodyCount : info.bodyCounts) {
+			float singleThreadedMs = 0.0f;
+			for (uint32_t threads = 1; threads <= maxThreads; threads++) {
+				PhysicsBenchmarkResult result = RunPhysicsBenchmarkCase(info, &threadPool, bodyCount, threads);
+				if (threads == 1) { singleThreadedMs = result.averageMs; }
+
+				std::printf("%8u %8u %12.3f %12.3f %9.2fx\n", bodyCount, threads, result.averageMs, result.p95Ms,
+					result.averageMs > 0.0f ? singleThreadedMs / result.averageMs : 0.0f);
+				std::fflush(stdout);
+			}
+		}
+
+		threadPool.Destroy();
+	}
+}
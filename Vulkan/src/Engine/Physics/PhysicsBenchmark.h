@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Mega
+{
+	struct ConstructInfoPhysicsBenchmark {
+		std::vector<uint32_t> bodyCounts = { 1000, 2500, 5000, 10000, 20000 };
+		uint32_t maxThreads = 0; // 0 = hardware concurrency
+
+		uint32_t warmupSteps = 30;    // Let the pile settle into contact before timing
+		uint32_t measuredSteps = 120;
+		float timeStep = 1.0f / 60.0f;
+	};
+
+	// Headless, no window or renderer. Drops a grid of boxes onto a ground plane and prints the
+	// average and 95th percentile step time for every body count and thread count combination
+	void RunPhysicsBenchmark(const ConstructInfoPhysicsBenchmark* in_pInfo);
+}
@@ -0,0 +1,67 @@
+#include "PhysicsDebugDraw.h"
+
+#include <iostream>
+
+#include <Bullet3D/BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+
+#include "Engine/Graphics/Objects/DebugLines.h"
+
+namespace Mega
+{
+	namespace
+	{
+		inline Vec3F ToVec3F(const btVector3& in_vector) { return Vec3F(in_vector.getX(), in_vector.getY(), in_vector.getZ()); }
+	}
+
+	void PhysicsDebugDraw::drawLine(const btVector3& in_from, const btVector3& in_to, const btVector3& in_color)
+	{
+		m_pLines->AddLine(ToVec3F(in_from), ToVec3F(in_to), ToVec3F(in_color));
+	}
+
+	void PhysicsDebugDraw::drawSphere(btScalar in_radius, const btTransform& in_transform, const btVector3& in_color)
+	{
+		const btMatrix3x3& basis = in_transform.getBasis();
+		Vec3F center = ToVec3F(in_transform.getOrigin());
+		Vec3F axisX = ToVec3F(basis.getColumn(0));
+		Vec3F axisY = ToVec3F(basis.getColumn(1));
+		Vec3F axisZ = ToVec3F(basis.getColumn(2));
+		uint32_t color = DebugLines::PackColor(ToVec3F(in_color));
+
+		// Drawn in the body's frame so spinning spheres visibly spin
+		m_pLines->AddCircle(center, axisX, axisY, (float)in_radius, color);
+		m_pLines->AddCircle(center, axisY, axisZ, (float)in_radius, color);
+		m_pLines->AddCircle(center, axisZ, axisX, (float)in_radius, color);
+	}
+
+	void PhysicsDebugDraw::drawContactPoint(const btVector3& in_pointOnB, const btVector3& in_normalOnB, btScalar /*in_distance*/, int /*in_lifeTime*/, const btVector3& in_color)
+	{
+		m_pLines->AddLine(ToVec3F(in_pointOnB), ToVec3F(in_pointOnB + in_normalOnB * PHYSICS_DEBUG_DRAW_CONTACT_LENGTH), ToVec3F(in_color));
+	}
+
+	void PhysicsDebugDraw::reportErrorWarning(const char* in_warning)
+	{
+		std::cout << "Bullet: " << in_warning << std::endl;
+	}
+
+	void PhysicsDebugDraw::DrawBroadphaseTree(const btDbvtBroadphase* in_pBroadphase, const int in_maxDepth)
+	{
+		for (int set = 0; set < 2; set++) {
+			if (in_pBroadphase->m_sets[set].m_root != nullptr) {
+				DrawTreeNode(in_pBroadphase->m_sets[set].m_root, 0, in_maxDepth);
+			}
+		}
+	}
+
+	void PhysicsDebugDraw::DrawTreeNode(const btDbvtNode* in_pNode, const int in_depth, const int in_maxDepth)
+	{
+		// Root is red, fading to blue towards the leaves
+		float t = in_maxDepth > 0 ? (float)in_depth / (float)in_maxDepth : 0.0f;
+		uint32_t color = DebugLines::PackColor(Vec3F(1.0f - t, 0.2f, t));
+		m_pLines->AddBox(ToVec3F(in_pNode->volume.Mins()), ToVec3F(in_pNode->volume.Maxs()), color);
+
+		if (in_pNode->isinternal() && in_depth < in_maxDepth) {
+			DrawTreeNode(in_pNode->childs[0], in_depth + 1, in_maxDepth);
+			DrawTreeNode(in_pNode->childs[1], in_depth + 1, in_maxDepth);
+		}
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Bullet3D/LinearMath/btIDebugDraw.h>
+
+#define PHYSICS_DEBUG_DRAW_CONTACT_LENGTH 0.25f
+
+class btDbvtBroadphase;
+struct btDbvtNode;
+namespace Mega
+{
+	class DebugLines;
+}
+
+namespace Mega
+{
+	// Feeds Bullet's debugDrawWorld into the frame's DebugLines instead of drawing anything itself.
+	// Spheres are drawn as three circles, Bullet's default sphere patch is over a thousand lines each
+	class PhysicsDebugDraw : public btIDebugDraw {
+	public:
+		void SetLines(DebugLines* in_pLines) { m_pLines = in_pLines; }
+
+		void drawLine(const btVector3& in_from, const btVector3& in_to, const btVector3& in_color) override;
+		void drawSphere(btScalar in_radius, const btTransform& in_transform, const btVector3& in_color) override;
+		void drawContactPoint(const btVector3& in_pointOnB, const btVector3& in_normalOnB, btScalar in_distance, int in_lifeTime, const btVector3& in_color) override;
+		void reportErrorWarning(const char* in_warning) override;
+		void draw3dText(const btVector3& /*in_location*/, const char* /*in_text*/) override {}
+
+		void setDebugMode(int in_debugMode) override { m_debugMode = in_debugMode; }
+		int getDebugMode() const override { return m_debugMode; }
+
+		// Boxes for every node of the broadphase's static and dynamic trees down to in_maxDepth, colored by depth
+		void DrawBroadphaseTree(const btDbvtBroadphase* in_pBroadphase, const int in_maxDepth);
+
+	private:
+		void DrawTreeNode(const btDbvtNode* in_pNode, const int in_depth, const int in_maxDepth);
+
+		DebugLines* m_pLines = nullptr;
+		int m_debugMode = DBG_NoDebug;
+	};
+}
@@ -0,0 +1,171 @@
+#include "PhysicsRecorder.h"
+
+#include <iostream>
+
+#include <Bullet3D/btBulletDynamicsCommon.h>
+
+#include "Engine/Core/Debug.h"
+#include "Engine/Physics/RigidBodyPool.h"
+
+namespace Mega
+{
+	bool PhysicsRecorder::Start(const char* in_filePath, RigidBodyPool* in_pPool, const btVector3& in_gravity, const bool in_multithreaded)
+	{
+		MEGA_ASSERT(!IsRecording(), "Physics recorder is already recording");
+		MEGA_ASSERT(in_pPool->GetLiveCount() == 0, "Physics recording has to start from an empty world or the replay wont match");
+
+		m_file.open(in_filePath, std::ios::binary | std::ios::trunc);
+		if (!m_file.is_open()) {
+			std::cout << "WARNING: Could not open " << in_filePath << " for physics recording" << std::endl;
+			return false;
+		}
+
+		m_pPool = in_pPool;
+		m_idsByPoolIndex.clear();
+		m_nextId = 0;
+		m_stepCount = 0;
+		m_lastTimeStep = 0.0f;
+		m_buffer.clear();
+		m_buffer.reserve(PHYSICS_RECORD_FLUSH_SIZE * 2);
+
+		PhysicsRecordHeader header;
+		header.multithreaded = in_multithreaded ? 1 : 0;
+		header.gravity[0] = (float)in_gravity.getX();
+		header.gravity[1] = (float)in_gravity.getY();
+		header.gravity[2] = (float)in_gravity.getZ();
+		Write(header);
+
+		return true;
+	}
+
+	void PhysicsRecorder::Stop()
+	{
+		if (!IsRecording()) { return; }
+
+		// Always end on a checksum so the replay can confirm it reached the same final state
+		if (m_stepCount % PHYSICS_RECORD_CHECKSUM_INTERVAL != 0) {
+			Write(ePhysicsRecordType::Checksum);
+			Write(ComputeChecksum(*m_pPool));
+		}
+
+		Flush();
+		m_file.close();
+		m_pPool = nullptr;
+
+		std::cout << "Physics recording stopped after " << m_stepCount << " steps" << std::endl;
+	}
+
+	void PhysicsRecorder::RecordSpawn(const uint32_t in_poolIndex, const ConstructInfoRigidBody3D* in_pBodyInfo, const ConstructInfoCollisionShape* const* in_ppShapeInfos, const uint32_t in_shapeCount)
+	{
+		if (m_idsByPoolIndex.size() <= in_poolIndex) { m_idsByPoolIndex.resize((size_t)in_poolIndex + 1, PHYSICS_RECORD_INVALID_ID); }
+		m_idsByPoolIndex[in_poolIndex] = m_nextId;
+
+		Write(ePhysicsRecordType::Spawn);
+		Write(m_nextId++);
+
+		WriteVector(in_pBodyInfo->globalPosition);
+		WriteVector(in_pBodyInfo->rotation);
+		Write(in_pBodyInfo->mass);
+		Write(in_pBodyInfo->friction);
+		Write(in_pBodyInfo->restitution);
+
+		Write(in_shapeCount);
+		for (uint32_t i = 0; i < in_shapeCount; i++) {
+			const ConstructInfoCollisionShape* pShape = in_ppShapeInfos[i];
+			eCollisionShapeType type = pShape->GetShapeType();
+
+			Write(type);
+			WriteVector(pShape->localPosition);
+			WriteVector(pShape->rotation);
+			switch (type) {
+			case (eCollisionShapeType::Box):
+				WriteVector(static_cast<const ConstructInfoCollisionBox*>(pShape)->dimensions);
+				break;
+			case (eCollisionShapeType::Sphere):
+				Write(static_cast<const ConstructInfoCollisionSphere*>(pShape)->radius);
+				break;
+			default:
+				MEGA_RUNTIME_ERROR("Physics recorder doesnt know this collision shape type");
+			}
+		}
+	}
+
+	void PhysicsRecorder::RecordDestroy(const uint32_t in_poolIndex)
+	{
+		MEGA_ASSERT(in_poolIndex < m_idsByPoolIndex.size() && m_idsByPoolIndex[in_poolIndex] != PHYSICS_RECORD_INVALID_ID, "Recording the destruction of a body that was never recorded");
+
+		Write(ePhysicsRecordType::Destroy);
+		Write(m_idsByPoolIndex[in_poolIndex]);
+		m_idsByPoolIndex[in_poolIndex] = PHYSICS_RECORD_INVALID_ID;
+	}
+
+	void PhysicsRecorder::RecordInput(const ePhysicsRecordType in_type, const uint32_t in_poolIndex, const btVector3& in_value)
+	{
+		MEGA_ASSERT(in_poolIndex < m_idsByPoolIndex.size() && m_idsByPoolIndex[in_poolIndex] != PHYSICS_RECORD_INVALID_ID, "Recording input for a body that was never recorded");
+
+		Write(in_type);
+		Write(m_idsByPoolIndex[in_poolIndex]);
+		WriteVector(in_value);
+	}
+
+	void PhysicsRecorder::RecordStep(const float in_timeStep)
+	{
+		if (in_timeStep != m_lastTimeStep) {
+			Write(ePhysicsRecordType::TimeStep);
+			Write(in_timeStep);
+			m_lastTimeStep = in_timeStep;
+		}
+
+		Write(ePhysicsRecordType::Step);
+		m_stepCount++;
+
+		if (m_stepCount % PHYSICS_RECORD_CHECKSUM_INTERVAL == 0) {
+			Write(ePhysicsRecordType::Checksum);
+			Write(ComputeChecksum(*m_pPool));
+		}
+
+		if (m_buffer.size() >= PHYSICS_RECORD_FLUSH_SIZE) { Flush(); }
+	}
+
+	uint64_t PhysicsRecorder::ComputeChecksum(RigidBodyPool& in_pool)
+	{
+		// FNV-1a over the raw bits, any difference at all (even the last float bit) changes the hash
+		uint64_t out_hash = 0xcbf29ce484222325ull;
+		auto hashBytes = [&out_hash](const void* in_pData, const size_t in_size) {
+			const uint8_t* pBytes = static_cast<const uint8_t*>(in_pData);
+			for (size_t i = 0; i < in_size; i++) {
+				out_hash ^= pBytes[i];
+				out_hash *= 0x100000001b3ull;
+			}
+		};
+
+		in_pool.ForEach([&hashBytes](RigidBody3D& in_body, const RigidBodyHandle in_handle) {
+			const btRigidBody* pBody = in_body.GetRawRigidBody();
+			const btTransform& transform = pBody->getWorldTransform();
+			btQuaternion rotation = transform.getRotation();
+
+			hashBytes(&in_handle.index, sizeof(in_handle.index));
+			hashBytes(transform.getOrigin().m_floats, sizeof(btScalar) * 3);
+			hashBytes(&rotation[0], sizeof(btScalar) * 4);
+			hashBytes(pBody->getLinearVelocity().m_floats, sizeof(btScalar) * 3);
+			hashBytes(pBody->getAngularVelocity().m_floats, sizeof(btScalar) * 3);
+		});
+
+		return out_hash;
+	}
+
+	void PhysicsRecorder::WriteVector(const btVector3& in_value)
+	{
+		Write(in_value.getX());
+		Write(in_value.getY());
+		Write(in_value.getZ());
+	}
+
+	void PhysicsRecorder::Flush()
+	{
+		if (m_buffer.empty()) { return; }
+
+		m_file.write(reinterpret_cast<const char*>(m_buffer.data()), (std::streamsize)m_buffer.size());
+		m_buffer.clear();
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <Bullet3D/LinearMath/btScalar.h>
+#include <Bullet3D/LinearMath/btVector3.h>
+
+#define PHYSICS_RECORD_MAGIC              uint32_t(0x5248504D) // "MPHR"
+#define PHYSICS_RECORD_VERSION            uint16_t(2) // 2: shape counts are 32 bit
+#define PHYSICS_RECORD_CHECKSUM_INTERVAL  uint32_t(30) // Steps between state checksums, how finely a divergence can be pinned down
+#define PHYSICS_RECORD_FLUSH_SIZE         size_t(1 << 16)
+#define PHYSICS_RECORD_INVALID_ID         uint32_t(0xFFFFFFFF)
+
+namespace Mega
+{
+	struct ConstructInfoRigidBody3D;
+	struct ConstructInfoCollisionShape;
+	class RigidBodyPool;
+}
+
+namespace Mega
+{
+	// Every record is one type byte followed by its payload, nothing is padded or aligned
+	enum class ePhysicsRecordType : uint8_t
+	{
+		Spawn = 0,           // id, body info, shape count, shapes
+		Destroy = 1,         // id
+		LinearForce = 2,     // id, vec3
+		LinearImpulse = 3,   // id, vec3
+		RotationalForce = 4, // id, vec3
+		SetPosition = 5,     // id, vec3
+		TimeStep = 6,        // float, only written when the step length changes
+		Step = 7,            // Everything since the previous Step is applied, then the world steps once
+		Checksum = 8,        // uint64 hash of every live body's state right after the preceding Step
+	};
+
+	struct PhysicsRecordHeader {
+		uint32_t magic = PHYSICS_RECORD_MAGIC;
+		uint16_t version = PHYSICS_RECORD_VERSION;
+		uint8_t scalarSize = sizeof(btScalar); // Vectors are stored as raw btScalars, a float build cant replay a double log
+		uint8_t multithreaded = 0;
+		float gravity[3] = { 0.0f, 0.0f, 0.0f };
+	};
+
+	// Captures every input that reaches pooled bodies (spawns, despawns, forces, impulses, teleports)
+	// one fixed step at a time into a compact binary log that RunPhysicsReplay can play back headless.
+	// Bodies are named by spawn order so the log doesnt depend on pool slots. Anything that pokes the
+	// btRigidBody directly (GetRawRigidBody()) goes around the recorder and wont be replayed
+	class PhysicsRecorder {
+	public:
+		bool Start(const char* in_filePath, RigidBodyPool* in_pPool, const btVector3& in_gravity, const bool in_multithreaded);
+		void Stop();
+		bool IsRecording() const { return m_file.is_open(); }
+
+		void RecordSpawn(const uint32_t in_poolIndex, const ConstructInfoRigidBody3D* in_pBodyInfo, const ConstructInfoCollisionShape* const* in_ppShapeInfos, const uint32_t in_shapeCount);
+		void RecordDestroy(const uint32_t in_poolIndex);
+		void RecordInput(const ePhysicsRecordType in_type, const uint32_t in_poolIndex, const btVector3& in_value);
+		// Call right after every fixed step
+		void RecordStep(const float in_timeStep);
+
+		uint32_t GetStepCount() const { return m_stepCount; }
+
+		// Order dependent hash of the position, rotation and velocities of every live body, bit exact
+		static uint64_t ComputeChecksum(RigidBodyPool& in_pool);
+
+	private:
+		template<typename T>
+		void Write(const T& in_value) {
+			const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(&in_value);
+			m_buffer.insert(m_buffer.end(), pBytes, pBytes + sizeof(T));
+		}
+		void WriteVector(const btVector3& in_value);
+		void Flush();
+
+		std::ofstream m_file;
+		std::vector<uint8_t> m_buffer;
+		RigidBodyPool* m_pPool = nullptr;
+
+		std::vector<uint32_t> m_idsByPoolIndex;
+		uint32_t m_nextId = 0;
+		uint32_t m_stepCount = 0;
+		float m_lastTimeStep = 0.0f;
+	};
+}
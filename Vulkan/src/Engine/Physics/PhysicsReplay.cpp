@@ -0,0 +1,236 @@
+#include "PhysicsReplay.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include <Bullet3D/btBulletDynamicsCommon.h>
+
+#include "Engine/Core/ThreadPool.h"
+#include "Engine/Physics/PhysicsWorld.h"
+#include "Engine/Physics/RigidBodyPool.h"
+#include "Engine/Physics/PhysicsRecorder.h"
+
+namespace Mega
+{
+	// Cursor over the whole log, any read past the end just flags the log as truncated
+	class PhysicsRecordReader {
+	public:
+		PhysicsRecordReader(const std::vector<uint8_t>& in_data) : m_data(in_data) {}
+
+		template<typename T>
+		T Read() {
+			T out_value{};
+			if (m_offset + sizeof(T) > m_data.size()) { m_truncated = true; m_offset = m_data.size(); return out_value; }
+
+			std::memcpy(&out_value, m_data.data() + m_offset, sizeof(T));
+			m_offset += sizeof(T);
+			return out_value;
+		}
+		btVector3 ReadVector() {
+			btScalar x = Read<btScalar>();
+			btScalar y = Read<btScalar>();
+			btScalar z = Read<btScalar>();
+			return btVector3(x, y, z);
+		}
+
+		bool AtEnd() const { return m_offset >= m_data.size(); }
+		bool IsTruncated() const { return m_truncated; }
+		size_t GetRemaining() const { return m_data.size() - m_offset; }
+		void MarkTruncated() { m_truncated = true; m_offset = m_data.size(); }
+
+	private:
+		const std::vector<uint8_t>& m_data;
+		size_t m_offset = 0;
+		bool m_truncated = false;
+	};
+
+	static RigidBodyHandle ReplaySpawn(PhysicsRecordReader& in_reader, RigidBodyPool& in_pool)
+	{
+		ConstructInfoRigidBody3D bodyInfo;
+		bodyInfo.globalPosition = in_reader.ReadVector();
+		bodyInfo.rotation = in_reader.ReadVector();
+		bodyInfo.mass = in_reader.Read<btScalar>();
+		bodyInfo.friction = in_reader.Read<btScalar>();
+		bodyInfo.restitution = in_reader.Read<btScalar>();
+
+		// Every shape takes at least its type and two vectors, a count the rest of the file can't hold is corrupt
+		uint32_t shapeCount = in_reader.Read<uint32_t>();
+		if (shapeCount > in_reader.GetRemaining() / (sizeof(eCollisionShapeType) + sizeof(btScalar) * 6)) {
+			in_reader.MarkTruncated();
+			return RigidBodyHandle();
+		}
+		std::vector<ConstructInfoCollisionBox> boxes;
+		std::vector<ConstructInfoCollisionSphere> spheres;
+		boxes.reserve(shapeCount);
+		spheres.reserve(shapeCount);
+
+		std::vector<ConstructInfoCollisionShape*> shapes;
+		for (uint32_t i = 0; i < shapeCount; i++) {
+			eCollisionShapeType type = in_reader.Read<eCollisionShapeType>();
+			btVector3 localPosition = in_reader.ReadVector();
+			btVector3 rotation = in_reader.ReadVector();
+
+			ConstructInfoCollisionShape* pShape = nullptr;
+			if (type == eCollisionShapeType::Box) {
+				boxes.emplace_back();
+				boxes.back().dimensions = in_reader.ReadVector();
+				pShape = &boxes.back();
+			}
+			else {
+				spheres.emplace_back();
+				spheres.back().radius = in_reader.Read<btScalar>();
+				pShape = &spheres.back();
+			}
+
+			pShape->localPosition = localPosition;
+			pShape->rotation = rotation;
+			shapes.push_back(pShape);
+		}
+
+		// Same overload the recording went through so the body ends up built the same way
+		return shapes.size() == 1 ? in_pool.Create(&bodyInfo, shapes[0]) : in_pool.Create(&bodyInfo, shapes);
+	}
+
+	bool RunPhysicsReplay(const ConstructInfoPhysicsReplay* in_pInfo)
+	{
+		std::ifstream file(in_pInfo->filePath, std::ios::binary);
+		if (!file.is_open()) {
+			std::printf("ERROR: Could not open physics recording %s\n", in_pInfo->filePath);
+			return false;
+		}
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		PhysicsRecordReader reader(data);
+
+		PhysicsRecordHeader header = reader.Read<PhysicsRecordHeader>();
+		if (reader.IsTruncated() || header.magic != PHYSICS_RECORD_MAGIC || header.version != PHYSICS_RECORD_VERSION) {
+			std::printf("ERROR: %s is not a physics recording this build can read\n", in_pInfo->filePath);
+			return false;
+		}
+		if (header.scalarSize != sizeof(btScalar)) {
+			std::printf("ERROR: %s was recorded with %u byte scalars, this build uses %u\n", in_pInfo->filePath, header.scalarSize, (uint32_t)sizeof(btScalar));
+			return false;
+		}
+		if (header.multithreaded != 0 || in_pInfo->multithreaded) {
+			std::printf("NOTE: Recording or replay is multithreaded, checksums may legitimately differ\n");
+		}
+
+		uint32_t threadCount = in_pInfo->threadCount != 0 ? in_pInfo->threadCount : std::max(std::thread::hardware_concurrency(), 1u);
+		ThreadPool threadPool;
+		threadPool.Initialize(in_pInfo->multithreaded ? threadCount - 1 : 0);
+
+		ConstructInfoPhysicsWorld worldInfo;
+		worldInfo.gravity = btVector3(header.gravity[0], header.gravity[1], header.gravity[2]);
+		worldInfo.multithreaded = in_pInfo->multithreaded;
+		worldInfo.threadCount = threadCount;
+
+		PhysicsWorld world;
+		world.Initialize(&worldInfo, &threadPool);
+		RigidBodyPool pool;
+		pool.Initialize(world.GetRawWorld());
+
+		std::vector<RigidBodyHandle> handlesById;
+		std::vector<float> stepTimes;
+		float timeStep = 1.0f / 60.0f;
+		uint32_t checksumCount = 0;
+		int64_t firstDivergentStep = -1;
+		bool corrupt = false;
+
+		auto getBody = [&](const uint32_t in_id) -> RigidBody3D* {
+			RigidBody3D* pBody = in_id < handlesById.size() ? pool.Get(handlesById[in_id]) : nullptr;
+			if (pBody == nullptr) { corrupt = true; }
+			return pBody;
+		};
+
+		while (!reader.AtEnd() && !reader.IsTruncated() && !corrupt) {
+			ePhysicsRecordType type = reader.Read<ePhysicsRecordType>();
+
+			switch (type) {
+			case (ePhysicsRecordType::Spawn): {
+				uint32_t id = reader.Read<uint32_t>();
+				if (handlesById.size() <= id) { handlesById.resize((size_t)id + 1); }
+				handlesById[id] = ReplaySpawn(reader, pool);
+				break;
+			}
+			case (ePhysicsRecordType::Destroy): {
+				uint32_t id = reader.Read<uint32_t>();
+				if (getBody(id) != nullptr) { pool.Release(handlesById[id]); }
+				break;
+			}
+			case (ePhysicsRecordType::LinearForce):
+			case (ePhysicsRecordType::LinearImpulse):
+			case (ePhysicsRecordType::RotationalForce):
+			case (ePhysicsRecordType::SetPosition): {
+				uint32_t id = reader.Read<uint32_t>();
+				btVector3 value = reader.ReadVector();
+
+				RigidBody3D* pBody = getBody(id);
+				if (pBody == nullptr) { break; }
+
+				if (type == ePhysicsRecordType::LinearForce) { pBody->ApplyLinearForce(value); }
+				else if (type == ePhysicsRecordType::LinearImpulse) { pBody->ApplyLinearImpulse(value); }
+				else if (type == ePhysicsRecordType::RotationalForce) { pBody->ApplyRotationalForce(value); }
+				else { pBody->SetPosition(value); }
+				break;
+			}
+			case (ePhysicsRecordType::TimeStep):
+				timeStep = reader.Read<float>();
+				break;
+			case (ePhysicsRecordType::Step):
+				pool.BeginStep();
+				world.StepSimulation(timeStep);
+				pool.EndStep();
+				stepTimes.push_back(world.GetLastStepTime());
+				break;
+			case (ePhysicsRecordType::Checksum): {
+				uint64_t recorded = reader.Read<uint64_t>();
+				checksumCount++;
+				if (firstDivergentStep < 0 && recorded != PhysicsRecorder::ComputeChecksum(pool)) {
+					firstDivergentStep = (int64_t)stepTimes.size();
+				}
+				break;
+			}
+			default:
+				corrupt = true;
+			}
+		}
+
+		// Timings
+		std::vector<uint32_t> order(stepTimes.size());
+		for (uint32_t i = 0; i < (uint32_t)order.size(); i++) { order[i] = i; }
+		std::sort(order.begin(), order.end(), [&stepTimes](const uint32_t in_a, const uint32_t in_b) { return stepTimes[in_a] > stepTimes[in_b]; });
+
+		float totalMs = 0.0f;
+		for (float stepTime : stepTimes) { totalMs += stepTime; }
+
+		std::printf("Replayed %u steps of %s (%s, %u threads)\n", (uint32_t)stepTimes.size(), in_pInfo->filePath,
+			world.IsMultithreaded() ? "multithreaded" : "single threaded", world.GetThreadCount());
+		if (!stepTimes.empty()) {
+			size_t p95 = std::min(order.size() - 1, (size_t)(0.05f * (float)(order.size() - 1) + 0.5f));
+			std::printf("Step time avg %.3f ms, p95 %.3f ms, max %.3f ms, total %.1f ms\n",
+				totalMs / (float)stepTimes.size(), stepTimes[order[p95]], stepTimes[order[0]], totalMs);
+
+			std::printf("Slowest steps:");
+			for (uint32_t i = 0; i < std::min(in_pInfo->slowestStepsShown, (uint32_t)order.size()); i++) {
+				std::printf(" #%u (%.3f ms)", order[i] + 1, stepTimes[order[i]]);
+			}
+			std::printf("\n");
+		}
+
+		bool out_success = !corrupt && !reader.IsTruncated() && firstDivergentStep < 0;
+		if (corrupt || reader.IsTruncated()) { std::printf("ERROR: Recording is corrupt or truncated, stopped after step %u\n", (uint32_t)stepTimes.size()); }
+		else if (firstDivergentStep >= 0) { std::printf("DIVERGED: State no longer matches the recording by step %lld\n", (long long)firstDivergentStep); }
+		else { std::printf("Deterministic: all %u checksums matched\n", checksumCount); }
+		std::fflush(stdout);
+
+		pool.Destroy();
+		world.Destroy();
+		threadPool.Destroy();
+
+		return out_success;
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Mega
+{
+	struct ConstructInfoPhysicsReplay {
+		const char* filePath = nullptr;
+
+		// Exact reproduction is only promised single threaded, the Mt world is here for timing runs
+		bool multithreaded = false;
+		uint32_t threadCount = 0; // 0 = hardware concurrency
+		uint32_t slowestStepsShown = 5;
+	};
+
+	// Headless, no window or renderer. Plays a PhysicsRecorder log back into a fresh world, checks the
+	// recorded state checksums and prints step timings plus the slowest steps so a regression can be
+	// bisected down to the steps that got slower. Returns false when the log cant be read or the
+	// simulation diverged from the recording
+	bool RunPhysicsReplay(const ConstructInfoPhysicsReplay* in_pInfo);
+}
@@ -0,0 +1,49 @@
+#include "PhysicsTaskScheduler.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include "Engine/Core/ThreadPool.h"
+
+namespace Mega
+{
+	PhysicsTaskScheduler::PhysicsTaskScheduler(ThreadPool* in_pThreadPool)
+		: btITaskScheduler("MegaThreadPool"), m_pThreadPool(in_pThreadPool)
+	{
+		m_threadCount = getMaxNumThreads();
+	}
+
+	int PhysicsTaskScheduler::getMaxNumThreads() const
+	{
+		return std::min((int)m_pThreadPool->GetThreadCount(), (int)BT_MAX_THREAD_COUNT);
+	}
+
+	void PhysicsTaskScheduler::setNumThreads(int in_numThreads)
+	{
+		m_threadCount = std::max(1, std::min(in_numThreads, getMaxNumThreads()));
+	}
+
+	void PhysicsTaskScheduler::parallelFor(int in_begin, int in_end, int in_grainSize, const btIParallelForBody& in_body)
+	{
+		m_pThreadPool->ParallelFor((uint32_t)in_begin, (uint32_t)in_end, (uint32_t)std::max(in_grainSize, 1),
+			[&in_body](const uint32_t in_chunkBegin, const uint32_t in_chunkEnd) {
+				in_body.forLoop((int)in_chunkBegin, (int)in_chunkEnd);
+			}, (uint32_t)m_threadCount);
+	}
+
+	btScalar PhysicsTaskScheduler::parallelSum(int in_begin, int in_end, int in_grainSize, const btIParallelSumBody& in_body)
+	{
+		std::mutex sumMutex;
+		btScalar out_sum = btScalar(0);
+
+		m_pThreadPool->ParallelFor((uint32_t)in_begin, (uint32_t)in_end, (uint32_t)std::max(in_grainSize, 1),
+			[&in_body, &sumMutex, &out_sum](const uint32_t in_chunkBegin, const uint32_t in_chunkEnd) {
+				btScalar partial = in_body.sumLoop((int)in_chunkBegin, (int)in_chunkEnd);
+
+				std::lock_guard<std::mutex> lock(sumMutex);
+				out_sum += partial;
+			}, (uint32_t)m_threadCount);
+
+		return out_sum;
+	}
+}
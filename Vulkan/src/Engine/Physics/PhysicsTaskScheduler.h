@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Bullet3D/LinearMath/btThreads.h>
+
+namespace Mega
+{
+	class ThreadPool;
+}
+
+namespace Mega
+{
+	// Lets Bullet's btParallelFor/btParallelSum run on the engine thread pool instead of
+	// spinning up its own threads
+	class PhysicsTaskScheduler : public btITaskScheduler
+	{
+	public:
+		PhysicsTaskScheduler(ThreadPool* in_pThreadPool);
+
+		int getMaxNumThreads() const override;
+		int getNumThreads() const override { return m_threadCount; }
+		void setNumThreads(int in_numThreads) override;
+
+		void parallelFor(int in_begin, int in_end, int in_grainSize, const btIParallelForBody& in_body) override;
+		btScalar parallelSum(int in_begin, int in_end, int in_grainSize, const btIParallelSumBody& in_body) override;
+
+	private:
+		ThreadPool* m_pThreadPool = nullptr;
+		int m_threadCount = 1;
+	};
+}
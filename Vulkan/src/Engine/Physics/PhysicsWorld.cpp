@@ -0,0 +1,110 @@
+#include "PhysicsWorld.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <Bullet3D/btBulletDynamicsCommon.h>
+#include <Bullet3D/BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <Bullet3D/BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <Bullet3D/BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+
+#include "Engine/Core/Debug.h"
+#include "Engine/Core/ThreadPool.h"
+#include "Engine/Physics/PhysicsTaskScheduler.h"
+
+#define PHYSICS_WORLD_MT_POOL_SIZE 80000 // Manifold/algorithm pool size so large Mt scenes dont fall back to malloc
+
+namespace Mega
+{
+	PhysicsWorld::PhysicsWorld() = default;
+	PhysicsWorld::~PhysicsWorld() = default;
+
+	void PhysicsWorld::Initialize(const ConstructInfoPhysicsWorld* in_pInfo, ThreadPool* in_pThreadPool)
+	{
+		ConstructInfoPhysicsWorld info = in_pInfo ? *in_pInfo : ConstructInfoPhysicsWorld();
+		m_multithreaded = info.multithreaded && in_pThreadPool != nullptr;
+
+		m_pBroadphase = new btDbvtBroadphase();
+
+		if (m_multithreaded) {
+#if !BT_THREADSAFE
+			std::cout << "WARNING: Bullet was built without BT_THREADSAFE, the multithreaded world will step on one thread" << std::endl;
+#endif
+			// The scheduler has to be in place before any of the Mt classes are created
+			m_pTaskScheduler = std::make_unique<PhysicsTaskScheduler>(in_pThreadPool);
+			if (info.threadCount != 0) { m_pTaskScheduler->setNumThreads((int)info.threadCount); }
+			btSetTaskScheduler(m_pTaskScheduler.get());
+
+			btDefaultCollisionConstructionInfo collisionInfo;
+			collisionInfo.m_defaultMaxPersistentManifoldPoolSize = PHYSICS_WORLD_MT_POOL_SIZE;
+			collisionInfo.m_defaultMaxCollisionAlgorithmPoolSize = PHYSICS_WORLD_MT_POOL_SIZE;
+			m_pCollisionConfiguration = new btDefaultCollisionConfiguration(collisionInfo);
+
+			m_pDispatcher = new btCollisionDispatcherMt(m_pCollisionConfiguration, info.dispatcherGrainSize);
+
+			// The pool takes ownership of the solvers in it
+			int solverCount = info.solverPoolSize != 0 ? (int)info.solverPoolSize : m_pTaskScheduler->getNumThreads();
+			std::vector<btConstraintSolver*> solvers((size_t)solverCount);
+			for (auto& solver : solvers) {
+				solver = new btSequentialImpulseConstraintSolverMt();
+			}
+			m_pSolverPool = new btConstraintSolverPoolMt(solvers.data(), solverCount);
+			m_pSolver = new btSequentialImpulseConstraintSolverMt(); // Used for islands too big to hand to a single pool solver
+
+			m_pWorld = new btDiscreteDynamicsWorldMt(m_pDispatcher, m_pBroadphase, m_pSolverPool, m_pSolver, m_pCollisionConfiguration);
+		}
+		else {
+			m_pCollisionConfiguration = new btDefaultCollisionConfiguration();
+			m_pDispatcher = new btCollisionDispatcher(m_pCollisionConfiguration);
+			m_pSolver = new btSequentialImpulseConstraintSolver;
+
+			m_pWorld = new btDiscreteDynamicsWorld(m_pDispatcher, m_pBroadphase, m_pSolver, m_pCollisionConfiguration);
+		}
+
+		m_pWorld->setGravity(info.gravity);
+	}
+
+	void PhysicsWorld::Destroy()
+	{
+		delete m_pWorld;
+		delete m_pSolver;
+		delete m_pSolverPool;
+		delete m_pBroadphase;
+		delete m_pDispatcher;
+		delete m_pCollisionConfiguration;
+
+		m_pWorld = nullptr;
+		m_pSolver = nullptr;
+		m_pSolverPool = nullptr;
+		m_pBroadphase = nullptr;
+		m_pDispatcher = nullptr;
+		m_pCollisionConfiguration = nullptr;
+
+		if (m_pTaskScheduler) {
+			if (btGetTaskScheduler() == m_pTaskScheduler.get()) { btSetTaskScheduler(nullptr); }
+			m_pTaskScheduler.reset();
+		}
+	}
+
+	void PhysicsWorld::StepSimulation(const float in_timeStep)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		// maxSubSteps of 0 makes Bullet take the step as given, the fixed step loop lives in the scene
+		m_pWorld->stepSimulation(in_timeStep, 0);
+
+		m_lastStepTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	uint32_t PhysicsWorld::GetThreadCount() const
+	{
+		return m_pTaskScheduler ? (uint32_t)m_pTaskScheduler->getNumThreads() : 1;
+	}
+
+	void PhysicsWorld::SetThreadCount(const uint32_t in_threadCount)
+	{
+		if (m_pTaskScheduler) { m_pTaskScheduler->setNumThreads((int)in_threadCount); }
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <Bullet3D/LinearMath/btVector3.h>
+
+class btDiscreteDynamicsWorld;
+class btCollisionConfiguration;
+class btCollisionDispatcher;
+class btBroadphaseInterface;
+class btConstraintSolver;
+class btConstraintSolverPoolMt;
+namespace Mega
+{
+	class ThreadPool;
+	class PhysicsTaskScheduler;
+}
+
+namespace Mega
+{
+	// ================ CONSTRUCT INFO ==================== //
+	struct ConstructInfoPhysicsWorld {
+		using btVec3 = btVector3;
+
+		btVec3 gravity = { 0.0, -9.8, 0.0 };
+
+		// Build btDiscreteDynamicsWorldMt and step it on the engine thread pool
+		bool multithreaded = false;
+		uint32_t threadCount = 0;    // 0 = every thread the pool has
+		uint32_t solverPoolSize = 0; // Solvers islands can be handed to in parallel, 0 = one per thread
+		int dispatcherGrainSize = 40;
+	};
+
+	// ================== PHYSICS WORLD ================ //
+	// Owns the Bullet world and everything it is built from. Single threaded by default, or the
+	// Mt variants of the world/dispatcher/solvers driven by a task scheduler on our thread pool
+	class PhysicsWorld {
+	public:
+		PhysicsWorld();
+		~PhysicsWorld();
+
+		void Initialize(const ConstructInfoPhysicsWorld* in_pInfo, ThreadPool* in_pThreadPool);
+		void Destroy();
+
+		// Advance exactly one fixed step
+		void StepSimulation(const float in_timeStep);
+
+		btDiscreteDynamicsWorld* GetRawWorld() const { return m_pWorld; }
+		bool IsMultithreaded() const { return m_multithreaded; }
+		uint32_t GetThreadCount() const;
+		void SetThreadCount(const uint32_t in_threadCount);
+
+		// Wall time of the last StepSimulation call in milliseconds
+		float GetLastStepTime() const { return m_lastStepTime; }
+
+	private:
+		btDiscreteDynamicsWorld* m_pWorld = nullptr; // Basically a container for rigid bodies
+
+		btCollisionConfiguration* m_pCollisionConfiguration = nullptr;
+		btCollisionDispatcher* m_pDispatcher = nullptr;
+		btBroadphaseInterface* m_pBroadphase = nullptr;
+		btConstraintSolver* m_pSolver = nullptr;          // Sequential solver, or the Mt solver used for large islands
+		btConstraintSolverPoolMt* m_pSolverPool = nullptr; // Only when multithreaded
+
+		std::unique_ptr<PhysicsTaskScheduler> m_pTaskScheduler;
+		bool m_multithreaded = false;
+
+		float m_lastStepTime = 0.0f;
+	};
+}
@@ -1,17 +1,21 @@
 #include "RigidBody.h"
 
+#include <new>
+
 #include <Bullet3D/btBulletDynamicsCommon.h>
 
 #include "Engine/Scene.h"
+#include "Engine/Physics/CollisionShapeCache.h"
+#include "Engine/Physics/RigidBodyPool.h"
+#include "Engine/Physics/PhysicsRecorder.h"
+
+static_assert(sizeof(btScalar) == sizeof(float), "Transform sync writes btTransform::getOpenGLMatrix straight into float matrices");
 
 namespace Mega
 {
 	// ------------------ ConstructInfo ----------------- //
-	void ConstructInfoCollisionBox::AddToCompoundShape(RigidBody3D* in_pBody) const
+	btTransform ConstructInfoCollisionShape::GetLocalTransform() const
 	{
-		btBoxShape* box = new btBoxShape(dimensions / 2.0); // Gets deleted in destroy
-		box->setImplicitShapeDimensions(dimensions / 2.0);
-
 		btQuaternion rotQuaternion;
 		btTransform  localTransform;
 
@@ -19,59 +23,87 @@ namespace Mega
 		localTransform.setOrigin(localPosition);
 		localTransform.setRotation(rotQuaternion);
 
-		in_pBody->m_pCompoundShape->addChildShape(localTransform, box);
+		return localTransform;
 	}
 
-	void ConstructInfoCollisionSphere::AddToCompoundShape(RigidBody3D* in_pBody) const
+	btCollisionShape* ConstructInfoCollisionBox::AcquireShape() const
 	{
-		btSphereShape* sphere = new btSphereShape(radius); // Gets deleted in destroy
-		sphere->setImplicitShapeDimensions(btVector3(radius, radius, radius));
-
-		btQuaternion rotQuaternion;
-		btTransform  localTransform;
+		return CollisionShapeCache::GetInstance().AcquireBox(dimensions / 2.0);
+	}
 
-		rotQuaternion.setEuler(rotation.getY(), rotation.getX(), rotation.getZ());
-		localTransform.setOrigin(localPosition);
-		localTransform.setRotation(rotQuaternion);
+	btCollisionShape* ConstructInfoCollisionSphere::AcquireShape() const
+	{
+		return CollisionShapeCache::GetInstance().AcquireSphere(radius);
+	}
 
-		in_pBody->m_pCompoundShape->addChildShape(localTransform, sphere);
+	// ------------------ MotionState ----------------- //
+	void RigidBodyMotionState::setWorldTransform(const btTransform& in_transform)
+	{
+		btDefaultMotionState::setWorldTransform(in_transform);
+		m_pOwner->OnMotionStateMoved();
 	}
 
 	// ------------------ RigidBody3D ----------------- //
 
 	void RigidBody3D::Initialize(const ConstructInfoRigidBody3D* in_pBodyInfo, const ConstructInfoCollisionShape* in_pColBoxInfo)
 	{
-		// Compund Collision Shape //
-		m_pCompoundShape = new btCompoundShape(1);
+		if (in_pColBoxInfo->HasIdentityLocalTransform()) {
+			// Single centered shape, collide with it directly and skip the compound traversal on every contact
+			m_pCollisionShape = in_pColBoxInfo->AcquireShape();
+		}
+		else {
+			m_pCompoundShape = new btCompoundShape(false, 1);
+			m_pCompoundShape->addChildShape(in_pColBoxInfo->GetLocalTransform(), in_pColBoxInfo->AcquireShape());
+			m_pCollisionShape = m_pCompoundShape;
+		}
 
 		// Rigid Body //
 		SetupBulletRigidBody(*in_pBodyInfo);
-
-		in_pColBoxInfo->AddToCompoundShape(this); // Setup and add collision shape to compound shape
 	}
 
 	void RigidBody3D::Initialize(const ConstructInfoRigidBody3D* in_pBodyInfo, const std::vector<ConstructInfoCollisionShape*>& in_colShapes)
 	{
+		if (in_colShapes.size() == 1) {
+			Initialize(in_pBodyInfo, in_colShapes[0]);
+			return;
+		}
+
 		// Compund Collision Shape //
-		m_pCompoundShape = new btCompoundShape(in_colShapes.size());
+		m_pCompoundShape = new btCompoundShape(in_colShapes.size() > 8, (int)in_colShapes.size());
+		for (auto info : in_colShapes) {
+			m_pCompoundShape->addChildShape(info->GetLocalTransform(), info->AcquireShape());
+		}
+		m_pCollisionShape = m_pCompoundShape;
 
 		// Rigid Body //
 		SetupBulletRigidBody(*in_pBodyInfo);
-
-		for (auto info : in_colShapes) {
-			info->AddToCompoundShape(this); // Setup and add collision shape to compound shape
-		}
 	}
 
 	void RigidBody3D::Destroy()
 	{
-		for (int i = 0; i < m_pCompoundShape->getNumChildShapes(); i++) {
-			delete m_pCompoundShape->getChildShape(i);
+		CollisionShapeCache& shapeCache = CollisionShapeCache::GetInstance();
+
+		if (m_pCompoundShape != nullptr) {
+			for (int i = 0; i < m_pCompoundShape->getNumChildShapes(); i++) {
+				shapeCache.Release(m_pCompoundShape->getChildShape(i));
+			}
+			delete m_pCompoundShape;
+		}
+		else {
+			shapeCache.Release(m_pCollisionShape);
 		}
 
-		delete m_pCompoundShape;
-		delete m_pMotionState;
-		delete m_pRigidBody;
+		// Constructed in place, so destroy in place
+		if (m_pRigidBody != nullptr) { m_pRigidBody->~btRigidBody(); }
+		if (m_pMotionState != nullptr) { m_pMotionState->~RigidBodyMotionState(); }
+
+		m_pCollisionShape = nullptr;
+		m_pCompoundShape = nullptr;
+		m_pMotionState = nullptr;
+		m_pRigidBody = nullptr;
+		m_pTransformTarget = nullptr;
+		m_pPool = nullptr;
+		m_queuedForSync = false;
 	}
 
 	void RigidBody3D::Update(const float in_dt)
@@ -114,42 +146,22 @@ namespace Mega
 
 	void RigidBody3D::ApplyLinearForce(const btVec3& in_force)
 	{
+		RecordInput(ePhysicsRecordType::LinearForce, in_force);
 		m_pRigidBody->applyCentralForce(in_force);
 	}
 
 	void RigidBody3D::ApplyLinearImpulse(const btVec3& in_force)
 	{
+		RecordInput(ePhysicsRecordType::LinearImpulse, in_force);
 		m_pRigidBody->applyCentralImpulse(in_force);
 	}
 
 	void RigidBody3D::ApplyRotationalForce(const btVec3& in_force)
 	{
+		RecordInput(ePhysicsRecordType::RotationalForce, in_force);
 		m_pRigidBody->applyTorque(in_force);
 	}
 
-	// Checks if two bodies collided in the last world step
-	//bool RigidBody3D::HasCollidedWith(const std::shared_ptr<RigidBody3D> in_body)
-	//{
-	//	assert(m_currentScene == in_body->m_currentScene && "ERROR: Testing collision between bodies in different scenes");
-	//
-	//	auto pWorld = m_currentScene->m_pPhysicsWorld;
-	//	int manifoldCount = pWorld->getDispatcher()->getNumManifolds();
-	//
-	//	for (int i = 0; i < manifoldCount; i++)
-	//	{
-	//		btPersistentManifold* contactManifold = pWorld->getDispatcher()->getManifoldByIndexInternal(i);
-	//		const btCollisionObject* body0 = contactManifold->getBody0();
-	//		const btCollisionObject* body1 = contactManifold->getBody1();
-	//
-	//		if ((m_pRigidBody == body0 || in_body->m_pRigidBody == body0)
-	//			&& (m_pRigidBody == body1 || in_body->m_pRigidBody == body1)) {
-	//			return true;
-	//		}
-	//	}
-	//
-	//	return false;
-	//}
-
 	glm::vec3 RigidBody3D::GetBodyPosition() const
 	{
 		btVec3 bt = m_pRigidBody->getWorldTransform().getOrigin();
@@ -180,33 +192,94 @@ namespace Mega
 
 	void RigidBody3D::SetPosition(const btVec3& in_position)
 	{
+		RecordInput(ePhysicsRecordType::SetPosition, in_position);
+
 		// Get new transform
 		btTransform newT = m_pRigidBody->getWorldTransform();
 		newT.setOrigin(in_position);
 
 		m_pRigidBody->setWorldTransform(newT);
 		m_pMotionState->setWorldTransform(newT);
+		m_previousTransform = newT; // Teleports shouldnt be smeared across a frame
+	}
+
+	void RigidBody3D::StorePreviousTransform()
+	{
+		m_previousTransform = m_pRigidBody->getWorldTransform();
+	}
+
+	btTransform RigidBody3D::GetInterpolatedTransform(const float in_alpha) const
+	{
+		const btTransform& current = m_pRigidBody->getWorldTransform();
+
+		btTransform out_transform;
+		out_transform.setOrigin(m_previousTransform.getOrigin().lerp(current.getOrigin(), in_alpha));
+		out_transform.setRotation(m_previousTransform.getRotation().slerp(current.getRotation(), in_alpha));
+
+		return out_transform;
+	}
+
+	Vec3F RigidBody3D::GetInterpolatedPosition(const float in_alpha) const
+	{
+		btVec3 bt = GetInterpolatedTransform(in_alpha).getOrigin();
+		return Vec3F(bt.getX(), bt.getY(), bt.getZ());
+	}
+
+	Vec3F RigidBody3D::GetInterpolatedRotation(const float in_alpha) const
+	{
+		glm::vec3 out_v;
+		GetInterpolatedTransform(in_alpha).getRotation().getEulerZYX(out_v.x, out_v.y, out_v.z);
+
+		return out_v;
+	}
+
+	void RigidBody3D::WriteTransformTarget(const float in_alpha) const
+	{
+		if (m_pTransformTarget == nullptr) { return; }
+
+		// btTransform is column major like glm so it can fill the matrix directly, no euler angles involved
+		if (in_alpha >= 1.0f) {
+			m_pRigidBody->getWorldTransform().getOpenGLMatrix(&(*m_pTransformTarget)[0][0]);
+		}
+		else {
+			GetInterpolatedTransform(in_alpha).getOpenGLMatrix(&(*m_pTransformTarget)[0][0]);
+		}
+	}
+
+	void RigidBody3D::OnMotionStateMoved()
+	{
+		if (m_pPool != nullptr && !m_queuedForSync) {
+			m_queuedForSync = true;
+			m_pPool->QueueSync(m_poolIndex);
+		}
+	}
+
+	void RigidBody3D::RecordInput(const ePhysicsRecordType in_type, const btVec3& in_value) const
+	{
+		if (m_pPool != nullptr && m_pPool->GetRecorder() != nullptr) {
+			m_pPool->GetRecorder()->RecordInput(in_type, m_poolIndex, in_value);
+		}
 	}
 
 	void RigidBody3D::SetupBulletRigidBody(const ConstructInfoRigidBody3D& in_info)
 	{
-		if (m_pRigidBody != nullptr) { delete m_pRigidBody; }
+		MEGA_ASSERT(m_pRigidBody == nullptr, "Setting up a rigid body twice; Destroy it first");
 
 		btMat3 rotMatrix;
 		btVec3 inertia;
 		rotMatrix.setEulerYPR(in_info.rotation.getY(), in_info.rotation.getX(), in_info.rotation.getZ());
 
-		m_pMotionState = new btDefaultMotionState(btTransform(rotMatrix, in_info.globalPosition));
-
-		m_pCompoundShape->calculateLocalInertia(in_info.mass, inertia);
+		m_pMotionState = new (m_motionStateStorage) RigidBodyMotionState(btTransform(rotMatrix, in_info.globalPosition), this);
 
-		inertia = btVector3(0.5f, 0.5f, 0.5f);
-		//std::cout << inertia.getX() << ", " << inertia.getY() << ", " << inertia.getZ() << std::endl;
+		// Shapes are built before the body now so the inertia actually comes from them
+		inertia = btVector3(0.0, 0.0, 0.0);
+		if (in_info.mass != 0.0) { m_pCollisionShape->calculateLocalInertia(in_info.mass, inertia); }
 
-		btRigidBody::btRigidBodyConstructionInfo rigidBodyInfo(in_info.mass, m_pMotionState, m_pCompoundShape, inertia);
+		btRigidBody::btRigidBodyConstructionInfo rigidBodyInfo(in_info.mass, m_pMotionState, m_pCollisionShape, inertia);
 		rigidBodyInfo.m_restitution = in_info.restitution;
 		rigidBodyInfo.m_friction = in_info.friction;
 
-		m_pRigidBody = new btRigidBody(rigidBodyInfo);
+		m_pRigidBody = new (m_rigidBodyStorage) btRigidBody(rigidBodyInfo);
+		m_previousTransform = m_pRigidBody->getWorldTransform();
 	}
 }
\ No newline at end of file
@@ -6,16 +6,22 @@
 #include <Bullet3D/LinearMath/btScalar.h>
 #include <Bullet3D/LinearMath/btVector3.h>
 #include <Bullet3D/LinearMath/btMatrix3x3.h>
+#include <Bullet3D/LinearMath/btTransform.h>
+#include <Bullet3D/LinearMath/btDefaultMotionState.h>
+#include <Bullet3D/BulletDynamics/Dynamics/btRigidBody.h>
 
 #include "Engine/Core/Math/Vec.h"
+#include "Engine/Core/Math/Mat.h"
+#include "Engine/Physics/CollisionShapeCache.h"
 
-class btRigidBody;
-class btDefaultMotionState;
 class btCompoundShape;
+class btCollisionShape;
 namespace Mega
 {
 	class Scene;
 	class RigidBody3D;
+	class RigidBodyPool;
+	enum class ePhysicsRecordType : uint8_t;
 }
 
 namespace Mega
@@ -34,37 +40,59 @@ namespace Mega
 	struct ConstructInfoCollisionShape {
 		using btVec3 = btVector3;
 
-		virtual void AddToCompoundShape(RigidBody3D* in_pBody) const { assert(false && "This shouldn't be called"); }
+		// Get a shared shape from the CollisionShapeCache, release it through the cache when done
+		virtual btCollisionShape* AcquireShape() const { assert(false && "This shouldn't be called"); return nullptr; }
+		virtual eCollisionShapeType GetShapeType() const { assert(false && "This shouldn't be called"); return eCollisionShapeType::Box; }
+		btTransform GetLocalTransform() const;
+		// A shape with no offset or rotation can be used by the body directly, without a compound around it
+		bool HasIdentityLocalTransform() const { return localPosition.isZero() && rotation.isZero(); }
+
+		btVec3 localPosition = { 0.0, 0.0, 0.0 };
+		btVec3 rotation = { 0.0, 0.0, 0.0 };
 	};
 	struct ConstructInfoCollisionBox : public ConstructInfoCollisionShape {
 		using btVec3 = btVector3;
 
-		void AddToCompoundShape(RigidBody3D* in_pBody) const;
-
-		btVec3 localPosition = { 0.0, 0.0, 0.0 };
-		btVec3 rotation = { 0.0, 0.0, 0.0 };
+		btCollisionShape* AcquireShape() const;
+		eCollisionShapeType GetShapeType() const { return eCollisionShapeType::Box; }
 
 		btVec3 dimensions = { 1.0, 1.0, 1.0 };
 	};
 	struct ConstructInfoCollisionSphere : public ConstructInfoCollisionShape {
-		void AddToCompoundShape(RigidBody3D* in_pBody) const;
-
-		btVec3 localPosition = { 0.0, 0.0, 0.0 };
-		btVec3 rotation = { 0.0, 0.0, 0.0 };
+		btCollisionShape* AcquireShape() const;
+		eCollisionShapeType GetShapeType() const { return eCollisionShapeType::Sphere; }
 
 		btScalar radius = 1.0;
 	};
 
+	// ================== MOTION STATE ================ //
+	// Bullet only pushes transforms into the motion states of bodies it actually moved (sleeping bodies are
+	// skipped), so this is where we find out which bodies need their render transform updated
+	class RigidBodyMotionState : public btDefaultMotionState {
+	public:
+		RigidBodyMotionState(const btTransform& in_transform, RigidBody3D* in_pOwner) : btDefaultMotionState(in_transform), m_pOwner(in_pOwner) {}
+
+		void setWorldTransform(const btTransform& in_transform) override;
+
+	private:
+		RigidBody3D* m_pOwner;
+	};
+
 	// ================== RIGID BODY 3D ================ //
+	// The btRigidBody and its motion state live inside this object (no separate heap allocations), which
+	// is what lets the RigidBodyPool pack bodies into contiguous slabs. Because of that it cant be copied
 	class RigidBody3D {
 	public:
-		friend ConstructInfoCollisionShape;
-		friend ConstructInfoCollisionBox;
-		friend ConstructInfoCollisionSphere;
+		friend RigidBodyPool;
+		friend RigidBodyMotionState;
 
 		using btVec3 = btVector3;
 		using btMat3 = btMatrix3x3;
 
+		RigidBody3D() {}
+		RigidBody3D(const RigidBody3D&) = delete;
+		RigidBody3D& operator=(const RigidBody3D&) = delete;
+
 		void Initialize(const ConstructInfoRigidBody3D* in_pBodyInfo, const ConstructInfoCollisionShape* in_pColBoxInfo);
 		void Initialize(const ConstructInfoRigidBody3D* in_pBodyInfo, const std::vector<ConstructInfoCollisionShape*>& in_colBoxInfos);
 		void Destroy();
@@ -76,16 +104,44 @@ namespace Mega
 		void ApplyRotationalForce(const btVec3& in_force);
 
 		btRigidBody* GetRawRigidBody() const { return m_pRigidBody; }
+		bool IsInitialized() const { return m_pRigidBody != nullptr; }
 		Vec3F GetBodyPosition() const;
 		Vec3F GetMotionStateRotation() const;
 		Vec3F GetMotionStatePosition() const;
 		void SetPosition(const btVec3& in_position);
 
+		// Render interpolation, the scene stores the previous state before every fixed step and
+		// in_alpha blends from it (0) to the current state (1)
+		void StorePreviousTransform();
+		btTransform GetInterpolatedTransform(const float in_alpha) const;
+		Vec3F GetInterpolatedPosition(const float in_alpha) const;
+		Vec3F GetInterpolatedRotation(const float in_alpha) const;
+
+		// Where the pool's transform sync writes this body's (interpolated) world matrix, usually a Model's
+		// transform storage. The pointer has to stay valid for as long as it is set
+		void SetTransformTarget(Mat4x4F* in_pTarget) { m_pTransformTarget = in_pTarget; }
+		void WriteTransformTarget(const float in_alpha) const;
+
 	private:
 		void SetupBulletRigidBody(const ConstructInfoRigidBody3D& in_info);
+		void OnMotionStateMoved();
+		// Hands the input to the pool's physics recorder when one is running
+		void RecordInput(const ePhysicsRecordType in_type, const btVec3& in_value) const;
+
+		btRigidBody* m_pRigidBody = nullptr;            // Points into m_rigidBodyStorage once initialized
+		RigidBodyMotionState* m_pMotionState = nullptr; // Points into m_motionStateStorage once initialized
+		btCollisionShape* m_pCollisionShape = nullptr; // What the body collides with, a cached shape or our compound
+		btCompoundShape* m_pCompoundShape = nullptr;   // Only when the body has several shapes or an offset one
+
+		btTransform m_previousTransform = btTransform::getIdentity();
+
+		// Transform sync, filled in when the body lives in a RigidBodyPool
+		RigidBodyPool* m_pPool = nullptr;
+		uint32_t m_poolIndex = 0;
+		bool m_queuedForSync = false;
+		Mat4x4F* m_pTransformTarget = nullptr;
 
-		btRigidBody* m_pRigidBody = nullptr;
-		btDefaultMotionState* m_pMotionState = nullptr;
-		btCompoundShape* m_pCompoundShape = nullptr;
+		alignas(16) unsigned char m_rigidBodyStorage[sizeof(btRigidBody)];
+		alignas(16) unsigned char m_motionStateStorage[sizeof(RigidBodyMotionState)];
 	};
 }
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "RigidBodyPool.h"
+
+#include <Bullet3D/btBulletDynamicsCommon.h>
+
+#include "Engine/Core/Debug.h"
+#include "Engine/Physics/PhysicsRecorder.h"
+
+namespace Mega
+{
+	void RigidBodyPool::Initialize(btDiscreteDynamicsWorld* in_pWorld)
+	{
+		m_pWorld = in_pWorld;
+	}
+
+	void RigidBodyPool::Destroy()
+	{
+		ForEach([this](RigidBody3D& in_body, const RigidBodyHandle) {
+			m_pWorld->removeRigidBody(in_body.GetRawRigidBody());
+			in_body.Destroy();
+		});
+
+		m_chunks.clear();
+		m_freeList.clear();
+		m_movedBodies.clear();
+		m_previouslyMovedBodies.clear();
+		m_movedCount = 0;
+		m_liveCount = 0;
+		m_pWorld = nullptr;
+	}
+
+	RigidBodyHandle RigidBodyPool::Create(const ConstructInfoRigidBody3D* in_pBodyInfo, const ConstructInfoCollisionShape* in_pShapeInfo)
+	{
+		uint32_t index = AllocateSlot();
+		m_chunks[index >> RIGID_BODY_POOL_CHUNK_SHIFT]->bodies[index & (RIGID_BODY_POOL_CHUNK_SIZE - 1)].Initialize(in_pBodyInfo, in_pShapeInfo);
+
+		if (m_pRecorder != nullptr) { m_pRecorder->RecordSpawn(index, in_pBodyInfo, &in_pShapeInfo, 1); }
+		return Commit(index);
+	}
+
+	RigidBodyHandle RigidBodyPool::Create(const ConstructInfoRigidBody3D* in_pBodyInfo, const std::vector<ConstructInfoCollisionShape*>& in_shapeInfos)
+	{
+		uint32_t index = AllocateSlot();
+		m_chunks[index >> RIGID_BODY_POOL_CHUNK_SHIFT]->bodies[index & (RIGID_BODY_POOL_CHUNK_SIZE - 1)].Initialize(in_pBodyInfo, in_shapeInfos);
+
+		if (m_pRecorder != nullptr) { m_pRecorder->RecordSpawn(index, in_pBodyInfo, in_shapeInfos.data(), (uint32_t)in_shapeInfos.size()); }
+		return Commit(index);
+	}
+
+	void RigidBodyPool::Release(const RigidBodyHandle in_handle)
+	{
+		RigidBody3D* pBody = Get(in_handle);
+		MEGA_ASSERT(pBody != nullptr, "Releasing a stale or invalid rigid body handle");
+		if (pBody == nullptr) { return; }
+
+		if (m_pRecorder != nullptr) { m_pRecorder->RecordDestroy(in_handle.index); }
+
+		// The slot may still sit in the moved list, keep the flag so reusing it this step doesnt queue it twice
+		bool queuedForSync = pBody->m_queuedForSync;
+		m_pWorld->removeRigidBody(pBody->GetRawRigidBody());
+		pBody->Destroy();
+		pBody->m_queuedForSync = queuedForSync;
+
+		Chunk& chunk = *m_chunks[in_handle.index >> RIGID_BODY_POOL_CHUNK_SHIFT];
+		uint32_t slot = in_handle.index & (RIGID_BODY_POOL_CHUNK_SIZE - 1);
+		chunk.aliveMask[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+		chunk.generations[slot]++;
+
+		m_freeList.push_back(in_handle.index);
+		m_liveCount--;
+	}
+
+	RigidBody3D* RigidBodyPool::Get(const RigidBodyHandle in_handle)
+	{
+		return const_cast<RigidBody3D*>(static_cast<const RigidBodyPool*>(this)->Get(in_handle));
+	}
+
+	const RigidBody3D* RigidBodyPool::Get(const RigidBodyHandle in_handle) const
+	{
+		uint32_t chunkIndex = in_handle.index >> RIGID_BODY_POOL_CHUNK_SHIFT;
+		if (!in_handle.IsValid() || chunkIndex >= m_chunks.size()) { return nullptr; }
+
+		const Chunk& chunk = *m_chunks[chunkIndex];
+		uint32_t slot = in_handle.index & (RIGID_BODY_POOL_CHUNK_SIZE - 1);
+		bool alive = (chunk.aliveMask[slot / 64] >> (slot % 64)) & 1;
+
+		return (alive && chunk.generations[slot] == in_handle.generation) ? &chunk.bodies[slot] : nullptr;
+	}
+
+	RigidBodyHandle RigidBodyPool::GetHandle(const btCollisionObject* in_pObject)
+	{
+		if (in_pObject == nullptr || in_pObject->getUserIndex() < 0) { return RigidBodyHandle(); }
+
+		return { (uint32_t)in_pObject->getUserIndex(), (uint32_t)in_pObject->getUserIndex2() };
+	}
+
+	uint32_t RigidBodyPool::AllocateSlot()
+	{
+		if (m_freeList.empty()) {
+			// Only time the pool touches the heap, one slab for the next RIGID_BODY_POOL_CHUNK_SIZE bodies
+			uint32_t firstIndex = (uint32_t)m_chunks.size() * RIGID_BODY_POOL_CHUNK_SIZE;
+			m_chunks.push_back(std::make_unique<Chunk>());
+			m_movedBodies.resize(GetCapacity());
+
+			m_freeList.reserve(m_freeList.size() + RIGID_BODY_POOL_CHUNK_SIZE);
+			for (uint32_t i = RIGID_BODY_POOL_CHUNK_SIZE; i > 0; i--) {
+				m_freeList.push_back(firstIndex + i - 1); // Reversed so slots get handed out in address order
+			}
+		}
+
+		uint32_t out_index = m_freeList.back();
+		m_freeList.pop_back();
+
+		return out_index;
+	}
+
+	RigidBodyHandle RigidBodyPool::Commit(const uint32_t in_index)
+	{
+		Chunk& chunk = *m_chunks[in_index >> RIGID_BODY_POOL_CHUNK_SHIFT];
+		uint32_t slot = in_index & (RIGID_BODY_POOL_CHUNK_SIZE - 1);
+		chunk.aliveMask[slot / 64] |= uint64_t(1) << (slot % 64);
+		m_liveCount++;
+
+		RigidBodyHandle out_handle = { in_index, chunk.generations[slot] };
+
+		RigidBody3D& body = chunk.bodies[slot];
+		body.m_pPool = this;
+		body.m_poolIndex = in_index;
+		body.OnMotionStateMoved(); // Gets its first transform written even if it never moves
+
+		btRigidBody* pRawBody = body.GetRawRigidBody();
+		pRawBody->setUserIndex((int)out_handle.index);
+		pRawBody->setUserIndex2((int)out_handle.generation);
+		pRawBody->setUserPointer(&body);
+		m_pWorld->addRigidBody(pRawBody);
+
+		return out_handle;
+	}
+
+	void RigidBodyPool::BeginStep()
+	{
+		// Whatever moved last step is what might move again, remember it so EndStep can catch the
+		// bodies that came to rest and give them one last exact write
+		uint32_t movedCount = m_movedCount.exchange(0);
+		m_previouslyMovedBodies.assign(m_movedBodies.begin(), m_movedBodies.begin() + movedCount);
+
+		for (uint32_t index : m_previouslyMovedBodies) {
+			m_chunks[index >> RIGID_BODY_POOL_CHUNK_SHIFT]->bodies[index & (RIGID_BODY_POOL_CHUNK_SIZE - 1)].m_queuedForSync = false;
+
+			RigidBody3D* pBody = GetLiveSlot(index);
+			if (pBody != nullptr) { pBody->StorePreviousTransform(); }
+		}
+	}
+
+	void RigidBodyPool::EndStep()
+	{
+		for (uint32_t index : m_previouslyMovedBodies) {
+			RigidBody3D* pBody = GetLiveSlot(index);
+			if (pBody == nullptr || pBody->m_queuedForSync) { continue; }
+
+			// Didnt move this step, previous == current so the write is exact and final until it wakes up
+			pBody->StorePreviousTransform();
+			pBody->WriteTransformTarget(1.0f);
+		}
+		m_previouslyMovedBodies.clear();
+	}
+
+	void RigidBodyPool::SyncTransforms(const float in_alpha)
+	{
+		uint32_t movedCount = m_movedCount.load(std::memory_order_acquire);
+		for (uint32_t i = 0; i < movedCount; i++) {
+			RigidBody3D* pBody = GetLiveSlot(m_movedBodies[i]);
+			if (pBody != nullptr) {
+				pBody->WriteTransformTarget(in_alpha);
+			}
+		}
+	}
+
+	void RigidBodyPool::QueueSync(const uint32_t in_index)
+	{
+		uint32_t slot = m_movedCount.fetch_add(1, std::memory_order_relaxed);
+		MEGA_ASSERT(slot < m_movedBodies.size(), "More bodies queued for transform sync than the pool holds");
+
+		m_movedBodies[slot] = in_index;
+	}
+
+	RigidBody3D* RigidBodyPool::GetLiveSlot(const uint32_t in_index)
+	{
+		Chunk& chunk = *m_chunks[in_index >> RIGID_BODY_POOL_CHUNK_SHIFT];
+		uint32_t slot = in_index & (RIGID_BODY_POOL_CHUNK_SIZE - 1);
+
+		return ((chunk.aliveMask[slot / 64] >> (slot % 64)) & 1) ? &chunk.bodies[slot] : nullptr;
+	}
+}
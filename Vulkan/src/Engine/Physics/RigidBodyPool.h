@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "Engine/Physics/RigidBody.h"
+
+#define RIGID_BODY_POOL_CHUNK_SIZE uint32_t(256)
+#define RIGID_BODY_POOL_CHUNK_SHIFT 8
+#define RIGID_BODY_POOL_INVALID_INDEX uint32_t(0xFFFFFFFF)
+
+class btDiscreteDynamicsWorld;
+namespace Mega
+{
+	class PhysicsRecorder;
+}
+
+namespace Mega
+{
+	// Stable reference to a pooled body. The generation changes every time a slot is reused so a
+	// handle to a despawned body reads as invalid instead of pointing at whatever took its place
+	struct RigidBodyHandle {
+		uint32_t index = RIGID_BODY_POOL_INVALID_INDEX;
+		uint32_t generation = 0;
+
+		bool IsValid() const { return index != RIGID_BODY_POOL_INVALID_INDEX; }
+		bool operator==(const RigidBodyHandle& in_other) const { return index == in_other.index && generation == in_other.generation; }
+		bool operator!=(const RigidBodyHandle& in_other) const { return !(*this == in_other); }
+	};
+
+	// Rigid bodies stored in fixed size slabs that are never moved or freed until the pool is
+	// destroyed. Create pops a free slot, Release pushes it back, both O(1) and allocation free once
+	// the pool has grown to its working size. Every body's btRigidBody carries its handle in
+	// userIndex/userIndex2 so Bullet callbacks can get back to it
+	class RigidBodyPool {
+	public:
+		void Initialize(btDiscreteDynamicsWorld* in_pWorld);
+		void Destroy();
+
+		RigidBodyHandle Create(const ConstructInfoRigidBody3D* in_pBodyInfo, const ConstructInfoCollisionShape* in_pShapeInfo);
+		RigidBodyHandle Create(const ConstructInfoRigidBody3D* in_pBodyInfo, const std::vector<ConstructInfoCollisionShape*>& in_shapeInfos);
+		void Release(const RigidBodyHandle in_handle);
+
+		// nullptr when the handle is stale or was never valid
+		RigidBody3D* Get(const RigidBodyHandle in_handle);
+		const RigidBody3D* Get(const RigidBodyHandle in_handle) const;
+		static RigidBodyHandle GetHandle(const btCollisionObject* in_pObject);
+
+		uint32_t GetLiveCount() const { return m_liveCount; }
+		uint32_t GetCapacity() const { return (uint32_t)m_chunks.size() * RIGID_BODY_POOL_CHUNK_SIZE; }
+
+		// Visit every live body in memory order, in_function(RigidBody3D&, RigidBodyHandle)
+		template<typename Function>
+		void ForEach(Function&& in_function);
+
+		// Transform sync. Around every fixed step call BeginStep/EndStep, then once per rendered frame
+		// SyncTransforms writes the interpolated matrix of every body Bullet moved into its transform
+		// target. Only bodies that moved are visited, sleeping ones cost nothing
+		void BeginStep();
+		void EndStep();
+		void SyncTransforms(const float in_alpha);
+		uint32_t GetMovingCount() const { return m_movedCount.load(std::memory_order_relaxed); }
+
+		// Called from motion states, may run on physics worker threads
+		void QueueSync(const uint32_t in_index);
+
+		// Spawns, releases and every input applied through RigidBody3D get logged while a recorder is set
+		void SetRecorder(PhysicsRecorder* in_pRecorder) { m_pRecorder = in_pRecorder; }
+		PhysicsRecorder* GetRecorder() const { return m_pRecorder; }
+
+	private:
+		struct alignas(16) Chunk {
+			RigidBody3D bodies[RIGID_BODY_POOL_CHUNK_SIZE];
+			uint32_t generations[RIGID_BODY_POOL_CHUNK_SIZE] = {};
+			uint64_t aliveMask[RIGID_BODY_POOL_CHUNK_SIZE / 64] = {};
+		};
+
+		static uint32_t CountTrailingZeros(const uint64_t in_mask) {
+#ifdef _MSC_VER
+			unsigned long out_index;
+			_BitScanForward64(&out_index, in_mask);
+			return (uint32_t)out_index;
+#else
+			return (uint32_t)__builtin_ctzll(in_mask);
+#endif
+		}
+
+		uint32_t AllocateSlot();
+		RigidBodyHandle Commit(const uint32_t in_index);
+		RigidBody3D* GetLiveSlot(const uint32_t in_index);
+
+		btDiscreteDynamicsWorld* m_pWorld = nullptr;
+		PhysicsRecorder* m_pRecorder = nullptr;
+		std::vector<std::unique_ptr<Chunk>> m_chunks;
+		std::vector<uint32_t> m_freeList;
+		uint32_t m_liveCount = 0;
+
+		// Bodies moved since BeginStep, sized to the pool capacity since a body is only queued once per step
+		std::vector<uint32_t> m_movedBodies;
+		std::atomic<uint32_t> m_movedCount = { 0 };
+		std::vector<uint32_t> m_previouslyMovedBodies;
+	};
+
+	template<typename Function>
+	void RigidBodyPool::ForEach(Function&& in_function)
+	{
+		for (uint32_t chunkIndex = 0; chunkIndex < (uint32_t)m_chunks.size(); chunkIndex++) {
+			Chunk& chunk = *m_chunks[chunkIndex];
+
+			for (uint32_t word = 0; word < RIGID_BODY_POOL_CHUNK_SIZE / 64; word++) {
+				uint64_t mask = chunk.aliveMask[word];
+				while (mask != 0) {
+					// Walk set bits lowest first so we stay in address order
+					uint32_t bit = CountTrailingZeros(mask);
+					mask &= mask - 1;
+
+					uint32_t slot = word * 64 + bit;
+					RigidBodyHandle handle = { (chunkIndex << RIGID_BODY_POOL_CHUNK_SHIFT) | slot, chunk.generations[slot] };
+					in_function(chunk.bodies[slot], handle);
+				}
+			}
+		}
+	}
+}
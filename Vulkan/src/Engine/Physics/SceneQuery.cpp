@@ -0,0 +1,317 @@
+#include "SceneQuery.h"
+
+#include <Bullet3D/btBulletDynamicsCommon.h>
+#include <Bullet3D/LinearMath/btAabbUtil2.h>
+#include <Bullet3D/BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+#include <Bullet3D/BulletCollision/NarrowPhaseCollision/btGjkPairDetector.h>
+#include <Bullet3D/BulletCollision/NarrowPhaseCollision/btPointCollector.h>
+#include <Bullet3D/BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h>
+#include <Bullet3D/BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h>
+
+#include "Engine/Core/Debug.h"
+#include "Engine/Core/ThreadPool.h"
+
+namespace Mega
+{
+	namespace
+	{
+		inline btVector3 ToBullet(const Vec3F& in_vector) { return btVector3(in_vector.x, in_vector.y, in_vector.z); }
+		inline Vec3F FromBullet(const btVector3& in_vector) { return Vec3F(in_vector.getX(), in_vector.getY(), in_vector.getZ()); }
+
+		inline bool PassesFilter(const QueryFilter& in_filter, const btBroadphaseProxy* in_pProxy)
+		{
+			if ((in_pProxy->m_collisionFilterGroup & in_filter.mask) == 0 || (in_filter.group & in_pProxy->m_collisionFilterMask) == 0) { return false; }
+
+			const btCollisionObject* pObject = (const btCollisionObject*)in_pProxy->m_clientObject;
+			return !in_filter.ignore.IsValid() || RigidBodyPool::GetHandle(pObject) != in_filter.ignore;
+		}
+
+		btConvexShape* AcquireQueryShape(const QueryShape& in_shape)
+		{
+			if (in_shape.type == eCollisionShapeType::Box) {
+				return (btConvexShape*)CollisionShapeCache::GetInstance().AcquireBox(ToBullet(in_shape.halfExtents));
+			}
+			return (btConvexShape*)CollisionShapeCache::GetInstance().AcquireSphere(in_shape.radius);
+		}
+
+		btQuaternion GetQueryRotation(const QueryShape& in_shape)
+		{
+			btQuaternion out_rotation;
+			out_rotation.setEuler(in_shape.rotation.y, in_shape.rotation.x, in_shape.rotation.z);
+			return out_rotation;
+		}
+
+		// Leaf callback shared by rays and sweeps. The tree walk itself cant shrink its ray once
+		// something was hit, so leaves past the closest hit so far get culled here before the
+		// narrowphase runs
+		template<typename NarrowPhase>
+		struct CastCollector : public btDbvt::ICollide {
+			CastCollector(const QueryFilter& in_filter, const btVector3& in_from, const btVector3& in_invDirection, const unsigned int in_signs[3],
+				const btScalar in_length, const btVector3& in_aabbMin, const btVector3& in_aabbMax, const btScalar& in_closestFraction, NarrowPhase& in_narrowPhase)
+				: filter(in_filter), from(in_from), invDirection(in_invDirection), signs(in_signs), length(in_length),
+				aabbMin(in_aabbMin), aabbMax(in_aabbMax), closestFraction(in_closestFraction), narrowPhase(in_narrowPhase) {}
+
+			void Process(const btDbvtNode* in_pLeaf) override
+			{
+				const btBroadphaseProxy* pProxy = (const btBroadphaseProxy*)in_pLeaf->data;
+				if (!PassesFilter(filter, pProxy)) { return; }
+
+				btVector3 bounds[2] = { in_pLeaf->volume.Mins() - aabbMax, in_pLeaf->volume.Maxs() - aabbMin };
+				btScalar entry = 0.0;
+				if (!btRayAabb2(from, invDirection, signs, bounds, entry, btScalar(0.0), closestFraction * length)) { return; }
+
+				narrowPhase((btCollisionObject*)pProxy->m_clientObject);
+			}
+
+			const QueryFilter& filter;
+			const btVector3& from;
+			const btVector3& invDirection;
+			const unsigned int* signs;
+			btScalar length;
+			const btVector3& aabbMin;
+			const btVector3& aabbMax;
+			const btScalar& closestFraction;
+			NarrowPhase& narrowPhase;
+		};
+
+		struct OverlapCollector : public btDbvt::ICollide {
+			void Process(const btDbvtNode* in_pLeaf) override
+			{
+				const btBroadphaseProxy* pProxy = (const btBroadphaseProxy*)in_pLeaf->data;
+				if (count == maxResults || !PassesFilter(*pFilter, pProxy)) { return; }
+
+				const btCollisionObject* pObject = (const btCollisionObject*)pProxy->m_clientObject;
+				if (Touches(pObject->getCollisionShape(), pObject->getWorldTransform())) {
+					pResults[count++] = RigidBodyPool::GetHandle(pObject);
+				}
+			}
+
+			bool Touches(const btCollisionShape* in_pShape, const btTransform& in_transform) const
+			{
+				if (in_pShape->isCompound()) {
+					const btCompoundShape* pCompound = (const btCompoundShape*)in_pShape;
+					for (int i = 0; i < pCompound->getNumChildShapes(); i++) {
+						if (Touches(pCompound->getChildShape(i), in_transform * pCompound->getChildTransform(i))) { return true; }
+					}
+					return false;
+				}
+				if (!in_pShape->isConvex()) { return false; }
+
+				// Same GJK/EPA pair test Bullet's convex-convex algorithm uses, margins included
+				btVoronoiSimplexSolver simplexSolver;
+				btGjkEpaPenetrationDepthSolver penetrationSolver;
+				btGjkPairDetector detector(pQueryShape, (const btConvexShape*)in_pShape, &simplexSolver, &penetrationSolver);
+
+				btGjkPairDetector::ClosestPointInput input;
+				input.m_transformA = queryTransform;
+				input.m_transformB = in_transform;
+
+				btPointCollector collector;
+				detector.getClosestPoints(input, collector, nullptr);
+
+				return collector.m_hasResult && collector.m_distance <= btScalar(0.0);
+			}
+
+			const QueryFilter* pFilter = nullptr;
+			const btConvexShape* pQueryShape = nullptr;
+			btTransform queryTransform;
+			RigidBodyHandle* pResults = nullptr;
+			uint32_t maxResults = 0;
+			uint32_t count = 0;
+		};
+
+		// Direction terms btDbvt::rayTestInternal wants, same setup as btCollisionWorld's ray callbacks
+		struct RaySetup {
+			RaySetup(const btVector3& in_from, const btVector3& in_to)
+			{
+				btVector3 direction = in_to - in_from;
+				length = direction.length();
+				direction = length > SIMD_EPSILON ? direction / length : btVector3(1.0, 0.0, 0.0);
+
+				invDirection[0] = direction[0] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / direction[0];
+				invDirection[1] = direction[1] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / direction[1];
+				invDirection[2] = direction[2] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / direction[2];
+				signs[0] = invDirection[0] < btScalar(0.0);
+				signs[1] = invDirection[1] < btScalar(0.0);
+				signs[2] = invDirection[2] < btScalar(0.0);
+			}
+
+			btVector3 invDirection;
+			unsigned int signs[3];
+			btScalar length;
+		};
+	}
+
+	void QueryHitResults::Resize(const uint32_t in_count)
+	{
+		hit.resize(in_count);
+		fraction.resize(in_count);
+		point.resize(in_count);
+		normal.resize(in_count);
+		body.resize(in_count);
+	}
+
+	void QueryOverlapResults::Resize(const uint32_t in_count, const uint32_t in_stride)
+	{
+		stride = in_stride;
+		count.resize(in_count);
+		bodies.resize((size_t)in_count * in_stride);
+	}
+
+	void SceneQuery::Initialize(btDiscreteDynamicsWorld* in_pWorld, ThreadPool* in_pThreadPool)
+	{
+		// PhysicsWorld always builds a btDbvtBroadphase, its two trees (static and dynamic proxies) are what we walk
+		m_pBroadphase = (btDbvtBroadphase*)in_pWorld->getBroadphase();
+		m_pThreadPool = in_pThreadPool;
+
+		m_stacks.resize(m_pThreadPool != nullptr ? m_pThreadPool->GetThreadSlotCount() : 1);
+	}
+
+	void SceneQuery::Destroy()
+	{
+		m_stacks.clear();
+		m_pBroadphase = nullptr;
+		m_pThreadPool = nullptr;
+	}
+
+	void SceneQuery::Raycast(const RaycastBatch& in_batch, QueryHitResults* out_pResults)
+	{
+		MEGA_ASSERT(in_batch.from.size() == in_batch.to.size(), "Raycast batch has mismatched from/to arrays");
+
+		const uint32_t count = in_batch.GetCount();
+		out_pResults->Resize(count);
+
+		auto castRange = [&](const uint32_t in_begin, const uint32_t in_end) {
+			btAlignedObjectArray<const btDbvtNode*>& stack = GetStack();
+			const btVector3 noExtents(0.0, 0.0, 0.0);
+
+			for (uint32_t i = in_begin; i < in_end; i++) {
+				const btVector3 from = ToBullet(in_batch.from[i]);
+				const btVector3 to = ToBullet(in_batch.to[i]);
+				const btTransform fromTransform(btQuaternion::getIdentity(), from);
+				const btTransform toTransform(btQuaternion::getIdentity(), to);
+				RaySetup ray(from, to);
+
+				btCollisionWorld::ClosestRayResultCallback callback(from, to);
+				auto narrowPhase = [&](btCollisionObject* in_pObject) {
+					btCollisionWorld::rayTestSingle(fromTransform, toTransform, in_pObject, in_pObject->getCollisionShape(), in_pObject->getWorldTransform(), callback);
+				};
+				CastCollector<decltype(narrowPhase)> collector(in_batch.filter, from, ray.invDirection, ray.signs, ray.length,
+					noExtents, noExtents, callback.m_closestHitFraction, narrowPhase);
+
+				for (int set = 0; set < 2; set++) {
+					const btDbvt& tree = m_pBroadphase->m_sets[set];
+					tree.rayTestInternal(tree.m_root, from, to, ray.invDirection, ray.signs, ray.length, noExtents, noExtents, stack, collector);
+				}
+
+				out_pResults->hit[i] = callback.hasHit();
+				out_pResults->fraction[i] = callback.hasHit() ? (float)callback.m_closestHitFraction : 1.0f;
+				out_pResults->point[i] = callback.hasHit() ? FromBullet(callback.m_hitPointWorld) : in_batch.to[i];
+				out_pResults->normal[i] = callback.hasHit() ? FromBullet(callback.m_hitNormalWorld) : Vec3F(0.0f);
+				out_pResults->body[i] = RigidBodyPool::GetHandle(callback.m_collisionObject);
+			}
+		};
+
+		if (m_pThreadPool != nullptr) { m_pThreadPool->ParallelFor(0, count, SCENE_QUERY_RAY_GRAIN_SIZE, castRange); }
+		else { castRange(0, count); }
+	}
+
+	void SceneQuery::Sweep(const SweepBatch& in_batch, QueryHitResults* out_pResults)
+	{
+		MEGA_ASSERT(in_batch.from.size() == in_batch.to.size(), "Sweep batch has mismatched from/to arrays");
+
+		const uint32_t count = in_batch.GetCount();
+		out_pResults->Resize(count);
+
+		btConvexShape* pCastShape = AcquireQueryShape(in_batch.shape);
+		const btQuaternion rotation = GetQueryRotation(in_batch.shape);
+
+		// Swept shape's box around its own origin, the tree walk grows every node by it
+		btVector3 castAabbMin, castAabbMax;
+		pCastShape->getAabb(btTransform(rotation), castAabbMin, castAabbMax);
+
+		auto castRange = [&](const uint32_t in_begin, const uint32_t in_end) {
+			btAlignedObjectArray<const btDbvtNode*>& stack = GetStack();
+
+			for (uint32_t i = in_begin; i < in_end; i++) {
+				const btVector3 from = ToBullet(in_batch.from[i]);
+				const btVector3 to = ToBullet(in_batch.to[i]);
+				const btTransform fromTransform(rotation, from);
+				const btTransform toTransform(rotation, to);
+				RaySetup ray(from, to);
+
+				btCollisionWorld::ClosestConvexResultCallback callback(from, to);
+				auto narrowPhase = [&](btCollisionObject* in_pObject) {
+					btCollisionWorld::objectQuerySingle(pCastShape, fromTransform, toTransform, in_pObject, in_pObject->getCollisionShape(),
+						in_pObject->getWorldTransform(), callback, btScalar(0.0));
+				};
+				CastCollector<decltype(narrowPhase)> collector(in_batch.filter, from, ray.invDirection, ray.signs, ray.length,
+					castAabbMin, castAabbMax, callback.m_closestHitFraction, narrowPhase);
+
+				for (int set = 0; set < 2; set++) {
+					const btDbvt& tree = m_pBroadphase->m_sets[set];
+					tree.rayTestInternal(tree.m_root, from, to, ray.invDirection, ray.signs, ray.length, castAabbMin, castAabbMax, stack, collector);
+				}
+
+				out_pResults->hit[i] = callback.hasHit();
+				out_pResults->fraction[i] = callback.hasHit() ? (float)callback.m_closestHitFraction : 1.0f;
+				out_pResults->point[i] = callback.hasHit() ? FromBullet(callback.m_hitPointWorld) : in_batch.to[i];
+				out_pResults->normal[i] = callback.hasHit() ? FromBullet(callback.m_hitNormalWorld) : Vec3F(0.0f);
+				out_pResults->body[i] = RigidBodyPool::GetHandle(callback.m_hitCollisionObject);
+			}
+		};
+
+		if (m_pThreadPool != nullptr) { m_pThreadPool->ParallelFor(0, count, SCENE_QUERY_SWEEP_GRAIN_SIZE, castRange); }
+		else { castRange(0, count); }
+
+		CollisionShapeCache::GetInstance().Release(pCastShape);
+	}
+
+	void SceneQuery::Overlap(const OverlapBatch& in_batch, QueryOverlapResults* out_pResults)
+	{
+		const uint32_t count = in_batch.GetCount();
+		out_pResults->Resize(count, in_batch.maxResults);
+
+		btConvexShape* pQueryShape = AcquireQueryShape(in_batch.shape);
+		const btQuaternion rotation = GetQueryRotation(in_batch.shape);
+
+		btVector3 localAabbMin, localAabbMax;
+		pQueryShape->getAabb(btTransform(rotation), localAabbMin, localAabbMax);
+
+		auto overlapRange = [&](const uint32_t in_begin, const uint32_t in_end) {
+			btAlignedObjectArray<const btDbvtNode*>& stack = GetStack();
+
+			for (uint32_t i = in_begin; i < in_end; i++) {
+				const btVector3 position = ToBullet(in_batch.position[i]);
+
+				OverlapCollector collector;
+				collector.pFilter = &in_batch.filter;
+				collector.pQueryShape = pQueryShape;
+				collector.queryTransform = btTransform(rotation, position);
+				collector.pResults = out_pResults->bodies.data() + (size_t)i * in_batch.maxResults;
+				collector.maxResults = in_batch.maxResults;
+
+				const btDbvtVolume volume = btDbvtVolume::FromMM(position + localAabbMin, position + localAabbMax);
+				for (int set = 0; set < 2; set++) {
+					const btDbvt& tree = m_pBroadphase->m_sets[set];
+					tree.collideTVNoStackAlloc(tree.m_root, volume, stack, collector);
+				}
+
+				out_pResults->count[i] = collector.count;
+			}
+		};
+
+		if (m_pThreadPool != nullptr) { m_pThreadPool->ParallelFor(0, count, SCENE_QUERY_OVERLAP_GRAIN_SIZE, overlapRange); }
+		else { overlapRange(0, count); }
+
+		CollisionShapeCache::GetInstance().Release(pQueryShape);
+	}
+
+	btAlignedObjectArray<const btDbvtNode*>& SceneQuery::GetStack()
+	{
+		uint32_t threadIndex = ThreadPool::GetCurrentThreadIndex();
+		MEGA_ASSERT(threadIndex < m_stacks.size(), "Scene query ran on a thread it has no traversal stack for");
+
+		return m_stacks[threadIndex];
+	}
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Bullet3D/LinearMath/btAlignedObjectArray.h>
+#include <Bullet3D/BulletCollision/BroadphaseCollision/btBroadphaseProxy.h>
+
+#include "Engine/Core/Math/Vec.h"
+#include "Engine/Physics/RigidBodyPool.h"
+#include "Engine/Physics/CollisionShapeCache.h"
+
+#define SCENE_QUERY_RAY_GRAIN_SIZE       uint32_t(64) // Rays per job, they are cheap so hand them out in big chunks
+#define SCENE_QUERY_SWEEP_GRAIN_SIZE     uint32_t(16)
+#define SCENE_QUERY_OVERLAP_GRAIN_SIZE   uint32_t(16)
+#define SCENE_QUERY_DEFAULT_MAX_OVERLAPS uint32_t(16)
+
+class btDbvtBroadphase;
+class btDiscreteDynamicsWorld;
+struct btDbvtNode;
+namespace Mega
+{
+	class ThreadPool;
+}
+
+namespace Mega
+{
+	// Same bits Bullet uses for bodies (btBroadphaseProxy::CollisionFilterGroups), a body is only
+	// tested when (body group & mask) and (group & body mask) are both non zero
+	struct QueryFilter {
+		int group = btBroadphaseProxy::DefaultFilter;
+		int mask = btBroadphaseProxy::AllFilter;
+		RigidBodyHandle ignore; // Usually the body doing the asking, so a tank's line of sight doesnt hit itself
+	};
+
+	// Shape swept or overlapped by a whole batch
+	struct QueryShape {
+		eCollisionShapeType type = eCollisionShapeType::Sphere;
+		float radius = 0.5f;                 // Sphere
+		Vec3F halfExtents = Vec3F(0.5f);     // Box
+		Vec3F rotation = Vec3F(0.0f);        // Box, euler angles like the collision shape construct infos
+	};
+
+	// ================== BATCHES ================ //
+	struct RaycastBatch {
+		QueryFilter filter;
+		std::vector<Vec3F> from;
+		std::vector<Vec3F> to;
+
+		void Add(const Vec3F& in_from, const Vec3F& in_to) { from.push_back(in_from); to.push_back(in_to); }
+		void Clear() { from.clear(); to.clear(); }
+		uint32_t GetCount() const { return (uint32_t)from.size(); }
+	};
+
+	struct SweepBatch {
+		QueryShape shape;
+		QueryFilter filter;
+		std::vector<Vec3F> from;
+		std::vector<Vec3F> to;
+
+		void Add(const Vec3F& in_from, const Vec3F& in_to) { from.push_back(in_from); to.push_back(in_to); }
+		void Clear() { from.clear(); to.clear(); }
+		uint32_t GetCount() const { return (uint32_t)from.size(); }
+	};
+
+	struct OverlapBatch {
+		QueryShape shape;
+		QueryFilter filter;
+		std::vector<Vec3F> position;
+		uint32_t maxResults = SCENE_QUERY_DEFAULT_MAX_OVERLAPS; // Bodies kept per query, extra ones are dropped
+
+		void Add(const Vec3F& in_position) { position.push_back(in_position); }
+		void Clear() { position.clear(); }
+		uint32_t GetCount() const { return (uint32_t)position.size(); }
+	};
+
+	// ================== RESULTS ================ //
+	// Closest hit of every ray/sweep, entry i belongs to query i of the batch. Kept around between
+	// frames so a steady batch size doesnt allocate
+	struct QueryHitResults {
+		std::vector<uint8_t> hit;
+		std::vector<float> fraction; // Along from -> to, 1 when nothing was hit
+		std::vector<Vec3F> point;
+		std::vector<Vec3F> normal;
+		std::vector<RigidBodyHandle> body; // Invalid when the hit object isnt a pooled body
+
+		void Resize(const uint32_t in_count);
+		uint32_t GetCount() const { return (uint32_t)hit.size(); }
+	};
+
+	// Query i owns bodies[i * stride, i * stride + count[i])
+	struct QueryOverlapResults {
+		uint32_t stride = 0;
+		std::vector<uint32_t> count;
+		std::vector<RigidBodyHandle> bodies;
+
+		void Resize(const uint32_t in_count, const uint32_t in_stride);
+		uint32_t GetCount() const { return (uint32_t)count.size(); }
+		const RigidBodyHandle* GetBodies(const uint32_t in_query) const { return bodies.data() + (size_t)in_query * stride; }
+	};
+
+	// ================== SCENE QUERY ================ //
+	// Runs batches of queries against the broadphase's dynamic AABB trees directly, spread across the
+	// thread pool. Every thread walks the trees with its own stack and only reads the world, so
+	// queries must not overlap a physics step (Scene::Update). Call from the main thread
+	class SceneQuery {
+	public:
+		void Initialize(btDiscreteDynamicsWorld* in_pWorld, ThreadPool* in_pThreadPool);
+		void Destroy();
+
+		void Raycast(const RaycastBatch& in_batch, QueryHitResults* out_pResults);
+		void Sweep(const SweepBatch& in_batch, QueryHitResults* out_pResults);
+		void Overlap(const OverlapBatch& in_batch, QueryOverlapResults* out_pResults);
+
+	private:
+		// Traversal stack for the calling thread
+		btAlignedObjectArray<const btDbvtNode*>& GetStack();
+
+		btDbvtBroadphase* m_pBroadphase = nullptr;
+		ThreadPool* m_pThreadPool = nullptr;
+		std::vector<btAlignedObjectArray<const btDbvtNode*>> m_stacks; // One per pool thread
+	};
+}
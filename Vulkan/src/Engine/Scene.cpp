@@ -1,6 +1,10 @@
 #include "Scene.h"
 
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cmath>
+
+#include <Bullet3D/BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
 
 #include "Engine/Camera.h"
 #include "Engine/Graphics/Renderer.h"
@@ -12,29 +16,116 @@ namespace Mega
 	{
 		MEGA_ASSERT(m_pRenderer != nullptr, "Trying to initialize scene without necesarry system Renderer; Set Renderer first");
 		// Initialize Bullet 3D //
-		m_collisionConfiguration = new btDefaultCollisionConfiguration();
-		m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
-		m_overlappingPairCache = new btDbvtBroadphase();
-		m_solver = new btSequentialImpulseConstraintSolver;
+		m_physicsWorld.Initialize(&m_physicsInfo, m_pThreadPool);
+		m_rigidBodyPool.Initialize(m_physicsWorld.GetRawWorld());
+		m_sceneQuery.Initialize(m_physicsWorld.GetRawWorld(), m_pThreadPool);
+
+		m_physicsDebugDraw.SetLines(&m_debugLines);
+		m_physicsWorld.GetRawWorld()->setDebugDrawer(&m_physicsDebugDraw);
+
+		// Entity systems, physics readback first so movement and models see this frame's bodies, then the
+		// hierarchy once every Transform has settled
+		m_transformHierarchy.Initialize(m_pThreadPool);
+		m_systems.Initialize(m_pThreadPool);
+		m_systems.AddSystem(MakeRigidBodyTransformSystem(&m_rigidBodyPool, m_pThreadPool));
+		m_systems.AddSystem(MakeMovementSystem(m_pThreadPool));
+		m_systems.AddSystem(MakeContactDamageSystem(&m_contactEvents, &m_contactDamageInfo));
+		m_systems.AddSystem(MakeHierarchyLocalSystem(&m_transformHierarchy));
+		m_systems.AddSystem(MakeHierarchyUpdateSystem(&m_transformHierarchy));
+		m_systems.AddSystem(MakeHierarchyModelSystem(&m_transformHierarchy));
+		m_systems.AddSystem(MakeModelTransformSystem());
 
-		m_pPhysicsWorld = new btDiscreteDynamicsWorld(m_dispatcher, m_overlappingPairCache, m_solver, m_collisionConfiguration);
-		m_pPhysicsWorld->setGravity(btVector3(0.0, -9.8, 0.0));
+		m_animation.Initialize(m_pThreadPool);
 	}
 
 	void Scene::OnDestroy()
 	{
+		StopPhysicsRecording();
+
+		m_animation.Destroy();
+		m_systems.Destroy();
+		m_entityWorld.Destroy();
+		m_transformHierarchy.Destroy();
+
 		// Cleanup Physics
-		delete m_pPhysicsWorld;
-		delete m_solver;
-		delete m_overlappingPairCache;
-		delete m_dispatcher;
-		delete m_collisionConfiguration;
+		m_sceneQuery.Destroy();
+		m_rigidBodyPool.Destroy();
+		m_physicsWorld.Destroy();
 	}
 
 	void Scene::Update(const float in_dt)
 	{
+		const float frameTime = std::min(in_dt, SCENE_MAX_FRAME_TIME);
+
 		// Update Bullet 3D //
-		m_pPhysicsWorld->stepSimulation(1.0f / 60.0f, 0);
+		m_accumulator += frameTime;
+
+		m_contactEvents.BeginFrame();
+
+		int steps = 0;
+		while (m_accumulator >= m_fixedTimeStep && steps < m_maxSubSteps) {
+			// Keep the state we are stepping away from so rendering can blend between the last two
+			m_rigidBodyPool.BeginStep();
+			m_physicsWorld.StepSimulation(m_fixedTimeStep);
+			m_rigidBodyPool.EndStep();
+			m_contactEvents.GatherStep(m_physicsWorld.GetRawWorld()->getDispatcher(), &m_rigidBodyPool);
+			if (m_physicsRecorder.IsRecording()) { m_physicsRecorder.RecordStep(m_fixedTimeStep); }
+
+			m_accumulator -= m_fixedTimeStep;
+			steps++;
+		}
+
+		// Too far behind to catch up, drop the backlog instead of spiraling into longer and longer frames
+		if (steps == m_maxSubSteps && m_accumulator >= m_fixedTimeStep) {
+			m_accumulator = std::fmod(m_accumulator, m_fixedTimeStep);
+		}
+
+		m_interpolationAlpha = m_accumulator / m_fixedTimeStep;
+		m_contactEvents.EndFrame(m_rigidBodyPool.GetCapacity());
+
+		// Push the moving bodies' transforms into their models, one pass over only what Bullet moved
+		m_rigidBodyPool.SyncTransforms(m_interpolationAlpha);
+
+		// Update Entities //
+		m_systems.Run(m_entityWorld, frameTime);
+
+		// Update Animation //
+		m_animation.Update(frameTime);
+	}
+
+	bool Scene::StartPhysicsRecording(const char* in_filePath)
+	{
+		ResetPhysics();
+
+		if (!m_physicsRecorder.Start(in_filePath, &m_rigidBodyPool, m_physicsInfo.gravity, m_physicsWorld.IsMultithreaded())) { return false; }
+		m_rigidBodyPool.SetRecorder(&m_physicsRecorder);
+
+		return true;
+	}
+
+	void Scene::StopPhysicsRecording()
+	{
+		m_rigidBodyPool.SetRecorder(nullptr);
+		m_physicsRecorder.Stop();
+	}
+
+	void Scene::ResetPhysics()
+	{
+		MEGA_ASSERT(m_rigidBodyPool.GetLiveCount() == 0, "Resetting physics with rigid bodies still alive");
+
+		// A world that has already stepped keeps caches (pairs, manifolds, solver seeds) a fresh one wont have
+		m_sceneQuery.Destroy();
+		m_rigidBodyPool.Destroy();
+		m_physicsWorld.Destroy();
+
+		m_physicsWorld.Initialize(&m_physicsInfo, m_pThreadPool);
+		m_rigidBodyPool.Initialize(m_physicsWorld.GetRawWorld());
+		m_sceneQuery.Initialize(m_physicsWorld.GetRawWorld(), m_pThreadPool);
+		m_physicsWorld.GetRawWorld()->setDebugDrawer(&m_physicsDebugDraw);
+
+		m_contactEvents = ContactEventStream();
+		m_accumulator = 0.0f;
+		m_interpolationAlpha = 1.0f;
 	}
 
 	void Scene::Clear()
@@ -45,6 +136,9 @@ namespace Mega
 
 	void Scene::AddModel(Model* in_pModel)
 	{
+		// Already drawn as part of a static batch
+		if (in_pModel->IsStatic()) { return; }
+
 		uint32_t drawCount = m_pModelDrawList.size();
 
 		if (drawCount >= SCENE_DRAW_LIMIT_MODELS) {
@@ -58,6 +152,25 @@ namespace Mega
 		}
 	}
 
+	void Scene::AddStaticModel(Model* in_pModel)
+	{
+		MEGA_ASSERT(!in_pModel->GetVertexData()->IsSkinned(), "Skinned models can't be baked into static batches");
+		in_pModel->SetStatic(true);
+		m_pStaticModels.push_back(in_pModel);
+	}
+
+	void Scene::BuildStaticBatches(const ConstructInfoStaticBatch* in_pInfo)
+	{
+		m_staticBatches = m_pRenderer->BuildStaticBatches(m_pStaticModels, in_pInfo);
+	}
+
+	void Scene::ClearStaticModels()
+	{
+		for (Model* pModel : m_pStaticModels) { pModel->SetStatic(false); }
+		m_pStaticModels.clear();
+		m_staticBatches.clear();
+	}
+
 	void Scene::AddLight(Light* in_pLight)
 	{
 		uint32_t lightCount = m_pLightDrawList.size();
@@ -74,18 +187,139 @@ namespace Mega
 	}
 	void Scene::Display(const Camera& in_camera)
 	{
+		AddEntityModels();
+		BuildDebugLines();
 		m_pRenderer->DisplayScene(this, in_camera);
+		m_debugLines.Clear();
 	}
 	void Scene::Display()
 	{
+		AddEntityModels();
+		BuildDebugLines();
 		m_pRenderer->DisplayScene(this);
+		m_debugLines.Clear();
 	}
 
-	void Scene::AddRigidBody(std::shared_ptr<RigidBody3D> in_body)
+	void Scene::AddEntityModels()
 	{
-		//assert(in_body->IsInitialized() && "ERROR: Adding an unitialized body to scene");
+		m_entityWorld.ForEach<const ModelRef>([this](const EntityHandle, const ModelRef& in_model) {
+			if (in_model.pModel != nullptr) { AddModel(in_model.pModel); }
+		});
+	}
+
+	void Scene::BuildDebugLines()
+	{
+		int physicsMode = btIDebugDraw::DBG_NoDebug;
+		if (m_debugDrawFlags & SCENE_DEBUG_DRAW_COLLISION_SHAPES) { physicsMode |= btIDebugDraw::DBG_DrawWireframe; }
+		if (m_debugDrawFlags & SCENE_DEBUG_DRAW_PHYSICS_AABBS) { physicsMode |= btIDebugDraw::DBG_DrawAabb; }
+		if (m_debugDrawFlags & SCENE_DEBUG_DRAW_CONTACTS) { physicsMode |= btIDebugDraw::DBG_DrawContactPoints; }
+
+		if (physicsMode != btIDebugDraw::DBG_NoDebug) {
+			m_physicsDebugDraw.setDebugMode(physicsMode);
+			m_physicsWorld.GetRawWorld()->debugDrawWorld();
+		}
+		if (m_debugDrawFlags & SCENE_DEBUG_DRAW_BROADPHASE_TREE) {
+			m_physicsDebugDraw.DrawBroadphaseTree((const btDbvtBroadphase*)m_physicsWorld.GetRawWorld()->getBroadphase(), SCENE_DEBUG_DRAW_TREE_DEPTH);
+		}
+		if (m_debugDrawFlags & SCENE_DEBUG_DRAW_MODEL_BOUNDS) {
+			uint32_t color = DebugLines::PackColor(Vec3F(0.0f, 1.0f, 0.0f));
+			for (const auto& pModel : m_pModelDrawList) { m_debugLines.AddModelBounds(*pModel, color); }
+
+			uint32_t batchColor = DebugLines::PackColor(Vec3F(0.0f, 1.0f, 1.0f));
+			for (const StaticBatch& batch : m_staticBatches) { m_debugLines.AddBox(batch.vertexData.boundsMin, batch.vertexData.boundsMax, batchColor); }
+		}
+		if (m_debugDrawFlags & SCENE_DEBUG_DRAW_LIGHT_RADII) {
+			uint32_t color = DebugLines::PackColor(Vec3F(1.0f, 1.0f, 0.0f));
+			for (const auto& pLight : m_pLightDrawList) { m_debugLines.AddLightRadius(*pLight, color); }
+		}
+		if (m_debugDrawFlags & SCENE_DEBUG_DRAW_PORTALS) {
+			uint32_t cellColor = DebugLines::PackColor(Vec3F(0.5f, 0.5f, 0.5f));
+			for (const PortalCell& cell : m_portalGraph.GetCells()) { m_debugLines.AddBox(cell.boundsMin, cell.boundsMax, cellColor); }
+
+			uint32_t portalColor = DebugLines::PackColor(Vec3F(1.0f, 0.0f, 1.0f));
+			for (const Portal& portal : m_portalGraph.GetPortals()) {
+				for (uint32_t i = 0; i < 4; i++) { m_debugLines.AddLine(portal.corners[i], portal.corners[(i + 1) % 4], portalColor); }
+			}
+		}
+	}
+
+	RigidBodyHandle Scene::CreateRigidBody(const ConstructInfoRigidBody3D* in_pBodyInfo, const ConstructInfoCollisionShape* in_pShapeInfo)
+	{
+		return m_rigidBodyPool.Create(in_pBodyInfo, in_pShapeInfo);
+	}
+
+	RigidBodyHandle Scene::CreateRigidBody(const ConstructInfoRigidBody3D* in_pBodyInfo, const std::vector<ConstructInfoCollisionShape*>& in_shapeInfos)
+	{
+		return m_rigidBodyPool.Create(in_pBodyInfo, in_shapeInfos);
+	}
+
+	void Scene::BindRigidBodyTransform(const RigidBodyHandle in_handle, Model* in_pModel)
+	{
+		RigidBody3D* pBody = m_rigidBodyPool.Get(in_handle);
+		MEGA_ASSERT(pBody != nullptr, "Binding a model to a stale rigid body handle");
+		if (pBody == nullptr) { return; }
+
+		pBody->SetTransformTarget(in_pModel ? in_pModel->GetTransformStorage() : nullptr);
+		pBody->WriteTransformTarget(1.0f);
+	}
+
+	void Scene::DestroyRigidBody(const RigidBodyHandle in_handle)
+	{
+		m_rigidBodyPool.Release(in_handle);
+	}
+
+	EntityHandle Scene::CreatePhysicsEntity(const ConstructInfoRigidBody3D* in_pBodyInfo, const ConstructInfoCollisionShape* in_pShapeInfo, Model* in_pModel)
+	{
+		return AttachPhysicsEntity(CreateRigidBody(in_pBodyInfo, in_pShapeInfo), in_pModel);
+	}
+
+	EntityHandle Scene::CreatePhysicsEntity(const ConstructInfoRigidBody3D* in_pBodyInfo, const std::vector<ConstructInfoCollisionShape*>& in_shapeInfos, Model* in_pModel)
+	{
+		return AttachPhysicsEntity(CreateRigidBody(in_pBodyInfo, in_shapeInfos), in_pModel);
+	}
+
+	EntityHandle Scene::AttachPhysicsEntity(const RigidBodyHandle in_body, Model* in_pModel)
+	{
+		const RigidBody3D* pBody = m_rigidBodyPool.Get(in_body);
+
+		Transform transform;
+		transform.position = pBody->GetMotionStatePosition();
+		transform.rotation = pBody->GetMotionStateRotation();
+
+		if (in_pModel == nullptr) { return m_entityWorld.Create(transform, Health(), RigidBodyRef{ in_body }); }
+
+		BindRigidBodyTransform(in_body, in_pModel);
+		transform.scale = in_pModel->GetScale();
+		return m_entityWorld.Create(transform, Health(), RigidBodyRef{ in_body }, ModelRef{ in_pModel });
+	}
+
+	void Scene::DestroyEntity(const EntityHandle in_entity)
+	{
+		const RigidBodyRef* pBody = m_entityWorld.Get<RigidBodyRef>(in_entity);
+		if (pBody != nullptr && pBody->handle.IsValid()) { DestroyRigidBody(pBody->handle); }
+
+		const TransformNodeRef* pNode = m_entityWorld.Get<TransformNodeRef>(in_entity);
+		if (pNode != nullptr && m_transformHierarchy.IsAlive(pNode->node)) { m_transformHierarchy.Destroy(pNode->node); }
+
+		m_entityWorld.Destroy(in_entity);
+	}
+
+	TransformNode Scene::AttachTransformNode(const EntityHandle in_entity, const EntityHandle in_parent)
+	{
+		MEGA_ASSERT(!m_entityWorld.Has<TransformNodeRef>(in_entity), "Entity is already in the transform hierarchy");
+
+		TransformNode parent;
+		if (m_entityWorld.IsAlive(in_parent)) {
+			const TransformNodeRef* pParentNode = m_entityWorld.Get<TransformNodeRef>(in_parent);
+			MEGA_ASSERT(pParentNode != nullptr, "Parent entity isnt in the transform hierarchy");
+			parent = pParentNode->node;
+		}
+
+		// The local transform comes from the entity's Transform on the next Update
+		TransformNodeRef nodeRef;
+		nodeRef.node = m_transformHierarchy.Create(Mat4x4F(1.0f), parent);
+		m_entityWorld.Add(in_entity, nodeRef);
 
-		m_pPhysicsWorld->addRigidBody(in_body->GetRawRigidBody());
-		m_rigidBodies.push_back(in_body);
+		return nodeRef.node;
 	}
 }
\ No newline at end of file
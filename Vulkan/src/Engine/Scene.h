@@ -7,12 +7,36 @@
 
 #include "Engine/Core/SystemGuard.h"
 #include "Engine/Physics/RigidBody.h"
+#include "Engine/Physics/PhysicsWorld.h"
+#include "Engine/Physics/RigidBodyPool.h"
+#include "Engine/Physics/ContactEvents.h"
+#include "Engine/Physics/SceneQuery.h"
+#include "Engine/Physics/PhysicsDebugDraw.h"
+#include "Engine/Physics/PhysicsRecorder.h"
+#include "Engine/ECS/ECS.h"
+#include "Engine/Animation/AnimationSystem.h"
+#include "Engine/Graphics/Objects/DebugLines.h"
 #include "Engine/Graphics/Renderer.h"
+#include "Engine/Graphics/PortalGraph.h"
 #include "Engine/Graphics/Objects/ModelData.h"
 
 #define SCENE_DRAW_LIMIT_MODELS uint32_t(100)
 #define SCENE_DRAW_LIMIT_SHAPES uint32_t(100)
 
+#define SCENE_DEFAULT_FIXED_TIME_STEP (1.0f / 60.0f)
+#define SCENE_DEFAULT_MAX_SUB_STEPS   5
+#define SCENE_MAX_FRAME_TIME          0.25f // Any frame longer than this (breakpoints, window drags) is clamped
+
+// What Display adds to the debug lines on top of whatever was added by hand
+#define SCENE_DEBUG_DRAW_COLLISION_SHAPES uint32_t(1)
+#define SCENE_DEBUG_DRAW_PHYSICS_AABBS    uint32_t(2)
+#define SCENE_DEBUG_DRAW_CONTACTS         uint32_t(4)
+#define SCENE_DEBUG_DRAW_BROADPHASE_TREE  uint32_t(8)
+#define SCENE_DEBUG_DRAW_MODEL_BOUNDS     uint32_t(16)
+#define SCENE_DEBUG_DRAW_LIGHT_RADII      uint32_t(32)
+#define SCENE_DEBUG_DRAW_PORTALS          uint32_t(64)
+#define SCENE_DEBUG_DRAW_TREE_DEPTH       8
+
 struct GLFWwindow;
 namespace Mega
 {
@@ -20,6 +44,7 @@ namespace Mega
 	class Renderer;
 	class Camera;
 	class Model;
+	class ThreadPool;
 	struct Light;
 }
 
@@ -33,37 +58,131 @@ namespace Mega
 		void OnInitialize() override;
 		void OnDestroy() override;
 
+		// Advances physics in fixed steps, in_dt is the real frame time in seconds
 		void Update(const float in_dt);
 
+		void SetFixedTimeStep(const float in_step) { m_fixedTimeStep = in_step; }
+		float GetFixedTimeStep() const { return m_fixedTimeStep; }
+		void SetMaxSubSteps(const int in_maxSubSteps) { m_maxSubSteps = in_maxSubSteps; }
+		int GetMaxSubSteps() const { return m_maxSubSteps; }
+		// How far between the previous and current physics state the renderer should draw, in [0, 1]
+		float GetInterpolationAlpha() const { return m_interpolationAlpha; }
+
 		void Clear();
+		// Static models are drawn every frame without being added again. They are baked (moved into world
+		// space and merged by cell and texture) by BuildStaticBatches, so they can't move after that
 		void AddModel(Model* in_pModel);
+		void AddStaticModel(Model* in_pModel);
+		// Call once the level is loaded, and again after adding or removing static models
+		void BuildStaticBatches(const ConstructInfoStaticBatch* in_pInfo = nullptr);
+		void ClearStaticModels();
+		const std::vector<StaticBatch>& GetStaticBatches() const { return m_staticBatches; }
 		void AddLight(Light* in_pLight);
+		// Cells and portals of an indoor level, leave it empty for outdoor levels (no portal culling)
+		PortalGraph& GetPortalGraph() { return m_portalGraph; }
+		const PortalGraph& GetPortalGraph() const { return m_portalGraph; }
 		void Display(const Camera& in_camera);
 		void Display();
 
-		void AddRigidBody(std::shared_ptr<RigidBody3D> in_body);
+		RigidBodyHandle CreateRigidBody(const ConstructInfoRigidBody3D* in_pBodyInfo, const ConstructInfoCollisionShape* in_pShapeInfo);
+		RigidBodyHandle CreateRigidBody(const ConstructInfoRigidBody3D* in_pBodyInfo, const std::vector<ConstructInfoCollisionShape*>& in_shapeInfos);
+		void DestroyRigidBody(const RigidBodyHandle in_handle);
+		// The scene's transform sync keeps in_pModel's world matrix on the body, the model must outlive the binding
+		void BindRigidBodyTransform(const RigidBodyHandle in_handle, Model* in_pModel);
+		RigidBody3D* GetRigidBody(const RigidBodyHandle in_handle) { return m_rigidBodyPool.Get(in_handle); }
+
+		// Entities are updated by the scene's systems at the end of every Update, and every ModelRef is drawn by Display
+		EntityWorld& GetEntityWorld() { return m_entityWorld; }
+		SystemScheduler& GetSystems() { return m_systems; }
+		// Transform, Health and a pooled rigid body, plus a ModelRef the body drives when in_pModel is set
+		EntityHandle CreatePhysicsEntity(const ConstructInfoRigidBody3D* in_pBodyInfo, const ConstructInfoCollisionShape* in_pShapeInfo, Model* in_pModel = nullptr);
+		EntityHandle CreatePhysicsEntity(const ConstructInfoRigidBody3D* in_pBodyInfo, const std::vector<ConstructInfoCollisionShape*>& in_shapeInfos, Model* in_pModel = nullptr);
+		// Releases the entity's rigid body and transform node too
+		void DestroyEntity(const EntityHandle in_entity);
+		// Puts in_entity in the transform hierarchy under in_parent (which has to have a node already, or
+		// be invalid for a root). Its Transform, if it has one, becomes the local transform
+		TransformNode AttachTransformNode(const EntityHandle in_entity, const EntityHandle in_parent = EntityHandle());
+		TransformHierarchy& GetTransformHierarchy() { return m_transformHierarchy; }
+
+		// Skeletal animation, clips advance in Update and are evaluated into the bone palette by Display
+		AnimationSystem& GetAnimation() { return m_animation; }
+
+		// Contacts from the physics steps taken in the last Update
+		const ContactEventStream& GetContactEvents() const { return m_contactEvents; }
+		ContactEventRange GetContactEvents(const RigidBodyHandle in_handle) const { return m_contactEvents.GetEvents(in_handle); }
+		bool HasContact(const RigidBodyHandle in_bodyA, const RigidBodyHandle in_bodyB) const { return m_contactEvents.HasContact(in_bodyA, in_bodyB); }
+		// How hard hits hurt physics entities (their Health), applied by the scene's ContactDamage system
+		ContactDamageInfo& GetContactDamageInfo() { return m_contactDamageInfo; }
+
+		// Batched world queries (picking, aiming, line of sight), run across the thread pool. Results are
+		// indexed like the batch, only valid between Updates
+		void Raycast(const RaycastBatch& in_batch, QueryHitResults* out_pResults) { m_sceneQuery.Raycast(in_batch, out_pResults); }
+		void Sweep(const SweepBatch& in_batch, QueryHitResults* out_pResults) { m_sceneQuery.Sweep(in_batch, out_pResults); }
+		void Overlap(const OverlapBatch& in_batch, QueryOverlapResults* out_pResults) { m_sceneQuery.Overlap(in_batch, out_pResults); }
+
+		// Lines drawn on top of the scene this frame, cleared after every Display
+		DebugLines& GetDebugLines() { return m_debugLines; }
+		void SetDebugDrawFlags(const uint32_t in_flags) { m_debugDrawFlags = in_flags; }
+		uint32_t GetDebugDrawFlags() const { return m_debugDrawFlags; }
 
 		VertexData LoadOBJ(const char* in_filePath) { return m_pRenderer->LoadOBJ(in_filePath); }
 		TextureData LoadTexture(const char* in_filePath) { return m_pRenderer->LoadTexture(in_filePath); }
+		VertexData LoadSkinnedMesh(const SkinnedMeshData& in_mesh) { return m_pRenderer->LoadSkinnedMesh(in_mesh); }
+
+		// Logs every physics input and step to in_filePath for RunPhysicsReplay. Rebuilds the physics world
+		// first so the replay starts from the same state, so no bodies may exist yet
+		bool StartPhysicsRecording(const char* in_filePath);
+		void StopPhysicsRecording();
+		bool IsRecordingPhysics() const { return m_physicsRecorder.IsRecording(); }
+
+		PhysicsWorld& GetPhysicsWorld() { return m_physicsWorld; }
+		RigidBodyPool& GetRigidBodyPool() { return m_rigidBodyPool; }
 
 	private:
 		void SetRenderer(Renderer* in_pRenderer) { m_pRenderer = in_pRenderer; }
+		void SetThreadPool(ThreadPool* in_pThreadPool) { m_pThreadPool = in_pThreadPool; }
+		void SetPhysicsInfo(const ConstructInfoPhysicsWorld& in_info) { m_physicsInfo = in_info; }
 		std::vector<Model*>& GetModelDrawList() { return m_pModelDrawList; }
 		std::vector<Light*>& GetLightDrawList() { return m_pLightDrawList; }
+		void BuildDebugLines();
+		void ResetPhysics();
+		void AddEntityModels();
+		EntityHandle AttachPhysicsEntity(const RigidBodyHandle in_body, Model* in_pModel);
 
 		// Graphics
 		Renderer* m_pRenderer = nullptr;
 
 		std::vector<Model*> m_pModelDrawList;
 		std::vector<Light*> m_pLightDrawList;
+		std::vector<Model*> m_pStaticModels;
+		std::vector<StaticBatch> m_staticBatches;
+		PortalGraph m_portalGraph;
 
-		// Physics
-		btDiscreteDynamicsWorld* m_pPhysicsWorld; // Basically a container for rigid bodies
-		std::vector<std::shared_ptr<RigidBody3D>> m_rigidBodies;
+		DebugLines m_debugLines;
+		uint32_t m_debugDrawFlags = 0;
 
-		btDefaultCollisionConfiguration* m_collisionConfiguration;
-		btCollisionDispatcher* m_dispatcher;
-		btBroadphaseInterface* m_overlappingPairCache;
-		btSequentialImpulseConstraintSolver* m_solver;
+		// Physics
+		ThreadPool* m_pThreadPool = nullptr;
+		ConstructInfoPhysicsWorld m_physicsInfo;
+		PhysicsWorld m_physicsWorld;
+		RigidBodyPool m_rigidBodyPool;
+		ContactEventStream m_contactEvents;
+		ContactDamageInfo m_contactDamageInfo;
+		SceneQuery m_sceneQuery;
+		PhysicsDebugDraw m_physicsDebugDraw;
+		PhysicsRecorder m_physicsRecorder;
+
+		// Entities
+		EntityWorld m_entityWorld;
+		SystemScheduler m_systems;
+		TransformHierarchy m_transformHierarchy;
+
+		// Animation
+		AnimationSystem m_animation;
+
+		float m_fixedTimeStep = SCENE_DEFAULT_FIXED_TIME_STEP;
+		int m_maxSubSteps = SCENE_DEFAULT_MAX_SUB_STEPS;
+		float m_accumulator = 0.0f;
+		float m_interpolationAlpha = 1.0f;
 	};
 }
\ No newline at end of file
@@ -1,18 +1,18 @@
 #pragma once
 
 #include "Engine/Engine.h"
-#include "Engine/Entity.h"
-#include "Engine/PhysicsEntity.h"
+#include "Engine/Scene.h"
+#include "Engine/ECS/ECS.h"
 #include <ImGui/imgui.h>
 #include "ImGui/Graphics/imgui_impl_glfw.h"
 #include "ImGui/Graphics/imgui_impl_vulkan.h"
 
 namespace Mega
 {
-	static Engine CreateEngine()
+	static Engine CreateEngine(const ConstructInfoEngine* in_pInfo = nullptr)
 	{
 		Engine out_engine;
-		out_engine.Initialize();
+		out_engine.Initialize(in_pInfo);
 
 		return out_engine;
 	}
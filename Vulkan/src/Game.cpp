@@ -8,6 +8,9 @@ float dir[3] = { 0.0f, 0.0f, 0.0f };
 float pos[3] = { 0.0f, 2.0f, 0.0f };
 float speed = 0.00002f;
 float col[3] = { 1.0f, 1.0f, 1.0f };
+bool drawCollision = false;
+bool drawBounds = false;
+bool drawPortals = false;
 
 void Game::Esc() {
 	m_paused = !m_paused;
@@ -23,7 +26,7 @@ void Game::Esc() {
 	}
 }
 
-void Game::Initialize()
+void Game::Initialize(const char* in_physicsRecordPath)
 {
 	// Initialze Graphics
 	m_engine = Mega::CreateEngine();
@@ -31,13 +34,38 @@ void Game::Initialize()
 	m_pScene = m_engine.GetScene();
 	m_pWindow = m_engine.GetApplicationWindow();
 
-	m_tankBody = Mega::Model(m_pRenderer->LoadOBJ("Assets/Models/wiiTankBody1.obj"));
-	m_tankTurret = Mega::Model(m_pRenderer->LoadOBJ("Assets/Models/wiiTankTurret1.obj"));
+	std::vector<Mega::VertexData> tankMeshes = m_pRenderer->LoadOBJs({ "Assets/Models/wiiTankBody1.obj", "Assets/Models/wiiTankTurret1.obj" });
+	m_tankBody = Mega::Model(tankMeshes[0]);
+	m_tankTurret = Mega::Model(tankMeshes[1]);
+	m_tankBody.SetOccluder(true);
+
+	// The turret rides on the body, moving the tank entity moves both
+	Mega::EntityWorld& entities = m_pScene->GetEntityWorld();
+	m_tankEntity = entities.Create(Mega::Transform(), Mega::ModelRef{ &m_tankBody });
+	m_pScene->AttachTransformNode(m_tankEntity);
+	m_turretEntity = entities.Create(Mega::Transform(), Mega::ModelRef{ &m_tankTurret });
+	m_pScene->AttachTransformNode(m_turretEntity, m_tankEntity);
+
+	// A field of parked tanks, a few hundred models that only cost a few draws once batched
+	m_staticProps.resize(GAME_STATIC_PROP_ROWS * GAME_STATIC_PROP_ROWS);
+	for (uint32_t i = 0; i < m_staticProps.size(); i++) {
+		Mega::Model& prop = m_staticProps[i];
+		prop = Mega::Model(i % 2 == 0 ? tankMeshes[0] : tankMeshes[1]);
+		prop.SetPosition(Mega::Vec3F((float)(i % GAME_STATIC_PROP_ROWS), 0.0f, (float)(i / GAME_STATIC_PROP_ROWS)) * GAME_STATIC_PROP_SPACING + Mega::Vec3F(10.0f, 0.0f, 10.0f));
+		prop.SetRotation(Mega::Vec3F(0.0f, (float)i * 0.7f, 0.0f));
+		m_pScene->AddStaticModel(&prop);
+	}
+	m_pScene->BuildStaticBatches();
+
+	// Cooked with --cook-portals, the level is drawn without portal culling when it isn't there
+	if (std::ifstream(GAME_PORTAL_LEVEL_PATH).good()) { m_pScene->GetPortalGraph().LoadCooked(GAME_PORTAL_LEVEL_PATH); }
+
+	// Has to start before any bodies exist
+	if (in_physicsRecordPath != nullptr) { m_pScene->StartPhysicsRecording(in_physicsRecordPath); }
 
 	Mega::ConstructInfoRigidBody3D bodyInfo;
 	Mega::ConstructInfoCollisionBox shapeInfo;
-	m_tankPhysicsBody = Mega::PhysicsEntity();
-	m_tankPhysicsBody.Initialize(&bodyInfo, &shapeInfo, m_pScene);
+	m_tankPhysicsBody = m_pScene->CreatePhysicsEntity(&bodyInfo, &shapeInfo);
 }
 
 void Game::Destroy()
@@ -47,29 +75,22 @@ void Game::Destroy()
 
 void Game::Run()
 {
+	m_framePacer.Initialize();
+	m_framePacer.SetPresentLimit(m_pRenderer->IsPresentVsyncLimited(), m_pRenderer->GetDisplayRefreshRate());
 	SetFrameRate(eFPS::DEFAULT);
+
 	glfwSetCursorPos(m_pWindow, m_mouseFreezePos.x, m_mouseFreezePos.y);
+	m_framePacer.Start();
 	while (!glfwWindowShouldClose(m_pWindow)) {
-		auto startTime = std::chrono::high_resolution_clock::now();
-
+		m_pRenderer->BeginFrame();
 		HandleEvents();
 		Update(m_dt);
 		Draw();
-		auto endTime = std::chrono::high_resolution_clock::now();
-
-		//auto deltaTime = startTime - endTime;
-		auto deltaTime = endTime - startTime;
-		if (deltaTime < m_targetTime) {
-			auto remainingTime = m_targetTime - deltaTime - std::chrono::milliseconds(7);
-			if (remainingTime > std::chrono::milliseconds(0)) {
-				std::this_thread::sleep_for(remainingTime);
 
-				while ((std::chrono::high_resolution_clock::now() - startTime) < m_targetTime) {}
-			}
-		}
-		m_dt = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
-		//std::cout << m_dt << std::endl;
+		m_dt = m_framePacer.EndFrame();
 	}
+
+	m_framePacer.Destroy();
 }
 
 void Game::HandleEvents()
@@ -115,7 +136,7 @@ void Game::Update(const float in_dt)
 	}
 
 	// Update
-	m_pScene->Update(in_dt);
+	m_pScene->Update(in_dt / 1000.0f);
 }	
 
 void Game::Draw()
@@ -218,7 +239,35 @@ void Game::Draw()
 	ImGui::Unindent();
 	*/
 
-	ImGui::SliderFloat("FPS: ", &m_dt, 1, 1000);
+	Mega::FramePacingStats pacing = m_framePacer.GetStats();
+	ImGui::Text("Frame: %.2fms (%.0f FPS)", m_dt, m_dt > 0.0f ? 1000.0f / m_dt : 0.0f);
+	ImGui::Text("Pacing error p50/p95/p99: %.0f / %.0f / %.0f us%s", pacing.p50, pacing.p95, pacing.p99, pacing.presentLimited ? " (vsync)" : "");
+	ImGui::Text("Sleep slack: %.0f us", pacing.sleepSlack);
+
+	// Flip this to compare throughput and latency with and without the render thread
+	Mega::RenderPipelineStats pipeline = m_pRenderer->GetPipelineStats();
+	bool pipelined = pipeline.pipelined;
+	if (ImGui::Checkbox("Render thread", &pipelined)) { m_pRenderer->SetPipelined(pipelined); }
+	ImGui::Text("Simulation: %.2fms (%.2fms waiting on render), render: %.2fms (%.2fms recording)", pipeline.simulationFrame, pipeline.simulationWait, pipeline.renderFrame, pipeline.renderWork);
+	ImGui::Text("Latency: %.2fms (worst %.2fms), dropped snapshots: %llu", pipeline.latency, pipeline.latencyWorst, (unsigned long long)pipeline.droppedSnapshots);
+	ImGui::Text("Triangles: %llu full detail, %llu after LOD", (unsigned long long)pipeline.trianglesFull, (unsigned long long)pipeline.trianglesDrawn);
+	ImGui::Text("Portals: %u draws in hidden cells", pipeline.portalCulledDraws);
+	ImGui::Text("Cpu occlusion: %u draws hidden", pipeline.cpuOccludedDraws);
+	if (pipeline.occlusionCulling) {
+		ImGui::Text("Occlusion: %u draws hidden, %u recovered in the second pass", pipeline.occludedDraws, pipeline.recoveredDraws);
+	}
+	else {
+		ImGui::Text("Occlusion: off");
+	}
+	ImGui::Text("Skinning: %u vertices", pipeline.skinnedVertices);
+	for (const Mega::RenderPassStats& pass : pipeline.passes) {
+		if (pass.culled) { ImGui::Text("  %s: culled", pass.name.c_str()); }
+		else { ImGui::Text("  %s: %.3fms", pass.name.c_str(), pass.gpuTime); }
+	}
+	ImGui::Text("Transients: %llu KB aliased into %llu KB", (unsigned long long)(pipeline.transientBytes / 1024), (unsigned long long)(pipeline.transientAllocatedBytes / 1024));
+	const Mega::AnimationSystem& animation = m_pScene->GetAnimation();
+	ImGui::Text("Animation LOD: %u full, %u throttled, %u reduced, %u frozen", animation.GetLodCount(Mega::eAnimationLod::Full),
+		animation.GetLodCount(Mega::eAnimationLod::Throttled), animation.GetLodCount(Mega::eAnimationLod::Reduced), animation.GetLodCount(Mega::eAnimationLod::Frozen));
 
 	ImGui::DragFloat3("Offset: ", pos, 0.01f);
 	ImGui::DragFloat3("Color: ", col, 0.01f);
@@ -233,14 +282,24 @@ void Game::Draw()
 	ImGui::SliderFloat("AO: ", &m_ambientLight.specular, 0.0f, 1.0f);
 	ImGui::SliderFloat("Strength: ", &m_ambientLight.strength, 0.0f, 10.0f);
 
+	Mega::Transform* pTank = m_pScene->GetEntityWorld().Get<Mega::Transform>(m_tankEntity);
+	Mega::Transform* pTurret = m_pScene->GetEntityWorld().Get<Mega::Transform>(m_turretEntity);
+	ImGui::DragFloat3("Tank position: ", &pTank->position.x, 0.01f);
+	ImGui::SliderAngle("Tank yaw: ", &pTank->rotation.y);
+	ImGui::SliderAngle("Turret yaw: ", &pTurret->rotation.y);
+
+	ImGui::Checkbox("Draw collision", &drawCollision);
+	ImGui::Checkbox("Draw bounds", &drawBounds);
+	ImGui::Checkbox("Draw portals", &drawPortals);
+	m_pScene->SetDebugDrawFlags((drawCollision ? SCENE_DEBUG_DRAW_COLLISION_SHAPES : 0) | (drawBounds ? SCENE_DEBUG_DRAW_MODEL_BOUNDS | SCENE_DEBUG_DRAW_LIGHT_RADII : 0) |
+		(drawPortals ? SCENE_DEBUG_DRAW_PORTALS : 0));
+
 
 	// ========================================== //
 
 	m_pScene->Clear();
 
 	m_pScene->AddLight(&m_ambientLight);
-	m_pScene->AddModel(&m_tankBody);
-	m_pScene->AddModel(&m_tankTurret);
 	
 	ImGui::Render();
 	m_pScene->Display(m_camera);
@@ -4,11 +4,16 @@
 #include <thread>
 #include <memory>
 #include <iostream>
+#include <fstream>
+#include <vector>
 
 #include "Engine/SuperUltraMega.h"
 
 #define RIGID_BODY_SCALE 1.0f, 1.0f, 1.0f
 #define CUBE_DIM Vec3(1, 1, 1)
+#define GAME_STATIC_PROP_ROWS    uint32_t(16)
+#define GAME_STATIC_PROP_SPACING 6.0f
+#define GAME_PORTAL_LEVEL_PATH   "Assets/Levels/KuatDriveYardsSegment.level"
 
 enum class eFPS {
 	DEFAULT,
@@ -23,7 +28,8 @@ public:
 	using Mat4 = Mega::Mat4x4F;
 	using btVec3 = btVector3;
 
-	void Initialize();
+	// in_physicsRecordPath logs the session's physics for RunPhysicsReplay
+	void Initialize(const char* in_physicsRecordPath = nullptr);
 	void Destroy();
 
 	void Run();
@@ -31,27 +37,27 @@ public:
 	void Update(const float in_dt);
 	void Draw();
 
-	std::shared_ptr<Mega::Entity> AddClone(Vec3 pos);
+	Mega::EntityHandle AddClone(Vec3 pos);
 	void Esc();
 
-	float GetFrameRate() const { return std::chrono::duration<float, std::milli>(m_targetTime).count(); }
+	float GetFrameRate() const { return std::chrono::duration<float, std::milli>(m_framePacer.GetTargetInterval()).count(); }
 	void  SetFrameRate(const float in_frameRate) {
 		if (in_frameRate == 0.0f) { SetFrameRate(eFPS::MAX); }
-		else { m_targetTime = std::chrono::milliseconds((int)(1000.0f / in_frameRate)); }
+		else { m_framePacer.SetTargetFrameRate(in_frameRate); }
 	}
 	void  SetFrameRate(const eFPS& in_fpsSetting) {
 		m_fpsSetting = in_fpsSetting;
 
 		switch (m_fpsSetting) {
 		case (eFPS::DEFAULT):
-			m_targetTime = std::chrono::milliseconds((int)(1000.0f / 60.0f));
+			m_framePacer.SetTargetFrameRate(60.0);
 			break;
 		case (eFPS::MAX):
-			m_targetTime = std::chrono::milliseconds(0);
+			m_framePacer.SetTargetFrameRate(0.0);
 			std::cout << "MAXED OUT BABY" << std::endl;
 			break;
 		default:
-			m_targetTime = std::chrono::milliseconds((int)(1000.0f / 60.0f));
+			m_framePacer.SetTargetFrameRate(60.0);
 			m_fpsSetting = eFPS::DEFAULT;
 		}
 	}
@@ -66,12 +72,15 @@ private:
 
 	Mega::Model m_tankBody;
 	Mega::Model m_tankTurret;
+	std::vector<Mega::Model> m_staticProps; // Baked into the scene's static batches, can't move
 
 	Mega::Light m_ambientLight;
-	Mega::PhysicsEntity m_tankPhysicsBody;
+	Mega::EntityHandle m_tankPhysicsBody;
+	Mega::EntityHandle m_tankEntity;
+	Mega::EntityHandle m_turretEntity; // Child of m_tankEntity in the transform hierarchy
 
 	// Engine
-	std::chrono::milliseconds m_targetTime = std::chrono::milliseconds(0);
+	Mega::FramePacer m_framePacer;
 	eFPS m_fpsSetting;
 	float m_dt = 0.0f;
 
@@ -1,6 +1,12 @@
 #include <windows.h>
 
 #include "Game.h"
+#include "Engine/Core/JobBenchmark.h"
+#include "Engine/Physics/PhysicsBenchmark.h"
+#include "Engine/Physics/PhysicsReplay.h"
+#include "Engine/Graphics/PortalGraph.h"
+#include "Engine/Animation/AnimationCooker.h"
+#include "Engine/Core/ThreadPool.h"
 
 // Questions:
 // - What does he mean by this: "This is an optional parameter that allows you to specify callbacks for a custom memory allocator. We will ignore this parameter in the tutorial and always pass nullptr as argument."
@@ -21,12 +27,8 @@
 // - Not breaking when cant find texture path/load texture
 // - Why does c++ forbid containers filled with const elements
 // - 1476 have vulkan's push constant be the same types as the models, or the other way
-// - Decide if bodies need a pointer to scene scene.cpp AddRigidBody() / nvm they do because if the scene has a shared ptr to it it needs to auto be removed in Body::Destroy()
-// - Match physics step with game loop
 // - Somehow use bullet 3d's ability to return a indentity matrix
 // - Fix GetMotionStateRotation(), so much copying, return Vec3 not btVec3
-// - Fix calculate inertia
-// - Fix HasCollidedWith(), should rigid body have a copy of scene
 // - Fix bad weak pointer when with renderer->DrawFrame(shared_from_this()) in scene
 // - Maybe make the vector of Models to draw an array thats already the size of DRAW_LIMIT
 // - Have guis or over the top drawing use a different pipeline so u can have low graphics in the game and high in guis
@@ -46,13 +48,80 @@
 //
 // - Did not add sfml dlls to includes in project props
 
-int main() {
+int main(int argc, char** argv) {
 	// HWND hWnd = GetConsoleWindow();
 	// ShowWindow(hWnd, SW_HIDE);
 
+	// Headless tools
+	for (int i = 1; i < argc; i++) {
+		if (std::string(argv[i]) == "--physics-benchmark") {
+			Mega::ConstructInfoPhysicsBenchmark benchmarkInfo;
+			if (i + 1 < argc) { benchmarkInfo.maxThreads = (uint32_t)std::atoi(argv[i + 1]); }
+
+			Mega::RunPhysicsBenchmark(&benchmarkInfo);
+			return EXIT_SUCCESS;
+		}
+		if (std::string(argv[i]) == "--job-benchmark") {
+			Mega::ConstructInfoJobBenchmark benchmarkInfo;
+			if (i + 1 < argc) { benchmarkInfo.maxThreads = (uint32_t)std::atoi(argv[i + 1]); }
+
+			Mega::RunJobBenchmark(&benchmarkInfo);
+			return EXIT_SUCCESS;
+		}
+		if (std::string(argv[i]) == "--cook-portals" && i + 2 < argc) {
+			// Tagged OBJ in, cooked level with its PVS out
+			Mega::PortalGraph portalGraph;
+			if (!portalGraph.LoadTaggedOBJ(argv[i + 1])) { return EXIT_FAILURE; }
+
+			Mega::ConstructInfoPortalBake bakeInfo;
+			if (i + 3 < argc) { bakeInfo.maxDepth = (uint32_t)std::atoi(argv[i + 3]); }
+
+			Mega::ThreadPool threadPool;
+			threadPool.Initialize(Mega::ThreadPool::GetDefaultWorkerCount());
+			portalGraph.BakePVS(&bakeInfo, &threadPool);
+			threadPool.Destroy();
+
+			return portalGraph.SaveCooked(argv[i + 2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		if (std::string(argv[i]) == "--cook-animation" && i + 2 < argc) {
+			// FBX in, ozz skeleton and clip archives out
+			Mega::ConstructInfoAnimationCook cookInfo;
+			cookInfo.sourcePath = argv[i + 1];
+			cookInfo.outputDir = argv[i + 2];
+			if (i + 3 < argc) { cookInfo.tolerance = (float)std::atof(argv[i + 3]); }
+			if (i + 4 < argc) { cookInfo.distance = (float)std::atof(argv[i + 4]); }
+
+			return Mega::CookAnimations(&cookInfo) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		if (std::string(argv[i]) == "--physics-replay") {
+			Mega::ConstructInfoPhysicsReplay replayInfo;
+			if (i + 1 < argc) { replayInfo.filePath = argv[i + 1]; }
+			if (i + 2 < argc) {
+				// Whole non negative number or nothing, atoi would quietly turn a typo into 0 (all cores)
+				char* pEnd = nullptr;
+				unsigned long threadCount = std::strtoul(argv[i + 2], &pEnd, 10);
+				if (argv[i + 2][0] < '0' || argv[i + 2][0] > '9' || *pEnd != '\0' || threadCount > UINT32_MAX) { replayInfo.filePath = nullptr; }
+
+				replayInfo.multithreaded = true;
+				replayInfo.threadCount = (uint32_t)threadCount;
+			}
+			if (replayInfo.filePath == nullptr) {
+				std::cout << "Usage: --physics-replay <recording> [thread count, 0 = all cores, runs the multithreaded world]" << std::endl;
+				return EXIT_FAILURE;
+			}
+
+			return Mega::RunPhysicsReplay(&replayInfo) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	const char* physicsRecordPath = nullptr;
+	for (int i = 1; i + 1 < argc; i++) {
+		if (std::string(argv[i]) == "--physics-record") { physicsRecordPath = argv[i + 1]; }
+	}
+
 	std::shared_ptr<Game> game = std::make_shared<Game>();
 	
-	game->Initialize();
+	game->Initialize(physicsRecordPath);
 	
 	try {
 		game->Run();